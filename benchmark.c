@@ -0,0 +1,2082 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "bidirectional_concurrent_hash_map.h"
+#include "bidirectional_frozen_hash_map.h"
+#include "bidirectional_hash_map.h"
+#include "bidirectional_hash_map_2.h"
+#include "bidirectional_hash_map_key_functions.h"
+#include "bidirectional_int_map.h"
+#include "bidirectional_open_hash_map.h"
+#include "bidirectional_snapshot_hash_map.h"
+#include "bidirectional_static_hash_map.h"
+#include "bidirectional_typed_hash_map.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**************************************************
+* The number of mappings each benchmark works on. *
+**************************************************/
+#define BENCHMARK_MAPPINGS (1 << 20)
+
+/*****************************************************************
+* The number of mappings of the heavy collision workload. All of *
+* them land in 16 buckets.                                       *
+*****************************************************************/
+#define COLLIDING_MAPPINGS (1 << 14)
+
+/********************************************************
+* The number of strings of the string key workloads.    *
+********************************************************/
+#define STRING_KEYS (1 << 17)
+
+/*********************************************************************
+* The number of mappings the concurrent benchmark preloads, and the  *
+* number of operations all its threads perform together.             *
+*********************************************************************/
+#define CONCURRENT_MAPPINGS   (1 << 18)
+#define CONCURRENT_OPERATIONS (1 << 21)
+
+/*************************************************************
+* The largest number of threads of the concurrent benchmark. *
+*************************************************************/
+#define MAXIMUM_BENCHMARK_THREADS 64
+
+static size_t primary_key_hasher(void* key)
+{
+    return (size_t) key;
+}
+
+static size_t secondary_key_hasher(void* key)
+{
+    return (size_t) key;
+}
+
+static int primary_key_equality(void* a, void* b)
+{
+    return a == b;
+}
+
+static int secondary_key_equality(void* a, void* b)
+{
+    return a == b;
+}
+
+static size_t colliding_key_hasher(void* key)
+{
+    return (size_t) key & 0xF;
+}
+
+static int key_compare(void* a, void* b)
+{
+    return ((size_t) a > (size_t) b) - ((size_t) a < (size_t) b);
+}
+
+/********************************************************************
+* A typical hand-written string hasher: FNV-1a, one byte at a time. *
+********************************************************************/
+static size_t fnv1a_string_hasher(void* key)
+{
+    const unsigned char* bytes = (const unsigned char*) key;
+    size_t hash = (size_t) 2166136261UL;
+    
+    while (*bytes)
+    {
+        hash ^= *bytes++;
+        hash *= (size_t) 16777619UL;
+    }
+    
+    return hash;
+}
+
+static int strcmp_string_equality(void* a, void* b)
+{
+    return strcmp((const char*) a, (const char*) b) == 0;
+}
+
+/******************************************************************************
+* Returns the number of milliseconds of processor time elapsed since 'start'. *
+******************************************************************************/
+static double milliseconds_since(clock_t start)
+{
+    return 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/****************************************************************
+* Returns the wall clock time in milliseconds. Unlike 'clock',  *
+* it does not add up the processor time of concurrent threads.  *
+****************************************************************/
+static double wall_clock_milliseconds(void)
+{
+    struct timespec now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return 1000.0 * now.tv_sec + now.tv_nsec / 1000000.0;
+}
+
+/*****************************************************************************
+* Fills 'keys' with pseudorandom keys so that the bucket indices spread like *
+* the ones of a real workload. 'state' is the nonzero xorshift state.        *
+*****************************************************************************/
+static void generate_keys(void** keys, size_t count, size_t state)
+{
+    size_t i;
+    
+    for (i = 0; i < count; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        keys[i] = (void*) state;
+    }
+}
+
+/****************************************************************************
+* Measures the operations that need to reach the opposite collision chain   *
+* node of a mapping: removal, re-keying in both directions and rehashing.   *
+****************************************************************************/
+static void benchmark_twin_access(float load_factor,
+                                  void** primary_keys,
+                                  void** secondary_keys,
+                                  void** other_keys)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        load_factor,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        NULL,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+    }
+    
+    printf("load factor %.2f: insert with rehash %8.1f ms",
+           load_factor,
+           milliseconds_since(start));
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                other_keys[i]);
+    }
+    
+    /*******************************************************************
+    * Now 'other_keys[i]' is the secondary key of 'secondary_keys[i]'. *
+    *******************************************************************/
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_secondary(&map,
+                                                  secondary_keys[i],
+                                                  other_keys[i]);
+    }
+    
+    printf(", re-key %8.1f ms", milliseconds_since(start));
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&map,
+                                                       secondary_keys[i]);
+    }
+    
+    printf(", remove %8.1f ms\n", milliseconds_since(start));
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/**************************************************************************
+* Measures insertion, successful and unsuccessful lookups in both the     *
+* directions, and removal on the chained engine.                          *
+**************************************************************************/
+static void benchmark_chained_engine(void** primary_keys,
+                                     void** secondary_keys,
+                                     void** other_keys)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        0.75f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        NULL,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+    }
+    
+    printf("chained: insert %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_get_by_primary_key(&map, primary_keys[i]);
+        bidirectional_hash_map_t_get_by_secondary_key(&map, secondary_keys[i]);
+    }
+    
+    printf(", hit %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_get_by_primary_key(&map, other_keys[i]);
+        bidirectional_hash_map_t_get_by_secondary_key(&map, other_keys[i]);
+    }
+    
+    printf(", miss %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&map, primary_keys[i]);
+    }
+    
+    printf(", remove %8.1f ms\n", milliseconds_since(start));
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/**************************************************************************
+* Measures insertion, successful and unsuccessful lookups in both the     *
+* directions, and removal on the open addressing engine.                  *
+**************************************************************************/
+static void benchmark_open_engine(void** primary_keys,
+                                  void** secondary_keys,
+                                  void** other_keys)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_open_hash_map_t map;
+    
+    bidirectional_open_hash_map_t_init(&map,
+                                       0,
+                                       0.75f,
+                                       primary_key_hasher,
+                                       secondary_key_hasher,
+                                       primary_key_equality,
+                                       secondary_key_equality,
+                                       NULL);
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_open_hash_map_t_put_by_primary(&map,
+                                                     primary_keys[i],
+                                                     secondary_keys[i]);
+    }
+    
+    printf("open:    insert %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_open_hash_map_t_get_by_primary_key(&map,
+                                                         primary_keys[i]);
+        bidirectional_open_hash_map_t_get_by_secondary_key(&map,
+                                                           secondary_keys[i]);
+    }
+    
+    printf(", hit %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_open_hash_map_t_get_by_primary_key(&map, other_keys[i]);
+        bidirectional_open_hash_map_t_get_by_secondary_key(&map,
+                                                           other_keys[i]);
+    }
+    
+    printf(", miss %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_open_hash_map_t_remove_by_primary_key(&map,
+                                                            primary_keys[i]);
+    }
+    
+    printf(", remove %8.1f ms\n", milliseconds_since(start));
+    bidirectional_open_hash_map_t_destroy(&map);
+}
+
+BIDIRECTIONAL_TYPED_HASH_MAP_INIT(typed_integer_map,
+                                  size_t,
+                                  size_t,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_EQUALITY,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_EQUALITY)
+
+/*****************************************************************************
+* Measures the same operations as 'benchmark_open_engine' on a typed map     *
+* generated for integer keys, whose hashing and key comparisons are inlined. *
+*****************************************************************************/
+static void benchmark_typed_engine(void** primary_keys,
+                                   void** secondary_keys,
+                                   void** other_keys)
+{
+    size_t i;
+    size_t key;
+    size_t found = 0;
+    clock_t start;
+    typed_integer_map_t map;
+    
+    typed_integer_map_t_init(&map, 0, 0.75f);
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        typed_integer_map_t_put_by_primary(&map,
+                                           (size_t) primary_keys[i],
+                                           (size_t) secondary_keys[i],
+                                           NULL);
+    }
+    
+    printf("typed:   insert %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        found += typed_integer_map_t_get_by_primary_key(
+                                                    &map,
+                                                    (size_t) primary_keys[i],
+                                                    &key);
+        found += typed_integer_map_t_get_by_secondary_key(
+                                                    &map,
+                                                    (size_t) secondary_keys[i],
+                                                    &key);
+    }
+    
+    printf(", hit %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        found += typed_integer_map_t_get_by_primary_key(&map,
+                                                        (size_t) other_keys[i],
+                                                        &key);
+        found += typed_integer_map_t_get_by_secondary_key(
+                                                    &map,
+                                                    (size_t) other_keys[i],
+                                                    &key);
+    }
+    
+    printf(", miss %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        typed_integer_map_t_remove_by_primary_key(&map,
+                                                  (size_t) primary_keys[i],
+                                                  NULL);
+    }
+    
+    printf(", remove %8.1f ms\n", milliseconds_since(start));
+    typed_integer_map_t_destroy(&map);
+    
+    if (found != 2 * BENCHMARK_MAPPINGS)
+    {
+        fputs("The typed map lost mappings.\n", stderr);
+    }
+}
+
+/*************************************************************************
+* Measures the same operations as 'benchmark_open_engine' on the integer *
+* map, which calls no hashers nor equality functions through pointers.   *
+*************************************************************************/
+static void benchmark_int_map(void** primary_keys,
+                              void** secondary_keys,
+                              void** other_keys)
+{
+    size_t i;
+    size_t found = 0;
+    uint64_t key;
+    clock_t start;
+    bidirectional_int_map_t map;
+    
+    bidirectional_int_map_t_init(&map, 0, 0.75f);
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_int_map_t_put_by_primary(&map,
+                                               (size_t) primary_keys[i],
+                                               (size_t) secondary_keys[i],
+                                               NULL);
+    }
+    
+    printf("int:     insert %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        found += bidirectional_int_map_t_get_by_primary_key(
+                                                    &map,
+                                                    (size_t) primary_keys[i],
+                                                    &key);
+        found += bidirectional_int_map_t_get_by_secondary_key(
+                                                    &map,
+                                                    (size_t) secondary_keys[i],
+                                                    &key);
+    }
+    
+    printf(", hit %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        found += bidirectional_int_map_t_get_by_primary_key(
+                                                    &map,
+                                                    (size_t) other_keys[i],
+                                                    &key);
+        found += bidirectional_int_map_t_get_by_secondary_key(
+                                                    &map,
+                                                    (size_t) other_keys[i],
+                                                    &key);
+    }
+    
+    printf(", miss %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_int_map_t_remove_by_primary_key(&map,
+                                                      (size_t) primary_keys[i],
+                                                      NULL);
+    }
+    
+    printf(", remove %8.1f ms\n", milliseconds_since(start));
+    bidirectional_int_map_t_destroy(&map);
+    
+    if (found != 2 * BENCHMARK_MAPPINGS)
+    {
+        fputs("The integer map lost mappings.\n", stderr);
+    }
+}
+
+/****************************************************************************
+* Measures the total insertion time and the slowest single insertion, which *
+* is dominated by a rehash unless the map rehashes incrementally.           *
+****************************************************************************/
+static void benchmark_rehash_latency(int flags,
+                                     void** primary_keys,
+                                     void** secondary_keys)
+{
+    size_t i;
+    clock_t start;
+    clock_t put_start;
+    clock_t slowest_put = 0;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init_with_flags(&map,
+                                             0,
+                                             0.75f,
+                                             primary_key_hasher,
+                                             secondary_key_hasher,
+                                             primary_key_equality,
+                                             secondary_key_equality,
+                                             NULL,
+                                             flags);
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        put_start = clock();
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+        
+        if (clock() - put_start > slowest_put)
+        {
+            slowest_put = clock() - put_start;
+        }
+    }
+    
+    printf("%s: insert %8.1f ms, slowest put %8.3f ms\n",
+           flags & BIDIRECTIONAL_HASH_MAP_INCREMENTAL_REHASH ?
+                "incremental" : "all at once",
+           milliseconds_since(start),
+           1000.0 * slowest_put / CLOCKS_PER_SEC);
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/***************************************************************************
+* Measures a cold load of a dataset of known size, with or without sizing  *
+* the map in advance.                                                      *
+***************************************************************************/
+static void benchmark_reserve(int reserve,
+                              void** primary_keys,
+                              void** secondary_keys)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        0.75f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        NULL,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    
+    start = clock();
+    
+    if (reserve)
+    {
+        bidirectional_hash_map_t_reserve(&map, BENCHMARK_MAPPINGS);
+    }
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+    }
+    
+    printf("%s: load %8.1f ms\n",
+           reserve ? "reserved" : "growing ",
+           milliseconds_since(start));
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/**************************************************************************
+* Measures storing pairs into a large map one at a time and in batches of *
+* 'batch_size' pairs. Half of the pairs update existing mappings, and the *
+* other half adds new ones.                                               *
+**************************************************************************/
+static void benchmark_put_batch(size_t batch_size,
+                                void** primary_keys,
+                                void** secondary_keys,
+                                void** other_keys)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_hash_map_t map;
+    void** put_primary_keys   = malloc(BENCHMARK_MAPPINGS * sizeof(void*));
+    void** put_secondary_keys = malloc(BENCHMARK_MAPPINGS * sizeof(void*));
+    
+    if (!put_primary_keys || !put_secondary_keys)
+    {
+        fputs("Not enough memory for the batch benchmark.\n", stderr);
+        free(put_primary_keys);
+        free(put_secondary_keys);
+        return;
+    }
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        put_primary_keys[i]   = i & 1 ? other_keys[i] : primary_keys[i];
+        put_secondary_keys[i] = i & 1 ? primary_keys[i] : other_keys[i];
+    }
+    
+    bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        0.75f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        NULL,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    
+    bidirectional_hash_map_t_reserve(&map, 2 * BENCHMARK_MAPPINGS);
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+    }
+    
+    start = clock();
+    
+    if (batch_size == 1)
+    {
+        for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+        {
+            bidirectional_hash_map_t_put_by_primary(&map,
+                                                    put_primary_keys[i],
+                                                    put_secondary_keys[i]);
+        }
+    }
+    else
+    {
+        for (i = 0; i < BENCHMARK_MAPPINGS; i += batch_size)
+        {
+            bidirectional_hash_map_t_put_batch_by_primary(
+                                                    &map,
+                                                    put_primary_keys + i,
+                                                    put_secondary_keys + i,
+                                                    batch_size,
+                                                    NULL);
+        }
+    }
+    
+    printf("batch size %4lu: put %8.1f ms\n",
+           (unsigned long) batch_size,
+           milliseconds_since(start));
+    
+    bidirectional_hash_map_t_destroy(&map);
+    free(put_primary_keys);
+    free(put_secondary_keys);
+}
+
+/**************************************************************************
+* Measures looking up all the mappings of a large map in both directions  *
+* one key at a time and in batches of 'batch_size' keys.                  *
+**************************************************************************/
+static void benchmark_get_batch(size_t batch_size,
+                                void** primary_keys,
+                                void** secondary_keys,
+                                void** results)
+{
+    size_t i;
+    clock_t start;
+    double primary_milliseconds;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        0.75f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        NULL,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+    }
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; i += batch_size)
+    {
+        if (batch_size == 1)
+        {
+            results[i] =
+            bidirectional_hash_map_t_get_by_primary_key(&map,
+                                                        primary_keys[i]);
+        }
+        else
+        {
+            bidirectional_hash_map_t_get_batch_by_primary(&map,
+                                                          primary_keys + i,
+                                                          batch_size,
+                                                          results + i);
+        }
+    }
+    
+    primary_milliseconds = milliseconds_since(start);
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; i += batch_size)
+    {
+        if (batch_size == 1)
+        {
+            results[i] =
+            bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                          secondary_keys[i]);
+        }
+        else
+        {
+            bidirectional_hash_map_t_get_batch_by_secondary(
+                                                        &map,
+                                                        secondary_keys + i,
+                                                        batch_size,
+                                                        results + i);
+        }
+    }
+    
+    printf("batch size %4lu: get by primary %8.1f ms, by secondary %8.1f ms\n",
+           (unsigned long) batch_size,
+           primary_milliseconds,
+           milliseconds_since(start));
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/************************************************************************
+* Measures removing all the mappings of a large map by primary key, one *
+* key at a time and in batches of 'batch_size' keys.                    *
+************************************************************************/
+static void benchmark_remove_batch(size_t batch_size,
+                                   void** primary_keys,
+                                   void** secondary_keys,
+                                   void** results)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        0.75f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        NULL,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+    }
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; i += batch_size)
+    {
+        if (batch_size == 1)
+        {
+            results[i] =
+            bidirectional_hash_map_t_remove_by_primary_key(&map,
+                                                           primary_keys[i]);
+        }
+        else
+        {
+            bidirectional_hash_map_t_remove_batch_by_primary(&map,
+                                                             primary_keys + i,
+                                                             batch_size,
+                                                             results + i);
+        }
+    }
+    
+    printf("batch size %4lu: remove %8.1f ms\n",
+           (unsigned long) batch_size,
+           milliseconds_since(start));
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/**********************************************************************
+* Measures a churning workload, in which every removal is followed by *
+* an insertion, and destroying a large map, with the given flags.     *
+**********************************************************************/
+static void benchmark_churn(int flags,
+                            void** primary_keys,
+                            void** secondary_keys,
+                            void** other_keys)
+{
+    size_t i;
+    clock_t start;
+    double churn_milliseconds;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init_with_flags(&map,
+                                             0,
+                                             0.75f,
+                                             primary_key_hasher,
+                                             secondary_key_hasher,
+                                             primary_key_equality,
+                                             secondary_key_equality,
+                                             NULL,
+                                             flags);
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+    }
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&map, primary_keys[i]);
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                other_keys[i],
+                                                primary_keys[i]);
+    }
+    
+    churn_milliseconds = milliseconds_since(start);
+    start = clock();
+    bidirectional_hash_map_t_destroy(&map);
+    
+    printf("%s: churn %8.1f ms, destroy %8.1f ms\n",
+           flags & BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS ?
+                "slab records" : "three mallocs",
+           churn_milliseconds,
+           milliseconds_since(start));
+}
+
+/***********************************************************************
+* Measures looking up every key of a large map in both directions, and *
+* then the same lookups on a frozen copy of the map.                   *
+***********************************************************************/
+static void benchmark_frozen(void** primary_keys,
+                             void** secondary_keys,
+                             void** results)
+{
+    size_t i;
+    clock_t start;
+    double primary_milliseconds;
+    bidirectional_hash_map_t map;
+    bidirectional_frozen_hash_map_t frozen_map;
+    
+    bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        0.75f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        NULL,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+    }
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        results[i] = bidirectional_hash_map_t_get_by_primary_key(
+                                                            &map,
+                                                            primary_keys[i]);
+    }
+    
+    primary_milliseconds = milliseconds_since(start);
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        results[i] = bidirectional_hash_map_t_get_by_secondary_key(
+                                                            &map,
+                                                            secondary_keys[i]);
+    }
+    
+    printf("hash map:   get by primary %8.1f ms, by secondary %8.1f ms\n",
+           primary_milliseconds,
+           milliseconds_since(start));
+    
+    start = clock();
+    bidirectional_hash_map_t_freeze(&map, &frozen_map);
+    printf("freeze:     %8.1f ms\n", milliseconds_since(start));
+    bidirectional_hash_map_t_destroy(&map);
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        results[i] = bidirectional_frozen_hash_map_t_get_by_primary_key(
+                                                            &frozen_map,
+                                                            primary_keys[i]);
+    }
+    
+    primary_milliseconds = milliseconds_since(start);
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        results[i] = bidirectional_frozen_hash_map_t_get_by_secondary_key(
+                                                            &frozen_map,
+                                                            secondary_keys[i]);
+    }
+    
+    printf("frozen map: get by primary %8.1f ms, by secondary %8.1f ms\n",
+           primary_milliseconds,
+           milliseconds_since(start));
+    
+    bidirectional_frozen_hash_map_t_destroy(&frozen_map);
+}
+
+/*******************************************************************
+* Measures building a static map over a large key set, and looking *
+* up every key of it in both directions.                           *
+*******************************************************************/
+static void benchmark_static(void** primary_keys,
+                             void** secondary_keys,
+                             void** results)
+{
+    size_t i;
+    clock_t start;
+    double primary_milliseconds;
+    key_pair_t* key_pairs = malloc(BENCHMARK_MAPPINGS * sizeof(key_pair_t));
+    bidirectional_static_hash_map_t map;
+    
+    if (!key_pairs)
+    {
+        return;
+    }
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        key_pairs[i].primary_key   = primary_keys[i];
+        key_pairs[i].secondary_key = secondary_keys[i];
+    }
+    
+    start = clock();
+    
+    if (!bidirectional_static_hash_map_t_build(&map,
+                                               key_pairs,
+                                               BENCHMARK_MAPPINGS,
+                                               primary_key_hasher,
+                                               secondary_key_hasher,
+                                               primary_key_equality,
+                                               secondary_key_equality,
+                                               NULL))
+    {
+        fputs("Could not build the static map.\n", stderr);
+        free(key_pairs);
+        return;
+    }
+    
+    printf("build:      %8.1f ms\n", milliseconds_since(start));
+    free(key_pairs);
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        results[i] = bidirectional_static_hash_map_t_get_by_primary_key(
+                                                            &map,
+                                                            primary_keys[i]);
+    }
+    
+    primary_milliseconds = milliseconds_since(start);
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        results[i] = bidirectional_static_hash_map_t_get_by_secondary_key(
+                                                            &map,
+                                                            secondary_keys[i]);
+    }
+    
+    printf("static map: get by primary %8.1f ms, by secondary %8.1f ms\n",
+           primary_milliseconds,
+           milliseconds_since(start));
+    
+    bidirectional_static_hash_map_t_destroy(&map);
+}
+
+/****************************************************************************
+* Measures insertion, successful lookups in both the directions and removal *
+* of 'count' mappings on the chained engine hashing with 'key_hasher'. With *
+* 'key_compare', the long collision chains turn into trees.                 *
+****************************************************************************/
+static void benchmark_chained_buckets(const char* label,
+                                      size_t count,
+                                      size_t (*key_hasher)(void*),
+                                      int (*key_compare)(void*, void*),
+                                      void** primary_keys,
+                                      void** secondary_keys)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init(&map,
+                                  0,
+                                  0.75f,
+                                  key_hasher,
+                                  key_hasher,
+                                  primary_key_equality,
+                                  secondary_key_equality,
+                                  NULL);
+    
+    bidirectional_hash_map_t_set_key_comparators(&map,
+                                                 key_compare,
+                                                 key_compare);
+    
+    start = clock();
+    
+    for (i = 0; i < count; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_keys[i],
+                                                secondary_keys[i]);
+    }
+    
+    printf("%s insert %8.1f ms", label, milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < count; ++i)
+    {
+        bidirectional_hash_map_t_get_by_primary_key(&map, primary_keys[i]);
+        bidirectional_hash_map_t_get_by_secondary_key(&map, secondary_keys[i]);
+    }
+    
+    printf(", hit %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < count; ++i)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&map, primary_keys[i]);
+    }
+    
+    printf(", remove %8.1f ms\n", milliseconds_since(start));
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/****************************************************************************
+* Measures insertion, successful lookups in both the directions and removal *
+* of 'count' mappings on the engine with AVL tree buckets.                  *
+****************************************************************************/
+static void benchmark_tree_buckets(const char* label,
+                                   size_t count,
+                                   size_t (*key_hasher)(void*),
+                                   void** primary_keys,
+                                   void** secondary_keys)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_hash_map_2_t map;
+    
+    bidirectional_hash_map_2_t_init(&map,
+                                    0,
+                                    0.75f,
+                                    key_hasher,
+                                    key_hasher,
+                                    key_compare,
+                                    key_compare,
+                                    NULL);
+    
+    start = clock();
+    
+    for (i = 0; i < count; ++i)
+    {
+        bidirectional_hash_map_2_t_put_by_primary(&map,
+                                                  primary_keys[i],
+                                                  secondary_keys[i]);
+    }
+    
+    printf("%s insert %8.1f ms", label, milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < count; ++i)
+    {
+        bidirectional_hash_map_2_t_get_by_primary_key(&map, primary_keys[i]);
+        bidirectional_hash_map_2_t_get_by_secondary_key(&map,
+                                                        secondary_keys[i]);
+    }
+    
+    printf(", hit %8.1f ms", milliseconds_since(start));
+    start = clock();
+    
+    for (i = 0; i < count; ++i)
+    {
+        bidirectional_hash_map_2_t_remove_by_primary_key(&map,
+                                                         primary_keys[i]);
+    }
+    
+    printf(", remove %8.1f ms\n", milliseconds_since(start));
+    bidirectional_hash_map_2_t_destroy(&map);
+}
+
+/****************************************************************************
+* Measures insertion and successful lookups of keys that, like the pointers *
+* returned by 'malloc', are multiples of 16, with the identity hasher.      *
+****************************************************************************/
+static void benchmark_hash_mixing(const char* label,
+                                  int flags,
+                                  void** primary_keys,
+                                  void** secondary_keys)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_hash_map_t map;
+    void* primary_key;
+    void* secondary_key;
+    
+    bidirectional_hash_map_t_init_with_flags(&map,
+                                             0,
+                                             0.75f,
+                                             primary_key_hasher,
+                                             secondary_key_hasher,
+                                             primary_key_equality,
+                                             secondary_key_equality,
+                                             NULL,
+                                             flags);
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        primary_key   = (void*)((size_t) primary_keys[i] << 4);
+        secondary_key = (void*)((size_t) secondary_keys[i] << 4);
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                primary_key,
+                                                secondary_key);
+    }
+    
+    printf("%s insert %8.1f ms", label, milliseconds_since(start));
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        primary_key   = (void*)((size_t) primary_keys[i] << 4);
+        secondary_key = (void*)((size_t) secondary_keys[i] << 4);
+        bidirectional_hash_map_t_get_by_primary_key(&map, primary_key);
+        bidirectional_hash_map_t_get_by_secondary_key(&map, secondary_key);
+    }
+    
+    printf(", hit %8.1f ms\n", milliseconds_since(start));
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/*****************************************************************************
+* Allocates 'count' pseudorandom lowercase strings whose lengths range from  *
+* 'minimum_length' to 'maximum_length'. The same 'state' gives strings with  *
+* the same contents at different addresses. Returns NULL if there is no      *
+* memory.                                                                    *
+*****************************************************************************/
+static char** generate_strings(size_t count,
+                               size_t minimum_length,
+                               size_t maximum_length,
+                               size_t state)
+{
+    size_t i;
+    size_t j;
+    size_t length;
+    char** strings = malloc(count * sizeof(char*));
+    char* characters = malloc(count * (maximum_length + 1));
+    
+    if (!strings || !characters)
+    {
+        free(strings);
+        free(characters);
+        return NULL;
+    }
+    
+    for (i = 0; i < count; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        
+        length = minimum_length +
+                 state % (maximum_length - minimum_length + 1);
+        
+        strings[i] = characters + i * (maximum_length + 1);
+        
+        for (j = 0; j < length; ++j)
+        {
+            strings[i][j] = (char)('a' + (state >> (j % 48)) % 26);
+        }
+        
+        strings[i][length] = '\0';
+    }
+    
+    return strings;
+}
+
+static void free_strings(char** strings)
+{
+    free(strings[0]);
+    free(strings);
+}
+
+/**************************************************************************
+* Measures hashing the string keys alone, inserting them as primary keys, *
+* and looking them up through copies at other addresses.                  *
+**************************************************************************/
+static void benchmark_string_keys(const char* label,
+                                  size_t (*string_hasher)(void*),
+                                  int (*string_equality)(void*, void*),
+                                  char** strings,
+                                  char** string_copies)
+{
+    size_t i;
+    size_t round;
+    size_t hash_sum = 0;
+    clock_t start;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init(&map,
+                                  0,
+                                  0.75f,
+                                  string_hasher,
+                                  bidirectional_hash_map_integer_hasher,
+                                  string_equality,
+                                  bidirectional_hash_map_integer_equality,
+                                  NULL);
+    
+    start = clock();
+    
+    for (round = 0; round < 8; ++round)
+    {
+        for (i = 0; i < STRING_KEYS; ++i)
+        {
+            hash_sum += string_hasher(strings[i]);
+        }
+    }
+    
+    printf("%s hash %8.1f ms", label, milliseconds_since(start));
+    
+    start = clock();
+    
+    for (i = 0; i < STRING_KEYS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                strings[i],
+                                                (void*)(i + 1));
+    }
+    
+    printf(", insert %8.1f ms", milliseconds_since(start));
+    
+    start = clock();
+    
+    for (round = 0; round < 8; ++round)
+    {
+        for (i = 0; i < STRING_KEYS; ++i)
+        {
+            bidirectional_hash_map_t_get_by_primary_key(&map,
+                                                        string_copies[i]);
+        }
+    }
+    
+    printf(", hit %8.1f ms (%d)\n",
+           milliseconds_since(start),
+           (int)(hash_sum & 1));
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/***********************************************************************
+* Runs the string key benchmarks on strings of the given length range. *
+***********************************************************************/
+static void benchmark_key_functions(size_t minimum_length,
+                                    size_t maximum_length)
+{
+    char** strings = generate_strings(STRING_KEYS,
+                                      minimum_length,
+                                      maximum_length,
+                                      0x4567891);
+    char** string_copies = generate_strings(STRING_KEYS,
+                                            minimum_length,
+                                            maximum_length,
+                                            0x4567891);
+    
+    if (!strings || !string_copies)
+    {
+        fputs("Not enough memory for the benchmark strings.\n", stderr);
+        exit(1);
+    }
+    
+    printf("%d to %d characters:\n",
+           (int) minimum_length,
+           (int) maximum_length);
+    benchmark_string_keys("  FNV-1a + strcmp:",
+                          fnv1a_string_hasher,
+                          strcmp_string_equality,
+                          strings,
+                          string_copies);
+    benchmark_string_keys("  built-in:       ",
+                          bidirectional_hash_map_string_hasher,
+                          bidirectional_hash_map_string_equality,
+                          strings,
+                          string_copies);
+    
+    free_strings(strings);
+    free_strings(string_copies);
+}
+
+/**************************************************************************
+* Measures insertion and successful lookups of short string keys in both  *
+* directions, with the keys either compared through the equality function *
+* or copied inline into the mapping records.                              *
+**************************************************************************/
+static void benchmark_inline_keys(size_t inline_key_capacity,
+                                  char** strings,
+                                  char** string_copies)
+{
+    size_t i;
+    clock_t start;
+    bidirectional_hash_map_t map;
+    
+    bidirectional_hash_map_t_init_with_flags(
+                                    &map,
+                                    0,
+                                    0.75f,
+                                    bidirectional_hash_map_string_hasher,
+                                    bidirectional_hash_map_string_hasher,
+                                    bidirectional_hash_map_string_equality,
+                                    bidirectional_hash_map_string_equality,
+                                    NULL,
+                                    BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    
+    bidirectional_hash_map_t_set_inline_keys(
+                                    &map,
+                                    bidirectional_hash_map_string_size,
+                                    bidirectional_hash_map_string_size,
+                                    inline_key_capacity);
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(
+                                    &map,
+                                    strings[i],
+                                    strings[BENCHMARK_MAPPINGS - 1 - i]);
+    }
+    
+    printf("%s insert %8.1f ms",
+           inline_key_capacity ? "inline keys:  " : "key pointers: ",
+           milliseconds_since(start));
+    
+    start = clock();
+    
+    for (i = 0; i < BENCHMARK_MAPPINGS; ++i)
+    {
+        bidirectional_hash_map_t_get_by_primary_key(&map, string_copies[i]);
+        bidirectional_hash_map_t_get_by_secondary_key(&map, string_copies[i]);
+    }
+    
+    printf(", hit %8.1f ms\n", milliseconds_since(start));
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/*****************************************************************
+* One thread of the concurrent benchmark. It works either on the *
+* striped map, or on a chained map behind a single mutex.        *
+*****************************************************************/
+typedef struct concurrent_benchmark_worker_t {
+    bidirectional_concurrent_hash_map_t* striped_map;
+    bidirectional_hash_map_t* locked_map;
+    pthread_mutex_t* map_lock;
+    void** primary_keys;
+    void** secondary_keys;
+    
+    /***********************************************************
+    * The preloaded mappings this thread re-keys. Every thread *
+    * owns its own slice, and draws the new secondary keys     *
+    * from its own slice of 'fresh_keys'.                      *
+    ***********************************************************/
+    size_t first_owned_key;
+    size_t owned_key_count;
+    void** fresh_keys;
+    size_t operations;
+    size_t random_state;
+    
+    /*****************************************************
+    * One operation in 'write_period' re-keys a mapping. *
+    *****************************************************/
+    size_t write_period;
+}
+concurrent_benchmark_worker_t;
+
+/****************************************************************
+* Runs a read-mostly mix: lookups in either direction, and now  *
+* and then a re-keying of an owned mapping to a fresh secondary *
+* key.                                                          *
+****************************************************************/
+static void* run_concurrent_benchmark_worker(void* argument)
+{
+    concurrent_benchmark_worker_t* worker = argument;
+    size_t i;
+    size_t index;
+    size_t next_fresh_key = 0;
+    size_t state = worker->random_state;
+    
+    for (i = 0; i < worker->operations; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        index = (state >> 4) % CONCURRENT_MAPPINGS;
+        
+        if (state % worker->write_period == 0)
+        {
+            index = worker->first_owned_key + index % worker->owned_key_count;
+            
+            if (worker->striped_map)
+            {
+                bidirectional_concurrent_hash_map_t_put_by_primary(
+                                        worker->striped_map,
+                                        worker->primary_keys[index],
+                                        worker->fresh_keys[next_fresh_key++]);
+            }
+            else
+            {
+                pthread_mutex_lock(worker->map_lock);
+                bidirectional_hash_map_t_put_by_primary(
+                                        worker->locked_map,
+                                        worker->primary_keys[index],
+                                        worker->fresh_keys[next_fresh_key++]);
+                pthread_mutex_unlock(worker->map_lock);
+            }
+        }
+        else if (worker->striped_map)
+        {
+            if (i & 1)
+            {
+                bidirectional_concurrent_hash_map_t_get_by_primary_key(
+                                                worker->striped_map,
+                                                worker->primary_keys[index]);
+            }
+            else
+            {
+                bidirectional_concurrent_hash_map_t_get_by_secondary_key(
+                                                worker->striped_map,
+                                                worker->secondary_keys[index]);
+            }
+        }
+        else
+        {
+            pthread_mutex_lock(worker->map_lock);
+            
+            if (i & 1)
+            {
+                bidirectional_hash_map_t_get_by_primary_key(
+                                                worker->locked_map,
+                                                worker->primary_keys[index]);
+            }
+            else
+            {
+                bidirectional_hash_map_t_get_by_secondary_key(
+                                                worker->locked_map,
+                                                worker->secondary_keys[index]);
+            }
+            
+            pthread_mutex_unlock(worker->map_lock);
+        }
+    }
+    
+    return NULL;
+}
+
+/*************************************************************************
+* Measures the wall clock time 'thread_count' threads take to perform    *
+* CONCURRENT_OPERATIONS operations together, either on the striped map   *
+* or on a chained map guarded by one global mutex. One operation in      *
+* 'write_period' is a write.                                             *
+*************************************************************************/
+static void benchmark_concurrent(int striped,
+                                 size_t thread_count,
+                                 size_t write_period,
+                                 void** primary_keys,
+                                 void** secondary_keys,
+                                 void** other_keys)
+{
+    size_t i;
+    double start;
+    bidirectional_concurrent_hash_map_t striped_map;
+    bidirectional_hash_map_t locked_map;
+    pthread_mutex_t map_lock;
+    concurrent_benchmark_worker_t workers[MAXIMUM_BENCHMARK_THREADS];
+    pthread_t threads[MAXIMUM_BENCHMARK_THREADS];
+    
+    if (striped)
+    {
+        bidirectional_concurrent_hash_map_t_init(&striped_map,
+                                                 4 * MAXIMUM_BENCHMARK_THREADS,
+                                                 0.75f,
+                                                 primary_key_hasher,
+                                                 secondary_key_hasher,
+                                                 primary_key_equality,
+                                                 secondary_key_equality,
+                                                 NULL);
+    }
+    else
+    {
+        bidirectional_hash_map_t_init_with_flags(
+                                        &locked_map,
+                                        0,
+                                        0.75f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        NULL,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+        pthread_mutex_init(&map_lock, NULL);
+    }
+    
+    for (i = 0; i < CONCURRENT_MAPPINGS; ++i)
+    {
+        if (striped)
+        {
+            bidirectional_concurrent_hash_map_t_put_by_primary(
+                                                        &striped_map,
+                                                        primary_keys[i],
+                                                        secondary_keys[i]);
+        }
+        else
+        {
+            bidirectional_hash_map_t_put_by_primary(&locked_map,
+                                                    primary_keys[i],
+                                                    secondary_keys[i]);
+        }
+    }
+    
+    for (i = 0; i < thread_count; ++i)
+    {
+        workers[i].striped_map     = striped ? &striped_map : NULL;
+        workers[i].locked_map      = &locked_map;
+        workers[i].map_lock        = &map_lock;
+        workers[i].primary_keys    = primary_keys;
+        workers[i].secondary_keys  = secondary_keys;
+        workers[i].owned_key_count = CONCURRENT_MAPPINGS / thread_count;
+        workers[i].first_owned_key = i * workers[i].owned_key_count;
+        workers[i].fresh_keys      = other_keys +
+                                     i * (BENCHMARK_MAPPINGS / thread_count);
+        workers[i].operations      = CONCURRENT_OPERATIONS / thread_count;
+        workers[i].random_state    = 0x4567891 + i;
+        workers[i].write_period    = write_period;
+    }
+    
+    start = wall_clock_milliseconds();
+    
+    for (i = 0; i < thread_count; ++i)
+    {
+        pthread_create(&threads[i],
+                       NULL,
+                       run_concurrent_benchmark_worker,
+                       &workers[i]);
+    }
+    
+    for (i = 0; i < thread_count; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    
+    printf("%s %2lu threads %8.1f ms\n",
+           striped ? "striped:    " : "global lock:",
+           (unsigned long) thread_count,
+           wall_clock_milliseconds() - start);
+    
+    if (striped)
+    {
+        bidirectional_concurrent_hash_map_t_destroy(&striped_map);
+    }
+    else
+    {
+        bidirectional_hash_map_t_destroy(&locked_map);
+        pthread_mutex_destroy(&map_lock);
+    }
+}
+
+/*******************************************************************
+* The work of one thread of the snapshot benchmark. Exactly one of *
+* 'snapshot_map' and 'locked_map' is set.                          *
+*******************************************************************/
+typedef struct snapshot_benchmark_worker_t {
+    bidirectional_snapshot_hash_map_t* snapshot_map;
+    bidirectional_hash_map_t* locked_map;
+    pthread_mutex_t* map_lock;
+    void** primary_keys;
+    void** secondary_keys;
+    size_t operations;
+    size_t random_state;
+}
+snapshot_benchmark_worker_t;
+
+/******************************************************************
+* Runs lookups in either direction. A snapshot reader announces a *
+* quiescent state every 1024 lookups, as a thread serving short   *
+* requests would between two of them.                             *
+******************************************************************/
+static void* run_snapshot_benchmark_worker(void* argument)
+{
+    snapshot_benchmark_worker_t* worker = argument;
+    snapshot_hash_map_reader_t* reader = NULL;
+    bidirectional_frozen_hash_map_t* version;
+    size_t i;
+    size_t index;
+    size_t state = worker->random_state;
+    
+    if (worker->snapshot_map)
+    {
+        reader = bidirectional_snapshot_hash_map_t_register_reader(
+                                                        worker->snapshot_map);
+    }
+    
+    for (i = 0; i < worker->operations; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        index = (state >> 4) % CONCURRENT_MAPPINGS;
+        
+        if (reader)
+        {
+            version = bidirectional_snapshot_hash_map_t_get_version(
+                                                        worker->snapshot_map);
+            
+            if (i & 1)
+            {
+                bidirectional_frozen_hash_map_t_get_by_primary_key(
+                                                version,
+                                                worker->primary_keys[index]);
+            }
+            else
+            {
+                bidirectional_frozen_hash_map_t_get_by_secondary_key(
+                                                version,
+                                                worker->secondary_keys[index]);
+            }
+            
+            if ((i & 1023) == 1023)
+            {
+                bidirectional_snapshot_hash_map_t_quiescent_state(
+                                                        worker->snapshot_map,
+                                                        reader);
+            }
+        }
+        else
+        {
+            pthread_mutex_lock(worker->map_lock);
+            
+            if (i & 1)
+            {
+                bidirectional_hash_map_t_get_by_primary_key(
+                                                worker->locked_map,
+                                                worker->primary_keys[index]);
+            }
+            else
+            {
+                bidirectional_hash_map_t_get_by_secondary_key(
+                                                worker->locked_map,
+                                                worker->secondary_keys[index]);
+            }
+            
+            pthread_mutex_unlock(worker->map_lock);
+        }
+    }
+    
+    if (reader)
+    {
+        bidirectional_snapshot_hash_map_t_unregister_reader(
+                                                        worker->snapshot_map,
+                                                        reader);
+    }
+    
+    return NULL;
+}
+
+/************************************************************************
+* Measures the wall clock time 'thread_count' threads take to perform   *
+* CONCURRENT_OPERATIONS lookups together, either in the current version *
+* of a snapshot map or in a chained map guarded by one global mutex.    *
+* For the snapshot map, also measures how long one publication takes.   *
+************************************************************************/
+static void benchmark_snapshot(int snapshot,
+                               size_t thread_count,
+                               void** primary_keys,
+                               void** secondary_keys)
+{
+    size_t i;
+    double start;
+    bidirectional_snapshot_hash_map_t snapshot_map;
+    bidirectional_hash_map_t locked_map;
+    pthread_mutex_t map_lock;
+    snapshot_benchmark_worker_t workers[MAXIMUM_BENCHMARK_THREADS];
+    pthread_t threads[MAXIMUM_BENCHMARK_THREADS];
+    
+    if (snapshot)
+    {
+        bidirectional_snapshot_hash_map_t_init(&snapshot_map,
+                                               0,
+                                               0.75f,
+                                               primary_key_hasher,
+                                               secondary_key_hasher,
+                                               primary_key_equality,
+                                               secondary_key_equality,
+                                               NULL);
+    }
+    else
+    {
+        bidirectional_hash_map_t_init_with_flags(
+                                        &locked_map,
+                                        0,
+                                        0.75f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        NULL,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+        pthread_mutex_init(&map_lock, NULL);
+    }
+    
+    for (i = 0; i < CONCURRENT_MAPPINGS; ++i)
+    {
+        if (snapshot)
+        {
+            bidirectional_snapshot_hash_map_t_put_by_primary(
+                                                        &snapshot_map,
+                                                        primary_keys[i],
+                                                        secondary_keys[i]);
+        }
+        else
+        {
+            bidirectional_hash_map_t_put_by_primary(&locked_map,
+                                                    primary_keys[i],
+                                                    secondary_keys[i]);
+        }
+    }
+    
+    if (snapshot)
+    {
+        start = wall_clock_milliseconds();
+        bidirectional_snapshot_hash_map_t_publish(&snapshot_map);
+        
+        if (thread_count == 1)
+        {
+            printf("publish:               %8.1f ms\n",
+                   wall_clock_milliseconds() - start);
+        }
+    }
+    
+    for (i = 0; i < thread_count; ++i)
+    {
+        workers[i].snapshot_map   = snapshot ? &snapshot_map : NULL;
+        workers[i].locked_map     = &locked_map;
+        workers[i].map_lock       = &map_lock;
+        workers[i].primary_keys   = primary_keys;
+        workers[i].secondary_keys = secondary_keys;
+        workers[i].operations     = CONCURRENT_OPERATIONS / thread_count;
+        workers[i].random_state   = 0x4567891 + i;
+    }
+    
+    start = wall_clock_milliseconds();
+    
+    for (i = 0; i < thread_count; ++i)
+    {
+        pthread_create(&threads[i],
+                       NULL,
+                       run_snapshot_benchmark_worker,
+                       &workers[i]);
+    }
+    
+    for (i = 0; i < thread_count; ++i)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    
+    printf("%s %2lu threads %8.1f ms\n",
+           snapshot ? "snapshot:   " : "global lock:",
+           (unsigned long) thread_count,
+           wall_clock_milliseconds() - start);
+    
+    if (snapshot)
+    {
+        bidirectional_snapshot_hash_map_t_destroy(&snapshot_map);
+    }
+    else
+    {
+        bidirectional_hash_map_t_destroy(&locked_map);
+        pthread_mutex_destroy(&map_lock);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    static const float load_factors[] = { 0.75f, 1.0f, 2.0f };
+    size_t i;
+    void** primary_keys   = malloc(BENCHMARK_MAPPINGS * sizeof(void*));
+    void** secondary_keys = malloc(BENCHMARK_MAPPINGS * sizeof(void*));
+    void** other_keys     = malloc(BENCHMARK_MAPPINGS * sizeof(void*));
+    const char* benchmark = argc > 1 ? argv[1] : "all";
+    
+    if (!primary_keys || !secondary_keys || !other_keys)
+    {
+        fputs("Not enough memory for the benchmark keys.\n", stderr);
+        return 1;
+    }
+    
+    generate_keys(primary_keys,   BENCHMARK_MAPPINGS, 0x1234567);
+    generate_keys(secondary_keys, BENCHMARK_MAPPINGS, 0x2345678);
+    generate_keys(other_keys,     BENCHMARK_MAPPINGS, 0x3456789);
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "twin"))
+    {
+        puts("--- Twin node access ---");
+        
+        for (i = 0; i < sizeof(load_factors) / sizeof(load_factors[0]); ++i)
+        {
+            benchmark_twin_access(load_factors[i],
+                                  primary_keys,
+                                  secondary_keys,
+                                  other_keys);
+        }
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "open"))
+    {
+        puts("--- Chained versus open addressing engine ---");
+        benchmark_chained_engine(primary_keys, secondary_keys, other_keys);
+        benchmark_open_engine(primary_keys, secondary_keys, other_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "typed"))
+    {
+        puts("--- Function pointer versus typed engines ---");
+        benchmark_chained_engine(primary_keys, secondary_keys, other_keys);
+        benchmark_open_engine(primary_keys, secondary_keys, other_keys);
+        benchmark_typed_engine(primary_keys, secondary_keys, other_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "int"))
+    {
+        puts("--- Function pointer engines versus the integer map ---");
+        benchmark_chained_engine(primary_keys, secondary_keys, other_keys);
+        benchmark_open_engine(primary_keys, secondary_keys, other_keys);
+        benchmark_int_map(primary_keys, secondary_keys, other_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "rehash"))
+    {
+        puts("--- Rehash latency ---");
+        benchmark_rehash_latency(BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS |
+                                 BIDIRECTIONAL_HASH_MAP_INCREMENTAL_REHASH,
+                                 primary_keys,
+                                 secondary_keys);
+        benchmark_rehash_latency(BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS,
+                                 primary_keys,
+                                 secondary_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "reserve"))
+    {
+        puts("--- Cold load ---");
+        benchmark_reserve(1, primary_keys, secondary_keys);
+        benchmark_reserve(0, primary_keys, secondary_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "batch"))
+    {
+        puts("--- Batch operations ---");
+        
+        for (i = 1; i <= 256; i <<= 2)
+        {
+            benchmark_put_batch(i, primary_keys, secondary_keys, other_keys);
+        }
+        
+        for (i = 1; i <= 256; i <<= 1)
+        {
+            benchmark_get_batch(i, primary_keys, secondary_keys, other_keys);
+        }
+        
+        for (i = 1; i <= 256; i <<= 2)
+        {
+            benchmark_remove_batch(i, primary_keys, secondary_keys, other_keys);
+        }
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "churn"))
+    {
+        puts("--- Churn and destroy ---");
+        benchmark_churn(0, primary_keys, secondary_keys, other_keys);
+        benchmark_churn(BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS,
+                        primary_keys,
+                        secondary_keys,
+                        other_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "frozen"))
+    {
+        puts("--- Frozen map ---");
+        benchmark_frozen(primary_keys, secondary_keys, other_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "static"))
+    {
+        puts("--- Static map ---");
+        benchmark_static(primary_keys, secondary_keys, other_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "avl"))
+    {
+        puts("--- Chained versus AVL tree buckets ---");
+        benchmark_chained_buckets("uniform   chained: ",
+                                  BENCHMARK_MAPPINGS,
+                                  primary_key_hasher,
+                                  NULL,
+                                  primary_keys,
+                                  secondary_keys);
+        benchmark_chained_buckets("uniform   adaptive:",
+                                  BENCHMARK_MAPPINGS,
+                                  primary_key_hasher,
+                                  key_compare,
+                                  primary_keys,
+                                  secondary_keys);
+        benchmark_tree_buckets("uniform   AVL:     ",
+                               BENCHMARK_MAPPINGS,
+                               primary_key_hasher,
+                               primary_keys,
+                               secondary_keys);
+        benchmark_chained_buckets("colliding chained: ",
+                                  COLLIDING_MAPPINGS,
+                                  colliding_key_hasher,
+                                  NULL,
+                                  primary_keys,
+                                  secondary_keys);
+        benchmark_chained_buckets("colliding adaptive:",
+                                  COLLIDING_MAPPINGS,
+                                  colliding_key_hasher,
+                                  key_compare,
+                                  primary_keys,
+                                  secondary_keys);
+        benchmark_tree_buckets("colliding AVL:     ",
+                               COLLIDING_MAPPINGS,
+                               colliding_key_hasher,
+                               primary_keys,
+                               secondary_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "mix"))
+    {
+        puts("--- Hash mixing ---");
+        benchmark_hash_mixing("unmixed:",
+                              BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS,
+                              primary_keys,
+                              secondary_keys);
+        benchmark_hash_mixing("mixed:  ",
+                              BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS |
+                              BIDIRECTIONAL_HASH_MAP_MIX_HASHES,
+                              primary_keys,
+                              secondary_keys);
+        benchmark_hash_mixing("seeded: ",
+                              BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS |
+                              BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES,
+                              primary_keys,
+                              secondary_keys);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "keys"))
+    {
+        puts("--- Built-in key functions ---");
+        benchmark_key_functions(4, 16);
+        benchmark_key_functions(16, 64);
+        benchmark_key_functions(128, 512);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "inline"))
+    {
+        char** strings = generate_strings(BENCHMARK_MAPPINGS,
+                                          4,
+                                          15,
+                                          0x5678912);
+        char** string_copies = generate_strings(BENCHMARK_MAPPINGS,
+                                                4,
+                                                15,
+                                                0x5678912);
+        
+        if (!strings || !string_copies)
+        {
+            fputs("Not enough memory for the benchmark strings.\n", stderr);
+            return 1;
+        }
+        
+        puts("--- Inline keys ---");
+        benchmark_inline_keys(0, strings, string_copies);
+        benchmark_inline_keys(16, strings, string_copies);
+        free_strings(strings);
+        free_strings(string_copies);
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "concurrent"))
+    {
+        puts("--- Global lock versus lock striping ---");
+        
+        for (i = 1; i <= MAXIMUM_BENCHMARK_THREADS; i <<= 1)
+        {
+            benchmark_concurrent(0,
+                                 i,
+                                 10,
+                                 primary_keys,
+                                 secondary_keys,
+                                 other_keys);
+            benchmark_concurrent(1,
+                                 i,
+                                 10,
+                                 primary_keys,
+                                 secondary_keys,
+                                 other_keys);
+        }
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "reads"))
+    {
+        puts("--- Lookups with one write in a hundred ---");
+        
+        for (i = 1; i <= MAXIMUM_BENCHMARK_THREADS; i <<= 2)
+        {
+            benchmark_concurrent(0,
+                                 i,
+                                 100,
+                                 primary_keys,
+                                 secondary_keys,
+                                 other_keys);
+            benchmark_concurrent(1,
+                                 i,
+                                 100,
+                                 primary_keys,
+                                 secondary_keys,
+                                 other_keys);
+        }
+    }
+    
+    if (!strcmp(benchmark, "all") || !strcmp(benchmark, "snapshot"))
+    {
+        puts("--- Global lock versus snapshot reads ---");
+        
+        for (i = 1; i <= MAXIMUM_BENCHMARK_THREADS; i <<= 2)
+        {
+            benchmark_snapshot(0, i, primary_keys, secondary_keys);
+            benchmark_snapshot(1, i, primary_keys, secondary_keys);
+        }
+    }
+    
+    free(primary_keys);
+    free(secondary_keys);
+    free(other_keys);
+    return 0;
+}
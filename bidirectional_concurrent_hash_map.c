@@ -0,0 +1,1420 @@
+#include "bidirectional_concurrent_hash_map.h"
+#include "bidirectional_hash_map.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/********************************************************************
+* Lookups go lock-free where the atomic builtins are there to order *
+* the accesses of the readers against those of the writers. Without *
+* them, lookups take the lock of their stripe.                      *
+********************************************************************/
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+#define CONCURRENT_HASH_MAP_OPTIMISTIC_READS
+#define ATOMIC_LOAD(pointer, order) __atomic_load_n(pointer, __ATOMIC_##order)
+#define ATOMIC_STORE(pointer, value, order) \
+        __atomic_store_n(pointer, value, __ATOMIC_##order)
+#define ATOMIC_FENCE(order) __atomic_thread_fence(__ATOMIC_##order)
+#else
+#define ATOMIC_LOAD(pointer, order) (*(pointer))
+#define ATOMIC_STORE(pointer, value, order) (*(pointer) = (value))
+#define ATOMIC_FENCE(order)
+#endif
+
+static const float  MINIMUM_LOAD_FACTOR      = 0.2f;
+static const size_t INITIAL_STRIPE_CAPACITY  = 8;
+static const size_t MAXIMUM_STRIPE_COUNT     = ((size_t) 1) << 16;
+static const size_t RECLAMATION_THRESHOLD    = 64;
+static const size_t FIRST_EPOCH              = 1;
+
+#ifdef CONCURRENT_HASH_MAP_OPTIMISTIC_READS
+/*************************************************************
+* The number of times a lookup retries after racing a writer *
+* before it takes the lock of the stripe instead.            *
+*************************************************************/
+static const int MAXIMUM_OPTIMISTIC_ATTEMPTS = 8;
+#endif
+
+/*********************************************************************
+* The largest number of stripes a single operation locks: the stripe *
+* of the key looked up, and the old and the new stripe of the key on *
+* the opposite side.                                                 *
+*********************************************************************/
+#define MAXIMUM_LOCKED_STRIPES 3
+
+/*******************************************************************
+* A set of stripe indices kept sorted, so that locking its stripes *
+* front to back follows the global lock order.                     *
+*******************************************************************/
+typedef struct stripe_set_t {
+    size_t indices[MAXIMUM_LOCKED_STRIPES];
+    size_t count;
+}
+stripe_set_t;
+
+static float max_float(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+static void stripe_set_clear(stripe_set_t* set)
+{
+    set->count = 0;
+}
+
+static int stripe_set_contains(stripe_set_t* set, size_t index)
+{
+    size_t i;
+    
+    for (i = 0; i < set->count; ++i)
+    {
+        if (set->indices[i] == index)
+        {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+/**************************************************************
+* Adds 'index' to the set unless it is there already, keeping *
+* the indices in ascending order.                             *
+**************************************************************/
+static void stripe_set_add(stripe_set_t* set, size_t index)
+{
+    size_t i;
+    
+    if (stripe_set_contains(set, index))
+    {
+        return;
+    }
+    
+    for (i = set->count; i > 0 && set->indices[i - 1] > index; --i)
+    {
+        set->indices[i] = set->indices[i - 1];
+    }
+    
+    set->indices[i] = index;
+    set->count++;
+}
+
+static concurrent_hash_map_stripe_t* get_stripe(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    size_t stripe_index)
+{
+    return &map->stripes[stripe_index].stripe;
+}
+
+/*************************************************************
+* Locks the stripes of the set in the ascending order of     *
+* their indices. Every operation doing so rules out the wait *
+* cycles a deadlock needs. The sequence of each stripe turns *
+* odd, so that the lock-free readers know to keep off.       *
+*************************************************************/
+static void lock_stripes(bidirectional_concurrent_hash_map_t* map,
+                         stripe_set_t* set)
+{
+    size_t i;
+    concurrent_hash_map_stripe_t* stripe;
+    
+    for (i = 0; i < set->count; ++i)
+    {
+        stripe = get_stripe(map, set->indices[i]);
+        pthread_mutex_lock(&stripe->lock);
+        ATOMIC_STORE(&stripe->sequence, stripe->sequence + 1, RELAXED);
+    }
+    
+    ATOMIC_FENCE(RELEASE);
+}
+
+static void unlock_stripes(bidirectional_concurrent_hash_map_t* map,
+                           stripe_set_t* set)
+{
+    size_t i = set->count;
+    concurrent_hash_map_stripe_t* stripe;
+    
+    while (i > 0)
+    {
+        stripe = get_stripe(map, set->indices[--i]);
+        ATOMIC_STORE(&stripe->sequence, stripe->sequence + 1, RELEASE);
+        pthread_mutex_unlock(&stripe->lock);
+    }
+}
+
+/***********************************************
+* Frees a retired block along with its record. *
+***********************************************/
+static void free_retirement(concurrent_retired_memory_t* retirement)
+{
+    if (retirement->memory != retirement)
+    {
+        free(retirement->memory);
+    }
+    
+    free(retirement);
+}
+
+/*****************************************************************
+* Frees the retired blocks no reader can reach any more, that is *
+* the ones retired two or more epochs ago. The caller holds      *
+* 'reclamation_lock'.                                            *
+*****************************************************************/
+static void free_retired_memory(bidirectional_concurrent_hash_map_t* map)
+{
+    concurrent_retired_memory_t** link = &map->retired;
+    concurrent_retired_memory_t* retirement;
+    
+    while (*link)
+    {
+        retirement = *link;
+        
+        if (retirement->epoch + 2 > map->epoch)
+        {
+            link = &retirement->next;
+            continue;
+        }
+        
+        *link = retirement->next;
+        map->retired_count--;
+        free_retirement(retirement);
+    }
+}
+
+/****************************************************************
+* Advances the global epoch if every reader inside a lookup has *
+* seen its current value. The caller holds 'reclamation_lock'.  *
+****************************************************************/
+static void try_advance_epoch(bidirectional_concurrent_hash_map_t* map)
+{
+    size_t reader_epoch;
+    concurrent_hash_map_reader_t* reader;
+    
+    pthread_mutex_lock(&map->reader_lock);
+    
+    /*************************************************************
+    * Pairs with the fence of a reader entering a lookup: either *
+    * its epoch is seen here, or it sees every unlinking done    *
+    * before this point.                                         *
+    *************************************************************/
+    ATOMIC_FENCE(SEQ_CST);
+    
+    for (reader = map->readers; reader; reader = reader->next)
+    {
+        reader_epoch = ATOMIC_LOAD(&reader->epoch, ACQUIRE);
+        
+        if (reader_epoch != 0 && reader_epoch != map->epoch)
+        {
+            pthread_mutex_unlock(&map->reader_lock);
+            return;
+        }
+    }
+    
+    pthread_mutex_unlock(&map->reader_lock);
+    ATOMIC_STORE(&map->epoch, map->epoch + 1, RELEASE);
+}
+
+/******************************************************************
+* Hands a block no longer reachable from the map over to be freed *
+* once the readers that might still hold it have left. The caller *
+* sets 'retirement->memory'.                                      *
+******************************************************************/
+static void retire_memory(bidirectional_concurrent_hash_map_t* map,
+                          concurrent_retired_memory_t* retirement)
+{
+    pthread_mutex_lock(&map->reclamation_lock);
+    
+    retirement->epoch = map->epoch;
+    retirement->next  = map->retired;
+    map->retired      = retirement;
+    
+    if (++map->retired_count >= RECLAMATION_THRESHOLD)
+    {
+        try_advance_epoch(map);
+        free_retired_memory(map);
+    }
+    
+    pthread_mutex_unlock(&map->reclamation_lock);
+}
+
+/***************************************************************
+* The destructor of 'reader_key'. Frees the reader of an       *
+* exiting thread for the next thread registering with the map. *
+***************************************************************/
+static void release_reader(void* reader)
+{
+    ATOMIC_STORE(&((concurrent_hash_map_reader_t*) reader)->in_use,
+                 0,
+                 RELEASE);
+}
+
+static size_t hash_primary_key(bidirectional_concurrent_hash_map_t* map,
+                               void* primary_key)
+{
+    return bidirectional_hash_map_mix_hash(
+                                    map->primary_key_hasher(primary_key));
+}
+
+static size_t hash_secondary_key(bidirectional_concurrent_hash_map_t* map,
+                                 void* secondary_key)
+{
+    return bidirectional_hash_map_mix_hash(
+                                    map->secondary_key_hasher(secondary_key));
+}
+
+/********************************************************
+* Returns the index of the stripe owning the key hashed *
+* to 'hash'. The lowest bits of the hash select it.     *
+********************************************************/
+static size_t get_stripe_index(bidirectional_concurrent_hash_map_t* map,
+                               size_t hash)
+{
+    return hash & (map->stripe_count - 1);
+}
+
+/****************************************************************
+* Returns the bucket index of the key hashed to 'hash' within a *
+* stripe table of 'capacity' buckets. The bits above the ones   *
+* selecting the stripe select the bucket.                       *
+****************************************************************/
+static size_t get_bucket_index(bidirectional_concurrent_hash_map_t* map,
+                               size_t hash,
+                               size_t capacity)
+{
+    return (hash >> map->stripe_bits) & (capacity - 1);
+}
+
+/***********************************************************************
+* Doubles the primary key table of 'stripe'. The caller holds the lock *
+* of the stripe. If there is no memory, the table is left as it is and *
+* its chains grow longer instead. The old table is retired, as readers *
+* may still be walking it.                                             *
+***********************************************************************/
+static void expand_primary_key_table(bidirectional_concurrent_hash_map_t* map,
+                                     concurrent_hash_map_stripe_t* stripe)
+{
+    size_t i;
+    size_t bucket_index;
+    size_t next_capacity = stripe->primary_key_table_capacity << 1;
+    concurrent_mapping_node_t* node;
+    concurrent_mapping_node_t* next_node;
+    concurrent_mapping_node_t** next_table =
+        calloc(next_capacity, sizeof(concurrent_mapping_node_t*));
+    concurrent_retired_memory_t* retirement =
+        malloc(sizeof(concurrent_retired_memory_t));
+    
+    if (!next_table || !retirement)
+    {
+        free(next_table);
+        free(retirement);
+        return;
+    }
+    
+    for (i = 0; i < stripe->primary_key_table_capacity; ++i)
+    {
+        for (node = stripe->primary_key_table[i]; node; node = next_node)
+        {
+            next_node = node->next_primary;
+            bucket_index = get_bucket_index(map,
+                                            node->key_pair.primary_key_hash,
+                                            next_capacity);
+            ATOMIC_STORE(&node->next_primary,
+                         next_table[bucket_index],
+                         RELAXED);
+            next_table[bucket_index] = node;
+        }
+    }
+    
+    /*************************************************************
+    * Publish the table before its capacity: a reader seeing the *
+    * new capacity is then sure to index the new table.          *
+    *************************************************************/
+    retirement->memory = stripe->primary_key_table;
+    ATOMIC_STORE(&stripe->primary_key_table, next_table, RELEASE);
+    ATOMIC_STORE(&stripe->primary_key_table_capacity, next_capacity, RELEASE);
+    retire_memory(map, retirement);
+}
+
+/************************************************************************
+* Doubles the secondary key table of 'stripe'. The caller holds the     *
+* lock of the stripe. If there is no memory, the table is left as it is *
+* and its chains grow longer instead. The old table is retired, as      *
+* readers may still be walking it.                                      *
+************************************************************************/
+static void expand_secondary_key_table(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    concurrent_hash_map_stripe_t* stripe)
+{
+    size_t i;
+    size_t bucket_index;
+    size_t next_capacity = stripe->secondary_key_table_capacity << 1;
+    concurrent_mapping_node_t* node;
+    concurrent_mapping_node_t* next_node;
+    concurrent_mapping_node_t** next_table =
+        calloc(next_capacity, sizeof(concurrent_mapping_node_t*));
+    concurrent_retired_memory_t* retirement =
+        malloc(sizeof(concurrent_retired_memory_t));
+    
+    if (!next_table || !retirement)
+    {
+        free(next_table);
+        free(retirement);
+        return;
+    }
+    
+    for (i = 0; i < stripe->secondary_key_table_capacity; ++i)
+    {
+        for (node = stripe->secondary_key_table[i]; node; node = next_node)
+        {
+            next_node = node->next_secondary;
+            bucket_index = get_bucket_index(map,
+                                            node->key_pair.secondary_key_hash,
+                                            next_capacity);
+            ATOMIC_STORE(&node->next_secondary,
+                         next_table[bucket_index],
+                         RELAXED);
+            next_table[bucket_index] = node;
+        }
+    }
+    
+    /*************************************************************
+    * Publish the table before its capacity: a reader seeing the *
+    * new capacity is then sure to index the new table.          *
+    *************************************************************/
+    retirement->memory = stripe->secondary_key_table;
+    ATOMIC_STORE(&stripe->secondary_key_table, next_table, RELEASE);
+    ATOMIC_STORE(&stripe->secondary_key_table_capacity, next_capacity, RELEASE);
+    retire_memory(map, retirement);
+}
+
+/****************************************************************
+* Links 'node' into the primary collision chain its primary key *
+* hash selects, growing the table of the stripe first if it is  *
+* full. The caller holds the lock of the stripe.                *
+****************************************************************/
+static void link_primary_key(bidirectional_concurrent_hash_map_t* map,
+                             concurrent_mapping_node_t* node)
+{
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map, get_stripe_index(map, node->key_pair.primary_key_hash));
+    concurrent_mapping_node_t** bucket;
+    
+    if (stripe->primary_key_count + 1 >
+        stripe->primary_key_table_capacity * map->load_factor)
+    {
+        expand_primary_key_table(map, stripe);
+    }
+    
+    bucket = &stripe->primary_key_table[
+                        get_bucket_index(map,
+                                         node->key_pair.primary_key_hash,
+                                         stripe->primary_key_table_capacity)];
+    
+    ATOMIC_STORE(&node->next_primary, *bucket, RELAXED);
+    ATOMIC_STORE(bucket, node, RELEASE);
+    stripe->primary_key_count++;
+}
+
+/*******************************************************************
+* Links 'node' into the secondary collision chain its secondary    *
+* key hash selects, growing the table of the stripe first if it is *
+* full. The caller holds the lock of the stripe.                   *
+*******************************************************************/
+static void link_secondary_key(bidirectional_concurrent_hash_map_t* map,
+                               concurrent_mapping_node_t* node)
+{
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map,
+                   get_stripe_index(map, node->key_pair.secondary_key_hash));
+    concurrent_mapping_node_t** bucket;
+    
+    if (stripe->secondary_key_count + 1 >
+        stripe->secondary_key_table_capacity * map->load_factor)
+    {
+        expand_secondary_key_table(map, stripe);
+    }
+    
+    bucket = &stripe->secondary_key_table[
+                        get_bucket_index(map,
+                                         node->key_pair.secondary_key_hash,
+                                         stripe->secondary_key_table_capacity)];
+    
+    ATOMIC_STORE(&node->next_secondary, *bucket, RELAXED);
+    ATOMIC_STORE(bucket, node, RELEASE);
+    stripe->secondary_key_count++;
+}
+
+/**************************************************************
+* Unlinks 'node' from its primary collision chain. The caller *
+* holds the lock of the stripe of its primary key.            *
+**************************************************************/
+static void unlink_primary_key(bidirectional_concurrent_hash_map_t* map,
+                               concurrent_mapping_node_t* node)
+{
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map, get_stripe_index(map, node->key_pair.primary_key_hash));
+    concurrent_mapping_node_t** link =
+        &stripe->primary_key_table[
+                        get_bucket_index(map,
+                                         node->key_pair.primary_key_hash,
+                                         stripe->primary_key_table_capacity)];
+    
+    while (*link != node)
+    {
+        link = &(*link)->next_primary;
+    }
+    
+    ATOMIC_STORE(link, node->next_primary, RELAXED);
+    stripe->primary_key_count--;
+}
+
+/****************************************************************
+* Unlinks 'node' from its secondary collision chain. The caller *
+* holds the lock of the stripe of its secondary key.            *
+****************************************************************/
+static void unlink_secondary_key(bidirectional_concurrent_hash_map_t* map,
+                                 concurrent_mapping_node_t* node)
+{
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map,
+                   get_stripe_index(map, node->key_pair.secondary_key_hash));
+    concurrent_mapping_node_t** link =
+        &stripe->secondary_key_table[
+                        get_bucket_index(map,
+                                         node->key_pair.secondary_key_hash,
+                                         stripe->secondary_key_table_capacity)];
+    
+    while (*link != node)
+    {
+        link = &(*link)->next_secondary;
+    }
+    
+    ATOMIC_STORE(link, node->next_secondary, RELAXED);
+    stripe->secondary_key_count--;
+}
+
+/*****************************************************************
+* Returns the mapping whose primary key is 'primary_key', or     *
+* NULL if there is none. The caller holds the lock of the stripe *
+* of 'primary_key_hash'.                                         *
+*****************************************************************/
+static concurrent_mapping_node_t* find_by_primary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key,
+                                    size_t primary_key_hash)
+{
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map, get_stripe_index(map, primary_key_hash));
+    concurrent_mapping_node_t* node =
+        stripe->primary_key_table[
+                        get_bucket_index(map,
+                                         primary_key_hash,
+                                         stripe->primary_key_table_capacity)];
+    
+    for (; node; node = node->next_primary)
+    {
+        if (node->key_pair.primary_key_hash == primary_key_hash &&
+            map->primary_key_equality(node->key_pair.primary_key,
+                                      primary_key))
+        {
+            return node;
+        }
+    }
+    
+    return NULL;
+}
+
+/*****************************************************************
+* Returns the mapping whose secondary key is 'secondary_key', or *
+* NULL if there is none. The caller holds the lock of the stripe *
+* of 'secondary_key_hash'.                                       *
+*****************************************************************/
+static concurrent_mapping_node_t* find_by_secondary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* secondary_key,
+                                    size_t secondary_key_hash)
+{
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map, get_stripe_index(map, secondary_key_hash));
+    concurrent_mapping_node_t* node =
+        stripe->secondary_key_table[
+                        get_bucket_index(map,
+                                         secondary_key_hash,
+                                         stripe->secondary_key_table_capacity)];
+    
+    for (; node; node = node->next_secondary)
+    {
+        if (node->key_pair.secondary_key_hash == secondary_key_hash &&
+            map->secondary_key_equality(node->key_pair.secondary_key,
+                                        secondary_key))
+        {
+            return node;
+        }
+    }
+    
+    return NULL;
+}
+
+/*************************************************************************
+* Adds a new mapping to the map. The caller holds the locks of the       *
+* stripes of both the hashes, which may be the same stripe. Returns 0 if *
+* there is no memory for the mapping, and 1 otherwise.                   *
+*************************************************************************/
+static int add_new_mapping(bidirectional_concurrent_hash_map_t* map,
+                           void* primary_key,
+                           size_t primary_key_hash,
+                           void* secondary_key,
+                           size_t secondary_key_hash)
+{
+    concurrent_mapping_node_t* node =
+        malloc(sizeof(concurrent_mapping_node_t));
+    
+    if (!node)
+    {
+        return 0;
+    }
+    
+    node->key_pair.primary_key        = primary_key;
+    node->key_pair.primary_key_hash   = primary_key_hash;
+    node->key_pair.secondary_key      = secondary_key;
+    node->key_pair.secondary_key_hash = secondary_key_hash;
+    
+    link_primary_key(map, node);
+    link_secondary_key(map, node);
+    return 1;
+}
+
+/*************************************************************************
+* Unlinks a mapping from both its collision chains. The caller holds the *
+* locks of the stripes of both its keys, and retires the node once it    *
+* has released them.                                                     *
+*************************************************************************/
+static void remove_mapping(bidirectional_concurrent_hash_map_t* map,
+                           concurrent_mapping_node_t* node)
+{
+    unlink_primary_key(map, node);
+    unlink_secondary_key(map, node);
+}
+
+/************************************************************************
+* Replaces the primary key of a mapping, moving it to the primary       *
+* collision chain of the new key. The caller holds the locks of the     *
+* stripe of the secondary key, and of the old and the new primary keys. *
+************************************************************************/
+static void* update_primary_key(bidirectional_concurrent_hash_map_t* map,
+                                concurrent_mapping_node_t* node,
+                                void* new_primary_key,
+                                size_t new_primary_key_hash)
+{
+    void* old_primary_key = node->key_pair.primary_key;
+    
+    unlink_primary_key(map, node);
+    ATOMIC_STORE(&node->key_pair.primary_key, new_primary_key, RELAXED);
+    ATOMIC_STORE(&node->key_pair.primary_key_hash,
+                 new_primary_key_hash,
+                 RELAXED);
+    link_primary_key(map, node);
+    
+    return old_primary_key;
+}
+
+/************************************************************************
+* Replaces the secondary key of a mapping, moving it to the secondary   *
+* collision chain of the new key. The caller holds the locks of the     *
+* stripe of the primary key, and of the old and the new secondary keys. *
+************************************************************************/
+static void* update_secondary_key(bidirectional_concurrent_hash_map_t* map,
+                                  concurrent_mapping_node_t* node,
+                                  void* new_secondary_key,
+                                  size_t new_secondary_key_hash)
+{
+    void* old_secondary_key = node->key_pair.secondary_key;
+    
+    unlink_secondary_key(map, node);
+    ATOMIC_STORE(&node->key_pair.secondary_key, new_secondary_key, RELAXED);
+    ATOMIC_STORE(&node->key_pair.secondary_key_hash,
+                 new_secondary_key_hash,
+                 RELAXED);
+    link_secondary_key(map, node);
+    
+    return old_secondary_key;
+}
+
+#ifdef CONCURRENT_HASH_MAP_OPTIMISTIC_READS
+/******************************************************************
+* Returns the reader of the calling thread, registering it on the *
+* first lookup of the thread. Returns NULL if there is no memory  *
+* for a new reader.                                               *
+******************************************************************/
+static concurrent_hash_map_reader_t* get_reader(
+                                    bidirectional_concurrent_hash_map_t* map)
+{
+    concurrent_hash_map_reader_t* reader =
+        pthread_getspecific(map->reader_key);
+    concurrent_hash_map_padded_reader_t* padded_reader;
+    
+    if (reader)
+    {
+        return reader;
+    }
+    
+    pthread_mutex_lock(&map->reader_lock);
+    
+    for (reader = map->readers; reader; reader = reader->next)
+    {
+        if (!ATOMIC_LOAD(&reader->in_use, ACQUIRE))
+        {
+            break;
+        }
+    }
+    
+    if (!reader)
+    {
+        padded_reader = malloc(sizeof(concurrent_hash_map_padded_reader_t));
+        
+        if (padded_reader)
+        {
+            reader = &padded_reader->reader;
+            reader->epoch = 0;
+            reader->next  = map->readers;
+            map->readers  = reader;
+        }
+    }
+    
+    if (reader)
+    {
+        ATOMIC_STORE(&reader->in_use, 1, RELAXED);
+        
+        if (pthread_setspecific(map->reader_key, reader) != 0)
+        {
+            ATOMIC_STORE(&reader->in_use, 0, RELAXED);
+            reader = NULL;
+        }
+    }
+    
+    pthread_mutex_unlock(&map->reader_lock);
+    return reader;
+}
+
+/**************************************************************
+* Announces that the calling thread starts a lock-free lookup *
+* in the current epoch. Returns NULL if the thread has no     *
+* reader and cannot get one.                                  *
+**************************************************************/
+static concurrent_hash_map_reader_t* enter_lookup(
+                                    bidirectional_concurrent_hash_map_t* map)
+{
+    concurrent_hash_map_reader_t* reader = get_reader(map);
+    
+    if (reader)
+    {
+        ATOMIC_STORE(&reader->epoch,
+                     ATOMIC_LOAD(&map->epoch, ACQUIRE),
+                     RELAXED);
+        ATOMIC_FENCE(SEQ_CST);
+    }
+    
+    return reader;
+}
+
+static void leave_lookup(concurrent_hash_map_reader_t* reader)
+{
+    ATOMIC_STORE(&reader->epoch, 0, RELEASE);
+}
+
+/************************************************************************
+* Looks 'primary_key' up without locking. Returns 0 if a writer changed *
+* the stripe meanwhile, in which case the result may be wrong and the   *
+* lookup has to be retried. Otherwise returns 1, and stores whether the *
+* key was found in '*found_ptr' and its secondary key in                *
+* '*secondary_key_ptr'.                                                 *
+************************************************************************/
+static int try_look_up_primary_key(bidirectional_concurrent_hash_map_t* map,
+                                   void* primary_key,
+                                   size_t primary_key_hash,
+                                   int* found_ptr,
+                                   void** secondary_key_ptr)
+{
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map, get_stripe_index(map, primary_key_hash));
+    concurrent_mapping_node_t** table;
+    concurrent_mapping_node_t* node;
+    size_t capacity;
+    size_t sequence = ATOMIC_LOAD(&stripe->sequence, ACQUIRE);
+    
+    if (sequence & 1)
+    {
+        return 0;
+    }
+    
+    capacity = ATOMIC_LOAD(&stripe->primary_key_table_capacity, ACQUIRE);
+    table    = ATOMIC_LOAD(&stripe->primary_key_table, ACQUIRE);
+    node     = ATOMIC_LOAD(&table[get_bucket_index(map,
+                                                   primary_key_hash,
+                                                   capacity)],
+                           ACQUIRE);
+    
+    *found_ptr = 0;
+    *secondary_key_ptr = NULL;
+    
+    while (node)
+    {
+        if (ATOMIC_LOAD(&node->key_pair.primary_key_hash, RELAXED) ==
+            primary_key_hash &&
+            map->primary_key_equality(
+                            ATOMIC_LOAD(&node->key_pair.primary_key, RELAXED),
+                            primary_key))
+        {
+            *found_ptr = 1;
+            *secondary_key_ptr =
+                ATOMIC_LOAD(&node->key_pair.secondary_key, RELAXED);
+            break;
+        }
+        
+        node = ATOMIC_LOAD(&node->next_primary, ACQUIRE);
+        
+        /************************************************************
+        * A mapping moved by a writer can lead the reader into      *
+        * another chain, or around in circles, so give up as soon   *
+        * as the stripe changes instead of at the end of the chain. *
+        ************************************************************/
+        ATOMIC_FENCE(ACQUIRE);
+        
+        if (ATOMIC_LOAD(&stripe->sequence, RELAXED) != sequence)
+        {
+            return 0;
+        }
+    }
+    
+    ATOMIC_FENCE(ACQUIRE);
+    return ATOMIC_LOAD(&stripe->sequence, RELAXED) == sequence;
+}
+
+/**********************************************************************
+* Looks 'secondary_key' up without locking. Returns 0 if a writer     *
+* changed the stripe meanwhile, in which case the result may be wrong *
+* and the lookup has to be retried. Otherwise returns 1, and stores   *
+* whether the key was found in '*found_ptr' and its primary key in    *
+* '*primary_key_ptr'.                                                 *
+**********************************************************************/
+static int try_look_up_secondary_key(bidirectional_concurrent_hash_map_t* map,
+                                     void* secondary_key,
+                                     size_t secondary_key_hash,
+                                     int* found_ptr,
+                                     void** primary_key_ptr)
+{
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map, get_stripe_index(map, secondary_key_hash));
+    concurrent_mapping_node_t** table;
+    concurrent_mapping_node_t* node;
+    size_t capacity;
+    size_t sequence = ATOMIC_LOAD(&stripe->sequence, ACQUIRE);
+    
+    if (sequence & 1)
+    {
+        return 0;
+    }
+    
+    capacity = ATOMIC_LOAD(&stripe->secondary_key_table_capacity, ACQUIRE);
+    table    = ATOMIC_LOAD(&stripe->secondary_key_table, ACQUIRE);
+    node     = ATOMIC_LOAD(&table[get_bucket_index(map,
+                                                   secondary_key_hash,
+                                                   capacity)],
+                           ACQUIRE);
+    
+    *found_ptr = 0;
+    *primary_key_ptr = NULL;
+    
+    while (node)
+    {
+        if (ATOMIC_LOAD(&node->key_pair.secondary_key_hash, RELAXED) ==
+            secondary_key_hash &&
+            map->secondary_key_equality(
+                            ATOMIC_LOAD(&node->key_pair.secondary_key, RELAXED),
+                            secondary_key))
+        {
+            *found_ptr = 1;
+            *primary_key_ptr =
+                ATOMIC_LOAD(&node->key_pair.primary_key, RELAXED);
+            break;
+        }
+        
+        node = ATOMIC_LOAD(&node->next_secondary, ACQUIRE);
+        ATOMIC_FENCE(ACQUIRE);
+        
+        if (ATOMIC_LOAD(&stripe->sequence, RELAXED) != sequence)
+        {
+            return 0;
+        }
+    }
+    
+    ATOMIC_FENCE(ACQUIRE);
+    return ATOMIC_LOAD(&stripe->sequence, RELAXED) == sequence;
+}
+#endif
+
+/*****************************************************************
+* Looks 'primary_key' up, storing its secondary key, or NULL, in *
+* '*secondary_key_ptr'. Returns 1 if the key is in the map, and  *
+* 0 otherwise. Takes the lock of the stripe only if the lookups  *
+* cannot go lock-free, or keep racing writers.                   *
+*****************************************************************/
+static int look_up_primary_key(bidirectional_concurrent_hash_map_t* map,
+                               void* primary_key,
+                               void** secondary_key_ptr)
+{
+    size_t primary_key_hash = hash_primary_key(map, primary_key);
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map, get_stripe_index(map, primary_key_hash));
+    concurrent_mapping_node_t* node;
+    
+#ifdef CONCURRENT_HASH_MAP_OPTIMISTIC_READS
+    int attempt;
+    int found;
+    concurrent_hash_map_reader_t* reader = enter_lookup(map);
+    
+    if (reader)
+    {
+        for (attempt = 0; attempt < MAXIMUM_OPTIMISTIC_ATTEMPTS; ++attempt)
+        {
+            if (try_look_up_primary_key(map,
+                                        primary_key,
+                                        primary_key_hash,
+                                        &found,
+                                        secondary_key_ptr))
+            {
+                leave_lookup(reader);
+                return found;
+            }
+        }
+        
+        leave_lookup(reader);
+    }
+#endif
+    
+    pthread_mutex_lock(&stripe->lock);
+    node = find_by_primary_key(map, primary_key, primary_key_hash);
+    *secondary_key_ptr = node ? node->key_pair.secondary_key : NULL;
+    pthread_mutex_unlock(&stripe->lock);
+    
+    return node != NULL;
+}
+
+/*****************************************************************
+* Looks 'secondary_key' up, storing its primary key, or NULL, in *
+* '*primary_key_ptr'. Returns 1 if the key is in the map, and 0  *
+* otherwise. Takes the lock of the stripe only if the lookups    *
+* cannot go lock-free, or keep racing writers.                   *
+*****************************************************************/
+static int look_up_secondary_key(bidirectional_concurrent_hash_map_t* map,
+                                 void* secondary_key,
+                                 void** primary_key_ptr)
+{
+    size_t secondary_key_hash = hash_secondary_key(map, secondary_key);
+    concurrent_hash_map_stripe_t* stripe =
+        get_stripe(map, get_stripe_index(map, secondary_key_hash));
+    concurrent_mapping_node_t* node;
+    
+#ifdef CONCURRENT_HASH_MAP_OPTIMISTIC_READS
+    int attempt;
+    int found;
+    concurrent_hash_map_reader_t* reader = enter_lookup(map);
+    
+    if (reader)
+    {
+        for (attempt = 0; attempt < MAXIMUM_OPTIMISTIC_ATTEMPTS; ++attempt)
+        {
+            if (try_look_up_secondary_key(map,
+                                          secondary_key,
+                                          secondary_key_hash,
+                                          &found,
+                                          primary_key_ptr))
+            {
+                leave_lookup(reader);
+                return found;
+            }
+        }
+        
+        leave_lookup(reader);
+    }
+#endif
+    
+    pthread_mutex_lock(&stripe->lock);
+    node = find_by_secondary_key(map, secondary_key, secondary_key_hash);
+    *primary_key_ptr = node ? node->key_pair.primary_key : NULL;
+    pthread_mutex_unlock(&stripe->lock);
+    
+    return node != NULL;
+}
+
+/************************************************************************
+* Frees the tables of the first 'stripe_count' stripes along with every *
+* mapping they hold, and destroys their locks.                          *
+************************************************************************/
+static void release_stripes(bidirectional_concurrent_hash_map_t* map,
+                            size_t stripe_count)
+{
+    size_t i;
+    size_t j;
+    concurrent_hash_map_stripe_t* stripe;
+    concurrent_mapping_node_t* node;
+    concurrent_mapping_node_t* next_node;
+    
+    for (i = 0; i < stripe_count; ++i)
+    {
+        stripe = get_stripe(map, i);
+        
+        /********************************************************
+        * Every mapping is in exactly one primary chain, so the *
+        * primary tables are where the mappings are freed from. *
+        ********************************************************/
+        for (j = 0; j < stripe->primary_key_table_capacity; ++j)
+        {
+            for (node = stripe->primary_key_table[j]; node; node = next_node)
+            {
+                next_node = node->next_primary;
+                free(node);
+            }
+        }
+        
+        free(stripe->primary_key_table);
+        free(stripe->secondary_key_table);
+        pthread_mutex_destroy(&stripe->lock);
+    }
+}
+
+/******************************************************************
+* Sets up the epochs, the retired list and the reader registry of *
+* the map. Returns 0 if a lock or the thread key cannot be had.   *
+******************************************************************/
+static int init_reclamation(bidirectional_concurrent_hash_map_t* map)
+{
+    map->epoch         = FIRST_EPOCH;
+    map->retired       = NULL;
+    map->retired_count = 0;
+    map->readers       = NULL;
+    
+    if (pthread_mutex_init(&map->reclamation_lock, NULL) != 0)
+    {
+        return 0;
+    }
+    
+    if (pthread_mutex_init(&map->reader_lock, NULL) != 0)
+    {
+        pthread_mutex_destroy(&map->reclamation_lock);
+        return 0;
+    }
+    
+    if (pthread_key_create(&map->reader_key, release_reader) != 0)
+    {
+        pthread_mutex_destroy(&map->reader_lock);
+        pthread_mutex_destroy(&map->reclamation_lock);
+        return 0;
+    }
+    
+    return 1;
+}
+
+/***************************************************************
+* Frees every retired block and every reader regardless of the *
+* epochs, as no thread may use the map any more, and releases  *
+* the locks and the thread key.                                *
+***************************************************************/
+static void release_reclamation(bidirectional_concurrent_hash_map_t* map)
+{
+    concurrent_retired_memory_t* retirement;
+    concurrent_retired_memory_t* next_retirement;
+    concurrent_hash_map_reader_t* reader;
+    concurrent_hash_map_reader_t* next_reader;
+    
+    pthread_key_delete(map->reader_key);
+    
+    for (retirement = map->retired; retirement; retirement = next_retirement)
+    {
+        next_retirement = retirement->next;
+        free_retirement(retirement);
+    }
+    
+    for (reader = map->readers; reader; reader = next_reader)
+    {
+        next_reader = reader->next;
+        free(reader);
+    }
+    
+    pthread_mutex_destroy(&map->reader_lock);
+    pthread_mutex_destroy(&map->reclamation_lock);
+}
+
+int bidirectional_concurrent_hash_map_t_init(
+        bidirectional_concurrent_hash_map_t* map,
+        size_t stripe_count,
+        float load_factor,
+        size_t (*primary_key_hasher)  (void*),
+        size_t (*secondary_key_hasher)(void*),
+        int (*primary_key_equality)   (void*, void*),
+        int (*secondary_key_equality)  (void*, void*),
+        void* error_sentinel)
+{
+    size_t i;
+    size_t stripe_bits = 0;
+    concurrent_hash_map_stripe_t* stripe;
+    
+    if (!map || !primary_key_hasher || !secondary_key_hasher
+             || !primary_key_equality || !secondary_key_equality)
+    {
+        return 0;
+    }
+    
+    while (((size_t) 1 << stripe_bits) < stripe_count &&
+           ((size_t) 1 << stripe_bits) < MAXIMUM_STRIPE_COUNT)
+    {
+        stripe_bits++;
+    }
+    
+    map->stripe_count = (size_t) 1 << stripe_bits;
+    map->stripe_bits  = stripe_bits;
+    
+    /**********************************************************
+    * Over-allocate by a stripe, so that the first stripe can *
+    * start at a multiple of the stripe size.                 *
+    **********************************************************/
+    map->stripe_block = malloc((map->stripe_count + 1) *
+                               sizeof(concurrent_hash_map_padded_stripe_t));
+    
+    if (!map->stripe_block)
+    {
+        return 0;
+    }
+    
+    map->stripes = (concurrent_hash_map_padded_stripe_t*)
+                   (((uintptr_t) map->stripe_block +
+                     CONCURRENT_HASH_MAP_STRIPE_SIZE - 1) &
+                    ~(uintptr_t)(CONCURRENT_HASH_MAP_STRIPE_SIZE - 1));
+    
+    map->load_factor            = max_float(load_factor, MINIMUM_LOAD_FACTOR);
+    map->primary_key_hasher     = primary_key_hasher;
+    map->secondary_key_hasher   = secondary_key_hasher;
+    map->primary_key_equality   = primary_key_equality;
+    map->secondary_key_equality = secondary_key_equality;
+    map->error_sentinel         = error_sentinel;
+    
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        stripe = get_stripe(map, i);
+        
+        stripe->primary_key_table_capacity   = INITIAL_STRIPE_CAPACITY;
+        stripe->secondary_key_table_capacity = INITIAL_STRIPE_CAPACITY;
+        stripe->primary_key_count            = 0;
+        stripe->secondary_key_count          = 0;
+        stripe->sequence                     = 0;
+        stripe->primary_key_table =
+            calloc(INITIAL_STRIPE_CAPACITY, sizeof(concurrent_mapping_node_t*));
+        stripe->secondary_key_table =
+            calloc(INITIAL_STRIPE_CAPACITY, sizeof(concurrent_mapping_node_t*));
+        
+        if (!stripe->primary_key_table || !stripe->secondary_key_table ||
+            pthread_mutex_init(&stripe->lock, NULL) != 0)
+        {
+            free(stripe->primary_key_table);
+            free(stripe->secondary_key_table);
+            release_stripes(map, i);
+            free(map->stripe_block);
+            map->stripe_block = NULL;
+            return 0;
+        }
+    }
+    
+    if (!init_reclamation(map))
+    {
+        release_stripes(map, map->stripe_count);
+        free(map->stripe_block);
+        map->stripe_block = NULL;
+        return 0;
+    }
+    
+    return 1;
+}
+
+void bidirectional_concurrent_hash_map_t_destroy(
+                                    bidirectional_concurrent_hash_map_t* map)
+{
+    if (!map || !map->stripe_block)
+    {
+        return;
+    }
+    
+    release_stripes(map, map->stripe_count);
+    release_reclamation(map);
+    free(map->stripe_block);
+    
+    map->stripe_block = NULL;
+    map->stripes      = NULL;
+}
+
+size_t bidirectional_concurrent_hash_map_t_size(
+                                    bidirectional_concurrent_hash_map_t* map)
+{
+    size_t i;
+    size_t size = 0;
+    concurrent_hash_map_stripe_t* stripe;
+    
+    for (i = 0; i < map->stripe_count; ++i)
+    {
+        stripe = get_stripe(map, i);
+        pthread_mutex_lock(&stripe->lock);
+        size += stripe->primary_key_count;
+        pthread_mutex_unlock(&stripe->lock);
+    }
+    
+    return size;
+}
+
+void* bidirectional_concurrent_hash_map_t_put_by_primary(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key,
+                                    void* secondary_key)
+{
+    size_t primary_key_hash   = hash_primary_key(map, primary_key);
+    size_t secondary_key_hash = hash_secondary_key(map, secondary_key);
+    size_t old_secondary_stripe_index;
+    concurrent_mapping_node_t* node;
+    stripe_set_t stripes;
+    void* result;
+    
+    stripe_set_clear(&stripes);
+    stripe_set_add(&stripes, get_stripe_index(map, primary_key_hash));
+    stripe_set_add(&stripes, get_stripe_index(map, secondary_key_hash));
+    
+    for (;;)
+    {
+        lock_stripes(map, &stripes);
+        node = find_by_primary_key(map, primary_key, primary_key_hash);
+        
+        if (!node)
+        {
+            result = add_new_mapping(map,
+                                     primary_key,
+                                     primary_key_hash,
+                                     secondary_key,
+                                     secondary_key_hash) ?
+                     NULL :
+                     map->error_sentinel;
+            break;
+        }
+        
+        old_secondary_stripe_index =
+            get_stripe_index(map, node->key_pair.secondary_key_hash);
+        
+        if (stripe_set_contains(&stripes, old_secondary_stripe_index))
+        {
+            result = update_secondary_key(map,
+                                          node,
+                                          secondary_key,
+                                          secondary_key_hash);
+            break;
+        }
+        
+        /*************************************************************
+        * The old secondary key is in a stripe not locked yet, and   *
+        * locking it now might break the lock order. Start over with *
+        * all the three stripes; if the mapping changes meanwhile,   *
+        * the next round finds out.                                  *
+        *************************************************************/
+        unlock_stripes(map, &stripes);
+        stripe_set_clear(&stripes);
+        stripe_set_add(&stripes, get_stripe_index(map, primary_key_hash));
+        stripe_set_add(&stripes, get_stripe_index(map, secondary_key_hash));
+        stripe_set_add(&stripes, old_secondary_stripe_index);
+    }
+    
+    unlock_stripes(map, &stripes);
+    return result;
+}
+
+void* bidirectional_concurrent_hash_map_t_put_by_secondary(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key,
+                                    void* secondary_key)
+{
+    size_t primary_key_hash   = hash_primary_key(map, primary_key);
+    size_t secondary_key_hash = hash_secondary_key(map, secondary_key);
+    size_t old_primary_stripe_index;
+    concurrent_mapping_node_t* node;
+    stripe_set_t stripes;
+    void* result;
+    
+    stripe_set_clear(&stripes);
+    stripe_set_add(&stripes, get_stripe_index(map, primary_key_hash));
+    stripe_set_add(&stripes, get_stripe_index(map, secondary_key_hash));
+    
+    for (;;)
+    {
+        lock_stripes(map, &stripes);
+        node = find_by_secondary_key(map, secondary_key, secondary_key_hash);
+        
+        if (!node)
+        {
+            result = add_new_mapping(map,
+                                     primary_key,
+                                     primary_key_hash,
+                                     secondary_key,
+                                     secondary_key_hash) ?
+                     NULL :
+                     map->error_sentinel;
+            break;
+        }
+        
+        old_primary_stripe_index =
+            get_stripe_index(map, node->key_pair.primary_key_hash);
+        
+        if (stripe_set_contains(&stripes, old_primary_stripe_index))
+        {
+            result = update_primary_key(map,
+                                        node,
+                                        primary_key,
+                                        primary_key_hash);
+            break;
+        }
+        
+        unlock_stripes(map, &stripes);
+        stripe_set_clear(&stripes);
+        stripe_set_add(&stripes, get_stripe_index(map, primary_key_hash));
+        stripe_set_add(&stripes, get_stripe_index(map, secondary_key_hash));
+        stripe_set_add(&stripes, old_primary_stripe_index);
+    }
+    
+    unlock_stripes(map, &stripes);
+    return result;
+}
+
+void* bidirectional_concurrent_hash_map_t_remove_by_primary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key)
+{
+    size_t primary_key_hash = hash_primary_key(map, primary_key);
+    size_t secondary_stripe_index;
+    concurrent_mapping_node_t* node;
+    stripe_set_t stripes;
+    void* secondary_key;
+    
+    stripe_set_clear(&stripes);
+    stripe_set_add(&stripes, get_stripe_index(map, primary_key_hash));
+    
+    for (;;)
+    {
+        lock_stripes(map, &stripes);
+        node = find_by_primary_key(map, primary_key, primary_key_hash);
+        
+        if (!node)
+        {
+            unlock_stripes(map, &stripes);
+            return NULL;
+        }
+        
+        secondary_stripe_index =
+            get_stripe_index(map, node->key_pair.secondary_key_hash);
+        
+        if (stripe_set_contains(&stripes, secondary_stripe_index))
+        {
+            break;
+        }
+        
+        unlock_stripes(map, &stripes);
+        stripe_set_clear(&stripes);
+        stripe_set_add(&stripes, get_stripe_index(map, primary_key_hash));
+        stripe_set_add(&stripes, secondary_stripe_index);
+    }
+    
+    remove_mapping(map, node);
+    unlock_stripes(map, &stripes);
+    
+    secondary_key = node->key_pair.secondary_key;
+    node->retirement.memory = node;
+    retire_memory(map, &node->retirement);
+    return secondary_key;
+}
+
+void* bidirectional_concurrent_hash_map_t_remove_by_secondary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* secondary_key)
+{
+    size_t secondary_key_hash = hash_secondary_key(map, secondary_key);
+    size_t primary_stripe_index;
+    concurrent_mapping_node_t* node;
+    stripe_set_t stripes;
+    void* primary_key;
+    
+    stripe_set_clear(&stripes);
+    stripe_set_add(&stripes, get_stripe_index(map, secondary_key_hash));
+    
+    for (;;)
+    {
+        lock_stripes(map, &stripes);
+        node = find_by_secondary_key(map, secondary_key, secondary_key_hash);
+        
+        if (!node)
+        {
+            unlock_stripes(map, &stripes);
+            return NULL;
+        }
+        
+        primary_stripe_index =
+            get_stripe_index(map, node->key_pair.primary_key_hash);
+        
+        if (stripe_set_contains(&stripes, primary_stripe_index))
+        {
+            break;
+        }
+        
+        unlock_stripes(map, &stripes);
+        stripe_set_clear(&stripes);
+        stripe_set_add(&stripes, get_stripe_index(map, secondary_key_hash));
+        stripe_set_add(&stripes, primary_stripe_index);
+    }
+    
+    remove_mapping(map, node);
+    unlock_stripes(map, &stripes);
+    
+    primary_key = node->key_pair.primary_key;
+    node->retirement.memory = node;
+    retire_memory(map, &node->retirement);
+    return primary_key;
+}
+
+void* bidirectional_concurrent_hash_map_t_get_by_primary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key)
+{
+    void* secondary_key;
+    
+    look_up_primary_key(map, primary_key, &secondary_key);
+    return secondary_key;
+}
+
+void* bidirectional_concurrent_hash_map_t_get_by_secondary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* secondary_key)
+{
+    void* primary_key;
+    
+    look_up_secondary_key(map, secondary_key, &primary_key);
+    return primary_key;
+}
+
+int bidirectional_concurrent_hash_map_t_contains_primary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key)
+{
+    void* secondary_key;
+    
+    return look_up_primary_key(map, primary_key, &secondary_key);
+}
+
+int bidirectional_concurrent_hash_map_t_contains_secondary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* secondary_key)
+{
+    void* primary_key;
+    
+    return look_up_secondary_key(map, secondary_key, &primary_key);
+}
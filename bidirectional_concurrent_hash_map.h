@@ -0,0 +1,476 @@
+#ifndef BIDIRECTIONAL_CONCURRENT_HASH_MAP_H
+#define BIDIRECTIONAL_CONCURRENT_HASH_MAP_H
+
+#include "key_pair.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/******************************************************************************
+* A bidirectional hash map that any number of threads may use at once. Both   *
+* hash tables are sharded into lock stripes: the hash of a key selects a      *
+* stripe, and the stripe owns the buckets of all the keys hashing to it, the  *
+* primary ones and the secondary ones alike, along with a mutex guarding      *
+* them. A mapping is thus reachable from the stripe of its primary key and    *
+* from the stripe of its secondary key, and changing it takes both locks.     *
+*                                                                             *
+* Operations that touch two or three stripes lock them in the ascending order *
+* of their indices. An operation that learns of another stripe it needs only  *
+* after having looked the mapping up releases its locks, and retries with all *
+* of them, so no thread ever waits for a lock while holding a higher one, and *
+* no deadlock is possible. Each stripe grows its own tables, so a resize      *
+* blocks only the keys of one stripe.                                         *
+*                                                                             *
+* Where the compiler offers atomic builtins, lookups take no lock and write   *
+* no shared memory. Each stripe has a sequence counter that writers make odd  *
+* while they change the stripe; a reader walks the chains optimistically and  *
+* retries if the counter moved meanwhile. Removed mappings and outgrown       *
+* tables are freed only once every reader that might still see them has left  *
+* its lookup, which the readers announce through epochs. The map cannot do    *
+* the same for the keys themselves: a lookup racing a writer may still pass a *
+* key just removed or replaced to the equality function, so the memory of     *
+* such a key must outlive the lookups running at the time of the removal.     *
+*                                                                             *
+* Each thread finds its reader through a thread-specific data key, and every  *
+* live map holds one such key from init to destroy. A process has only        *
+* PTHREAD_KEYS_MAX of them (1024 with glibc), shared with all the other code  *
+* using them, so at most that many concurrent maps can live at once; beyond   *
+* that, initializing a map fails.                                             *
+******************************************************************************/
+
+/*******************************************************************
+* A block of memory no longer reachable from the map, awaiting the *
+* moment no reader can hold a pointer to it any more.              *
+*******************************************************************/
+typedef struct concurrent_retired_memory_t {
+    
+    /***************************************************************
+    * The block to free. If it is the record itself, the record is *
+    * the first member of the block; otherwise the record was      *
+    * allocated on its own, and is freed along with the block.     *
+    ***************************************************************/
+    void* memory;
+    
+    /*************************************************
+    * The global epoch of the map at the retirement. *
+    *************************************************/
+    size_t epoch;
+    
+    /***********************************
+    * The next retired block, or NULL. *
+    ***********************************/
+    struct concurrent_retired_memory_t* next;
+}
+concurrent_retired_memory_t;
+
+/*************************************************************************
+* A mapping of the concurrent map. It is linked into a primary collision *
+* chain and a secondary one, possibly of two different stripes.          *
+*************************************************************************/
+typedef struct concurrent_mapping_node_t {
+    
+    /*****************************************************************
+    * The record by which the mapping is retired once it is removed. *
+    * It comes first, so that its address is that of the mapping.    *
+    * Readers never look at it.                                      *
+    *****************************************************************/
+    concurrent_retired_memory_t retirement;
+    
+    /******************************************************************
+    * The keys and their hashes, mixed with the built-in mixer of the *
+    * map.                                                            *
+    ******************************************************************/
+    key_pair_t key_pair;
+    
+    /************************************************************
+    * The next mapping in the primary collision chain, or NULL. *
+    ************************************************************/
+    struct concurrent_mapping_node_t* next_primary;
+    
+    /**************************************************************
+    * The next mapping in the secondary collision chain, or NULL. *
+    **************************************************************/
+    struct concurrent_mapping_node_t* next_secondary;
+
+}
+concurrent_mapping_node_t;
+
+/*********************************************************************
+* A lock stripe: a mutex and the slices of both hash tables it owns. *
+*********************************************************************/
+typedef struct concurrent_hash_map_stripe_t {
+    
+    /**************************************************
+    * Guards every other field of this stripe and the *
+    * collision chains hanging off its buckets.       *
+    **************************************************/
+    pthread_mutex_t lock;
+    
+    /***********************************************************
+    * The buckets of the primary keys whose hashes select this *
+    * stripe.                                                  *
+    ***********************************************************/
+    concurrent_mapping_node_t** primary_key_table;
+    
+    /*************************************************************
+    * The buckets of the secondary keys whose hashes select this *
+    * stripe.                                                    *
+    *************************************************************/
+    concurrent_mapping_node_t** secondary_key_table;
+    
+    /************************************************
+    * The number of buckets in 'primary_key_table'. *
+    ************************************************/
+    size_t primary_key_table_capacity;
+    
+    /**************************************************
+    * The number of buckets in 'secondary_key_table'. *
+    **************************************************/
+    size_t secondary_key_table_capacity;
+    
+    /*************************************************
+    * The number of mappings in 'primary_key_table'. *
+    *************************************************/
+    size_t primary_key_count;
+    
+    /***************************************************
+    * The number of mappings in 'secondary_key_table'. *
+    ***************************************************/
+    size_t secondary_key_count;
+    
+    /***************************************************************
+    * Incremented by the writers holding the lock both when they   *
+    * start and when they stop changing the stripe, so it is odd   *
+    * while a change is under way. A lock-free reader that sees it *
+    * odd or changed has to retry.                                 *
+    ***************************************************************/
+    size_t sequence;
+}
+concurrent_hash_map_stripe_t;
+
+/*******************************************************************
+* The number of bytes each stripe is padded to. Two cache lines,   *
+* since the processor fetches adjacent lines in pairs: two threads *
+* working on two neighbouring stripes share no line this way.      *
+*******************************************************************/
+#define CONCURRENT_HASH_MAP_STRIPE_SIZE 128
+
+/***************************************************************
+* A stripe padded to CONCURRENT_HASH_MAP_STRIPE_SIZE bytes, so *
+* that the locks of different stripes are not falsely shared.  *
+***************************************************************/
+typedef union concurrent_hash_map_padded_stripe_t {
+    
+    /**************
+    * The stripe. *
+    **************/
+    concurrent_hash_map_stripe_t stripe;
+    
+    /***********************************
+    * The padding up to the full size. *
+    ***********************************/
+    char padding[CONCURRENT_HASH_MAP_STRIPE_SIZE];
+}
+concurrent_hash_map_padded_stripe_t;
+
+/*****************************************************************
+* The announcement of one reading thread. Only its thread writes *
+* 'epoch', so lookups write no memory another thread writes.     *
+*****************************************************************/
+typedef struct concurrent_hash_map_reader_t {
+    
+    /***************************************************************
+    * The global epoch the thread read at the start of its current *
+    * lookup, or 0 while the thread is not looking anything up.    *
+    ***************************************************************/
+    size_t epoch;
+    
+    /************************************************************
+    * Zero once the thread has exited and the record is free to *
+    * be taken by another thread. The exiting thread clears it  *
+    * without taking 'reader_lock'.                             *
+    ************************************************************/
+    int in_use;
+    
+    /***************************************
+    * The next reader of the map, or NULL. *
+    ***************************************/
+    struct concurrent_hash_map_reader_t* next;
+}
+concurrent_hash_map_reader_t;
+
+/**********************************************************************
+* A reader padded to CONCURRENT_HASH_MAP_STRIPE_SIZE bytes, so that a *
+* thread announcing its epoch does not disturb the others.            *
+**********************************************************************/
+typedef union concurrent_hash_map_padded_reader_t {
+    
+    /**************
+    * The reader. *
+    **************/
+    concurrent_hash_map_reader_t reader;
+    
+    /***********************************
+    * The padding up to the full size. *
+    ***********************************/
+    char padding[CONCURRENT_HASH_MAP_STRIPE_SIZE];
+}
+concurrent_hash_map_padded_reader_t;
+
+typedef struct bidirectional_concurrent_hash_map_t {
+    
+    /****************************************************************
+    * The stripes, aligned to CONCURRENT_HASH_MAP_STRIPE_SIZE bytes *
+    * within 'stripe_block'.                                        *
+    ****************************************************************/
+    concurrent_hash_map_padded_stripe_t* stripes;
+    
+    /**********************************************
+    * The memory block the stripes are carved of. *
+    **********************************************/
+    void* stripe_block;
+    
+    /************************************************
+    * The number of stripes. Always a power of two. *
+    ************************************************/
+    size_t stripe_count;
+    
+    /*******************************************************************
+    * The number of low hash bits selecting the stripe. The bits above *
+    * them select the bucket within the stripe.                        *
+    *******************************************************************/
+    size_t stripe_bits;
+    
+    /************************************************
+    * The maximum load factor of the bucket tables. *
+    ************************************************/
+    float load_factor;
+    
+    /***************************************************************************
+    * The function producing the bucket index in the primary key table given a *
+    * primary key.                                                             *
+    ***************************************************************************/
+    size_t (*primary_key_hasher)(void* primary_key);
+    
+    /***************************************************************************
+    * The function producing the bucket index in the secondary key table given *
+    * a secondary key.                                                         *
+    ***************************************************************************/
+    size_t (*secondary_key_hasher)(void* secondary_key);
+    
+    /*****************************************************
+    * The function for comparing two given primary keys. *
+    *****************************************************/
+    int    (*primary_key_equality)(void* primary_key_1, void* primary_key_2);
+    
+    /*******************************************************
+    * The function for comparing two given secondary keys. *
+    *******************************************************/
+    int    (*secondary_key_equality)(void* secondary_key_1,
+                                     void* secondary_key_2);
+    
+    /*****************************************
+    * A value that is returned upon failure. *
+    *****************************************/
+    void* error_sentinel;
+    
+    /******************************************************************
+    * The global epoch. It advances once every reader in a lookup has *
+    * seen its current value, so a block retired at epoch E can no    *
+    * longer be reached by any reader once the epoch is E + 2.        *
+    ******************************************************************/
+    size_t epoch;
+    
+    /***********************************************************
+    * Guards 'retired' and 'retired_count', and serializes the *
+    * advancing of the epoch.                                  *
+    ***********************************************************/
+    pthread_mutex_t reclamation_lock;
+    
+    /********************************************************
+    * The blocks waiting to be freed, the latest one first. *
+    ********************************************************/
+    concurrent_retired_memory_t* retired;
+    
+    /*************************************
+    * The number of blocks in 'retired'. *
+    *************************************/
+    size_t retired_count;
+    
+    /************************************************************
+    * Guards the list of readers and the claiming of free ones. *
+    ************************************************************/
+    pthread_mutex_t reader_lock;
+    
+    /************************************************
+    * All the readers ever registered with the map. *
+    ************************************************/
+    concurrent_hash_map_reader_t* readers;
+    
+    /**********************************************************
+    * Maps each thread to its reader, registered on its first *
+    * lookup and released when the thread exits.              *
+    **********************************************************/
+    pthread_key_t reader_key;
+}
+bidirectional_concurrent_hash_map_t;
+
+/****************************************************************************
+* Builds a new, empty concurrent bidirectional hash map. The hashers and  | *
+* the equality functions are called from any thread, possibly at once.    | *
+*-------------------------------------------------------------------------+ *
+* map -------------------- the map to initialize.                           *
+* stripe_count ----------- the number of lock stripes. Rounded up to a      *
+*                          power of two. A few times the number of threads  *
+*                          using the map keeps the contention low.          *
+* load_factor ------------ the maximum load factor of each stripe.          *
+* primary_key_hasher ----- the function for producing primary key hashes.   *
+* secondary_key_hasher --- the function for producing secondary key hashes. *
+* primary_key_equality --- the function for comparing primary keys.         *
+* secondary_key_equality - the function for comparing secondary keys.       *
+* error_sentinel --------- the value returned on failed addition.           *
+*-------------------------------------------------------------------------+ *
+* RETURNS: 1 if initialization was successfull, 0 otherwise, such as when | *
+* the process has no thread-specific data key left.                       | *
+****************************************************************************/
+int bidirectional_concurrent_hash_map_t_init(
+        bidirectional_concurrent_hash_map_t* map,
+        size_t stripe_count,
+        float load_factor,
+        size_t (*primary_key_hasher)  (void*),
+        size_t (*secondary_key_hasher)(void*),
+        int (*primary_key_equality)   (void*, void*),
+        int (*secondary_key_equality)  (void*, void*),
+        void* error_sentinel);
+
+/**************************************************************************
+* Releases all the resources of the input map. No other thread may use  | *
+* the map any more.                                                     | *
+*-----------------------------------------------------------------------+ *
+* map - the map to destroy.                                               *
+**************************************************************************/
+void bidirectional_concurrent_hash_map_t_destroy(
+                                    bidirectional_concurrent_hash_map_t* map);
+
+/******************************************************************************
+* Returns the number of key pairs in the input map. The stripes are counted | *
+* one at a time, so the result is exact only if no other thread changes     | *
+* the map meanwhile.                                                        | *
+*---------------------------------------------------------------------------+ *
+* map - the map to query.                                                     *
+*----------------------------------------------+                              *
+* RETURNS: the number of key pairs in this map.|                              *
+******************************************************************************/
+size_t bidirectional_concurrent_hash_map_t_size(
+                                    bidirectional_concurrent_hash_map_t* map);
+
+/******************************************************************************
+* Associates the primary key to the secondary key in the input map.|          *
+*------------------------------------------------------------------+          *
+* map ----------- the map into which to store the pair.                       *
+* primary_key --- the primary key.                                            *
+* secondary_key - the secondary key.                                          *
+*---------------------------------------------------------------------------+ *
+* RETURNS: old secondary key in case the primary key is in the map, NULL if | *
+* the primary key has no mappings yet, and the error sentinel if there is   | *
+* no memory for the new mapping.                                            | *
+******************************************************************************/
+void* bidirectional_concurrent_hash_map_t_put_by_primary(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key,
+                                    void* secondary_key);
+
+/******************************************************************************
+* Associates the secondary key to the primary key in the input map.|          *
+*------------------------------------------------------------------+          *
+* map ----------- the map into which to store the pair.                       *
+* primary_key --- the primary key.                                            *
+* secondary_key - the secondary key.                                          *
+*---------------------------------------------------------------------------+ *
+* RETURNS: old primary key in case the secondary key is in the map, NULL if | *
+* the secondary key has no mappings yet, and the error sentinel if there is | *
+* no memory for the new mapping.                                            | *
+******************************************************************************/
+void* bidirectional_concurrent_hash_map_t_put_by_secondary(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key,
+                                    void* secondary_key);
+
+/******************************************************************************
+* Removes a key pair by its primary key.|                                     *
+*---------------------------------------+                                     *
+* map --------- the map.                                                      *
+* primary_key - the primary key.                                              *
+*---------------------------------------------------------------------------+ *
+* RETURNS: NULL if the primary key is not mapped. The current associated    | *
+* secondary key otherwise.                                                  | *
+******************************************************************************/
+void* bidirectional_concurrent_hash_map_t_remove_by_primary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key);
+
+/****************************************************************************
+* Removes a key pair by its secondary key.|                                 *
+*-----------------------------------------+                                 *
+* map ----------- the map.                                                  *
+* secondary_key - the secondary key.                                        *
+*-------------------------------------------------------------------------+ *
+* RETURNS: NULL if the secondary key is not mapped. The current associated| *
+* primary key otherwise.                                                  | *
+****************************************************************************/
+void* bidirectional_concurrent_hash_map_t_remove_by_secondary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* secondary_key);
+
+/******************************************************************************
+* Queries the secondary key via its primary key.|                             *
+*-----------------------------------------------+                             *
+* map --------- the map to query.                                             *
+* primary_key - the primary key to use.                                       *
+*---------------------------------------------------------------------------+ *
+* RETURNS: If the primary key is associated with a secondary key, that very | *
+* secondary key is returned. Otherwise, NULL is returned.                   | *
+******************************************************************************/
+void* bidirectional_concurrent_hash_map_t_get_by_primary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key);
+
+/******************************************************************************
+* Queries the primary key via its secondary key.|                             *
+*-----------------------------------------------+                             *
+* map ----------- the map to query.                                           *
+* secondary_key - the secondary key to use.                                   *
+*---------------------------------------------------------------------------+ *
+* RETURNS: If the secondary key is associated with a primary key, that very | *
+* primary key is returned. Otherwise, NULL is returned.                     | *
+******************************************************************************/
+void* bidirectional_concurrent_hash_map_t_get_by_secondary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* secondary_key);
+
+/**************************************************************************
+* Queries whether the map contains 'primary_key' as a primary key.|       *
+*-----------------------------------------------------------------+       *
+* map --------- the map to query.                                         *
+* primary_key - the primary key to query.                                 *
+*-----------------------------------------------------------------------+ *
+* RETURNS: If the primary key is in the map, returns 1. Otherwise, 0 is | *
+* returned.                                                             | *
+**************************************************************************/
+int bidirectional_concurrent_hash_map_t_contains_primary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* primary_key);
+
+/****************************************************************************
+* Queries whether the map contains 'secondary_key' as a secondary key.|     *
+*---------------------------------------------------------------------+     *
+* map ----------- the map to query.                                         *
+* secondary_key - the secondary key to query.                               *
+*-------------------------------------------------------------------------+ *
+* RETURNS: If the secondary key is in the map, returns 1. Otherwise, 0 is | *
+* returned.                                                               | *
+****************************************************************************/
+int bidirectional_concurrent_hash_map_t_contains_secondary_key(
+                                    bidirectional_concurrent_hash_map_t* map,
+                                    void* secondary_key);
+
+#endif /* BIDIRECTIONAL_CONCURRENT_HASH_MAP_H */
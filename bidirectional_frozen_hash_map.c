@@ -0,0 +1,254 @@
+#include "bidirectional_frozen_hash_map.h"
+#include <stdlib.h>
+#include <string.h>
+
+/****************************************************************
+* Returns an integer that is a power of two no less than 'num'. *
+****************************************************************/
+static size_t to_power_of_two(size_t num)
+{
+    size_t ret = 1;
+    
+    while (ret < num)
+    {
+        ret <<= 1;
+    }
+    
+    return ret;
+}
+
+/********************************************************************
+* Stores 'mapping_index' into the first free slot of 'index' on the *
+* probe sequence starting at 'slot'.                                *
+********************************************************************/
+static void insert_into_index(uint32_t* index,
+                              size_t modulo_mask,
+                              size_t slot,
+                              uint32_t mapping_index)
+{
+    while (index[slot] != FROZEN_HASH_MAP_EMPTY_SLOT)
+    {
+        slot = (slot + 1) & modulo_mask;
+    }
+    
+    index[slot] = mapping_index;
+}
+
+/*******************************************************************
+* Returns the index slot the probe sequence of 'hash' starts from. *
+*******************************************************************/
+static size_t get_home_slot(bidirectional_frozen_hash_map_t* map, size_t hash)
+{
+    if (map->hash_flags & BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES)
+    {
+        hash = bidirectional_hash_map_siphash13_word(&map->hash_key, hash);
+    }
+    else if (map->hash_flags & BIDIRECTIONAL_HASH_MAP_MIX_HASHES)
+    {
+        hash = bidirectional_hash_map_mix_hash(hash);
+    }
+    
+    return hash & map->modulo_mask;
+}
+
+int bidirectional_hash_map_t_freeze(
+                                bidirectional_hash_map_t* map,
+                                bidirectional_frozen_hash_map_t* frozen_map)
+{
+    primary_collision_chain_node_t* primary_collision_chain_node;
+    key_pair_t* key_pair;
+    size_t capacity;
+    size_t modulo_mask;
+    uint32_t mapping_index;
+    unsigned char* block;
+    
+    if (!map || !frozen_map || !bidirectional_hash_map_t_is_working(map))
+    {
+        return 0;
+    }
+    
+    /******************************************************************
+    * The indices must stay below the empty slot marker, and doubling *
+    * the size must not overflow.                                     *
+    ******************************************************************/
+    if (map->size >= (size_t) 0x7FFFFFFFUL)
+    {
+        return 0;
+    }
+    
+    /******************************************************************
+    * Keeping the index arrays at most half full keeps the probe runs *
+    * short; the slots are only four bytes each.                      *
+    ******************************************************************/
+    capacity    = to_power_of_two(map->size << 1);
+    modulo_mask = capacity - 1;
+    
+    /******************************************************************
+    * The key pairs come first so that the block alignment serves the *
+    * pointers; the index arrays follow them.                         *
+    ******************************************************************/
+    block = map->allocator.allocate(map->allocator.context,
+                                    map->size * sizeof(key_pair_t) +
+                                    2 * capacity * sizeof(uint32_t));
+    
+    if (!block)
+    {
+        return 0;
+    }
+    
+    frozen_map->size                   = map->size;
+    frozen_map->capacity               = capacity;
+    frozen_map->modulo_mask            = modulo_mask;
+    frozen_map->key_pairs              = (key_pair_t*) block;
+    frozen_map->primary_index          =
+        (uint32_t*)(block + map->size * sizeof(key_pair_t));
+    frozen_map->secondary_index        = frozen_map->primary_index + capacity;
+    frozen_map->primary_key_hasher     = map->primary_key_hasher;
+    frozen_map->secondary_key_hasher   = map->secondary_key_hasher;
+    frozen_map->primary_key_equality   = map->primary_key_equality;
+    frozen_map->secondary_key_equality = map->secondary_key_equality;
+    frozen_map->allocator              = map->allocator;
+    frozen_map->hash_key               = map->hash_key;
+    frozen_map->hash_flags             =
+        map->flags & (BIDIRECTIONAL_HASH_MAP_MIX_HASHES |
+                      BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES);
+    
+    memset(frozen_map->primary_index, 0xFF, 2 * capacity * sizeof(uint32_t));
+    
+    mapping_index = 0;
+    
+    for (primary_collision_chain_node = map->first_collision_chain_node;
+         primary_collision_chain_node;
+         primary_collision_chain_node = primary_collision_chain_node->down)
+    {
+        key_pair = &frozen_map->key_pairs[mapping_index];
+        *key_pair = *primary_collision_chain_node->key_pair;
+        
+        /***************************************************************
+        * The hashes in the key pairs are the ones the map works with, *
+        * that is, already scrambled if the map scrambles its hashes.  *
+        ***************************************************************/
+        insert_into_index(frozen_map->primary_index,
+                          modulo_mask,
+                          key_pair->primary_key_hash & modulo_mask,
+                          mapping_index);
+        
+        insert_into_index(frozen_map->secondary_index,
+                          modulo_mask,
+                          key_pair->secondary_key_hash & modulo_mask,
+                          mapping_index);
+        
+        mapping_index++;
+    }
+    
+    return 1;
+}
+
+void bidirectional_frozen_hash_map_t_destroy(
+                                        bidirectional_frozen_hash_map_t* map)
+{
+    if (!map || !map->key_pairs)
+    {
+        return;
+    }
+    
+    map->allocator.deallocate(map->allocator.context, map->key_pairs);
+    
+    map->key_pairs       = NULL;
+    map->primary_index   = NULL;
+    map->secondary_index = NULL;
+    map->size            = 0;
+    map->capacity        = 0;
+}
+
+size_t bidirectional_frozen_hash_map_t_size(
+                                        bidirectional_frozen_hash_map_t* map)
+{
+    return map->size;
+}
+
+/*******************************************************************
+* Returns the key pair whose primary key is 'primary_key', or NULL *
+* if there is no such key pair.                                    *
+*******************************************************************/
+static key_pair_t* find_key_pair_by_primary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* primary_key)
+{
+    size_t slot = get_home_slot(map, map->primary_key_hasher(primary_key));
+    uint32_t mapping_index;
+    
+    while ((mapping_index = map->primary_index[slot])
+           != FROZEN_HASH_MAP_EMPTY_SLOT)
+    {
+        if (map->primary_key_equality(map->key_pairs[mapping_index].primary_key,
+                                      primary_key))
+        {
+            return &map->key_pairs[mapping_index];
+        }
+        
+        slot = (slot + 1) & map->modulo_mask;
+    }
+    
+    return NULL;
+}
+
+/***************************************************************
+* Returns the key pair whose secondary key is 'secondary_key', *
+* or NULL if there is no such key pair.                        *
+***************************************************************/
+static key_pair_t* find_key_pair_by_secondary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* secondary_key)
+{
+    size_t slot = get_home_slot(map,
+                                map->secondary_key_hasher(secondary_key));
+    uint32_t mapping_index;
+    key_pair_t* key_pair;
+    
+    while ((mapping_index = map->secondary_index[slot])
+           != FROZEN_HASH_MAP_EMPTY_SLOT)
+    {
+        key_pair = &map->key_pairs[mapping_index];
+        
+        if (map->secondary_key_equality(key_pair->secondary_key,
+                                        secondary_key))
+        {
+            return key_pair;
+        }
+        
+        slot = (slot + 1) & map->modulo_mask;
+    }
+    
+    return NULL;
+}
+
+void* bidirectional_frozen_hash_map_t_get_by_primary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* primary_key)
+{
+    key_pair_t* key_pair = find_key_pair_by_primary_key(map, primary_key);
+    return key_pair ? key_pair->secondary_key : NULL;
+}
+
+void* bidirectional_frozen_hash_map_t_get_by_secondary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* secondary_key)
+{
+    key_pair_t* key_pair = find_key_pair_by_secondary_key(map, secondary_key);
+    return key_pair ? key_pair->primary_key : NULL;
+}
+
+int bidirectional_frozen_hash_map_t_contains_primary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* primary_key)
+{
+    return find_key_pair_by_primary_key(map, primary_key) != NULL ? 1 : 0;
+}
+
+int bidirectional_frozen_hash_map_t_contains_secondary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* secondary_key)
+{
+    return find_key_pair_by_secondary_key(map, secondary_key) != NULL ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+#ifndef BIDIRECTIONAL_FROZEN_HASH_MAP_H
+#define BIDIRECTIONAL_FROZEN_HASH_MAP_H
+
+#include "bidirectional_hash_map.h"
+#include "key_pair.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/****************************************************************************
+* An immutable snapshot of a bidirectional hash map. All of its data lives  *
+* in a single memory block: a dense array of the key pairs followed by two  *
+* linearly probed index arrays, one per direction, whose slots hold indices *
+* into the key pair array. There are no chain nodes and no pointers between *
+* the mappings.                                                             *
+****************************************************************************/
+typedef struct bidirectional_frozen_hash_map_t {
+    
+    /**********************************
+    * Caches the number of key pairs. *
+    **********************************/
+    size_t size;
+    
+    /*************************************************
+    * Holds the number of slots in each index array. *
+    *************************************************/
+    size_t capacity;
+    
+    /***************************************
+    * The mask used for simulating modulo. *
+    ***************************************/
+    size_t modulo_mask;
+    
+    /*******************************************************************
+    * The dense array of all key pairs. It also points to the start of *
+    * the memory block of this map.                                    *
+    *******************************************************************/
+    key_pair_t* key_pairs;
+    
+    /************************************************************
+    * The slots indexing 'key_pairs' by primary key. The unused *
+    * slots hold FROZEN_HASH_MAP_EMPTY_SLOT.                    *
+    ************************************************************/
+    uint32_t* primary_index;
+    
+    /**************************************************************
+    * The slots indexing 'key_pairs' by secondary key. The unused *
+    * slots hold FROZEN_HASH_MAP_EMPTY_SLOT.                      *
+    **************************************************************/
+    uint32_t* secondary_index;
+    
+    /***************************************************************************
+    * The function producing the bucket index in the primary key table given a *
+    * primary key.                                                             *
+    ***************************************************************************/
+    size_t (*primary_key_hasher)(void* primary_key);
+    
+    /***************************************************************************
+    * The function producing the bucket index in the secondary key table given *
+    * a secondary key.                                                         *
+    ***************************************************************************/
+    size_t (*secondary_key_hasher)(void* secondary_key);
+    
+    /***********************************************
+    * The function for comparing the primary keys. *
+    ***********************************************/
+    int (*primary_key_equality)(void* key1, void* key2);
+    
+    /*************************************************
+    * The function for comparing the secondary keys. *
+    *************************************************/
+    int (*secondary_key_equality)(void* key1, void* key2);
+    
+    /**************************************************************
+    * The BIDIRECTIONAL_HASH_MAP_MIX_HASHES and                   *
+    * BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES flags of the map this  *
+    * one was frozen from, which scramble the key hashes the same *
+    * way here.                                                   *
+    **************************************************************/
+    int hash_flags;
+    
+    /******************************************************
+    * The secret key of the map this one was frozen from. *
+    ******************************************************/
+    bidirectional_hash_map_hash_key_t hash_key;
+    
+    /****************************************************
+    * The allocator the memory block was obtained from. *
+    ****************************************************/
+    bidirectional_hash_map_allocator_t allocator;
+}
+bidirectional_frozen_hash_map_t;
+
+/**********************************************************
+* The index array entry denoting a slot that is not used. *
+**********************************************************/
+#define FROZEN_HASH_MAP_EMPTY_SLOT ((uint32_t) 0xFFFFFFFFUL)
+
+/******************************************************************************
+* Builds a frozen copy of the input map. The frozen map uses the hashers,   | *
+* the equality functions and the allocator of 'map', which is left intact   | *
+* and may be destroyed right away.                                          | *
+*---------------------------------------------------------------------------+ *
+* map -------- the map to freeze.                                             *
+* frozen_map - the frozen map to initialize.                                  *
+*---------------------------------------------------------------------------+ *
+* RETURNS: 1 if the frozen map was built, 0 if there is no memory or the    | *
+* map holds too many mappings.                                              | *
+******************************************************************************/
+int bidirectional_hash_map_t_freeze(
+                                bidirectional_hash_map_t* map,
+                                bidirectional_frozen_hash_map_t* frozen_map);
+
+/************************************************
+* Releases all the resources of the input map.| *
+*---------------------------------------------+ *
+* map - the map to destroy.                     *
+************************************************/
+void bidirectional_frozen_hash_map_t_destroy(
+                                        bidirectional_frozen_hash_map_t* map);
+
+/*****************************************************
+* Returns the number of key pairs in the input map.| *
+*--------------------------------------------------+ *
+* map - the map to query.                            *
+*----------------------------------------------+     *
+* RETURNS: the number of key pairs in this map.|     *
+*****************************************************/
+size_t bidirectional_frozen_hash_map_t_size(
+                                        bidirectional_frozen_hash_map_t* map);
+
+/******************************************************************************
+* Queries the secondary key via its primary key.|                             *
+*-----------------------------------------------+                             *
+* map --------- the map to query.                                             *
+* primary_key - the primary key to use.                                       *
+*---------------------------------------------------------------------------+ *
+* RETURNS: If the primary key is associated with a secondary key, that very | *
+* secondary key is returned. Otherwise, NULL is returned.                   | *
+******************************************************************************/
+void* bidirectional_frozen_hash_map_t_get_by_primary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* primary_key);
+
+/******************************************************************************
+* Queries the primary key via its secondary key.|                             *
+*-----------------------------------------------+                             *
+* map ----------- the map to query.                                           *
+* secondary_key - the secondary key to use.                                   *
+*---------------------------------------------------------------------------+ *
+* RETURNS: If the secondary key is associated with a primary key, that very | *
+* primary key is returned. Otherwise, NULL is returned.                     | *
+******************************************************************************/
+void* bidirectional_frozen_hash_map_t_get_by_secondary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* secondary_key);
+
+/**************************************************************************
+* Queries whether the map contains 'primary_key' as a primary key.|       *
+*-----------------------------------------------------------------+       *
+* map --------- the map to query.                                         *
+* primary_key - the primary key to query.                                 *
+*-----------------------------------------------------------------------+ *
+* RETURNS: If the primary key is in the map, returns 1. Otherwise, 0 is | *
+* returned.                                                             | *
+**************************************************************************/
+int bidirectional_frozen_hash_map_t_contains_primary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* primary_key);
+
+/**************************************************************************
+* Queries whether the map contains 'secondary_key' as a secondary key.|   *
+*---------------------------------------------------------------------+   *
+* map ----------- the map to query.                                       *
+* secondary_key - the secondary key to query.                             *
+*-----------------------------------------------------------------------+ *
+* RETURNS: If the secondary key is in the map, returns 1. Otherwise, 0  | *
+* is returned.                                                          | *
+**************************************************************************/
+int bidirectional_frozen_hash_map_t_contains_secondary_key(
+                                        bidirectional_frozen_hash_map_t* map,
+                                        void* secondary_key);
+
+#endif /* BIDIRECTIONAL_FROZEN_HASH_MAP_H */
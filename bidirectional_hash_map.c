@@ -1,5 +1,8 @@
 #include "bidirectional_hash_map.h"
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 static float max_float(float a, float b)
 {
@@ -26,18 +29,989 @@ static size_t to_power_of_two(size_t num)
     return  ret;
 }
 
+/********************************************************
+* Allocates 'size' bytes with the allocator of the map. *
+********************************************************/
+static void* allocate(bidirectional_hash_map_t* map, size_t size)
+{
+    return map->allocator.allocate(map->allocator.context, size);
+}
+
+/******************************************************************
+* Allocates a zeroed table of 'count' pointers with the allocator *
+* of the map.                                                     *
+******************************************************************/
+static void* allocate_table(bidirectional_hash_map_t* map, size_t count)
+{
+    return map->allocator.allocate_zeroed(map->allocator.context,
+                                          count,
+                                          sizeof(void*));
+}
+
+/************************************************************
+* Releases 'memory' obtained from the allocator of the map. *
+************************************************************/
+static void deallocate(bidirectional_hash_map_t* map, void* memory)
+{
+    map->allocator.deallocate(map->allocator.context, memory);
+}
+
 static const float  MINIMUM_LOAD_FACTOR      = 0.2;
 static const size_t MINIMUM_INITIAL_CAPACITY = 8;
 
+/****************************************************************
+* The largest capacity of the hash tables: the largest power of *
+* two whose table still fits in half the address space.         *
+****************************************************************/
+static const size_t MAXIMUM_CAPACITY = (SIZE_MAX >> 1) / sizeof(void*) + 1;
+
+/*********************************************************************
+* The number of old buckets each operation migrates while the map is *
+* rehashed incrementally.                                            *
+*********************************************************************/
+static const size_t REHASH_BUCKETS_PER_OPERATION = 4;
+
+/*****************************************************************
+* The bounds for the number of mapping records in a single slab. *
+*****************************************************************/
+static const size_t MINIMUM_SLAB_RECORD_COUNT = 32;
+static const size_t MAXIMUM_SLAB_RECORD_COUNT = 1 << 16;
+
+/******************************************************************
+* A collision chain longer than this turns into a collision tree, *
+* provided the map has an ordering function for its keys.         *
+******************************************************************/
+static const size_t TREEIFY_THRESHOLD = 8;
+
+/******************************************************************
+* A collision tree no higher than this, and thus holding at most  *
+* seven nodes, turns back into a collision chain.                 *
+******************************************************************/
+static const int UNTREEIFY_HEIGHT = 3;
+
+/******************************************************************
+* The inline copy of a key starts with a length byte, which holds *
+* NOT_INLINED_KEY_SIZE for the keys too large to copy.            *
+******************************************************************/
+static const size_t MAXIMUM_INLINE_KEY_CAPACITY = 254;
+static const size_t NOT_INLINED_KEY_SIZE        = 255;
+
+/*****************************************************************
+* Stands for the size of a key not measured yet during a lookup. *
+*****************************************************************/
+static const size_t UNMEASURED_KEY_SIZE = (size_t) -1;
+
+/**********************************************************
+* The multipliers of the MurmurHash3 finalizer, in its    *
+* 64-bit or 32-bit variant depending on 'size_t'.         *
+**********************************************************/
+#if SIZE_MAX > 0xFFFFFFFFUL
+static const size_t MIX_MULTIPLIER_1 = ((size_t) 0xFF51AFD7UL << 16 << 16) |
+                                       (size_t) 0xED558CCDUL;
+static const size_t MIX_MULTIPLIER_2 = ((size_t) 0xC4CEB9FEUL << 16 << 16) |
+                                       (size_t) 0x1A85EC53UL;
+#else
+static const size_t MIX_MULTIPLIER_1 = (size_t) 0x85EBCA6BUL;
+static const size_t MIX_MULTIPLIER_2 = (size_t) 0xC2B2AE35UL;
+#endif
+
+/****************************************************************
+* The number of keys whose memory accesses the batch operations *
+* overlap.                                                      *
+****************************************************************/
+#define BATCH_WINDOW_SIZE 16
+
+/**********************************************************************
+* Asks for the cache line of 'address' ahead of a read, or of a write *
+* if 'write' is 1. Expands to nothing where the hint is unavailable.  *
+**********************************************************************/
+#ifdef __GNUC__
+#define PREFETCH(address, write) __builtin_prefetch(address, write)
+#else
+#define PREFETCH(address, write)
+#endif
+
+static void do_rehash_step(bidirectional_hash_map_t* map);
+
+size_t bidirectional_hash_map_mix_hash(size_t hash)
+{
+#if SIZE_MAX > 0xFFFFFFFFUL
+    hash ^= hash >> 33;
+    hash *= MIX_MULTIPLIER_1;
+    hash ^= hash >> 33;
+    hash *= MIX_MULTIPLIER_2;
+    hash ^= hash >> 33;
+#else
+    hash ^= hash >> 16;
+    hash *= MIX_MULTIPLIER_1;
+    hash ^= hash >> 13;
+    hash *= MIX_MULTIPLIER_2;
+    hash ^= hash >> 16;
+#endif
+    return hash;
+}
+
+/*****************************************************************
+* Turns the output of a key hasher into the hash the map works   *
+* with: keyed if the map is seeded, mixed if it asks for mixing. *
+*****************************************************************/
+static size_t scramble_hash(bidirectional_hash_map_t* map, size_t hash)
+{
+    if (map->flags & BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES)
+    {
+        return bidirectional_hash_map_siphash13_word(&map->hash_key, hash);
+    }
+    
+    if (map->flags & BIDIRECTIONAL_HASH_MAP_MIX_HASHES)
+    {
+        return bidirectional_hash_map_mix_hash(hash);
+    }
+    
+    return hash;
+}
+
+/*******************************************************************
+* Returns the hash of 'primary_key' the map works with: the output *
+* of the primary key hasher, scrambled if the map asks for it.     *
+*******************************************************************/
+static size_t hash_primary_key(bidirectional_hash_map_t* map,
+                               void* primary_key)
+{
+    return scramble_hash(map, map->primary_key_hasher(primary_key));
+}
+
+/*********************************************************************
+* Returns the hash of 'secondary_key' the map works with: the output *
+* of the secondary key hasher, scrambled if the map asks for it.     *
+*********************************************************************/
+static size_t hash_secondary_key(bidirectional_hash_map_t* map,
+                                 void* secondary_key)
+{
+    return scramble_hash(map, map->secondary_key_hasher(secondary_key));
+}
+
+/******************************************************************************
+* Returns the bucket of the primary key table holding the collision chain for *
+* primary keys with the hash 'primary_key_hash'. While the map is being       *
+* rehashed incrementally, the buckets of the old table that are not migrated  *
+* yet are still in use.                                                       *
+******************************************************************************/
+static primary_collision_chain_node_t** get_primary_collision_chain_bucket(
+                                                bidirectional_hash_map_t* map,
+                                                size_t primary_key_hash)
+{
+    size_t old_bucket_index;
+    
+    if (map->old_primary_key_table)
+    {
+        old_bucket_index = primary_key_hash & map->old_modulo_mask;
+        
+        if (old_bucket_index >= map->rehash_index)
+        {
+            return &map->old_primary_key_table[old_bucket_index];
+        }
+    }
+    
+    return &map->primary_key_table[primary_key_hash & map->modulo_mask];
+}
+
+/****************************************************************************
+* Returns the bucket of the secondary key table holding the collision chain *
+* for secondary keys with the hash 'secondary_key_hash'.                    *
+****************************************************************************/
+static secondary_collision_chain_node_t**
+get_secondary_collision_chain_bucket(bidirectional_hash_map_t* map,
+                                     size_t secondary_key_hash)
+{
+    size_t old_bucket_index;
+    
+    if (map->old_secondary_key_table)
+    {
+        old_bucket_index = secondary_key_hash & map->old_modulo_mask;
+        
+        if (old_bucket_index >= map->rehash_index)
+        {
+            return &map->old_secondary_key_table[old_bucket_index];
+        }
+    }
+    
+    return &map->secondary_key_table[secondary_key_hash & map->modulo_mask];
+}
+
+/***************************************************************
+* Returns the height of 'node' in its collision tree, which is *
+* 0 for NULL.                                                  *
+***************************************************************/
+static int get_primary_tree_height(primary_collision_chain_node_t* node)
+{
+    return node ? node->tree_height : 0;
+}
+
+/***************************************************************
+* Returns the height of 'node' in its collision tree, which is *
+* 0 for NULL.                                                  *
+***************************************************************/
+static int get_secondary_tree_height(secondary_collision_chain_node_t* node)
+{
+    return node ? node->tree_height : 0;
+}
+
+/********************************************************************
+* Recomputes the height of 'node' from the heights of its children. *
+********************************************************************/
+static void update_primary_tree_height(primary_collision_chain_node_t* node)
+{
+    int left_height  = get_primary_tree_height(node->prev);
+    int right_height = get_primary_tree_height(node->next);
+    
+    node->tree_height = (left_height > right_height ?
+                         left_height :
+                         right_height) + 1;
+}
+
+/********************************************************************
+* Recomputes the height of 'node' from the heights of its children. *
+********************************************************************/
+static void update_secondary_tree_height(
+                                    secondary_collision_chain_node_t* node)
+{
+    int left_height  = get_secondary_tree_height(node->prev);
+    int right_height = get_secondary_tree_height(node->next);
+    
+    node->tree_height = (left_height > right_height ?
+                         left_height :
+                         right_height) + 1;
+}
+
+/********************************************************************
+* Orders 'primary_key' with the hash 'primary_key_hash' relative to *
+* the primary key of 'node': by the hashes first, then by the       *
+* ordering function of the map.                                     *
+********************************************************************/
+static int compare_primary_key(bidirectional_hash_map_t* map,
+                               void* primary_key,
+                               size_t primary_key_hash,
+                               primary_collision_chain_node_t* node)
+{
+    if (primary_key_hash != node->key_pair->primary_key_hash)
+    {
+        return primary_key_hash < node->key_pair->primary_key_hash ? -1 : 1;
+    }
+    
+    return map->primary_key_compare(primary_key, node->key_pair->primary_key);
+}
+
+/************************************************************************
+* Orders 'secondary_key' with the hash 'secondary_key_hash' relative to *
+* the secondary key of 'node'.                                          *
+************************************************************************/
+static int compare_secondary_key(bidirectional_hash_map_t* map,
+                                 void* secondary_key,
+                                 size_t secondary_key_hash,
+                                 secondary_collision_chain_node_t* node)
+{
+    if (secondary_key_hash != node->key_pair->secondary_key_hash)
+    {
+        return secondary_key_hash < node->key_pair->secondary_key_hash ?
+               -1 : 1;
+    }
+    
+    return map->secondary_key_compare(secondary_key,
+                                      node->key_pair->secondary_key);
+}
+
+/*********************************************************************
+* Makes 'new_child' take the place of 'old_child' under 'parent', or *
+* in 'bucket' if 'old_child' is the root of the collision tree.      *
+*********************************************************************/
+static void replace_primary_tree_child(
+                                    primary_collision_chain_node_t** bucket,
+                                    primary_collision_chain_node_t* parent,
+                                    primary_collision_chain_node_t* old_child,
+                                    primary_collision_chain_node_t* new_child)
+{
+    if (!parent)
+    {
+        *bucket = new_child;
+    }
+    else if (parent->prev == old_child)
+    {
+        parent->prev = new_child;
+    }
+    else
+    {
+        parent->next = new_child;
+    }
+}
+
+/*********************************************************************
+* Makes 'new_child' take the place of 'old_child' under 'parent', or *
+* in 'bucket' if 'old_child' is the root of the collision tree.      *
+*********************************************************************/
+static void replace_secondary_tree_child(
+                                secondary_collision_chain_node_t** bucket,
+                                secondary_collision_chain_node_t* parent,
+                                secondary_collision_chain_node_t* old_child,
+                                secondary_collision_chain_node_t* new_child)
+{
+    if (!parent)
+    {
+        *bucket = new_child;
+    }
+    else if (parent->prev == old_child)
+    {
+        parent->prev = new_child;
+    }
+    else
+    {
+        parent->next = new_child;
+    }
+}
+
+/********************************************************************
+* Rotates the subtree rooted at 'node' to the left or, if 'left' is *
+* zero, to the right, and returns the new root of the subtree.      *
+********************************************************************/
+static primary_collision_chain_node_t* rotate_primary_tree(
+                                        primary_collision_chain_node_t* node,
+                                        int left)
+{
+    primary_collision_chain_node_t* pivot = left ? node->next : node->prev;
+    primary_collision_chain_node_t* inner = left ? pivot->prev : pivot->next;
+    
+    if (left)
+    {
+        node->next  = inner;
+        pivot->prev = node;
+    }
+    else
+    {
+        node->prev  = inner;
+        pivot->next = node;
+    }
+    
+    if (inner)
+    {
+        inner->parent = node;
+    }
+    
+    pivot->parent = node->parent;
+    node->parent  = pivot;
+    
+    update_primary_tree_height(node);
+    update_primary_tree_height(pivot);
+    return pivot;
+}
+
+/********************************************************************
+* Rotates the subtree rooted at 'node' to the left or, if 'left' is *
+* zero, to the right, and returns the new root of the subtree.      *
+********************************************************************/
+static secondary_collision_chain_node_t* rotate_secondary_tree(
+                                    secondary_collision_chain_node_t* node,
+                                    int left)
+{
+    secondary_collision_chain_node_t* pivot = left ? node->next : node->prev;
+    secondary_collision_chain_node_t* inner = left ? pivot->prev : pivot->next;
+    
+    if (left)
+    {
+        node->next  = inner;
+        pivot->prev = node;
+    }
+    else
+    {
+        node->prev  = inner;
+        pivot->next = node;
+    }
+    
+    if (inner)
+    {
+        inner->parent = node;
+    }
+    
+    pivot->parent = node->parent;
+    node->parent  = pivot;
+    
+    update_secondary_tree_height(node);
+    update_secondary_tree_height(pivot);
+    return pivot;
+}
+
+/*****************************************************************
+* Restores the AVL property of the collision tree in 'bucket' on *
+* the path from 'node' up to the root.                           *
+*****************************************************************/
+static void rebalance_primary_tree(primary_collision_chain_node_t** bucket,
+                                   primary_collision_chain_node_t* node)
+{
+    primary_collision_chain_node_t* parent;
+    primary_collision_chain_node_t* subtree;
+    int balance;
+    
+    for (; node; node = parent)
+    {
+        parent = node->parent;
+        update_primary_tree_height(node);
+        balance = get_primary_tree_height(node->prev) -
+                  get_primary_tree_height(node->next);
+        
+        if (balance > 1)
+        {
+            if (get_primary_tree_height(node->prev->prev) <
+                get_primary_tree_height(node->prev->next))
+            {
+                node->prev = rotate_primary_tree(node->prev, 1);
+            }
+            
+            subtree = rotate_primary_tree(node, 0);
+        }
+        else if (balance < -1)
+        {
+            if (get_primary_tree_height(node->next->next) <
+                get_primary_tree_height(node->next->prev))
+            {
+                node->next = rotate_primary_tree(node->next, 0);
+            }
+            
+            subtree = rotate_primary_tree(node, 1);
+        }
+        else
+        {
+            continue;
+        }
+        
+        replace_primary_tree_child(bucket, parent, node, subtree);
+    }
+}
+
+/*****************************************************************
+* Restores the AVL property of the collision tree in 'bucket' on *
+* the path from 'node' up to the root.                           *
+*****************************************************************/
+static void rebalance_secondary_tree(
+                                    secondary_collision_chain_node_t** bucket,
+                                    secondary_collision_chain_node_t* node)
+{
+    secondary_collision_chain_node_t* parent;
+    secondary_collision_chain_node_t* subtree;
+    int balance;
+    
+    for (; node; node = parent)
+    {
+        parent = node->parent;
+        update_secondary_tree_height(node);
+        balance = get_secondary_tree_height(node->prev) -
+                  get_secondary_tree_height(node->next);
+        
+        if (balance > 1)
+        {
+            if (get_secondary_tree_height(node->prev->prev) <
+                get_secondary_tree_height(node->prev->next))
+            {
+                node->prev = rotate_secondary_tree(node->prev, 1);
+            }
+            
+            subtree = rotate_secondary_tree(node, 0);
+        }
+        else if (balance < -1)
+        {
+            if (get_secondary_tree_height(node->next->next) <
+                get_secondary_tree_height(node->next->prev))
+            {
+                node->next = rotate_secondary_tree(node->next, 0);
+            }
+            
+            subtree = rotate_secondary_tree(node, 1);
+        }
+        else
+        {
+            continue;
+        }
+        
+        replace_secondary_tree_child(bucket, parent, node, subtree);
+    }
+}
+
+/******************************************************************
+* Inserts 'node' as a leaf into the collision tree in 'bucket'.   *
+* Equal keys, which only occur as duplicate secondary keys, go to *
+* the right.                                                      *
+******************************************************************/
+static void insert_primary_tree_node(bidirectional_hash_map_t* map,
+                                     primary_collision_chain_node_t** bucket,
+                                     primary_collision_chain_node_t* node)
+{
+    primary_collision_chain_node_t* parent = NULL;
+    primary_collision_chain_node_t* current = *bucket;
+    int cmp = 0;
+    
+    while (current)
+    {
+        parent = current;
+        cmp = compare_primary_key(map,
+                                  node->key_pair->primary_key,
+                                  node->key_pair->primary_key_hash,
+                                  current);
+        
+        current = cmp < 0 ? current->prev : current->next;
+    }
+    
+    node->prev        = NULL;
+    node->next        = NULL;
+    node->parent      = parent;
+    node->tree_height = 1;
+    
+    if (!parent)
+    {
+        *bucket = node;
+    }
+    else
+    {
+        if (cmp < 0)
+        {
+            parent->prev = node;
+        }
+        else
+        {
+            parent->next = node;
+        }
+        
+        rebalance_primary_tree(bucket, parent);
+    }
+}
+
+/******************************************************************
+* Inserts 'node' as a leaf into the collision tree in 'bucket'.   *
+* Equal keys, which only occur as duplicate secondary keys, go to *
+* the right.                                                      *
+******************************************************************/
+static void insert_secondary_tree_node(
+                                    bidirectional_hash_map_t* map,
+                                    secondary_collision_chain_node_t** bucket,
+                                    secondary_collision_chain_node_t* node)
+{
+    secondary_collision_chain_node_t* parent = NULL;
+    secondary_collision_chain_node_t* current = *bucket;
+    int cmp = 0;
+    
+    while (current)
+    {
+        parent = current;
+        cmp = compare_secondary_key(map,
+                                    node->key_pair->secondary_key,
+                                    node->key_pair->secondary_key_hash,
+                                    current);
+        
+        current = cmp < 0 ? current->prev : current->next;
+    }
+    
+    node->prev        = NULL;
+    node->next        = NULL;
+    node->parent      = parent;
+    node->tree_height = 1;
+    
+    if (!parent)
+    {
+        *bucket = node;
+    }
+    else
+    {
+        if (cmp < 0)
+        {
+            parent->prev = node;
+        }
+        else
+        {
+            parent->next = node;
+        }
+        
+        rebalance_secondary_tree(bucket, parent);
+    }
+}
+
+/******************************************************************
+* Removes 'node' from the collision tree in 'bucket'. A node with *
+* two children is replaced by its in-order successor node itself, *
+* since its twin and the iteration list point to the node.        *
+******************************************************************/
+static void remove_primary_tree_node(primary_collision_chain_node_t** bucket,
+                                     primary_collision_chain_node_t* node)
+{
+    primary_collision_chain_node_t* successor;
+    primary_collision_chain_node_t* child;
+    primary_collision_chain_node_t* rebalance_start;
+    
+    if (node->prev && node->next)
+    {
+        successor = node->next;
+        
+        while (successor->prev)
+        {
+            successor = successor->prev;
+        }
+        
+        if (successor->parent == node)
+        {
+            rebalance_start = successor;
+        }
+        else
+        {
+            rebalance_start = successor->parent;
+            rebalance_start->prev = successor->next;
+            
+            if (successor->next)
+            {
+                successor->next->parent = rebalance_start;
+            }
+            
+            successor->next = node->next;
+            successor->next->parent = successor;
+        }
+        
+        successor->prev = node->prev;
+        successor->prev->parent = successor;
+        successor->parent = node->parent;
+        replace_primary_tree_child(bucket, node->parent, node, successor);
+    }
+    else
+    {
+        child = node->prev ? node->prev : node->next;
+        
+        if (child)
+        {
+            child->parent = node->parent;
+        }
+        
+        replace_primary_tree_child(bucket, node->parent, node, child);
+        rebalance_start = node->parent;
+    }
+    
+    rebalance_primary_tree(bucket, rebalance_start);
+}
+
+/******************************************************************
+* Removes 'node' from the collision tree in 'bucket' the same way *
+* as 'remove_primary_tree_node' does.                             *
+******************************************************************/
+static void remove_secondary_tree_node(
+                                    secondary_collision_chain_node_t** bucket,
+                                    secondary_collision_chain_node_t* node)
+{
+    secondary_collision_chain_node_t* successor;
+    secondary_collision_chain_node_t* child;
+    secondary_collision_chain_node_t* rebalance_start;
+    
+    if (node->prev && node->next)
+    {
+        successor = node->next;
+        
+        while (successor->prev)
+        {
+            successor = successor->prev;
+        }
+        
+        if (successor->parent == node)
+        {
+            rebalance_start = successor;
+        }
+        else
+        {
+            rebalance_start = successor->parent;
+            rebalance_start->prev = successor->next;
+            
+            if (successor->next)
+            {
+                successor->next->parent = rebalance_start;
+            }
+            
+            successor->next = node->next;
+            successor->next->parent = successor;
+        }
+        
+        successor->prev = node->prev;
+        successor->prev->parent = successor;
+        successor->parent = node->parent;
+        replace_secondary_tree_child(bucket, node->parent, node, successor);
+    }
+    else
+    {
+        child = node->prev ? node->prev : node->next;
+        
+        if (child)
+        {
+            child->parent = node->parent;
+        }
+        
+        replace_secondary_tree_child(bucket, node->parent, node, child);
+        rebalance_start = node->parent;
+    }
+    
+    rebalance_secondary_tree(bucket, rebalance_start);
+}
+
+/***************************************************************
+* Turns the collision chain in 'bucket' into a collision tree. *
+***************************************************************/
+static void treeify_primary_bucket(bidirectional_hash_map_t* map,
+                                   primary_collision_chain_node_t** bucket)
+{
+    primary_collision_chain_node_t* node = *bucket;
+    primary_collision_chain_node_t* next;
+    
+    *bucket = NULL;
+    
+    for (; node; node = next)
+    {
+        next = node->next;
+        insert_primary_tree_node(map, bucket, node);
+    }
+}
+
+/***************************************************************
+* Turns the collision chain in 'bucket' into a collision tree. *
+***************************************************************/
+static void treeify_secondary_bucket(bidirectional_hash_map_t* map,
+                                     secondary_collision_chain_node_t** bucket)
+{
+    secondary_collision_chain_node_t* node = *bucket;
+    secondary_collision_chain_node_t* next;
+    
+    *bucket = NULL;
+    
+    for (; node; node = next)
+    {
+        next = node->next;
+        insert_secondary_tree_node(map, bucket, node);
+    }
+}
+
+/********************************************************************
+* Turns the collision tree in 'bucket' back into a collision chain. *
+* The leaves are detached one by one, so no stack is needed.        *
+********************************************************************/
+static void untreeify_primary_bucket(primary_collision_chain_node_t** bucket)
+{
+    primary_collision_chain_node_t* chain = NULL;
+    primary_collision_chain_node_t* node = *bucket;
+    primary_collision_chain_node_t* parent;
+    
+    while (node)
+    {
+        if (node->prev)
+        {
+            node = node->prev;
+        }
+        else if (node->next)
+        {
+            node = node->next;
+        }
+        else
+        {
+            parent = node->parent;
+            
+            if (parent)
+            {
+                replace_primary_tree_child(bucket, parent, node, NULL);
+            }
+            
+            node->tree_height = 0;
+            node->prev = NULL;
+            node->next = chain;
+            
+            if (chain)
+            {
+                chain->prev = node;
+            }
+            
+            chain = node;
+            node = parent;
+        }
+    }
+    
+    *bucket = chain;
+}
+
+/********************************************************************
+* Turns the collision tree in 'bucket' back into a collision chain. *
+********************************************************************/
+static void untreeify_secondary_bucket(
+                                    secondary_collision_chain_node_t** bucket)
+{
+    secondary_collision_chain_node_t* chain = NULL;
+    secondary_collision_chain_node_t* node = *bucket;
+    secondary_collision_chain_node_t* parent;
+    
+    while (node)
+    {
+        if (node->prev)
+        {
+            node = node->prev;
+        }
+        else if (node->next)
+        {
+            node = node->next;
+        }
+        else
+        {
+            parent = node->parent;
+            
+            if (parent)
+            {
+                replace_secondary_tree_child(bucket, parent, node, NULL);
+            }
+            
+            node->tree_height = 0;
+            node->prev = NULL;
+            node->next = chain;
+            
+            if (chain)
+            {
+                chain->prev = node;
+            }
+            
+            chain = node;
+            node = parent;
+        }
+    }
+    
+    *bucket = chain;
+}
+
+/**************************************************************
+* Returns 1 if the collision chain starting at 'node' is long *
+* enough to turn into a collision tree.                       *
+**************************************************************/
+static int is_primary_collision_chain_long(
+                                        primary_collision_chain_node_t* node)
+{
+    size_t chain_length = 0;
+    
+    for (; node; node = node->next)
+    {
+        if (++chain_length > TREEIFY_THRESHOLD)
+        {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+/**************************************************************
+* Returns 1 if the collision chain starting at 'node' is long *
+* enough to turn into a collision tree.                       *
+**************************************************************/
+static int is_secondary_collision_chain_long(
+                                    secondary_collision_chain_node_t* node)
+{
+    size_t chain_length = 0;
+    
+    for (; node; node = node->next)
+    {
+        if (++chain_length > TREEIFY_THRESHOLD)
+        {
+            return 1;
+        }
+    }
+    
+    return 0;
+}
+
+/*****************************************************************
+* This function links 'primary_collision_chain_node' to the head *
+* of the collision chain in 'bucket', or into the collision tree *
+* in 'bucket'. A chain growing too long turns into a tree.       *
+*****************************************************************/
+static void link_primary_collision_chain_node(
+                bidirectional_hash_map_t* map,
+                primary_collision_chain_node_t** bucket,
+                primary_collision_chain_node_t* primary_collision_chain_node)
+{
+    if (*bucket && (*bucket)->tree_height)
+    {
+        insert_primary_tree_node(map, bucket, primary_collision_chain_node);
+        return;
+    }
+    
+    primary_collision_chain_node->prev = NULL;
+    primary_collision_chain_node->next = *bucket;
+    primary_collision_chain_node->tree_height = 0;
+    
+    if (*bucket)
+    {
+        (*bucket)->prev = primary_collision_chain_node;
+    }
+    
+    *bucket = primary_collision_chain_node;
+    
+    if (map->primary_key_compare &&
+        is_primary_collision_chain_long(*bucket))
+    {
+        treeify_primary_bucket(map, bucket);
+    }
+}
+
+/*******************************************************************
+* This function links 'secondary_collision_chain_node' to the head *
+* of the collision chain in 'bucket', or into the collision tree   *
+* in 'bucket'. A chain growing too long turns into a tree.         *
+*******************************************************************/
+static void link_secondary_collision_chain_node(
+            bidirectional_hash_map_t* map,
+            secondary_collision_chain_node_t** bucket,
+            secondary_collision_chain_node_t* secondary_collision_chain_node)
+{
+    if (*bucket && (*bucket)->tree_height)
+    {
+        insert_secondary_tree_node(map, bucket, secondary_collision_chain_node);
+        return;
+    }
+    
+    secondary_collision_chain_node->prev = NULL;
+    secondary_collision_chain_node->next = *bucket;
+    secondary_collision_chain_node->tree_height = 0;
+    
+    if (*bucket)
+    {
+        (*bucket)->prev = secondary_collision_chain_node;
+    }
+    
+    *bucket = secondary_collision_chain_node;
+    
+    if (map->secondary_key_compare &&
+        is_secondary_collision_chain_long(*bucket))
+    {
+        treeify_secondary_bucket(map, bucket);
+    }
+}
+
 /*************************************************************************
 * This function unlinks 'primary_collision_chain_node' from it collision *
-* chain.                                                                 *
+* chain or tree. A tree shrinking low enough turns back into a chain.    *
 *************************************************************************/
 static void unlink_primary_collision_chain_node(
                 bidirectional_hash_map_t* map,
                 primary_collision_chain_node_t* primary_collision_chain_node)
 {
-    size_t primary_node_collision_chain_bucket_index;
+    primary_collision_chain_node_t** bucket;
+    
+    if (primary_collision_chain_node->tree_height)
+    {
+        bucket = get_primary_collision_chain_bucket(
+                        map,
+                        primary_collision_chain_node->key_pair
+                        ->primary_key_hash);
+        
+        remove_primary_tree_node(bucket, primary_collision_chain_node);
+        
+        if (*bucket && (*bucket)->tree_height <= UNTREEIFY_HEIGHT)
+        {
+            untreeify_primary_bucket(bucket);
+        }
+        
+        return;
+    }
     
     if (primary_collision_chain_node->prev)
     {
@@ -46,12 +1020,12 @@ static void unlink_primary_collision_chain_node(
     }
     else
     {
-        primary_node_collision_chain_bucket_index =
-        primary_collision_chain_node->key_pair
-        ->primary_key_hash & map->modulo_mask;
+        bucket = get_primary_collision_chain_bucket(
+                        map,
+                        primary_collision_chain_node->key_pair
+                        ->primary_key_hash);
         
-        map->primary_key_table[primary_node_collision_chain_bucket_index] =
-        map->primary_key_table[primary_node_collision_chain_bucket_index]->next;
+        *bucket = (*bucket)->next;
     }
     
     if (primary_collision_chain_node->next)
@@ -63,13 +1037,30 @@ static void unlink_primary_collision_chain_node(
 
 /****************************************************************************
 * This function unlinks 'secondary_collision_chain_node' from its collision *
-* chain.                                                                    *
+* chain or tree.                                                            *
 ****************************************************************************/
 static void unlink_secondary_collision_chain_node(
             bidirectional_hash_map_t* map,
             secondary_collision_chain_node_t* secondary_collision_chain_node)
 {
-    size_t secondary_node_collision_chain_bucket_index;
+    secondary_collision_chain_node_t** bucket;
+    
+    if (secondary_collision_chain_node->tree_height)
+    {
+        bucket = get_secondary_collision_chain_bucket(
+                        map,
+                        secondary_collision_chain_node->key_pair
+                        ->secondary_key_hash);
+        
+        remove_secondary_tree_node(bucket, secondary_collision_chain_node);
+        
+        if (*bucket && (*bucket)->tree_height <= UNTREEIFY_HEIGHT)
+        {
+            untreeify_secondary_bucket(bucket);
+        }
+        
+        return;
+    }
     
     if (secondary_collision_chain_node->prev)
     {
@@ -78,13 +1069,12 @@ static void unlink_secondary_collision_chain_node(
     }
     else
     {
-        secondary_node_collision_chain_bucket_index =
-        secondary_collision_chain_node->key_pair
-        ->secondary_key_hash & map->modulo_mask;
+        bucket = get_secondary_collision_chain_bucket(
+                        map,
+                        secondary_collision_chain_node->key_pair
+                        ->secondary_key_hash);
         
-        map->secondary_key_table[secondary_node_collision_chain_bucket_index] =
-        map->secondary_key_table[secondary_node_collision_chain_bucket_index]
-           ->next;
+        *bucket = (*bucket)->next;
     }
     
     if (secondary_collision_chain_node->next)
@@ -94,66 +1084,6 @@ static void unlink_secondary_collision_chain_node(
     }
 }
 
-/*************************************************************
-* Finds a secondary collision chain node that corresponds to *
-* 'primary_collision_chain_node'.                            *
-*************************************************************/
-static secondary_collision_chain_node_t*
-find_secondary_collision_chain_node_via_primary_collision_chain_node(
-                bidirectional_hash_map_t* map,
-                primary_collision_chain_node_t* primary_collision_chain_node)
-{
-    size_t secondary_collision_chain_node_bucket_index =
-    primary_collision_chain_node->key_pair
-    ->secondary_key_hash & map->modulo_mask;
-    
-    secondary_collision_chain_node_t* secondary_collision_chain_node =
-    map->secondary_key_table[secondary_collision_chain_node_bucket_index];
-    
-    for (;
-         secondary_collision_chain_node;
-         secondary_collision_chain_node = secondary_collision_chain_node->next)
-    {
-        if (secondary_collision_chain_node->key_pair ==
-            primary_collision_chain_node->key_pair)
-        {
-            break;
-        }
-    }
-    
-    return secondary_collision_chain_node;
-}
-
-/***********************************************************
-* Finds a primary collision chain node that corresponds to *
-* 'secondary_collision_chain_node'.                        *
-***********************************************************/
-static primary_collision_chain_node_t*
-find_primary_collision_chain_node_via_secondary_collision_chain_node(
-            bidirectional_hash_map_t* map,
-            secondary_collision_chain_node_t* secondary_collision_chain_node)
-{
-    size_t primary_collision_chain_node_bucket_index =
-    secondary_collision_chain_node->key_pair
-    ->primary_key_hash & map->modulo_mask;
-    
-    primary_collision_chain_node_t* primary_collision_chain_node =
-    map->primary_key_table[primary_collision_chain_node_bucket_index];
-    
-    for (;
-         primary_collision_chain_node;
-         primary_collision_chain_node = primary_collision_chain_node->next)
-    {
-        if (primary_collision_chain_node->key_pair ==
-            secondary_collision_chain_node->key_pair)
-        {
-            break;
-        }
-    }
-    
-    return primary_collision_chain_node;
-}
-
 /**************************************************************************
 * This function removes 'primary_collision_chain_node' from the iteration *
 * list.                                                                   *
@@ -183,52 +1113,469 @@ static void unlink_primary_collision_chain_node_from_iteraton_list(
     }
 }
 
+/******************************************************************
+* Returns the number of bytes of a mapping record followed by two *
+* inline keys of up to 'inline_key_capacity' bytes and a length   *
+* byte each, rounded up to whole cache lines so that every record *
+* of a slab starts at a cache line boundary.                      *
+******************************************************************/
+static size_t get_mapping_record_size(size_t inline_key_capacity)
+{
+    size_t size = sizeof(mapping_record_t);
+    
+    if (inline_key_capacity > 0)
+    {
+        size += 2 * (1 + inline_key_capacity);
+    }
+    
+    return (size + BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE - 1) /
+           BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE *
+           BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE;
+}
+
+/*************************************************************************
+* Returns the mapping record following 'mapping_record' in its slab. The *
+* records are 'mapping_record_size' bytes apart, which exceeds the size  *
+* of the record type when the map stores keys inline.                    *
+*************************************************************************/
+static mapping_record_t* get_next_mapping_record(
+                                        bidirectional_hash_map_t* map,
+                                        mapping_record_t* mapping_record)
+{
+    return (mapping_record_t*)((char*) mapping_record +
+                               map->mapping_record_size);
+}
+
+/*****************************************************************************
+* Adds a new slab of 'record_count' mapping records to the map and makes its *
+* records the unused ones. The records left unused in the previous slab are  *
+* moved to the free list. Returns 0 if there is no memory.                   *
+*****************************************************************************/
+static int add_mapping_record_slab(bidirectional_hash_map_t* map,
+                                   size_t record_count)
+{
+    char* memory;
+    size_t misalignment;
+    mapping_record_slab_t* mapping_record_slab;
+    
+    if (record_count > (SIZE_MAX - 2 * BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE) /
+                       map->mapping_record_size)
+    {
+        return 0;
+    }
+    
+    /*************************************************************
+    * The allocator guarantees no particular alignment, so leave *
+    * room for aligning the slab header by hand.                 *
+    *************************************************************/
+    memory = allocate(map,
+                      2 * BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE +
+                      record_count * map->mapping_record_size);
+    
+    if (!memory)
+    {
+        return 0;
+    }
+    
+    for (; map->unused_slab_record_count > 0;
+           map->unused_slab_record_count--)
+    {
+        map->unused_slab_records->key_pair.primary_key =
+        map->free_mapping_records;
+        
+        map->free_mapping_records = map->unused_slab_records;
+        map->unused_slab_records  =
+        get_next_mapping_record(map, map->unused_slab_records);
+        map->free_mapping_record_count++;
+    }
+    
+    misalignment = (size_t) memory % BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE;
+    mapping_record_slab = (mapping_record_slab_t*)
+                          (memory +
+                           (BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE -
+                            misalignment) %
+                           BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE);
+    
+    mapping_record_slab->next = map->mapping_record_slabs;
+    mapping_record_slab->record_count = record_count;
+    mapping_record_slab->memory = memory;
+    
+    map->mapping_record_slabs = mapping_record_slab;
+    map->unused_slab_records =
+    (mapping_record_t*)((char*) mapping_record_slab +
+                        BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE);
+    map->unused_slab_record_count = record_count;
+    map->slab_record_count += record_count;
+    return 1;
+}
+
+/****************************************************************************
+* Allocates a mapping record. The records released by removed mappings are  *
+* reused first, then the slab records are handed out in address order. Once *
+* the slab is used up, a new slab is added, as large as all the earlier     *
+* slabs combined, so that their number stays logarithmic. Returns NULL if   *
+* there is no memory.                                                       *
+****************************************************************************/
+static mapping_record_t* allocate_mapping_record(bidirectional_hash_map_t* map)
+{
+    mapping_record_t* mapping_record = map->free_mapping_records;
+    size_t record_count;
+    
+    if (mapping_record)
+    {
+        map->free_mapping_records = mapping_record->key_pair.primary_key;
+        map->free_mapping_record_count--;
+        return mapping_record;
+    }
+    
+    if (map->unused_slab_record_count == 0)
+    {
+        record_count = map->slab_record_count;
+        record_count = max_size_t(record_count, MINIMUM_SLAB_RECORD_COUNT);
+        
+        if (record_count > MAXIMUM_SLAB_RECORD_COUNT)
+        {
+            record_count = MAXIMUM_SLAB_RECORD_COUNT;
+        }
+        
+        if (!add_mapping_record_slab(map, record_count))
+        {
+            return NULL;
+        }
+    }
+    
+    mapping_record = map->unused_slab_records;
+    map->unused_slab_records = get_next_mapping_record(map, mapping_record);
+    map->unused_slab_record_count--;
+    return mapping_record;
+}
+
+/***************************************************************************
+* Releases all the slabs of the map at once, regardless of how many of the *
+* mapping records in them are still in use.                                *
+***************************************************************************/
+static void free_mapping_record_slabs(bidirectional_hash_map_t* map)
+{
+    mapping_record_slab_t* mapping_record_slab;
+    
+    while (map->mapping_record_slabs)
+    {
+        mapping_record_slab = map->mapping_record_slabs;
+        map->mapping_record_slabs = mapping_record_slab->next;
+        deallocate(map, mapping_record_slab->memory);
+    }
+    
+    map->unused_slab_records       = NULL;
+    map->unused_slab_record_count  = 0;
+    map->free_mapping_records      = NULL;
+    map->free_mapping_record_count = 0;
+    map->slab_record_count         = 0;
+}
+
+/**************************************************************************
+* Releases the memory of the mapping which 'primary_collision_chain_node' *
+* and 'secondary_collision_chain_node' belong to.                         *
+**************************************************************************/
+static void free_mapping(
+            bidirectional_hash_map_t* map,
+            primary_collision_chain_node_t* primary_collision_chain_node,
+            secondary_collision_chain_node_t* secondary_collision_chain_node)
+{
+    mapping_record_t* mapping_record;
+    
+    if (map->flags & BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS)
+    {
+        /****************************************************************
+        * The key pair is the first member of the record, so the record *
+        * starts where the key pair does.                               *
+        ****************************************************************/
+        mapping_record =
+        (mapping_record_t*) primary_collision_chain_node->key_pair;
+        
+        mapping_record->key_pair.primary_key = map->free_mapping_records;
+        map->free_mapping_records = mapping_record;
+        map->free_mapping_record_count++;
+        return;
+    }
+    
+    deallocate(map, primary_collision_chain_node->key_pair);
+    deallocate(map, primary_collision_chain_node);
+    deallocate(map, secondary_collision_chain_node);
+}
+
 /****************************************************************************
 * This function is responsible for removing a primary/secondary key mapping *
-* from the bidirectional hash map.                                          *
+* from the bidirectional hash map. This function also decrements the 'size' *
+* of the map, but leaves shrinking the hash tables to the caller.           *
 ****************************************************************************/
 static void remove_mapping(
                 bidirectional_hash_map_t* map,
                 primary_collision_chain_node_t* primary_collision_chain_node)
 {
     secondary_collision_chain_node_t* secondary_collision_chain_node =
-    find_secondary_collision_chain_node_via_primary_collision_chain_node(
-                                                map,
-                                                primary_collision_chain_node);
+    primary_collision_chain_node->twin;
     
-    free(primary_collision_chain_node->key_pair);
     unlink_primary_collision_chain_node_from_iteraton_list(
                                                 map,
                                                 primary_collision_chain_node);
     
-    /*****************************************************
-    * Unlink and purge the primary collision chain node: *
-    *****************************************************/
+    /***************************************************
+    * Unlink both the collision chain nodes from their *
+    * collision chains:                                *
+    ***************************************************/
     unlink_primary_collision_chain_node(map, primary_collision_chain_node);
-    free(primary_collision_chain_node);
-    
-    /*******************************************************
-    * Unlink and purge the secondary collision chain node: *
-    *******************************************************/
     unlink_secondary_collision_chain_node(map, secondary_collision_chain_node);
-    free(secondary_collision_chain_node);
+    
+    /****************************
+    * Purge the mapping's data: *
+    ****************************/
+    free_mapping(map,
+                 primary_collision_chain_node,
+                 secondary_collision_chain_node);
+    map->size--;
+}
+
+/********************************************************************
+* Returns the node of 'primary_key' in the collision tree rooted at *
+* 'node', or NULL if there is no such node.                         *
+********************************************************************/
+static primary_collision_chain_node_t* find_primary_tree_node(
+                                        bidirectional_hash_map_t* map,
+                                        primary_collision_chain_node_t* node,
+                                        void* primary_key,
+                                        size_t primary_key_hash)
+{
+    int cmp;
+    
+    while (node)
+    {
+        cmp = compare_primary_key(map, primary_key, primary_key_hash, node);
+        
+        if (cmp == 0)
+        {
+            break;
+        }
+        
+        node = cmp < 0 ? node->prev : node->next;
+    }
+    
+    return node;
+}
+
+/**********************************************************************
+* Returns the node of 'secondary_key' in the collision tree rooted at *
+* 'node', or NULL if there is no such node.                           *
+**********************************************************************/
+static secondary_collision_chain_node_t* find_secondary_tree_node(
+                                    bidirectional_hash_map_t* map,
+                                    secondary_collision_chain_node_t* node,
+                                    void* secondary_key,
+                                    size_t secondary_key_hash)
+{
+    int cmp;
+    
+    while (node)
+    {
+        cmp = compare_secondary_key(map,
+                                    secondary_key,
+                                    secondary_key_hash,
+                                    node);
+        
+        if (cmp == 0)
+        {
+            break;
+        }
+        
+        node = cmp < 0 ? node->prev : node->next;
+    }
+    
+    return node;
+}
+
+/******************************************************************
+* Returns the inline copy of the primary key of a mapping record, *
+* given the key pair at the start of the record.                  *
+******************************************************************/
+static unsigned char* get_inline_primary_key(key_pair_t* key_pair)
+{
+    return (unsigned char*) key_pair + sizeof(mapping_record_t);
+}
+
+/********************************************************************
+* Returns the inline copy of the secondary key of a mapping record, *
+* which follows the inline copy of its primary key.                 *
+********************************************************************/
+static unsigned char* get_inline_secondary_key(bidirectional_hash_map_t* map,
+                                               key_pair_t* key_pair)
+{
+    return get_inline_primary_key(key_pair) + 1 + map->inline_key_capacity;
+}
+
+/****************************************************************
+* Copies 'key' of 'key_size' bytes to 'inline_key', or marks it *
+* as not inlined if it is too large.                            *
+****************************************************************/
+static void store_inline_key(bidirectional_hash_map_t* map,
+                             unsigned char* inline_key,
+                             void* key,
+                             size_t key_size)
+{
+    if (key_size <= map->inline_key_capacity)
+    {
+        inline_key[0] = (unsigned char) key_size;
+        memcpy(inline_key + 1, key, key_size);
+    }
+    else
+    {
+        inline_key[0] = (unsigned char) NOT_INLINED_KEY_SIZE;
+    }
+}
+
+/**************************************************************
+* Refreshes the inline copy of the primary key of 'key_pair', *
+* if the map stores primary keys inline.                      *
+**************************************************************/
+static void store_inline_primary_key(bidirectional_hash_map_t* map,
+                                     key_pair_t* key_pair)
+{
+    if (map->primary_key_size)
+    {
+        store_inline_key(map,
+                         get_inline_primary_key(key_pair),
+                         key_pair->primary_key,
+                         map->primary_key_size(key_pair->primary_key));
+    }
+}
+
+/****************************************************************
+* Refreshes the inline copy of the secondary key of 'key_pair', *
+* if the map stores secondary keys inline.                      *
+****************************************************************/
+static void store_inline_secondary_key(bidirectional_hash_map_t* map,
+                                       key_pair_t* key_pair)
+{
+    if (map->secondary_key_size)
+    {
+        store_inline_key(map,
+                         get_inline_secondary_key(map, key_pair),
+                         key_pair->secondary_key,
+                         map->secondary_key_size(key_pair->secondary_key));
+    }
+}
+
+/****************************************************************
+* Compares 'key' against the key whose inline copy is           *
+* 'inline_key'. Returns 1 or 0 if the copy decides the outcome, *
+* or -1 if the equality function has to. '*key_size' caches the *
+* size of 'key' across the calls of a single lookup.            *
+****************************************************************/
+static int compare_inline_key(bidirectional_hash_map_t* map,
+                              size_t (*key_size_function)(void*),
+                              unsigned char* inline_key,
+                              void* key,
+                              size_t* key_size)
+{
+    if (*key_size == UNMEASURED_KEY_SIZE)
+    {
+        *key_size = key_size_function(key);
+    }
+    
+    if (inline_key[0] != NOT_INLINED_KEY_SIZE)
+    {
+        return inline_key[0] == *key_size &&
+               memcmp(inline_key + 1, key, *key_size) == 0;
+    }
+    
+    /**************************************************************
+    * The stored key is too large to be inlined, so a key that is *
+    * small enough can not be equal to it.                        *
+    **************************************************************/
+    return *key_size <= map->inline_key_capacity ? 0 : -1;
+}
+
+/*************************************************************************
+* Returns nonzero if 'primary_key' equals the primary key of 'key_pair'. *
+*************************************************************************/
+static int primary_keys_are_equal(bidirectional_hash_map_t* map,
+                                  void* primary_key,
+                                  size_t* primary_key_size,
+                                  key_pair_t* key_pair)
+{
+    int result;
+    
+    if (map->primary_key_size)
+    {
+        result = compare_inline_key(map,
+                                    map->primary_key_size,
+                                    get_inline_primary_key(key_pair),
+                                    primary_key,
+                                    primary_key_size);
+        
+        if (result >= 0)
+        {
+            return result;
+        }
+    }
+    
+    return map->primary_key_equality(primary_key, key_pair->primary_key);
+}
+
+/*****************************************************************
+* Returns nonzero if 'secondary_key' equals the secondary key of *
+* 'key_pair'.                                                    *
+*****************************************************************/
+static int secondary_keys_are_equal(bidirectional_hash_map_t* map,
+                                    void* secondary_key,
+                                    size_t* secondary_key_size,
+                                    key_pair_t* key_pair)
+{
+    int result;
+    
+    if (map->secondary_key_size)
+    {
+        result = compare_inline_key(map,
+                                    map->secondary_key_size,
+                                    get_inline_secondary_key(map, key_pair),
+                                    secondary_key,
+                                    secondary_key_size);
+        
+        if (result >= 0)
+        {
+            return result;
+        }
+    }
+    
+    return map->secondary_key_equality(secondary_key,
+                                       key_pair->secondary_key);
 }
 
 /*************************************************************************
 * This functions returns a primary collision chain node corresponding to *
-* 'primary_key'.                                                         *
+* 'primary_key' whose hash is 'primary_key_hash'. If the map is being    *
+* rehashed incrementally, some of the pending migration work is done     *
+* first.                                                                 *
 *************************************************************************/
-static primary_collision_chain_node_t* find_primary_collision_chain_node(
-                                                bidirectional_hash_map_t* map,
-                                                void* primary_key)
+static primary_collision_chain_node_t*
+find_primary_collision_chain_node_by_hash(bidirectional_hash_map_t* map,
+                                          void* primary_key,
+                                          size_t primary_key_hash)
 {
-    size_t primary_key_hash = map->primary_key_hasher(primary_key);
+    primary_collision_chain_node_t* primary_collision_chain_node;
+    size_t primary_key_size = UNMEASURED_KEY_SIZE;
     
-    size_t primary_key_collision_chain_bucket_index =
-    primary_key_hash & map->modulo_mask;
+    do_rehash_step(map);
     
-    primary_collision_chain_node_t* primary_collision_chain_node =
-    map->primary_key_table[primary_key_collision_chain_bucket_index];
+    primary_collision_chain_node =
+    *get_primary_collision_chain_bucket(map, primary_key_hash);
+    
+    if (primary_collision_chain_node &&
+        primary_collision_chain_node->tree_height)
+    {
+        return find_primary_tree_node(map,
+                                 primary_collision_chain_node,
+                                 primary_key,
+                                 primary_key_hash);
+    }
     
     for (;
          primary_collision_chain_node;
@@ -237,9 +1584,11 @@ static primary_collision_chain_node_t* find_primary_collision_chain_node(
         if (primary_collision_chain_node->key_pair->primary_key_hash ==
             primary_key_hash)
         {
-            if (map->primary_key_equality(
-                        primary_key,
-                        primary_collision_chain_node->key_pair->primary_key))
+            if (primary_keys_are_equal(
+                                map,
+                                primary_key,
+                                &primary_key_size,
+                                primary_collision_chain_node->key_pair))
             {
                 break;
             }
@@ -251,19 +1600,31 @@ static primary_collision_chain_node_t* find_primary_collision_chain_node(
 
 /***************************************************************************
 * This functions returns a secondary collision chain node corresponding to *
-* 'secondary_key'.                                                         *
+* 'secondary_key' whose hash is 'secondary_key_hash'. If the map is being  *
+* rehashed incrementally, some of the pending migration work is done       *
+* first.                                                                   *
 ***************************************************************************/
-static secondary_collision_chain_node_t* find_secondary_collision_chain_node(
-                                                bidirectional_hash_map_t* map,
-                                                void* secondary_key)
+static secondary_collision_chain_node_t*
+find_secondary_collision_chain_node_by_hash(bidirectional_hash_map_t* map,
+                                            void* secondary_key,
+                                            size_t secondary_key_hash)
 {
-    size_t secondary_key_hash = map->secondary_key_hasher(secondary_key);
+    secondary_collision_chain_node_t* secondary_collision_chain_node;
+    size_t secondary_key_size = UNMEASURED_KEY_SIZE;
     
-    size_t secondary_key_collision_chain_bucket_index =
-    secondary_key_hash & map->modulo_mask;
+    do_rehash_step(map);
     
-    secondary_collision_chain_node_t* secondary_collision_chain_node =
-    map->secondary_key_table[secondary_key_collision_chain_bucket_index];
+    secondary_collision_chain_node =
+    *get_secondary_collision_chain_bucket(map, secondary_key_hash);
+    
+    if (secondary_collision_chain_node &&
+        secondary_collision_chain_node->tree_height)
+    {
+        return find_secondary_tree_node(map,
+                                 secondary_collision_chain_node,
+                                 secondary_key,
+                                 secondary_key_hash);
+    }
     
     for (;
          secondary_collision_chain_node;
@@ -272,9 +1633,11 @@ static secondary_collision_chain_node_t* find_secondary_collision_chain_node(
         if (secondary_collision_chain_node->key_pair->secondary_key_hash ==
             secondary_key_hash)
         {
-            if (map->secondary_key_equality(
-                    secondary_key,
-                    secondary_collision_chain_node->key_pair->secondary_key))
+            if (secondary_keys_are_equal(
+                                map,
+                                secondary_key,
+                                &secondary_key_size,
+                                secondary_collision_chain_node->key_pair))
             {
                 break;
             }
@@ -284,6 +1647,34 @@ static secondary_collision_chain_node_t* find_secondary_collision_chain_node(
     return secondary_collision_chain_node;
 }
 
+/*************************************************************************
+* This functions returns a primary collision chain node corresponding to *
+* 'primary_key'.                                                         *
+*************************************************************************/
+static primary_collision_chain_node_t* find_primary_collision_chain_node(
+                                                bidirectional_hash_map_t* map,
+                                                void* primary_key)
+{
+    return find_primary_collision_chain_node_by_hash(
+                                        map,
+                                        primary_key,
+                                        hash_primary_key(map, primary_key));
+}
+
+/***************************************************************************
+* This functions returns a secondary collision chain node corresponding to *
+* 'secondary_key'.                                                         *
+***************************************************************************/
+static secondary_collision_chain_node_t* find_secondary_collision_chain_node(
+                                                bidirectional_hash_map_t* map,
+                                                void* secondary_key)
+{
+    return find_secondary_collision_chain_node_by_hash(
+                                    map,
+                                    secondary_key,
+                                    hash_secondary_key(map, secondary_key));
+}
+
 int bidirectional_hash_map_t_init(
                                 bidirectional_hash_map_t* map,
                                 size_t initial_capacity,
@@ -293,6 +1684,52 @@ int bidirectional_hash_map_t_init(
                                 int (*primary_key_equality)   (void*, void*),
                                 int (*secondary_key_equality) (void*, void*),
                                 void* error_sentinel)
+{
+    return bidirectional_hash_map_t_init_with_flags(map,
+                                                    initial_capacity,
+                                                    load_factor,
+                                                    primary_key_hasher,
+                                                    secondary_key_hasher,
+                                                    primary_key_equality,
+                                                    secondary_key_equality,
+                                                    error_sentinel,
+                                                    0);
+}
+
+int bidirectional_hash_map_t_init_with_flags(
+                                bidirectional_hash_map_t* map,
+                                size_t initial_capacity,
+                                float load_factor,
+                                size_t (*primary_key_hasher)  (void*),
+                                size_t (*secondary_key_hasher)(void*),
+                                int (*primary_key_equality)   (void*, void*),
+                                int (*secondary_key_equality) (void*, void*),
+                                void* error_sentinel,
+                                int flags)
+{
+    return bidirectional_hash_map_t_init_with_allocator(map,
+                                                        initial_capacity,
+                                                        load_factor,
+                                                        primary_key_hasher,
+                                                        secondary_key_hasher,
+                                                        primary_key_equality,
+                                                        secondary_key_equality,
+                                                        error_sentinel,
+                                                        flags,
+                                                        NULL);
+}
+
+int bidirectional_hash_map_t_init_with_allocator(
+                        bidirectional_hash_map_t* map,
+                        size_t initial_capacity,
+                        float load_factor,
+                        size_t (*primary_key_hasher)  (void*),
+                        size_t (*secondary_key_hasher)(void*),
+                        int (*primary_key_equality)   (void*, void*),
+                        int (*secondary_key_equality) (void*, void*),
+                        void* error_sentinel,
+                        int flags,
+                        const bidirectional_hash_map_allocator_t* allocator)
 {
     if (!map)
     {
@@ -307,30 +1744,46 @@ int bidirectional_hash_map_t_init(
         return 0;
     }
     
+    if (!allocator)
+    {
+        allocator = &bidirectional_hash_map_default_allocator;
+    }
+    
+    if (!bidirectional_hash_map_allocator_t_is_valid(allocator))
+    {
+        return 0;
+    }
+    
+    map->allocator = *allocator;
+    
     load_factor      = max_float(load_factor, MINIMUM_LOAD_FACTOR);
     initial_capacity = max_size_t(initial_capacity, MINIMUM_INITIAL_CAPACITY);
     initial_capacity = to_power_of_two(initial_capacity);
     
-    map->primary_key_table   = NULL;
-    map->secondary_key_table = NULL;
+    map->primary_key_table       = NULL;
+    map->secondary_key_table     = NULL;
+    map->old_primary_key_table   = NULL;
+    map->old_secondary_key_table = NULL;
+    map->old_capacity            = 0;
+    map->rehash_index            = 0;
     map->capacity            = initial_capacity;
+    map->minimum_capacity    = initial_capacity;
     map->load_factor         = load_factor;
+    map->shrink_load_factor  = load_factor / 4;
     map->size                = 0;
     
-    map->primary_key_table = calloc(initial_capacity,
-                                    sizeof(primary_collision_chain_node_t*));
+    map->primary_key_table = allocate_table(map, initial_capacity);
     
     if (!map->primary_key_table)
     {
         return 0;
     }
     
-    map->secondary_key_table =
-        calloc(initial_capacity, sizeof(secondary_collision_chain_node_t*));
+    map->secondary_key_table = allocate_table(map, initial_capacity);
     
     if (!map->secondary_key_table)
     {
-        free(map->primary_key_table);
+        deallocate(map, map->primary_key_table);
         map->primary_key_table = NULL;
         return 0;
     }
@@ -340,7 +1793,30 @@ int bidirectional_hash_map_t_init(
     map->secondary_key_hasher   = secondary_key_hasher;
     map->primary_key_equality   = primary_key_equality;
     map->secondary_key_equality = secondary_key_equality;
+    map->primary_key_compare    = NULL;
+    map->secondary_key_compare  = NULL;
     map->error_sentinel         = error_sentinel;
+    map->flags                  = flags;
+    map->hash_key.k0            = 0;
+    map->hash_key.k1            = 0;
+    
+    if (flags & BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES)
+    {
+        bidirectional_hash_map_hash_key_t_randomize(&map->hash_key);
+    }
+    
+    map->first_collision_chain_node = NULL;
+    map->last_collision_chain_node  = NULL;
+    map->mapping_record_slabs       = NULL;
+    map->unused_slab_records        = NULL;
+    map->unused_slab_record_count   = 0;
+    map->free_mapping_records       = NULL;
+    map->free_mapping_record_count  = 0;
+    map->slab_record_count          = 0;
+    map->mapping_record_size        = get_mapping_record_size(0);
+    map->inline_key_capacity        = 0;
+    map->primary_key_size           = NULL;
+    map->secondary_key_size         = NULL;
     
     return 1;
 }
@@ -366,24 +1842,38 @@ void bidirectional_hash_map_t_destroy(bidirectional_hash_map_t* map)
     
     primary_collision_chain_node = map->first_collision_chain_node;
     
-    /*************************
-    * Free the mapping data. *
-    *************************/
-    while (primary_collision_chain_node)
+    /***************************************************************
+    * Free the mapping data. The fused mapping records go with the *
+    * slabs, so there is no need to visit them one by one.         *
+    ***************************************************************/
+    if (map->flags & BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS)
     {
-        primary_collision_chain_node_next = primary_collision_chain_node->down;
-        remove_mapping(map, primary_collision_chain_node);
-        primary_collision_chain_node = primary_collision_chain_node_next;
+        free_mapping_record_slabs(map);
+    }
+    else
+    {
+        while (primary_collision_chain_node)
+        {
+            primary_collision_chain_node_next =
+            primary_collision_chain_node->down;
+            
+            remove_mapping(map, primary_collision_chain_node);
+            primary_collision_chain_node = primary_collision_chain_node_next;
+        }
     }
     
     /*******************************
     * Free the actual hash tables. *
     *******************************/
-    free(map->primary_key_table);
-    free(map->secondary_key_table);
+    deallocate(map, map->primary_key_table);
+    deallocate(map, map->secondary_key_table);
+    deallocate(map, map->old_primary_key_table);
+    deallocate(map, map->old_secondary_key_table);
     
     map->primary_key_table   = NULL;
     map->secondary_key_table = NULL;
+    map->old_primary_key_table   = NULL;
+    map->old_secondary_key_table = NULL;
     map->first_collision_chain_node = NULL;
     map->last_collision_chain_node = NULL;
     map->capacity = 0;
@@ -405,139 +1895,403 @@ size_t bidirectional_hash_map_t_capacity(bidirectional_hash_map_t* map)
     return map->capacity;
 }
 
-/*****************************************************************************
-* This function relinks all the mappings (key pairs and collision chains) to *
-* new hash tables.                                                           *
-*****************************************************************************/
-static void relink_to_new_tables(
-                bidirectional_hash_map_t* map,
-                primary_collision_chain_node_t* primary_collision_chain_node,
-                primary_collision_chain_node_t** next_primary_hash_table,
-                secondary_collision_chain_node_t** next_secondary_hash_table)
+/****************************************************************************
+* This function migrates the collision chains of the next bucket of the old *
+* hash tables to the current hash tables. Once all the old buckets are      *
+* migrated, the old hash tables are released.                               *
+****************************************************************************/
+static void migrate_next_bucket(bidirectional_hash_map_t* map)
 {
-    size_t primary_collision_chain_bucket_index;
-    size_t secondary_collision_chain_bucket_index;
-    size_t next_capacity;
-    size_t next_modulo_mask;
+    primary_collision_chain_node_t* primary_collision_chain_node;
+    primary_collision_chain_node_t* primary_collision_chain_node_next;
+    secondary_collision_chain_node_t* secondary_collision_chain_node;
+    secondary_collision_chain_node_t* secondary_collision_chain_node_next;
+    size_t bucket_index = map->rehash_index;
     
-    secondary_collision_chain_node_t* secondary_collision_chain_node =
-        find_secondary_collision_chain_node_via_primary_collision_chain_node(
-                                                map,
-                                                primary_collision_chain_node);
+    if (map->old_primary_key_table[bucket_index] &&
+        map->old_primary_key_table[bucket_index]->tree_height)
+    {
+        untreeify_primary_bucket(&map->old_primary_key_table[bucket_index]);
+    }
     
-    /********************************************************************
-    * Unlink the 'primary_collision_chain_node' from its current chain. *
-    ********************************************************************/
-    unlink_primary_collision_chain_node(map, primary_collision_chain_node);
+    primary_collision_chain_node = map->old_primary_key_table[bucket_index];
+    map->old_primary_key_table[bucket_index] = NULL;
     
-    /*********************************************************
-    * Unlink the opposite collision chain node of            *
-    * 'primary_collision_chain_node' from its current chain. *
-    *********************************************************/
-    unlink_secondary_collision_chain_node(map, secondary_collision_chain_node);
+    while (primary_collision_chain_node)
+    {
+        primary_collision_chain_node_next = primary_collision_chain_node->next;
+        
+        link_primary_collision_chain_node(
+                map,
+                &map->primary_key_table[
+                    primary_collision_chain_node->key_pair->primary_key_hash
+                    & map->modulo_mask],
+                primary_collision_chain_node);
+        
+        primary_collision_chain_node = primary_collision_chain_node_next;
+    }
     
-    /*******************************************************
-    * Relink both 'primary_collision_chain_node' and       *
-    * 'secondary_collision_chain_node' to new hash tables. *
-    *******************************************************/
-    next_capacity = map->capacity << 1;
-    next_modulo_mask = next_capacity - 1;
+    if (map->old_secondary_key_table[bucket_index] &&
+        map->old_secondary_key_table[bucket_index]->tree_height)
+    {
+        untreeify_secondary_bucket(
+                                &map->old_secondary_key_table[bucket_index]);
+    }
     
-    /*************************************************************
-    * Link 'primary_collision_chain_node' to its new hash table. *
-    *************************************************************/
-    primary_collision_chain_bucket_index =
-    primary_collision_chain_node->key_pair->primary_key_hash & next_modulo_mask;
+    secondary_collision_chain_node =
+    map->old_secondary_key_table[bucket_index];
+    map->old_secondary_key_table[bucket_index] = NULL;
     
-    primary_collision_chain_node->prev = NULL;
-    primary_collision_chain_node->next =
-    next_primary_hash_table[primary_collision_chain_bucket_index];
+    while (secondary_collision_chain_node)
+    {
+        secondary_collision_chain_node_next =
+        secondary_collision_chain_node->next;
+        
+        link_secondary_collision_chain_node(
+                map,
+                &map->secondary_key_table[
+                    secondary_collision_chain_node->key_pair->secondary_key_hash
+                    & map->modulo_mask],
+                secondary_collision_chain_node);
+        
+        secondary_collision_chain_node = secondary_collision_chain_node_next;
+    }
+    
+    if (++map->rehash_index == map->old_capacity)
+    {
+        deallocate(map, map->old_primary_key_table);
+        deallocate(map, map->old_secondary_key_table);
+        
+        map->old_primary_key_table   = NULL;
+        map->old_secondary_key_table = NULL;
+        map->old_capacity            = 0;
+        map->rehash_index            = 0;
+    }
+}
+
+/***************************************************************************
+* This function does a bounded amount of pending migration work. Every     *
+* operation runs it via the find functions when the map is being rehashed. *
+***************************************************************************/
+static void do_rehash_step(bidirectional_hash_map_t* map)
+{
+    size_t i;
     
-    if (next_primary_hash_table[primary_collision_chain_bucket_index])
+    for (i = 0;
+         i < REHASH_BUCKETS_PER_OPERATION &&
+         map->old_primary_key_table;
+         ++i)
     {
-        next_primary_hash_table[primary_collision_chain_bucket_index]->prev =
-        primary_collision_chain_node;
+        migrate_next_bucket(map);
     }
+}
+
+/******************************************************************************
+* This function is responsible for allocating hash tables of 'next_capacity'  *
+* buckets and relinking all current collision chain nodes to them. If the map *
+* is rehashed incrementally, the relinking is only started, and the           *
+* following operations complete it a few buckets at a time.                   *
+******************************************************************************/
+static int resize_hash_map(bidirectional_hash_map_t* map, size_t next_capacity)
+{
+    primary_collision_chain_node_t** next_primary_hash_table;
+    secondary_collision_chain_node_t** next_secondary_hash_table;
     
-    next_primary_hash_table[primary_collision_chain_bucket_index] =
-    primary_collision_chain_node;
+    /***********************************************************
+    * Only one migration may be in progress, so finish the old *
+    * one, if any.                                             *
+    ***********************************************************/
+    bidirectional_hash_map_t_finish_rehash(map);
     
-    /***************************************************************
-    * Link 'secondary_collision_chain_node' to its new hash table. *
-    ***************************************************************/
-    secondary_collision_chain_bucket_index =
-    secondary_collision_chain_node->key_pair->secondary_key_hash
-    & next_modulo_mask;
+    next_primary_hash_table = allocate_table(map, next_capacity);
     
-    secondary_collision_chain_node->prev = NULL;
-    secondary_collision_chain_node->next =
-    next_secondary_hash_table[secondary_collision_chain_bucket_index];
+    if (!next_primary_hash_table)
+    {
+        return 0;
+    }
+    
+    next_secondary_hash_table = allocate_table(map, next_capacity);
+    
+    if (!next_secondary_hash_table)
+    {
+        deallocate(map, next_primary_hash_table);
+        return 0;
+    }
+    
+    map->old_primary_key_table   = map->primary_key_table;
+    map->old_secondary_key_table = map->secondary_key_table;
+    map->old_capacity            = map->capacity;
+    map->old_modulo_mask         = map->modulo_mask;
+    map->rehash_index            = 0;
     
-    if (next_secondary_hash_table[secondary_collision_chain_bucket_index])
+    map->primary_key_table   = next_primary_hash_table;
+    map->secondary_key_table = next_secondary_hash_table;
+    map->capacity            = next_capacity;
+    map->modulo_mask         = next_capacity - 1;
+    
+    if (!(map->flags & BIDIRECTIONAL_HASH_MAP_INCREMENTAL_REHASH))
     {
-        next_secondary_hash_table[secondary_collision_chain_bucket_index]->prev
-        = secondary_collision_chain_node;
+        bidirectional_hash_map_t_finish_rehash(map);
     }
     
-    next_secondary_hash_table[secondary_collision_chain_bucket_index] =
-    secondary_collision_chain_node;
+    return 1;
 }
 
 /*******************************************************************************
 * This function is responsible for allocating larger hash tables and relinking *
-* all current collision chain nodes and key pairs to them.                     *
+* all current collision chain nodes and key pairs to them, possibly gradually. *
 *******************************************************************************/
 static int expand_hash_map(bidirectional_hash_map_t* map)
 {
-    size_t next_capacity;
-    size_t next_modulo_mask;
-    primary_collision_chain_node_t** next_primary_hash_table;
-    secondary_collision_chain_node_t** next_secondary_hash_table;
-    primary_collision_chain_node_t* primary_collision_chain_node;
-    primary_collision_chain_node_t* primary_collision_chain_node_next;
+    if (map->capacity >= MAXIMUM_CAPACITY)
+    {
+        return 0;
+    }
+    
+    return resize_hash_map(map, map->capacity << 1);
+}
+
+/****************************************************************************
+* This function halves the hash tables as many times as needed for the load *
+* of the map to get back above the low watermark. Failing to allocate the   *
+* smaller tables is harmless, as the map just keeps using the current ones. *
+****************************************************************************/
+static void shrink_hash_map_if_sparse(bidirectional_hash_map_t* map)
+{
+    size_t next_capacity = map->capacity;
     
-    next_capacity = map->capacity << 1;
+    while (next_capacity > map->minimum_capacity &&
+           map->size < next_capacity * map->shrink_load_factor)
+    {
+        next_capacity >>= 1;
+    }
+    
+    if (next_capacity < map->capacity)
+    {
+        resize_hash_map(map, next_capacity);
+    }
+}
+
+void bidirectional_hash_map_t_set_key_comparators(
+                            bidirectional_hash_map_t* map,
+                            int (*primary_key_compare)  (void*, void*),
+                            int (*secondary_key_compare)(void*, void*))
+{
+    size_t i;
     
-    next_primary_hash_table = calloc(next_capacity,
-                                     sizeof(primary_collision_chain_node_t*));
+    /*********************************************************
+    * Rebuild every bucket under the new ordering functions, *
+    * with all of them in the current hash tables.           *
+    *********************************************************/
+    bidirectional_hash_map_t_finish_rehash(map);
     
-    if (!next_primary_hash_table)
+    for (i = 0; i < map->capacity; ++i)
+    {
+        if (map->primary_key_table[i] &&
+            map->primary_key_table[i]->tree_height)
+        {
+            untreeify_primary_bucket(&map->primary_key_table[i]);
+        }
+        
+        if (map->secondary_key_table[i] &&
+            map->secondary_key_table[i]->tree_height)
+        {
+            untreeify_secondary_bucket(&map->secondary_key_table[i]);
+        }
+    }
+    
+    map->primary_key_compare   = primary_key_compare;
+    map->secondary_key_compare = secondary_key_compare;
+    
+    for (i = 0; i < map->capacity; ++i)
+    {
+        if (primary_key_compare &&
+            is_primary_collision_chain_long(map->primary_key_table[i]))
+        {
+            treeify_primary_bucket(map, &map->primary_key_table[i]);
+        }
+        
+        if (secondary_key_compare &&
+            is_secondary_collision_chain_long(map->secondary_key_table[i]))
+        {
+            treeify_secondary_bucket(map, &map->secondary_key_table[i]);
+        }
+    }
+}
+
+int bidirectional_hash_map_t_set_inline_keys(
+                                bidirectional_hash_map_t* map,
+                                size_t (*primary_key_size)  (void*),
+                                size_t (*secondary_key_size)(void*),
+                                size_t inline_key_capacity)
+{
+    if (!(map->flags & BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS) ||
+        map->size > 0 ||
+        inline_key_capacity > MAXIMUM_INLINE_KEY_CAPACITY)
     {
         return 0;
     }
     
-    next_secondary_hash_table =
-        calloc(next_capacity, sizeof(secondary_collision_chain_node_t*));
+    if (inline_key_capacity == 0)
+    {
+        primary_key_size   = NULL;
+        secondary_key_size = NULL;
+    }
     
-    if (!next_secondary_hash_table)
+    /***************************************************************
+    * The records change their size, so the slabs carved for the   *
+    * old size go. The map is empty, hence none of them is in use. *
+    ***************************************************************/
+    free_mapping_record_slabs(map);
+    
+    map->primary_key_size    = primary_key_size;
+    map->secondary_key_size  = secondary_key_size;
+    map->inline_key_capacity = inline_key_capacity;
+    map->mapping_record_size = get_mapping_record_size(inline_key_capacity);
+    return 1;
+}
+
+void bidirectional_hash_map_t_set_shrink_load_factor(
+                                                bidirectional_hash_map_t* map,
+                                                float shrink_load_factor)
+{
+    if (shrink_load_factor < 0.0f)
+    {
+        shrink_load_factor = 0.0f;
+    }
+    
+    if (shrink_load_factor > map->load_factor / 4)
+    {
+        shrink_load_factor = map->load_factor / 4;
+    }
+    
+    map->shrink_load_factor = shrink_load_factor;
+}
+
+int bidirectional_hash_map_t_reserve(bidirectional_hash_map_t* map,
+                                     size_t mapping_count)
+{
+    size_t next_capacity = map->capacity;
+    size_t available_mapping_record_count;
+    
+    while (mapping_count > next_capacity * map->load_factor)
+    {
+        if (next_capacity >= MAXIMUM_CAPACITY)
+        {
+            return 0;
+        }
+        
+        next_capacity <<= 1;
+    }
+    
+    if (next_capacity > map->capacity)
+    {
+        if (!resize_hash_map(map, next_capacity))
+        {
+            return 0;
+        }
+        
+        /***********************************************************
+        * Reserving is done ahead of the load, so do not leave any *
+        * migration work for the operations that follow.           *
+        ***********************************************************/
+        bidirectional_hash_map_t_finish_rehash(map);
+    }
+    
+    map->minimum_capacity = max_size_t(map->minimum_capacity, next_capacity);
+    
+    if (!(map->flags & BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS))
+    {
+        return 1;
+    }
+    
+    available_mapping_record_count = map->size +
+                                     map->free_mapping_record_count +
+                                     map->unused_slab_record_count;
+    
+    if (available_mapping_record_count >= mapping_count)
+    {
+        return 1;
+    }
+    
+    /*************************************************************
+    * A single slab holds all the missing records, however many. *
+    *************************************************************/
+    return add_mapping_record_slab(
+                            map,
+                            mapping_count - available_mapping_record_count);
+}
+
+int bidirectional_hash_map_t_shrink_to_fit(bidirectional_hash_map_t* map)
+{
+    size_t next_capacity = MINIMUM_INITIAL_CAPACITY;
+    
+    while (map->size > next_capacity * map->load_factor)
+    {
+        next_capacity <<= 1;
+    }
+    
+    if (next_capacity < map->capacity)
+    {
+        if (!resize_hash_map(map, next_capacity))
+        {
+            return 0;
+        }
+    }
+    
+    /************************************************************
+    * The caller wants the memory back now, so release the old  *
+    * tables right away even if the map rehashes incrementally. *
+    ************************************************************/
+    bidirectional_hash_map_t_finish_rehash(map);
+    
+    /***************************************************************
+    * The slabs can only be released as a whole, that is, once the *
+    * map is empty.                                                *
+    ***************************************************************/
+    if (map->size == 0)
+    {
+        free_mapping_record_slabs(map);
+    }
+    
+    if (map->minimum_capacity > map->capacity)
+    {
+        map->minimum_capacity = map->capacity;
+    }
+    
+    return 1;
+}
+
+int bidirectional_hash_map_t_is_rehashing(bidirectional_hash_map_t* map)
+{
+    return map->old_primary_key_table ? 1 : 0;
+}
+
+size_t bidirectional_hash_map_t_pending_rehash_buckets(
+                                                bidirectional_hash_map_t* map)
+{
+    return map->old_primary_key_table ?
+           map->old_capacity - map->rehash_index :
+           0;
+}
+
+size_t bidirectional_hash_map_t_rehash_step(bidirectional_hash_map_t* map,
+                                            size_t bucket_count)
+{
+    while (bucket_count-- > 0 && map->old_primary_key_table)
     {
-        free(next_primary_hash_table);
-        return 0;
+        migrate_next_bucket(map);
     }
     
-    next_modulo_mask = next_capacity - 1;
-    primary_collision_chain_node = map->first_collision_chain_node;
-    
-    while (primary_collision_chain_node)
+    return bidirectional_hash_map_t_pending_rehash_buckets(map);
+}
+
+void bidirectional_hash_map_t_finish_rehash(bidirectional_hash_map_t* map)
+{
+    while (map->old_primary_key_table)
     {
-        primary_collision_chain_node_next = primary_collision_chain_node->down;
-        relink_to_new_tables(map,
-                             primary_collision_chain_node,
-                             next_primary_hash_table,
-                             next_secondary_hash_table);
-        
-        primary_collision_chain_node = primary_collision_chain_node_next;
+        migrate_next_bucket(map);
     }
-    
-    free(map->primary_key_table);
-    free(map->secondary_key_table);
-    
-    map->primary_key_table = next_primary_hash_table;
-    map->secondary_key_table = next_secondary_hash_table;
-    map->capacity = next_capacity;
-    map->modulo_mask = next_modulo_mask;
-
-    return 1;
 }
 
 /************************************************************************
@@ -546,19 +2300,16 @@ static int expand_hash_map(bidirectional_hash_map_t* map)
 static void* update_primary_key(
             bidirectional_hash_map_t* map,
             secondary_collision_chain_node_t* secondary_collision_chain_node,
-            void* new_primary_key)
+            void* new_primary_key,
+            size_t new_primary_key_hash)
 {
     void* old_primary_key;
-    size_t new_primary_key_hash;
-    size_t new_primary_key_collision_chain_bucket_index;
     
     /*******************************************************
     * Find the corresponding primary collision chain node: *
     *******************************************************/
     primary_collision_chain_node_t* primary_collision_chain_node =
-    find_primary_collision_chain_node_via_secondary_collision_chain_node(
-                                                map,
-                                                secondary_collision_chain_node);
+    secondary_collision_chain_node->twin;
     
     old_primary_key = primary_collision_chain_node->key_pair->primary_key;
     
@@ -571,26 +2322,15 @@ static void* update_primary_key(
     * Link the unlinked 'primary_collision_chain_node' to its new collision *
     * chain. Updates the actual key and its hash as well.                   *
     ************************************************************************/
-    new_primary_key_hash = map->primary_key_hasher(new_primary_key);
-    new_primary_key_collision_chain_bucket_index =
-    new_primary_key_hash & map->modulo_mask;
-    
     primary_collision_chain_node->key_pair->primary_key = new_primary_key;
     primary_collision_chain_node->key_pair->primary_key_hash =
     new_primary_key_hash;
+    store_inline_primary_key(map, primary_collision_chain_node->key_pair);
     
-    primary_collision_chain_node->prev = NULL;
-    primary_collision_chain_node->next =
-    map->primary_key_table[new_primary_key_collision_chain_bucket_index];
-    
-    if (map->primary_key_table[new_primary_key_collision_chain_bucket_index])
-    {
-        map->primary_key_table[new_primary_key_collision_chain_bucket_index]
-           ->prev = primary_collision_chain_node;
-    }
-    
-    map->primary_key_table[new_primary_key_collision_chain_bucket_index] =
-    primary_collision_chain_node;
+    link_primary_collision_chain_node(
+                map,
+                get_primary_collision_chain_bucket(map, new_primary_key_hash),
+                primary_collision_chain_node);
     
     return old_primary_key;
 }
@@ -598,19 +2338,16 @@ static void* update_primary_key(
 static void* update_secondary_key(
                 bidirectional_hash_map_t* map,
                 primary_collision_chain_node_t* primary_collision_chain_node,
-                void* new_secondary_key)
+                void* new_secondary_key,
+                size_t new_secondary_key_hash)
 {
     void* old_secondary_key;
-    size_t new_secondary_key_hash;
-    size_t new_secondary_key_collision_chain_bucket_index;
     
     /*********************************************************
     * Find the corresponding secondary collision chain node: *
     *********************************************************/
     secondary_collision_chain_node_t* secondary_collision_chain_node =
-        find_secondary_collision_chain_node_via_primary_collision_chain_node(
-                                                map,
-                                                primary_collision_chain_node);
+        primary_collision_chain_node->twin;
     
     old_secondary_key = secondary_collision_chain_node->key_pair->secondary_key;
     
@@ -624,27 +2361,16 @@ static void* update_secondary_key(
     * Links the unlinked 'secondary_collision_chain_node' to its new collision *
     * chain. Updates the actual key and its has as well.                       *
     ***************************************************************************/
-    new_secondary_key_hash = map->secondary_key_hasher(new_secondary_key);
-    new_secondary_key_collision_chain_bucket_index =
-    new_secondary_key_hash & map->modulo_mask;
-    
     secondary_collision_chain_node->key_pair->secondary_key = new_secondary_key;
     secondary_collision_chain_node->key_pair->secondary_key_hash =
     new_secondary_key_hash;
+    store_inline_secondary_key(map,
+                               secondary_collision_chain_node->key_pair);
     
-    secondary_collision_chain_node->prev = NULL;
-    secondary_collision_chain_node->next =
-    map->secondary_key_table[new_secondary_key_collision_chain_bucket_index];
-    
-    if (map->
-        secondary_key_table[new_secondary_key_collision_chain_bucket_index])
-    {
-        map->secondary_key_table[new_secondary_key_collision_chain_bucket_index]
-           ->prev = secondary_collision_chain_node;
-    }
-    
-    map->secondary_key_table[new_secondary_key_collision_chain_bucket_index] =
-    secondary_collision_chain_node;
+    link_secondary_collision_chain_node(
+            map,
+            get_secondary_collision_chain_bucket(map, new_secondary_key_hash),
+            secondary_collision_chain_node);
     
     return old_secondary_key;
 }
@@ -656,13 +2382,14 @@ static void* update_secondary_key(
 *******************************************************************************/
 static int add_new_mapping(bidirectional_hash_map_t* map,
                            void* primary_key,
-                           void* secondary_key)
+                           size_t primary_key_hash,
+                           void* secondary_key,
+                           size_t secondary_key_hash)
 {
+    mapping_record_t* mapping_record;
     key_pair_t* key_pair;
     primary_collision_chain_node_t* primary_collision_chain_node;
     secondary_collision_chain_node_t* secondary_collision_chain_node;
-    size_t primary_key_collision_chain_bucket_index;
-    size_t secondary_key_collision_chain_bucket_index;
     
     if (map->size > map->capacity * map->load_factor)
     {
@@ -672,76 +2399,78 @@ static int add_new_mapping(bidirectional_hash_map_t* map,
         }
     }
     
-    key_pair = malloc(sizeof(*key_pair));
-    
-    if (!key_pair)
-    {
-        return 0;
-    }
-    
-    primary_collision_chain_node =
-    malloc(sizeof(*primary_collision_chain_node));
-    
-    if (!primary_collision_chain_node)
+    if (map->flags & BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS)
     {
-        free(key_pair);
-        return 0;
+        mapping_record = allocate_mapping_record(map);
+        
+        if (!mapping_record)
+        {
+            return 0;
+        }
+        
+        key_pair = &mapping_record->key_pair;
+        primary_collision_chain_node =
+        &mapping_record->primary_collision_chain_node;
+        secondary_collision_chain_node =
+        &mapping_record->secondary_collision_chain_node;
     }
-    
-    secondary_collision_chain_node =
-    malloc(sizeof(*secondary_collision_chain_node));
-    
-    if (!secondary_collision_chain_node)
+    else
     {
-        free(key_pair);
-        free(primary_collision_chain_node);
-        return 0;
+        key_pair = allocate(map, sizeof(*key_pair));
+        
+        if (!key_pair)
+        {
+            return 0;
+        }
+        
+        primary_collision_chain_node =
+        allocate(map, sizeof(*primary_collision_chain_node));
+        
+        if (!primary_collision_chain_node)
+        {
+            deallocate(map, key_pair);
+            return 0;
+        }
+        
+        secondary_collision_chain_node =
+        allocate(map, sizeof(*secondary_collision_chain_node));
+        
+        if (!secondary_collision_chain_node)
+        {
+            deallocate(map, key_pair);
+            deallocate(map, primary_collision_chain_node);
+            return 0;
+        }
     }
     
     key_pair->primary_key = primary_key;
-    key_pair->primary_key_hash = map->primary_key_hasher(primary_key);
+    key_pair->primary_key_hash = primary_key_hash;
     key_pair->secondary_key = secondary_key;
-    key_pair->secondary_key_hash = map->secondary_key_hasher(secondary_key);
+    key_pair->secondary_key_hash = secondary_key_hash;
+    store_inline_primary_key(map, key_pair);
+    store_inline_secondary_key(map, key_pair);
+    
+    primary_collision_chain_node->twin   = secondary_collision_chain_node;
+    secondary_collision_chain_node->twin = primary_collision_chain_node;
     
     /****************************************************
     * Link 'primary_collision_chain_node' to its table: *
     ****************************************************/
     primary_collision_chain_node->key_pair = key_pair;
-    primary_collision_chain_node->prev = NULL;
-    primary_key_collision_chain_bucket_index =
-    key_pair->primary_key_hash & map->modulo_mask;
-    
-    primary_collision_chain_node->next =
-    map->primary_key_table[primary_key_collision_chain_bucket_index];
-    
-    if (map->primary_key_table[primary_key_collision_chain_bucket_index])
-    {
-        map->primary_key_table[primary_key_collision_chain_bucket_index]->prev =
-        primary_collision_chain_node;
-    }
-    
-    map->primary_key_table[primary_key_collision_chain_bucket_index] =
-    primary_collision_chain_node;
+    link_primary_collision_chain_node(
+            map,
+            get_primary_collision_chain_bucket(map, key_pair->primary_key_hash),
+            primary_collision_chain_node);
     
     /******************************************************
     * Link 'secondary_collision_chain_node' to its table: *
     ******************************************************/
     secondary_collision_chain_node->key_pair = key_pair;
-    secondary_collision_chain_node->prev = NULL;
-    secondary_key_collision_chain_bucket_index =
-    key_pair->secondary_key_hash & map->modulo_mask;
-    
-    secondary_collision_chain_node->next =
-    map->secondary_key_table[secondary_key_collision_chain_bucket_index];
-    
-    if (map->secondary_key_table[secondary_key_collision_chain_bucket_index])
-    {
-        map->secondary_key_table[secondary_key_collision_chain_bucket_index]
-        ->prev = secondary_collision_chain_node;
-    }
-    
-    map->secondary_key_table[secondary_key_collision_chain_bucket_index] =
-    secondary_collision_chain_node;
+    link_secondary_collision_chain_node(
+            map,
+            get_secondary_collision_chain_bucket(map,
+                                                 key_pair->secondary_key_hash),
+            secondary_collision_chain_node);
     
     /********************************
     * Deal with the iteration list. *
@@ -769,20 +2498,29 @@ void* bidirectional_hash_map_t_put_by_primary(bidirectional_hash_map_t* map,
                                               void* primary_key,
                                               void* secondary_key)
 {
+    size_t primary_key_hash   = hash_primary_key(map, primary_key);
+    size_t secondary_key_hash = hash_secondary_key(map, secondary_key);
     primary_collision_chain_node_t* primary_collision_chain_node;
     
     primary_collision_chain_node =
-        find_primary_collision_chain_node(map, primary_key);
+        find_primary_collision_chain_node_by_hash(map,
+                                                  primary_key,
+                                                  primary_key_hash);
     
     if (primary_collision_chain_node)
     {
         return update_secondary_key(map,
                                     primary_collision_chain_node,
-                                    secondary_key);
+                                    secondary_key,
+                                    secondary_key_hash);
     }
     else
     {
-        add_new_mapping(map, primary_key, secondary_key);
+        add_new_mapping(map,
+                        primary_key,
+                        primary_key_hash,
+                        secondary_key,
+                        secondary_key_hash);
         return NULL;
     }
 }
@@ -791,24 +2529,189 @@ void* bidirectional_hash_map_t_put_by_secondary(bidirectional_hash_map_t* map,
                                                 void* primary_key,
                                                 void* secondary_key)
 {
+    size_t primary_key_hash   = hash_primary_key(map, primary_key);
+    size_t secondary_key_hash = hash_secondary_key(map, secondary_key);
     secondary_collision_chain_node_t* secondary_collision_chain_node;
     
     secondary_collision_chain_node =
-        find_secondary_collision_chain_node(map, secondary_key);
+        find_secondary_collision_chain_node_by_hash(map,
+                                                    secondary_key,
+                                                    secondary_key_hash);
     
     if (secondary_collision_chain_node)
     {
         return update_primary_key(map,
                                   secondary_collision_chain_node,
-                                  primary_key);
+                                  primary_key,
+                                  primary_key_hash);
     }
     else
     {
-        add_new_mapping(map, primary_key, secondary_key);
+        add_new_mapping(map,
+                        primary_key,
+                        primary_key_hash,
+                        secondary_key,
+                        secondary_key_hash);
         return NULL;
     }
 }
 
+/*****************************************************************************
+* This function prefetches the first node of the collision chain in the      *
+* primary bucket for 'primary_key_hash'. The bucket slot itself has to be in *
+* the cache already in order not to stall, so it is prefetched in an earlier *
+* stage. The node is not loaded here, since that would wait for the very     *
+* miss being prefetched: the key pair is only prefetched along if the        *
+* records are fused, as its address then follows from that of the node.      *
+*****************************************************************************/
+static void prefetch_primary_collision_chain(bidirectional_hash_map_t* map,
+                                             size_t primary_key_hash)
+{
+    primary_collision_chain_node_t* primary_collision_chain_node =
+    *get_primary_collision_chain_bucket(map, primary_key_hash);
+    
+    if (primary_collision_chain_node)
+    {
+        PREFETCH(primary_collision_chain_node, 0);
+        
+        if (map->flags & BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS)
+        {
+            PREFETCH((char*) primary_collision_chain_node -
+                     offsetof(mapping_record_t,
+                              primary_collision_chain_node), 0);
+        }
+    }
+}
+
+/********************************************************************
+* This function prefetches the secondary bucket counterpart of what *
+* 'prefetch_primary_collision_chain' prefetches.                    *
+********************************************************************/
+static void prefetch_secondary_collision_chain(bidirectional_hash_map_t* map,
+                                               size_t secondary_key_hash)
+{
+    secondary_collision_chain_node_t* secondary_collision_chain_node =
+    *get_secondary_collision_chain_bucket(map, secondary_key_hash);
+    
+    if (secondary_collision_chain_node)
+    {
+        PREFETCH(secondary_collision_chain_node, 0);
+        
+        if (map->flags & BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS)
+        {
+            PREFETCH((char*) secondary_collision_chain_node -
+                     offsetof(mapping_record_t,
+                              secondary_collision_chain_node), 0);
+        }
+    }
+}
+
+/***************************************************************************
+* This function prefetches the nodes that removing the mapping of          *
+* 'primary_collision_chain_node' relinks: its twin and its neighbours in   *
+* the collision chain and in the iteration list.                           *
+***************************************************************************/
+static void prefetch_mapping_neighbours(
+                primary_collision_chain_node_t* primary_collision_chain_node)
+{
+    PREFETCH(primary_collision_chain_node->twin, 1);
+    PREFETCH(primary_collision_chain_node->next, 1);
+    PREFETCH(primary_collision_chain_node->up,   1);
+    PREFETCH(primary_collision_chain_node->down, 1);
+}
+
+int bidirectional_hash_map_t_put_batch_by_primary(
+                                                bidirectional_hash_map_t* map,
+                                                void** primary_keys,
+                                                void** secondary_keys,
+                                                size_t count,
+                                                void** results)
+{
+    size_t primary_key_hashes[BATCH_WINDOW_SIZE];
+    size_t secondary_key_hashes[BATCH_WINDOW_SIZE];
+    size_t window_start;
+    size_t window_size;
+    size_t i;
+    int all_stored = 1;
+    primary_collision_chain_node_t* primary_collision_chain_node;
+    void* result;
+    
+    for (window_start = 0; window_start < count; window_start += window_size)
+    {
+        window_size = count - window_start < BATCH_WINDOW_SIZE ?
+                      count - window_start :
+                      BATCH_WINDOW_SIZE;
+        
+        /********************************************************
+        * Stage 1: hash the keys and prefetch the bucket slots. *
+        ********************************************************/
+        for (i = 0; i < window_size; ++i)
+        {
+            primary_key_hashes[i] =
+            hash_primary_key(map, primary_keys[window_start + i]);
+            secondary_key_hashes[i] =
+            hash_secondary_key(map, secondary_keys[window_start + i]);
+            
+            PREFETCH(
+                get_primary_collision_chain_bucket(map,
+                                                   primary_key_hashes[i]),
+                0);
+            PREFETCH(
+                get_secondary_collision_chain_bucket(map,
+                                                     secondary_key_hashes[i]),
+                1);
+        }
+        
+        /***************************************************************
+        * Stage 2: prefetch the heads of the primary collision chains. *
+        ***************************************************************/
+        for (i = 0; i < window_size; ++i)
+        {
+            prefetch_primary_collision_chain(map, primary_key_hashes[i]);
+        }
+        
+        /*******************************
+        * Stage 3: resolve the window. *
+        *******************************/
+        for (i = 0; i < window_size; ++i)
+        {
+            primary_collision_chain_node =
+            find_primary_collision_chain_node_by_hash(
+                                                map,
+                                                primary_keys[window_start + i],
+                                                primary_key_hashes[i]);
+            
+            if (primary_collision_chain_node)
+            {
+                result = update_secondary_key(map,
+                                              primary_collision_chain_node,
+                                              secondary_keys[window_start + i],
+                                              secondary_key_hashes[i]);
+            }
+            else if (add_new_mapping(map,
+                                     primary_keys[window_start + i],
+                                     primary_key_hashes[i],
+                                     secondary_keys[window_start + i],
+                                     secondary_key_hashes[i]))
+            {
+                result = NULL;
+            }
+            else
+            {
+                result = map->error_sentinel;
+                all_stored = 0;
+            }
+            
+            if (results)
+            {
+                results[window_start + i] = result;
+            }
+        }
+    }
+    
+    return all_stored;
+}
+
 void* bidirectional_hash_map_t_remove_by_primary_key(
                                                 bidirectional_hash_map_t* map,
                                                 void* primary_key)
@@ -816,7 +2719,6 @@ void* bidirectional_hash_map_t_remove_by_primary_key(
     primary_collision_chain_node_t* primary_collision_chain_node =
         find_primary_collision_chain_node(map, primary_key);
     
-    secondary_collision_chain_node_t* secondary_collision_chain_node;
     void* secondary_key;
     
     if (primary_collision_chain_node == NULL)
@@ -824,22 +2726,9 @@ void* bidirectional_hash_map_t_remove_by_primary_key(
         return NULL;
     }
     
-    secondary_collision_chain_node =
-    find_secondary_collision_chain_node_via_primary_collision_chain_node(
-                                                map,
-                                                primary_collision_chain_node);
-    
-    unlink_primary_collision_chain_node(map, primary_collision_chain_node);
-    unlink_secondary_collision_chain_node(map, secondary_collision_chain_node);
     secondary_key = primary_collision_chain_node->key_pair->secondary_key;
-    
-    unlink_primary_collision_chain_node_from_iteraton_list(
-                                                map,
-                                                primary_collision_chain_node);
-    
-    free(primary_collision_chain_node->key_pair);
-    free(primary_collision_chain_node);
-    free(secondary_collision_chain_node);
+    remove_mapping(map, primary_collision_chain_node);
+    shrink_hash_map_if_sparse(map);
     
     return secondary_key;
 }
@@ -859,26 +2748,174 @@ void* bidirectional_hash_map_t_remove_by_secondary_key(
         return NULL;
     }
     
-    primary_collision_chain_node =
-    find_primary_collision_chain_node_via_secondary_collision_chain_node(
-                                                map,
-                                                secondary_collision_chain_node);
+    primary_collision_chain_node = secondary_collision_chain_node->twin;
     
-    unlink_primary_collision_chain_node(map, primary_collision_chain_node);
-    unlink_secondary_collision_chain_node(map, secondary_collision_chain_node);
     primary_key = primary_collision_chain_node->key_pair->primary_key;
+    remove_mapping(map, primary_collision_chain_node);
+    shrink_hash_map_if_sparse(map);
     
-    unlink_primary_collision_chain_node_from_iteraton_list(
-                                                map,
-                                                primary_collision_chain_node);
-    
-    unlink_primary_collision_chain_node_from_iteraton_list(map, primary_collision_chain_node);
+    return primary_key;
+}
+
+/***************************************************************************
+* This function removes the mappings of 'count' keys in windows. 'primary' *
+* tells whether the keys are primary or secondary ones.                    *
+***************************************************************************/
+static size_t remove_batch(bidirectional_hash_map_t* map,
+                           int primary,
+                           void** keys,
+                           size_t count,
+                           void** results)
+{
+    size_t key_hashes[BATCH_WINDOW_SIZE];
+    size_t window_start;
+    size_t window_size;
+    size_t i;
+    size_t removed = 0;
+    void* result;
+    primary_collision_chain_node_t* primary_collision_chain_node;
+    secondary_collision_chain_node_t* secondary_collision_chain_node;
     
-    free(primary_collision_chain_node->key_pair);
-    free(primary_collision_chain_node);
-    free(secondary_collision_chain_node);
+    for (window_start = 0; window_start < count; window_start += window_size)
+    {
+        window_size = count - window_start < BATCH_WINDOW_SIZE ?
+                      count - window_start :
+                      BATCH_WINDOW_SIZE;
+        
+        /********************************************************
+        * Stage 1: hash the keys and prefetch the bucket slots. *
+        ********************************************************/
+        for (i = 0; i < window_size; ++i)
+        {
+            if (primary)
+            {
+                key_hashes[i] = hash_primary_key(map, keys[window_start + i]);
+                PREFETCH(
+                    get_primary_collision_chain_bucket(map, key_hashes[i]),
+                    0);
+            }
+            else
+            {
+                key_hashes[i] =
+                hash_secondary_key(map, keys[window_start + i]);
+                PREFETCH(
+                    get_secondary_collision_chain_bucket(map, key_hashes[i]),
+                    0);
+            }
+        }
+        
+        /*************************************
+        * Stage 2: prefetch the chain heads. *
+        *************************************/
+        for (i = 0; i < window_size; ++i)
+        {
+            if (primary)
+            {
+                prefetch_primary_collision_chain(map, key_hashes[i]);
+            }
+            else
+            {
+                prefetch_secondary_collision_chain(map, key_hashes[i]);
+            }
+        }
+        
+        /****************************************************************
+        * Stage 3: prefetch what unlinking the chain heads would touch. *
+        ****************************************************************/
+        for (i = 0; i < window_size; ++i)
+        {
+            if (primary)
+            {
+                primary_collision_chain_node =
+                *get_primary_collision_chain_bucket(map, key_hashes[i]);
+            }
+            else
+            {
+                secondary_collision_chain_node =
+                *get_secondary_collision_chain_bucket(map, key_hashes[i]);
+                
+                primary_collision_chain_node =
+                secondary_collision_chain_node ?
+                secondary_collision_chain_node->twin :
+                NULL;
+            }
+            
+            if (primary_collision_chain_node)
+            {
+                prefetch_mapping_neighbours(primary_collision_chain_node);
+            }
+        }
+        
+        /*********************************************************
+        * Stage 4: remove. Each key is looked up only after the  *
+        * previous one is removed, so repeated keys are handled. *
+        *********************************************************/
+        for (i = 0; i < window_size; ++i)
+        {
+            if (primary)
+            {
+                primary_collision_chain_node =
+                find_primary_collision_chain_node_by_hash(
+                                                map,
+                                                keys[window_start + i],
+                                                key_hashes[i]);
+            }
+            else
+            {
+                secondary_collision_chain_node =
+                find_secondary_collision_chain_node_by_hash(
+                                                map,
+                                                keys[window_start + i],
+                                                key_hashes[i]);
+                
+                primary_collision_chain_node =
+                secondary_collision_chain_node ?
+                secondary_collision_chain_node->twin :
+                NULL;
+            }
+            
+            result = NULL;
+            
+            if (primary_collision_chain_node)
+            {
+                result = primary ?
+                         primary_collision_chain_node->key_pair->secondary_key :
+                         primary_collision_chain_node->key_pair->primary_key;
+                
+                remove_mapping(map, primary_collision_chain_node);
+                removed++;
+            }
+            
+            if (results)
+            {
+                results[window_start + i] = result;
+            }
+        }
+    }
     
-    return primary_key;
+    /********************************************************
+    * Shrink once for the whole batch rather than stepwise. *
+    ********************************************************/
+    shrink_hash_map_if_sparse(map);
+    return removed;
+}
+
+size_t bidirectional_hash_map_t_remove_batch_by_primary(
+                                                bidirectional_hash_map_t* map,
+                                                void** primary_keys,
+                                                size_t count,
+                                                void** results)
+{
+    return remove_batch(map, 1, primary_keys, count, results);
+}
+
+size_t bidirectional_hash_map_t_remove_batch_by_secondary(
+                                                bidirectional_hash_map_t* map,
+                                                void** secondary_keys,
+                                                size_t count,
+                                                void** results)
+{
+    return remove_batch(map, 0, secondary_keys, count, results);
 }
 
 void* bidirectional_hash_map_t_get_by_primary_key(bidirectional_hash_map_t* map,
@@ -910,6 +2947,124 @@ void* bidirectional_hash_map_t_get_by_secondary_key(
     return secondary_collision_chain_node->key_pair->primary_key;
 }
 
+size_t bidirectional_hash_map_t_get_batch_by_primary(
+                                                bidirectional_hash_map_t* map,
+                                                void** primary_keys,
+                                                size_t count,
+                                                void** results)
+{
+    size_t primary_key_hashes[BATCH_WINDOW_SIZE];
+    size_t window_start;
+    size_t window_size;
+    size_t i;
+    size_t found = 0;
+    primary_collision_chain_node_t* primary_collision_chain_node;
+    
+    for (window_start = 0; window_start < count; window_start += window_size)
+    {
+        window_size = count - window_start < BATCH_WINDOW_SIZE ?
+                      count - window_start :
+                      BATCH_WINDOW_SIZE;
+        
+        for (i = 0; i < window_size; ++i)
+        {
+            primary_key_hashes[i] =
+            hash_primary_key(map, primary_keys[window_start + i]);
+            
+            PREFETCH(
+                get_primary_collision_chain_bucket(map,
+                                                   primary_key_hashes[i]),
+                0);
+        }
+        
+        for (i = 0; i < window_size; ++i)
+        {
+            prefetch_primary_collision_chain(map, primary_key_hashes[i]);
+        }
+        
+        for (i = 0; i < window_size; ++i)
+        {
+            primary_collision_chain_node =
+            find_primary_collision_chain_node_by_hash(
+                                                map,
+                                                primary_keys[window_start + i],
+                                                primary_key_hashes[i]);
+            
+            if (primary_collision_chain_node)
+            {
+                results[window_start + i] =
+                primary_collision_chain_node->key_pair->secondary_key;
+                found++;
+            }
+            else
+            {
+                results[window_start + i] = NULL;
+            }
+        }
+    }
+    
+    return found;
+}
+
+size_t bidirectional_hash_map_t_get_batch_by_secondary(
+                                                bidirectional_hash_map_t* map,
+                                                void** secondary_keys,
+                                                size_t count,
+                                                void** results)
+{
+    size_t secondary_key_hashes[BATCH_WINDOW_SIZE];
+    size_t window_start;
+    size_t window_size;
+    size_t i;
+    size_t found = 0;
+    secondary_collision_chain_node_t* secondary_collision_chain_node;
+    
+    for (window_start = 0; window_start < count; window_start += window_size)
+    {
+        window_size = count - window_start < BATCH_WINDOW_SIZE ?
+                      count - window_start :
+                      BATCH_WINDOW_SIZE;
+        
+        for (i = 0; i < window_size; ++i)
+        {
+            secondary_key_hashes[i] =
+            hash_secondary_key(map, secondary_keys[window_start + i]);
+            
+            PREFETCH(
+                get_secondary_collision_chain_bucket(map,
+                                                     secondary_key_hashes[i]),
+                0);
+        }
+        
+        for (i = 0; i < window_size; ++i)
+        {
+            prefetch_secondary_collision_chain(map, secondary_key_hashes[i]);
+        }
+        
+        for (i = 0; i < window_size; ++i)
+        {
+            secondary_collision_chain_node =
+            find_secondary_collision_chain_node_by_hash(
+                                            map,
+                                            secondary_keys[window_start + i],
+                                            secondary_key_hashes[i]);
+            
+            if (secondary_collision_chain_node)
+            {
+                results[window_start + i] =
+                secondary_collision_chain_node->key_pair->primary_key;
+                found++;
+            }
+            else
+            {
+                results[window_start + i] = NULL;
+            }
+        }
+    }
+    
+    return found;
+}
+
 int bidirectional_hash_map_t_contains_primary_key(bidirectional_hash_map_t* map,
                                                   void* primary_key)
 {
@@ -1,32 +1,11 @@
 #ifndef BIDIRECTIONAL_HASH_MAP_H
 #define BIDIRECTIONAL_HASH_MAP_H
 
+#include "bidirectional_hash_map_allocator.h"
+#include "bidirectional_hash_map_hashing.h"
+#include "key_pair.h"
 #include <stdlib.h>
 
-typedef struct key_pair_t {
-    
-    /*******************
-    * The primary key. *
-    *******************/
-    void* primary_key;
-    
-    /*********************
-    * The secondary key. *
-    *********************/
-    void* secondary_key;
-    
-    /*******************************
-    * The hash of the primary key. *
-    *******************************/
-    size_t primary_key_hash;
-    
-    /********************************
-    * The hash of the secondary key *
-    ********************************/
-    size_t secondary_key_hash;
-}
-key_pair_t;
-
 /********************************************************
 * The collision chain node type for primary key chains. *
 ********************************************************/
@@ -34,16 +13,23 @@ typedef struct primary_collision_chain_node_t {
     
     /*************************************************************************
     * Points to the previous collision chain node or is set to NULL if there *
-    * is no previous collision chain node.                                   *
+    * is no previous collision chain node. In a collision tree, points to    *
+    * the left child instead.                                                *
     *************************************************************************/
     struct primary_collision_chain_node_t* prev;
     
     /***************************************************************************
     * Points to the next collision chain node or is set to NULL if there is no *
-    * next collision chain node.                                               *
+    * next collision chain node. In a collision tree, points to the right      *
+    * child instead.                                                           *
     ***************************************************************************/
     struct primary_collision_chain_node_t* next;
     
+    /*******************************************************************
+    * Points to the parent node in a collision tree. Unused in chains. *
+    *******************************************************************/
+    struct primary_collision_chain_node_t* parent;
+    
     /**************************************************************************
     * The previously added node. This field is used for faster iteration over *
     * the entire hash map.                                                    *
@@ -56,10 +42,21 @@ typedef struct primary_collision_chain_node_t {
     ***************************************************************************/
     struct primary_collision_chain_node_t* down;
     
+    /***************************************************************
+    * Points to the secondary collision chain node of the mapping. *
+    ***************************************************************/
+    struct secondary_collision_chain_node_t* twin;
+    
     /*******************************************
     * Points to the actual key pair structure. *
     *******************************************/
     key_pair_t* key_pair;
+    
+    /**************************************************************
+    * The height of this node in its collision tree, or 0 if this *
+    * node is in a collision chain.                               *
+    **************************************************************/
+    int tree_height;
 }
 primary_collision_chain_node_t;
 
@@ -70,23 +67,132 @@ typedef struct secondary_collision_chain_node_t {
     
     /*************************************************************************
     * Points to the previous collision chain node or is set to NULL if there *
-    * is no previous collision chain node.                                   *
+    * is no previous collision chain node. In a collision tree, points to    *
+    * the left child instead.                                                *
     *************************************************************************/
     struct secondary_collision_chain_node_t* prev;
     
     /***************************************************************************
     * Points to the next collision chain node or is set to NULL if there is no *
-    * next collision chain node.                                               *
+    * next collision chain node. In a collision tree, points to the right      *
+    * child instead.                                                           *
     ***************************************************************************/
     struct secondary_collision_chain_node_t* next;
     
+    /*******************************************************************
+    * Points to the parent node in a collision tree. Unused in chains. *
+    *******************************************************************/
+    struct secondary_collision_chain_node_t* parent;
+    
+    /*************************************************************
+    * Points to the primary collision chain node of the mapping. *
+    *************************************************************/
+    struct primary_collision_chain_node_t* twin;
+    
     /*******************************************
     * Points to the actual key pair structure. *
     *******************************************/
     key_pair_t* key_pair;
+    
+    /**************************************************************
+    * The height of this node in its collision tree, or 0 if this *
+    * node is in a collision chain.                               *
+    **************************************************************/
+    int tree_height;
 }
 secondary_collision_chain_node_t;
 
+/*******************************************************************************
+* A mapping record fuses the key pair and both of its collision chain nodes    *
+* into a single memory block. The records are carved out of slabs owned by the *
+* map, so adding and removing mappings does not call the allocator at all.     *
+* Within a slab, the records are padded to whole cache lines, so none of them  *
+* touches more cache lines than its size requires.                             *
+*******************************************************************************/
+typedef struct mapping_record_t {
+    
+    /***************************************
+    * The key pair of this mapping record. *
+    ***************************************/
+    key_pair_t key_pair;
+    
+    /**************************************************************
+    * The collision chain node linking this record to the primary *
+    * hash table.                                                 *
+    **************************************************************/
+    primary_collision_chain_node_t primary_collision_chain_node;
+    
+    /****************************************************************
+    * The collision chain node linking this record to the secondary *
+    * hash table.                                                   *
+    ****************************************************************/
+    secondary_collision_chain_node_t secondary_collision_chain_node;
+}
+mapping_record_t;
+
+/****************************************************************************
+* A slab is a single allocation holding a run of mapping records of a map.  *
+* The slab header takes a cache line of its own, and the records follow it. *
+****************************************************************************/
+typedef struct mapping_record_slab_t {
+    
+    /********************************************
+    * The next slab of the map or NULL if none. *
+    ********************************************/
+    struct mapping_record_slab_t* next;
+    
+    /**************************************
+    * The number of records in this slab. *
+    **************************************/
+    size_t record_count;
+    
+    /**************************************************************
+    * The memory block returned by the allocator. The slab header *
+    * lies at the first cache line boundary within it.            *
+    **************************************************************/
+    void* memory;
+}
+mapping_record_slab_t;
+
+/****************************************************************
+* The size of a cache line in bytes. Slabs and the records in   *
+* them are aligned to this.                                     *
+****************************************************************/
+#define BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE 64
+
+/******************************************************************************
+* The flag requesting that every mapping is stored in a single mapping record *
+* allocated from the slabs of the map. Destroying such a map releases the     *
+* slabs without visiting the mappings.                                        *
+******************************************************************************/
+#define BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS 0x1
+
+/******************************************************************************
+* The flag requesting that the hash tables are resized incrementally: instead *
+* of relinking all the mappings at once, each operation migrates a few of the *
+* old buckets to the new hash tables.                                         *
+******************************************************************************/
+#define BIDIRECTIONAL_HASH_MAP_INCREMENTAL_REHASH 0x2
+
+/******************************************************************************
+* The flag requesting that the map scrambles every key hash with              *
+* 'bidirectional_hash_map_mix_hash' before using it. Bucket indices are taken *
+* from the low bits of a hash, so without mixing, keys such as aligned        *
+* pointers or IDs sharing a stride fall into a fraction of the buckets.       *
+******************************************************************************/
+#define BIDIRECTIONAL_HASH_MAP_MIX_HASHES 0x4
+
+/*****************************************************************************
+* The flag requesting that the map draws a random secret key at init, and    *
+* picks buckets by the SipHash-1-3 of every key hash under that key. Callers *
+* choosing the keys can then no longer aim them at a single bucket, because  *
+* they do not know where their hashes land. Keys with equal hashes still     *
+* collide, so hashers of untrusted byte strings should themselves be keyed,  *
+* for example with 'bidirectional_hash_map_siphash13'. Overrides             *
+* BIDIRECTIONAL_HASH_MAP_MIX_HASHES.                                         *
+*****************************************************************************/
+#define BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES 0x8
+
 typedef struct bidirectional_hash_map_t {
     
     /**********************************
@@ -104,6 +210,18 @@ typedef struct bidirectional_hash_map_t {
     *************************/
     float  load_factor;
     
+    /*********************************************************
+    * Stores the load factor below which the hash tables are *
+    * halved. Zero disables the automatic shrinking.         *
+    *********************************************************/
+    float  shrink_load_factor;
+    
+    /************************************************************
+    * The capacity below which the hash tables are never shrunk *
+    * automatically.                                            *
+    ************************************************************/
+    size_t minimum_capacity;
+    
     /***************************************
     * The mask used for simulating modulo. *
     ***************************************/ 
@@ -119,6 +237,34 @@ typedef struct bidirectional_hash_map_t {
     ****************************/
     struct secondary_collision_chain_node_t** secondary_key_table;
     
+    /***************************************************************
+    * The primary hash table being migrated from, or NULL if there *
+    * is no migration in progress.                                 *
+    ***************************************************************/
+    struct primary_collision_chain_node_t** old_primary_key_table;
+    
+    /*****************************************************************
+    * The secondary hash table being migrated from, or NULL if there *
+    * is no migration in progress.                                   *
+    *****************************************************************/
+    struct secondary_collision_chain_node_t** old_secondary_key_table;
+    
+    /***************************************
+    * The capacity of the old hash tables. *
+    ***************************************/
+    size_t old_capacity;
+    
+    /*****************************************************
+    * The mask used for simulating modulo in old tables. *
+    *****************************************************/
+    size_t old_modulo_mask;
+    
+    /***********************************************************
+    * The index of the next old bucket to migrate. All the old *
+    * buckets below this index are empty.                      *
+    ***********************************************************/
+    size_t rehash_index;
+    
     /***************************************************************************
     * The function producing the bucket index in the primary key table given a *
     * primary key.                                                             *
@@ -142,6 +288,19 @@ typedef struct bidirectional_hash_map_t {
     int    (*secondary_key_equality)(void* secondary_key_1,
                                      void* secondary_key_2);
     
+    /**************************************************************
+    * The optional function ordering two primary keys, or NULL if *
+    * the primary key buckets stay collision chains.              *
+    **************************************************************/
+    int    (*primary_key_compare)(void* primary_key_1, void* primary_key_2);
+    
+    /****************************************************************
+    * The optional function ordering two secondary keys, or NULL if *
+    * the secondary key buckets stay collision chains.              *
+    ****************************************************************/
+    int    (*secondary_key_compare)(void* secondary_key_1,
+                                    void* secondary_key_2);
+    
     /***************************************************************************
     * Caches the primary collision chain node of the mapping that was added to *
     * this hash map. Used for starting the iteration over all mappings. We     *
@@ -160,6 +319,80 @@ typedef struct bidirectional_hash_map_t {
     * A value that is returned upon failure. *
     *****************************************/
     void* error_sentinel;
+    
+    /********************************************************
+    * The bitwise OR of the BIDIRECTIONAL_HASH_MAP_* flags. *
+    ********************************************************/
+    int flags;
+    
+    /******************************************************
+    * The secret key of the bucket selection. Used in the *
+    * BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES mode only.     *
+    ******************************************************/
+    bidirectional_hash_map_hash_key_t hash_key;
+    
+    /***********************************************************
+    * The slabs holding the mapping records of the map, newest *
+    * first. Used in the BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS *
+    * mode only.                                               *
+    ***********************************************************/
+    mapping_record_slab_t* mapping_record_slabs;
+    
+    /**********************************************************
+    * The records of the newest slab never handed out so far. *
+    **********************************************************/
+    mapping_record_t* unused_slab_records;
+    
+    /**************************************************
+    * The number of records at 'unused_slab_records'. *
+    **************************************************/
+    size_t unused_slab_record_count;
+    
+    /*********************************************************
+    * The stack of the records released by removed mappings, *
+    * linked through their primary keys.                     *
+    *********************************************************/
+    mapping_record_t* free_mapping_records;
+    
+    /***************************************************
+    * The number of records in 'free_mapping_records'. *
+    ***************************************************/
+    size_t free_mapping_record_count;
+    
+    /******************************************
+    * The number of records in all the slabs. *
+    ******************************************/
+    size_t slab_record_count;
+    
+    /********************************************************
+    * The number of bytes of each mapping record, including *
+    * the inline key storage following the record.          *
+    ********************************************************/
+    size_t mapping_record_size;
+    
+    /*****************************************************
+    * The largest key, in bytes, copied into the mapping *
+    * records, or 0 if no keys are stored inline.        *
+    *****************************************************/
+    size_t inline_key_capacity;
+    
+    /********************************************************
+    * The function returning the number of bytes of a       *
+    * primary key, or NULL if primary keys are not inlined. *
+    ********************************************************/
+    size_t (*primary_key_size)(void* primary_key);
+    
+    /***************************************************
+    * The function returning the number of bytes of a  *
+    * secondary key, or NULL if secondary keys are not *
+    * inlined.                                         *
+    ***************************************************/
+    size_t (*secondary_key_size)(void* secondary_key);
+    
+    /********************************************************
+    * The allocator of the hash tables and mapping storage. *
+    ********************************************************/
+    bidirectional_hash_map_allocator_t allocator;
 }
 bidirectional_hash_map_t;
 
@@ -205,6 +438,62 @@ int bidirectional_hash_map_t_init(
         int (*secondary_key_equality)  (void*, void*),
         void* error_sentinel);
 
+/*****************************************************************************
+* Builds a new, empty bidirectional hash map with the given flags.|          *
+*-----------------------------------------------------------------+          *
+* map -------------------- the map to initialize.                            *
+* initial_capacity ------- the initial capacity of both the hash tables.     *
+* load_factor ------------ the load factor.                                  *
+* primary_key_hasher ----- the function for producing primary key hashes.    *
+* secondary_key_hasher --- the function for producing secondary key hashes.  *
+* primary_key_equality --- the function for comparing primary keys.          *
+* secondary_key_equality - the function for comparing secondary keys.        *
+* error_sentinel --------- the value returned upon failure.                  *
+* flags ------------------ the bitwise OR of BIDIRECTIONAL_HASH_MAP_* flags. *
+*-----------------------------------------------------------+                *
+* RETURNS: 1 if initialization was successfull, 0 otherwise.|                *
+*****************************************************************************/
+int bidirectional_hash_map_t_init_with_flags(
+        bidirectional_hash_map_t* map,
+        size_t initial_capacity,
+        float load_factor,
+        size_t (*primary_key_hasher)  (void*),
+        size_t (*secondary_key_hasher)(void*),
+        int (*primary_key_equality)   (void*, void*),
+        int (*secondary_key_equality)  (void*, void*),
+        void* error_sentinel,
+        int flags);
+
+/*****************************************************************************
+* Builds a new, empty bidirectional hash map with the given flags, taking  | *
+* all its memory from the given allocator.                                 | *
+*--------------------------------------------------------------------------+ *
+* map -------------------- the map to initialize.                            *
+* initial_capacity ------- the initial capacity of both the hash tables.     *
+* load_factor ------------ the load factor.                                  *
+* primary_key_hasher ----- the function for producing primary key hashes.    *
+* secondary_key_hasher --- the function for producing secondary key hashes.  *
+* primary_key_equality --- the function for comparing primary keys.          *
+* secondary_key_equality - the function for comparing secondary keys.        *
+* error_sentinel --------- the value returned upon failure.                  *
+* flags ------------------ the bitwise OR of BIDIRECTIONAL_HASH_MAP_* flags. *
+* allocator -------------- the allocator to copy into the map, or NULL for   *
+*                          the default 'malloc' based one.                   *
+*-----------------------------------------------------------+                *
+* RETURNS: 1 if initialization was successfull, 0 otherwise.|                *
+*****************************************************************************/
+int bidirectional_hash_map_t_init_with_allocator(
+        bidirectional_hash_map_t* map,
+        size_t initial_capacity,
+        float load_factor,
+        size_t (*primary_key_hasher)  (void*),
+        size_t (*secondary_key_hasher)(void*),
+        int (*primary_key_equality)   (void*, void*),
+        int (*secondary_key_equality) (void*, void*),
+        void* error_sentinel,
+        int flags,
+        const bidirectional_hash_map_allocator_t* allocator);
+
 /************************************************
 * Releases all the resources of the input map.| *
 *---------------------------------------------+ *
@@ -230,6 +519,17 @@ int bidirectional_hash_map_t_is_working(bidirectional_hash_map_t* map);
 *****************************************************/
 size_t bidirectional_hash_map_t_size(bidirectional_hash_map_t* map);
 
+/*****************************************************************************
+* Scrambles 'hash' with the MurmurHash3 finalizer so that every bit of the | *
+* input affects the low bits of the output. The mixing is a bijection, so  | *
+* distinct hashes stay distinct.                                           | *
+*--------------------------------------------------------------------------+ *
+* hash - the hash to scramble.                                               *
+*-----------------------------+                                              *
+* RETURNS: the scrambled hash.|                                              *
+*****************************************************************************/
+size_t bidirectional_hash_map_mix_hash(size_t hash);
+
 /*****************************************************************************
 * Returns the capacity of one of the hash tables (another one has the same | *
 * capacity).                                                               | *
@@ -240,6 +540,140 @@ size_t bidirectional_hash_map_t_size(bidirectional_hash_map_t* map);
 *****************************************************************************/
 size_t bidirectional_hash_map_t_capacity(bidirectional_hash_map_t* map);
 
+/*****************************************************************************
+* Sets the functions ordering the keys. Once a collision chain grows       | *
+* longer than eight nodes, a bucket with an ordering function turns it     | *
+* into an AVL tree, keyed by the hash and then by the ordering function,   | *
+* so that even a hash function sending every key to the same bucket costs  | *
+* O(log n) per operation. The tree turns back into a chain once it         | *
+* shrinks. An ordering function returns a negative value, zero or a        | *
+* positive value as its first key is less than, equal to or greater than   | *
+* its second key, and returns zero exactly when the equality function      | *
+* returns nonzero.                                                         | *
+*--------------------------------------------------------------------------+ *
+* map ------------------- the map to configure.                              *
+* primary_key_compare --- the function ordering primary keys, or NULL to     *
+*                         keep the primary key buckets as chains.            *
+* secondary_key_compare - the function ordering secondary keys, or NULL to   *
+*                         keep the secondary key buckets as chains.          *
+*****************************************************************************/
+void bidirectional_hash_map_t_set_key_comparators(
+                            bidirectional_hash_map_t* map,
+                            int (*primary_key_compare)  (void*, void*),
+                            int (*secondary_key_compare)(void*, void*));
+
+/*****************************************************************************
+* Makes the map copy the keys of up to 'inline_key_capacity' bytes into    | *
+* its mapping records, and compare such keys with 'memcmp' against the     | *
+* copies instead of calling the equality function, which would dereference | *
+* the stored key. A key size function returns the number of bytes at the   | *
+* key pointer that make up the key, such as 'strlen(key) + 1' for strings; | *
+* two keys must be equal exactly when their bytes are. The keys themselves | *
+* are still owned by the caller and returned as before. Requires the       | *
+* BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS mode and an empty map.             | *
+*--------------------------------------------------------------------------+ *
+* map ----------------- the map to configure.                                *
+* primary_key_size ---- the function measuring primary keys, or NULL to      *
+*                       compare primary keys with the equality function.     *
+* secondary_key_size -- the function measuring secondary keys, or NULL to    *
+*                       compare secondary keys with the equality function.   *
+* inline_key_capacity - the largest key size stored inline, at most 254.     *
+*                       Zero turns inline keys off.                          *
+*------------------------------------------------------------------------+   *
+* RETURNS: 1 if the map was configured, 0 if it holds mappings, does not |   *
+* fuse its mappings, or the capacity is too large.                       |   *
+*****************************************************************************/
+int bidirectional_hash_map_t_set_inline_keys(
+                                bidirectional_hash_map_t* map,
+                                size_t (*primary_key_size)  (void*),
+                                size_t (*secondary_key_size)(void*),
+                                size_t inline_key_capacity);
+
+/****************************************************************************
+* Sets the low-watermark load factor: when a removal makes the load of the  *
+* map drop below it, both hash tables are halved, though never below the    *
+* initial capacity. The value is capped at a quarter of the load factor, so *
+* that a halved map is at most half full and the workloads that oscillate   *
+* around a watermark do not resize the map back and forth. The default is a *
+* quarter of the load factor.|                                              *
+*----------------------------+                                              *
+* map ---------------- the map to configure.                                *
+* shrink_load_factor - the low-watermark load factor, or 0 to disable the   *
+*                      automatic shrinking.                                 *
+****************************************************************************/
+void bidirectional_hash_map_t_set_shrink_load_factor(
+                                                bidirectional_hash_map_t* map,
+                                                float shrink_load_factor);
+
+/*****************************************************************************
+* Prepares the map for holding 'mapping_count' mappings: both the hash     | *
+* tables are resized in one step so that adding that many mappings causes  | *
+* no rehashing, and the automatic shrinking never goes below that size. In | *
+* the BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS mode, the mapping records for  | *
+* the missing mappings are allocated in advance as well.                   | *
+*--------------------------------------------------------------------------+ *
+* map ----------- the map to prepare.                                        *
+* mapping_count - the number of mappings the map should be ready for.        *
+*--------------------------------------------------------------------------+ *
+* RETURNS: 1 on success, 0 if the memory could not be allocated or no      | *
+* table capacity can hold 'mapping_count' mappings, in which case the map  | *
+* remains valid.                                                           | *
+*****************************************************************************/
+int bidirectional_hash_map_t_reserve(bidirectional_hash_map_t* map,
+                                     size_t mapping_count);
+
+/*****************************************************************************
+* Shrinks both the hash tables to the smallest capacity that holds all the | *
+* current mappings without exceeding the load factor. The slabs of mapping | *
+* records can only be released as a whole, so that happens only if the map | *
+* is empty.                                                                | *
+*--------------------------------------------------------------------------+ *
+* map - the map to shrink.                                                   *
+*-----------------------------------------------------------+                *
+* RETURNS: 1 on success, 0 if the new tables could not be   |                *
+* allocated, in which case the map is left as is.           |                *
+*****************************************************************************/
+int bidirectional_hash_map_t_shrink_to_fit(bidirectional_hash_map_t* map);
+
+/****************************************************************************
+* Queries whether the input map is migrating its mappings to resized hash | *
+* tables.                                                                 | *
+*-------------------------------------------------------------------------+ *
+* map - the map to query.                                                   *
+*-------------------------------------------------------------+             *
+* RETURNS: 1 if there is migration work pending, 0 otherwise.|              *
+****************************************************************************/
+int bidirectional_hash_map_t_is_rehashing(bidirectional_hash_map_t* map);
+
+/*********************************************************************
+* Returns the number of old buckets still to be migrated.|           *
+*--------------------------------------------------------+           *
+* map - the map to query.                                            *
+*------------------------------------------------------------------+ *
+* RETURNS: the number of buckets pending migration, 0 if there is  | *
+* no migration in progress.                                        | *
+*********************************************************************/
+size_t bidirectional_hash_map_t_pending_rehash_buckets(
+                                                bidirectional_hash_map_t* map);
+
+/************************************************************************
+* Migrates at most 'bucket_count' of the pending old buckets.|          *
+*------------------------------------------------------------+          *
+* map ---------- the map to work on.                                    *
+* bucket_count - the maximum number of old buckets to migrate.          *
+*-----------------------------------------------------------------+     *
+* RETURNS: the number of buckets still pending migration afterwards.|   *
+************************************************************************/
+size_t bidirectional_hash_map_t_rehash_step(bidirectional_hash_map_t* map,
+                                            size_t bucket_count);
+
+/*************************************************
+* Completes all the pending migration work.|     *
+*------------------------------------------+     *
+* map - the map to work on.                      *
+*************************************************/
+void bidirectional_hash_map_t_finish_rehash(bidirectional_hash_map_t* map);
+
 /******************************************************************************
 * Associates the primary key to the secondary key in the input map.|          *
 *------------------------------------------------------------------+          *
@@ -268,6 +702,30 @@ void* bidirectional_hash_map_t_put_by_secondary(bidirectional_hash_map_t* map,
                                                 void* primary_key,
                                                 void* secondary_key);
 
+/******************************************************************************
+* Associates 'primary_keys[i]' to 'secondary_keys[i]' for each i below      | *
+* 'count' in this order, just like 'bidirectional_hash_map_t_put_by_primary'| *
+* would. The keys are hashed and their buckets prefetched a window at a     | *
+* time, so that the cache misses within the window overlap.                 | *
+*---------------------------------------------------------------------------+ *
+* map ------------ the map into which to store the pairs.                     *
+* primary_keys --- the primary keys.                                          *
+* secondary_keys - the secondary keys.                                        *
+* count ---------- the number of pairs.                                       *
+* results -------- NULL, or the array receiving for each pair what            *
+*                  'bidirectional_hash_map_t_put_by_primary' returns, or the  *
+*                  error sentinel if the pair could not be stored.            *
+*-----------------------------------------------------------------------+     *
+* RETURNS: 1 if all the pairs were stored, 0 if the memory ran out for  |     *
+* some of them.                                                         |     *
+******************************************************************************/
+int bidirectional_hash_map_t_put_batch_by_primary(
+                                                bidirectional_hash_map_t* map,
+                                                void** primary_keys,
+                                                void** secondary_keys,
+                                                size_t count,
+                                                void** results);
+
 /******************************************************************************
 * Removes a key pair by its primary key.|                                     *
 *---------------------------------------+                                     *
@@ -294,6 +752,44 @@ void* bidirectional_hash_map_t_remove_by_secondary_key(
         bidirectional_hash_map_t* map,
         void* secondary_key);
 
+/******************************************************************************
+* Removes the key pairs of 'count' primary keys. The lookups and the nodes  | *
+* the removals relink are prefetched a window at a time, and the hash       | *
+* tables are shrunk at most once for the whole batch.                       | *
+*---------------------------------------------------------------------------+ *
+* map ---------- the map.                                                     *
+* primary_keys - the primary keys to remove.                                  *
+* count -------- the number of keys.                                          *
+* results ------ NULL, or the array receiving for each primary key what       *
+*                'bidirectional_hash_map_t_remove_by_primary_key' returns.    *
+*------------------------------------------------+                            *
+* RETURNS: the number of key pairs removed.      |                            *
+******************************************************************************/
+size_t bidirectional_hash_map_t_remove_batch_by_primary(
+                                                bidirectional_hash_map_t* map,
+                                                void** primary_keys,
+                                                size_t count,
+                                                void** results);
+
+/******************************************************************************
+* Removes the key pairs of 'count' secondary keys in the same way as        | *
+* 'bidirectional_hash_map_t_remove_batch_by_primary'.                       | *
+*---------------------------------------------------------------------------+ *
+* map ------------ the map.                                                   *
+* secondary_keys - the secondary keys to remove.                              *
+* count ---------- the number of keys.                                        *
+* results -------- NULL, or the array receiving for each secondary key what   *
+*                  'bidirectional_hash_map_t_remove_by_secondary_key'         *
+*                  returns.                                                   *
+*------------------------------------------------+                            *
+* RETURNS: the number of key pairs removed.      |                            *
+******************************************************************************/
+size_t bidirectional_hash_map_t_remove_batch_by_secondary(
+                                                bidirectional_hash_map_t* map,
+                                                void** secondary_keys,
+                                                size_t count,
+                                                void** results);
+
 /******************************************************************************
 * Queries the secondary key via its primary key.|                             *
 *-----------------------------------------------+                             *
@@ -319,6 +815,45 @@ void* bidirectional_hash_map_t_get_by_secondary_key(
         bidirectional_hash_map_t* map,
         void* secondary_key);
 
+/******************************************************************************
+* Queries the secondary keys of 'count' primary keys. The lookups proceed a | *
+* window at a time in stages: first the buckets, then the chain heads are   | *
+* prefetched for the whole window, so that the cache misses of the window   | *
+* overlap. If the mappings are fused, the key pairs come along with the     | *
+* chain heads, as they share the records.                                   | *
+*---------------------------------------------------------------------------+ *
+* map ---------- the map to query.                                            *
+* primary_keys - the primary keys to use.                                     *
+* count -------- the number of keys.                                          *
+* results ------ the array receiving for each primary key what                *
+*                'bidirectional_hash_map_t_get_by_primary_key' returns.       *
+*-------------------------------------------------------------+               *
+* RETURNS: the number of primary keys found in the map.       |               *
+******************************************************************************/
+size_t bidirectional_hash_map_t_get_batch_by_primary(
+                                                bidirectional_hash_map_t* map,
+                                                void** primary_keys,
+                                                size_t count,
+                                                void** results);
+
+/******************************************************************************
+* Queries the primary keys of 'count' secondary keys in the same staged     | *
+* fashion as 'bidirectional_hash_map_t_get_batch_by_primary'.               | *
+*---------------------------------------------------------------------------+ *
+* map ------------ the map to query.                                          *
+* secondary_keys - the secondary keys to use.                                 *
+* count ---------- the number of keys.                                        *
+* results -------- the array receiving for each secondary key what            *
+*                  'bidirectional_hash_map_t_get_by_secondary_key' returns.   *
+*-------------------------------------------------------------+               *
+* RETURNS: the number of secondary keys found in the map.     |               *
+******************************************************************************/
+size_t bidirectional_hash_map_t_get_batch_by_secondary(
+                                                bidirectional_hash_map_t* map,
+                                                void** secondary_keys,
+                                                size_t count,
+                                                void** results);
+
 /**************************************************************************
 * Queries whether the map contains 'primary_key' as a primary key.|       *
 *-----------------------------------------------------------------+       *
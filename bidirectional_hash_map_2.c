@@ -45,8 +45,55 @@ static size_t to_power_of_two(size_t num)
 static const float  MINIMUM_LOAD_FACTOR      = 0.2;
 static const size_t MINIMUM_INITIAL_CAPACITY = 8;
 
+/********************************************************
+* Allocates 'size' bytes with the allocator of the map. *
+********************************************************/
+static void* allocate(bidirectional_hash_map_2_t* map, size_t size)
+{
+    return map->allocator.allocate(map->allocator.context, size);
+}
+
+/******************************************************************
+* Allocates a zeroed table of 'count' pointers with the allocator *
+* of the map.                                                     *
+******************************************************************/
+static void* allocate_table(bidirectional_hash_map_2_t* map, size_t count)
+{
+    return map->allocator.allocate_zeroed(map->allocator.context,
+                                          count,
+                                          sizeof(void*));
+}
+
+/************************************************************
+* Releases 'memory' obtained from the allocator of the map. *
+************************************************************/
+static void deallocate(bidirectional_hash_map_2_t* map, void* memory)
+{
+    map->allocator.deallocate(map->allocator.context, memory);
+}
+
+
+/********************************************************************
+* Recomputes the height of 'node' from the heights of its children. *
+********************************************************************/
+static void update_primary_tree_node_height(primary_collision_tree_node_t* node)
+{
+    node->height = max_int(get_primary_tree_node_height(node->left),
+                           get_primary_tree_node_height(node->right)) + 1;
+}
+
+/********************************************************************
+* Recomputes the height of 'node' from the heights of its children. *
+********************************************************************/
+static void update_secondary_tree_node_height(
+                                        secondary_collision_tree_node_t* node)
+{
+    node->height = max_int(get_secondary_tree_node_height(node->left),
+                           get_secondary_tree_node_height(node->right)) + 1;
+}
+
 static primary_collision_tree_node_t*
-get_primary_minimum_tree_node_of(primary_collision_tree_node_t* node)
+get_minimum_tree_node_of_primary(primary_collision_tree_node_t* node)
 {
     while (node->left)
     {
@@ -57,7 +104,7 @@ get_primary_minimum_tree_node_of(primary_collision_tree_node_t* node)
 }
 
 static secondary_collision_tree_node_t*
-get_secondary_minimum_tree_node_of(secondary_collision_tree_node_t* node)
+get_minimum_tree_node_of_secondary(secondary_collision_tree_node_t* node)
 {
     while (node->left)
     {
@@ -67,50 +114,41 @@ get_secondary_minimum_tree_node_of(secondary_collision_tree_node_t* node)
     return node;
 }
 
-static primary_collision_tree_node_t* 
-get_minimum_tree_node_of_primary(primary_collision_tree_node_t* node) 
-{
-    while (node->left) 
-    {
-         node = node->left;
-    }    
-
-    return node;
-}
-
-static secondary_collision_tree_node_t* 
-get_minimum_tree_node_of_secondary(secondary_collision_tree_node_t* node) 
+/****************************************************************************
+* Compares the primary key 'primary_key' having the hash 'primary_key_hash' *
+* to the primary key of 'node'. The collision trees are ordered by the key  *
+* hashes first, so the comparator runs only on keys with equal hashes.      *
+****************************************************************************/
+static int compare_primary_key(bidirectional_hash_map_2_t* map,
+                               void* primary_key,
+                               size_t primary_key_hash,
+                               primary_collision_tree_node_t* node)
 {
-    while (node->left) 
+    if (primary_key_hash != node->key_pair->primary_key_hash)
     {
-         node = node->left;
-    }    
-
-    return node;
+        return primary_key_hash < node->key_pair->primary_key_hash ? -1 : 1;
+    }
+    
+    return map->primary_key_compare(primary_key, node->key_pair->primary_key);
 }
 
-static primary_collision_tree_node_t* get_primary_collision_tree_node_successor(
-                    primary_collision_tree_node_t* primary_collision_tree_node)
+/*****************************************************************************
+* Compares the secondary key 'secondary_key' having the hash                 *
+* 'secondary_key_hash' to the secondary key of 'node'.                       *
+*****************************************************************************/
+static int compare_secondary_key(bidirectional_hash_map_2_t* map,
+                                 void* secondary_key,
+                                 size_t secondary_key_hash,
+                                 secondary_collision_tree_node_t* node)
 {
-    primary_collision_tree_node_t* parent_of_primary_collision_tree_node;
-    
-    if (primary_collision_tree_node->right)
+    if (secondary_key_hash != node->key_pair->secondary_key_hash)
     {
-        return get_minimum_tree_node_of_primary(primary_collision_tree_node->right);
+        return secondary_key_hash < node->key_pair->secondary_key_hash ?
+               -1 : 1;
     }
     
-    parent_of_primary_collision_tree_node = primary_collision_tree_node->parent;
-    
-    while (parent_of_primary_collision_tree_node
-           && parent_of_primary_collision_tree_node->right
-           == primary_collision_tree_node)
-    {
-        primary_collision_tree_node = parent_of_primary_collision_tree_node;
-        parent_of_primary_collision_tree_node =
-        parent_of_primary_collision_tree_node->parent;
-    }
-    
-    return parent_of_primary_collision_tree_node;
+    return map->secondary_key_compare(secondary_key,
+                                      node->key_pair->secondary_key);
 }
 
 /***********************************************************
@@ -131,11 +169,8 @@ primary_collision_tree_left_rotate(primary_collision_tree_node_t* node_1)
         node_1->right->parent = node_1;
     }
     
-    node_1->height = max_int(get_primary_tree_node_height(node_1->left),
-                             get_primary_tree_node_height(node_1->right)) + 1;
-
-    node_2->height = max_int(get_primary_tree_node_height(node_2->left),
-                             get_primary_tree_node_height(node_2->right)) + 1;
+    update_primary_tree_node_height(node_1);
+    update_primary_tree_node_height(node_2);
     return node_2;
 }
 
@@ -149,20 +184,16 @@ primary_collision_tree_right_rotate(primary_collision_tree_node_t* node_1)
     
     node_2->parent = node_1->parent;
     node_1->parent = node_2;
-    node_1->left = node_2->right;
-    node_2->right = node_1;
+    node_1->left   = node_2->right;
+    node_2->right  = node_1;
     
     if (node_1->left)
     {
         node_1->left->parent = node_1;
     }
     
-    node_1->height = max_int(get_primary_tree_node_height(node_1->left),
-                             get_primary_tree_node_height(node_1->right)) + 1;
-                             
-    node_2->height = max_int(get_primary_tree_node_height(node_2->left),
-                             get_primary_tree_node_height(node_2->right)) + 1;
-    
+    update_primary_tree_node_height(node_1);
+    update_primary_tree_node_height(node_2);
     return node_2;
 }
 
@@ -188,207 +219,6 @@ primary_collision_tree_left_right_rotate(primary_collision_tree_node_t* node_1)
     return primary_collision_tree_right_rotate(node_1);
 }
 
-/****************************************************************************
-* This function is responsible for balancing a primary collision tree after *
-* inserting a node into it.                                                 *
-****************************************************************************/
-static void fix_primary_collision_tree_after_insertion(
-                                        bidirectional_hash_map_2_t* map,
-                                        primary_collision_tree_node_t* node)
-{
-    primary_collision_tree_node_t* grand_parent;
-    primary_collision_tree_node_t* parent = node->parent;
-    primary_collision_tree_node_t* sub_tree;
-    size_t node_bucket_index;
-    
-    while (parent)
-    {
-        if (get_primary_tree_node_height(parent->left) ==
-            get_primary_tree_node_height(parent->right) + 2)
-        {
-            grand_parent = parent->parent;
-            
-            if (get_primary_tree_node_height(parent->left->left) >=
-                get_primary_tree_node_height(parent->left->right))
-            {
-                sub_tree = primary_collision_tree_right_rotate(parent);
-            }
-            else
-            {
-                sub_tree = primary_collision_tree_left_right_rotate(parent);
-            }
-            
-            if (!grand_parent)
-            {
-                node_bucket_index = node->key_pair->primary_key_hash
-                                  & map->modulo_mask;
-                map->primary_key_table[node_bucket_index] = sub_tree;
-            }
-            else if (grand_parent->left == parent)
-            {
-                grand_parent->left = sub_tree;
-            }
-            else
-            {
-                grand_parent->right = sub_tree;
-            }
-            
-            if (grand_parent)
-            {
-                grand_parent->height =
-                max_int(get_primary_tree_node_height(grand_parent->left),
-                        get_primary_tree_node_height(grand_parent->right)) + 1;
-            }
-            
-            return;
-        }
-        else if (get_primary_tree_node_height(parent->right) ==
-                 get_primary_tree_node_height(parent->left) + 2)
-        {
-            grand_parent = parent->parent;
-            
-            if (get_primary_tree_node_height(parent->right->right) >=
-                get_primary_tree_node_height(parent->right->left))
-            {
-                sub_tree = primary_collision_tree_left_rotate(parent);
-            }
-            else
-            {
-                sub_tree = primary_collision_tree_right_left_rotate(parent);
-            }
-            
-            if (!grand_parent)
-            {
-                node_bucket_index = node->key_pair->primary_key_hash
-                                  & map->modulo_mask;
-                map->primary_key_table[node_bucket_index] = sub_tree;
-            }
-            else if (grand_parent->left == parent)
-            {
-                grand_parent->left = sub_tree;
-            }
-            else
-            {
-                grand_parent->right = sub_tree;
-            }
-            
-            if (grand_parent)
-            {
-                grand_parent->height =
-                max_int(get_primary_tree_node_height(grand_parent->left),
-                        get_primary_tree_node_height(grand_parent->right)) + 1;
-            }
-            
-            return;
-        }
-        
-        parent->height =
-        max_int(get_primary_tree_node_height(parent->left),
-                get_primary_tree_node_height(parent->right)) + 1;
-        
-        parent = parent->parent;
-    }
-}
-
-/****************************************************************************
-* This function is responsible for balancing a primary collision tree after *
-* deleting a node from it.                                                  *
-****************************************************************************/
-static void fix_primary_collision_tree_after_deletion(
-                                        bidirectional_hash_map_2_t* map,
-                                        primary_collision_tree_node_t* node)
-{
-    primary_collision_tree_node_t* grand_parent;
-    primary_collision_tree_node_t* parent = node->parent;
-    primary_collision_tree_node_t* sub_tree;
-    size_t node_bucket_index;
-    
-    while (parent)
-    {
-        if (get_primary_tree_node_height(parent->left) ==
-            get_primary_tree_node_height(parent->right) + 2)
-        {
-            grand_parent = parent->parent;
-            
-            if (get_primary_tree_node_height(parent->left->left) >=
-                get_primary_tree_node_height(parent->left->right))
-            {
-                sub_tree = primary_collision_tree_right_rotate(parent);
-            }
-            else
-            {
-                sub_tree = primary_collision_tree_left_right_rotate(parent);
-            }
-            
-            if (!grand_parent)
-            {
-                node_bucket_index = node->key_pair->primary_key_hash
-                                  & map->modulo_mask;
-
-                map->primary_key_table[node_bucket_index] = sub_tree;
-            }
-            else if (grand_parent->left == parent)
-            {
-                grand_parent->left = sub_tree;
-            }
-            else
-            {
-                grand_parent->right = sub_tree;
-            }
-            
-            if (grand_parent)
-            {
-                grand_parent->height =
-                max_int(get_primary_tree_node_height(grand_parent->left),
-                        get_primary_tree_node_height(grand_parent->right)) + 1;
-            }
-        }
-        else if (get_primary_tree_node_height(parent->right) ==
-                 get_primary_tree_node_height(parent->left) + 2)
-        {
-            grand_parent = parent->parent;
-            
-            if (get_primary_tree_node_height(parent->right->right) >=
-                get_primary_tree_node_height(parent->right->left))
-            {
-                sub_tree = primary_collision_tree_left_rotate(parent);
-            }
-            else
-            {
-                sub_tree = primary_collision_tree_right_left_rotate(parent);
-            }
-            
-            if (!grand_parent)
-            {
-                node_bucket_index = node->key_pair->primary_key_hash
-                                  & map->modulo_mask;
-                map->primary_key_table[node_bucket_index] = sub_tree;
-            }
-            else if (grand_parent->left == parent)
-            {
-                grand_parent->left = sub_tree;
-            }
-            else
-            {
-                grand_parent->right = sub_tree;
-            }
-            
-            if (grand_parent)
-            {
-                grand_parent->height =
-                max_int(get_primary_tree_node_height(grand_parent->left),
-                        get_primary_tree_node_height(grand_parent->right)) + 1;
-            }
-        }
-        
-        parent->height =
-        max_int(get_primary_tree_node_height(parent->left),
-                get_primary_tree_node_height(parent->right)) + 1;
-        
-        parent = parent->parent;
-    }
-}
-
 /*************************************************************
 * Performs left rotation of a secondary collision tree node. *
 *************************************************************/
@@ -407,11 +237,8 @@ secondary_collision_tree_left_rotate(secondary_collision_tree_node_t* node_1)
         node_1->right->parent = node_1;
     }
     
-    node_1->height = max_int(get_secondary_tree_node_height(node_1->left),
-                             get_secondary_tree_node_height(node_1->right)) + 1;
-	
-    node_2->height = max_int(get_secondary_tree_node_height(node_2->left),
-                             get_secondary_tree_node_height(node_2->right)) + 1;
+    update_secondary_tree_node_height(node_1);
+    update_secondary_tree_node_height(node_2);
     return node_2;
 }
 
@@ -425,20 +252,16 @@ secondary_collision_tree_right_rotate(secondary_collision_tree_node_t* node_1)
     
     node_2->parent = node_1->parent;
     node_1->parent = node_2;
-    node_1->left = node_2->right;
-    node_2->right = node_1;
+    node_1->left   = node_2->right;
+    node_2->right  = node_1;
     
     if (node_1->left)
     {
         node_1->left->parent = node_1;
     }
     
-    node_1->height = max_int(get_secondary_tree_node_height(node_1->left),
-                             get_secondary_tree_node_height(node_1->right)) + 1;
-
-    node_2->height = max_int(get_secondary_tree_node_height(node_2->left),
-                             get_secondary_tree_node_height(node_2->right)) + 1;
-    
+    update_secondary_tree_node_height(node_1);
+    update_secondary_tree_node_height(node_2);
     return node_2;
 }
 
@@ -454,9 +277,9 @@ secondary_collision_tree_right_left_rotate(
     return secondary_collision_tree_left_rotate(node_1);
 }
 
-/**************************************************************************
-* Performs a double left/right rotation of a primary collision tree node. *
-**************************************************************************/
+/****************************************************************************
+* Performs a double left/right rotation of a secondary collision tree node. *
+****************************************************************************/
 static secondary_collision_tree_node_t*
 secondary_collision_tree_left_right_rotate(
                                         secondary_collision_tree_node_t* node_1)
@@ -466,604 +289,405 @@ secondary_collision_tree_left_right_rotate(
     return secondary_collision_tree_right_rotate(node_1);
 }
 
-/******************************************************************************
-* This function is responsible for balancing a secondary collision tree after *
-* inserting a node into it.                                                   *
-******************************************************************************/
-static void fix_secondary_collision_tree_after_insertion(
-                                        bidirectional_hash_map_2_t* map,
-                                        secondary_collision_tree_node_t* node)
+/****************************************************************************
+* Makes 'new_child' take the place of 'old_child' under 'parent', or at the *
+* 'root' of the collision tree if 'parent' is NULL.                         *
+****************************************************************************/
+static void replace_primary_collision_tree_child(
+                                    primary_collision_tree_node_t** root,
+                                    primary_collision_tree_node_t* parent,
+                                    primary_collision_tree_node_t* old_child,
+                                    primary_collision_tree_node_t* new_child)
 {
-    secondary_collision_tree_node_t* grand_parent;
-    secondary_collision_tree_node_t* parent = node->parent;
-    secondary_collision_tree_node_t* sub_tree;
-    size_t node_bucket_index;
+    if (!parent)
+    {
+        *root = new_child;
+    }
+    else if (parent->left == old_child)
+    {
+        parent->left = new_child;
+    }
+    else
+    {
+        parent->right = new_child;
+    }
+}
+
+/****************************************************************************
+* Makes 'new_child' take the place of 'old_child' under 'parent', or at the *
+* 'root' of the collision tree if 'parent' is NULL.                         *
+****************************************************************************/
+static void replace_secondary_collision_tree_child(
+                                    secondary_collision_tree_node_t** root,
+                                    secondary_collision_tree_node_t* parent,
+                                    secondary_collision_tree_node_t* old_child,
+                                    secondary_collision_tree_node_t* new_child)
+{
+    if (!parent)
+    {
+        *root = new_child;
+    }
+    else if (parent->left == old_child)
+    {
+        parent->left = new_child;
+    }
+    else
+    {
+        parent->right = new_child;
+    }
+}
+
+/*****************************************************************************
+* Restores the AVL property of a primary collision tree on the path from     *
+* 'node' to the 'root' after an insertion or a deletion below 'node'.        *
+*****************************************************************************/
+static void fix_primary_collision_tree(primary_collision_tree_node_t** root,
+                                       primary_collision_tree_node_t* node)
+{
+    primary_collision_tree_node_t* parent;
+    primary_collision_tree_node_t* sub_tree;
     
-    while (parent)
+    while (node)
     {
-        if (get_secondary_tree_node_height(parent->left) ==
-            get_secondary_tree_node_height(parent->right) + 2)
+        parent = node->parent;
+        update_primary_tree_node_height(node);
+        
+        if (get_primary_tree_node_height(node->left) ==
+            get_primary_tree_node_height(node->right) + 2)
         {
-            grand_parent = parent->parent;
-            
-            if (get_secondary_tree_node_height(parent->left->left) >=
-                get_secondary_tree_node_height(parent->left->right))
-            {
-                sub_tree = secondary_collision_tree_right_rotate(parent);
-            }
-            else
-            {
-                sub_tree = secondary_collision_tree_left_right_rotate(parent);
-            }
-            
-            if (!grand_parent)
+            if (get_primary_tree_node_height(node->left->left) >=
+                get_primary_tree_node_height(node->left->right))
             {
-                node_bucket_index = node->key_pair->primary_key_hash
-                                  & map->modulo_mask;
-                map->secondary_key_table[node_bucket_index] = sub_tree;
-            }
-            else if (grand_parent->left == parent)
-            {
-                grand_parent->left = sub_tree;
+                sub_tree = primary_collision_tree_right_rotate(node);
             }
             else
             {
-                grand_parent->right = sub_tree;
-            }
-            
-            if (grand_parent)
-            {
-                grand_parent->height =
-                max_int(get_secondary_tree_node_height(grand_parent->left),
-                        get_secondary_tree_node_height(grand_parent->right))
-                    + 1;
+                sub_tree = primary_collision_tree_left_right_rotate(node);
             }
             
-            return;
+            replace_primary_collision_tree_child(root, parent, node, sub_tree);
         }
-        else if (get_secondary_tree_node_height(parent->right) ==
-                 get_secondary_tree_node_height(parent->left) + 2)
+        else if (get_primary_tree_node_height(node->right) ==
+                 get_primary_tree_node_height(node->left) + 2)
         {
-            grand_parent = parent->parent;
-            
-            if (get_secondary_tree_node_height(parent->right->right) >=
-                get_secondary_tree_node_height(parent->right->left))
+            if (get_primary_tree_node_height(node->right->right) >=
+                get_primary_tree_node_height(node->right->left))
             {
-                sub_tree = secondary_collision_tree_left_rotate(parent);
+                sub_tree = primary_collision_tree_left_rotate(node);
             }
             else
             {
-                sub_tree = secondary_collision_tree_right_left_rotate(parent);
+                sub_tree = primary_collision_tree_right_left_rotate(node);
             }
             
-            if (!grand_parent)
-            {
-                node_bucket_index = node->key_pair->secondary_key_hash
-                                  & map->modulo_mask;
-                map->secondary_key_table[node_bucket_index] = sub_tree;
-            }
-            else if (grand_parent->left == parent)
-            {
-                grand_parent->left = sub_tree;
-            }
-            else
-            {
-                grand_parent->right = sub_tree;
-            }
-            
-            if (grand_parent)
-            {
-                grand_parent->height =
-                max_int(get_secondary_tree_node_height(grand_parent->left),
-                        get_secondary_tree_node_height(grand_parent->right))
-                    + 1;
-            }
-            
-            return;
+            replace_primary_collision_tree_child(root, parent, node, sub_tree);
         }
         
-        parent->height =
-        max_int(get_secondary_tree_node_height(parent->left),
-                get_secondary_tree_node_height(parent->right)) + 1;
-        
-        parent = parent->parent;
+        node = parent;
     }
 }
 
-/******************************************************************************
-* This function is responsible for balancing a secondary collision tree after *
-* deleting a node from it.                                                    *
-******************************************************************************/
-static void fix_secondary_collision_tree_after_deletion(
-                                        bidirectional_hash_map_2_t* map,
-                                        secondary_collision_tree_node_t* node)
+/*****************************************************************************
+* Restores the AVL property of a secondary collision tree on the path from   *
+* 'node' to the 'root' after an insertion or a deletion below 'node'.        *
+*****************************************************************************/
+static void fix_secondary_collision_tree(
+                                    secondary_collision_tree_node_t** root,
+                                    secondary_collision_tree_node_t* node)
 {
-    secondary_collision_tree_node_t* grand_parent;
-    secondary_collision_tree_node_t* parent = node->parent;
+    secondary_collision_tree_node_t* parent;
     secondary_collision_tree_node_t* sub_tree;
-    size_t node_bucket_index;
     
-    while (parent)
+    while (node)
     {
-        if (get_secondary_tree_node_height(parent->left) ==
-            get_secondary_tree_node_height(parent->right) + 2)
+        parent = node->parent;
+        update_secondary_tree_node_height(node);
+        
+        if (get_secondary_tree_node_height(node->left) ==
+            get_secondary_tree_node_height(node->right) + 2)
         {
-            grand_parent = parent->parent;
-            
-            if (get_secondary_tree_node_height(parent->left->left) >=
-                get_secondary_tree_node_height(parent->left->right))
+            if (get_secondary_tree_node_height(node->left->left) >=
+                get_secondary_tree_node_height(node->left->right))
             {
-                sub_tree = secondary_collision_tree_right_rotate(parent);
+                sub_tree = secondary_collision_tree_right_rotate(node);
             }
             else
             {
-                sub_tree = secondary_collision_tree_left_right_rotate(parent);
+                sub_tree = secondary_collision_tree_left_right_rotate(node);
             }
             
-            if (!grand_parent)
-            {
-                node_bucket_index = node->key_pair->secondary_key_hash
-                                  & map->modulo_mask;
-                map->secondary_key_table[node_bucket_index] = sub_tree;
-            }
-            else if (grand_parent->left == parent)
-            {
-                grand_parent->left = sub_tree;
-            }
-            else
-            {
-                grand_parent->right = sub_tree;
-            }
-            
-            if (grand_parent)
-            {
-                grand_parent->height =
-                max_int(get_secondary_tree_node_height(grand_parent->left),
-                        get_secondary_tree_node_height(grand_parent->right))
-                    + 1;
-            }
+            replace_secondary_collision_tree_child(root,
+                                                   parent,
+                                                   node,
+                                                   sub_tree);
         }
-        else if (get_secondary_tree_node_height(parent->right) ==
-                 get_secondary_tree_node_height(parent->left) + 2)
+        else if (get_secondary_tree_node_height(node->right) ==
+                 get_secondary_tree_node_height(node->left) + 2)
         {
-            grand_parent = parent->parent;
-            
-            if (get_secondary_tree_node_height(parent->right->right) >=
-                get_secondary_tree_node_height(parent->right->left))
-            {
-                sub_tree = secondary_collision_tree_left_rotate(parent);
-            }
-            else
-            {
-                sub_tree = secondary_collision_tree_right_left_rotate(parent);
-            }
-            
-            if (!grand_parent)
-            {
-                node_bucket_index = node->key_pair->secondary_key_hash
-                                  & map->modulo_mask;
-                map->secondary_key_table[node_bucket_index] = sub_tree;
-            }
-            else if (grand_parent->left == parent)
+            if (get_secondary_tree_node_height(node->right->right) >=
+                get_secondary_tree_node_height(node->right->left))
             {
-                grand_parent->left = sub_tree;
+                sub_tree = secondary_collision_tree_left_rotate(node);
             }
             else
             {
-                grand_parent->right = sub_tree;
+                sub_tree = secondary_collision_tree_right_left_rotate(node);
             }
             
-            if (grand_parent)
-            {
-                grand_parent->height =
-                max_int(get_secondary_tree_node_height(grand_parent->left),
-                        get_secondary_tree_node_height(grand_parent->right))
-                    + 1;
-            }
+            replace_secondary_collision_tree_child(root,
+                                                   parent,
+                                                   node,
+                                                   sub_tree);
         }
         
-        parent->height =
-        max_int(get_secondary_tree_node_height(parent->left),
-                get_secondary_tree_node_height(parent->right)) + 1;
-        
-        parent = parent->parent;
-    }
-}
-
-/************************************************************************
-* Unlinks 'node' from its collision tree when 'node' has both children. *
-************************************************************************/
-static void unlink_primary_collision_tree_node_with_both_children(
-                    bidirectional_hash_map_2_t* map,
-                    primary_collision_tree_node_t* node)
-{
-    primary_collision_tree_node_t* successor =
-    get_minimum_tree_node_of_primary(node->right);
-    	
-    primary_collision_tree_node_t* child_of_successor;
-    primary_collision_tree_node_t* parent_of_successor;
-    
-    node->key_pair = successor->key_pair;
-    
-    child_of_successor  = successor->right;
-    parent_of_successor = successor->parent;
-    
-    /* THIS IS STRANGE: */
-    if (parent_of_successor->left == successor)
-    {
-        parent_of_successor->left = child_of_successor;
-    }
-    else
-    {
-        parent_of_successor->right = child_of_successor;
-    }
-    
-    if (child_of_successor)
-    {
-        child_of_successor->parent = parent_of_successor;
-    }
-    
-    fix_primary_collision_tree_after_deletion(map, successor);
-}
-
-/*************************************************************************
-* Unlinks 'node' from its collision tree when 'node' has only one child. *
-*************************************************************************/
-static void unlink_primary_collision_tree_node_with_one_child(
-                    bidirectional_hash_map_2_t* map,
-                    primary_collision_tree_node_t* node)
-{
-    primary_collision_tree_node_t* child;
-    primary_collision_tree_node_t* parent;
-    
-    size_t node_bucket_index = node->key_pair->primary_key_hash
-                             & map->modulo_mask;
-    
-    if (node->left)
-    {
-        child = node->left;
-    }
-    else
-    {
-        child = node->right;
-    }
-    
-    parent = node->parent;
-    child->parent = parent;
-    
-    if (!parent)
-    {
-        map->primary_key_table[node_bucket_index] = child;
-        return;
-    }
-    
-    if (node == parent->left)
-    {
-        parent->left = child;
-    }
-    else
-    {
-        parent->right = child;
-    }
-    
-    fix_primary_collision_tree_after_deletion(map, node);
-}
-
-/**********************************************************************
-* Unlinks 'node' from its collision tree when 'node' has no children. *
-**********************************************************************/
-static void unlink_primary_collision_tree_node_with_no_children(
-                                            bidirectional_hash_map_2_t* map,
-                                            primary_collision_tree_node_t* node)
-{
-    primary_collision_tree_node_t* parent = node->parent;
-    
-    size_t node_bucket_index = node->key_pair->primary_key_hash
-                             & map->modulo_mask;
-    
-    if (!parent)
-    {
-        map->primary_key_table[node_bucket_index] = NULL;
-        return;
-    }
-    
-    if (node == parent->left)
-    {
-        parent->left = NULL;
-    }
-    else
-    {
-        parent->right = NULL;
-    }
-    
-    fix_primary_collision_tree_after_deletion(map, node->parent);
-}
-
-/******************************************************************************
-* This function unlinks 'primary_collision_tree_node' from it collision tree. *
-******************************************************************************/
-static void unlink_primary_collision_tree_node(
-                    bidirectional_hash_map_2_t* map,
-                    primary_collision_tree_node_t* primary_collision_tree_node)
-{
-    if (primary_collision_tree_node->left &&
-        primary_collision_tree_node->right)
-    {
-        /***************************************************
-        * 'primary_collision_tree_node' has both children. *
-        ***************************************************/
-        unlink_primary_collision_tree_node_with_both_children(
-                                                map,
-                                                primary_collision_tree_node);
-    }
-    else if (primary_collision_tree_node->left ||
-             primary_collision_tree_node->right)
-    {
-        /****************************************************
-        * 'primary_collision_tree_node' has only one child. *
-        ****************************************************/
-        unlink_primary_collision_tree_node_with_one_child(
-                                                map,
-                                                primary_collision_tree_node);
-    }
-    else
-    {
-        /*************************************************
-        * 'primary_collision_tree_node' has no children. *
-        *************************************************/
-        unlink_primary_collision_tree_node_with_no_children(
-                                                map,
-                                                primary_collision_tree_node);
+        node = parent;
     }
 }
 
-
-/************************************************************************
-* Unlinks 'node' from its collision tree when 'node' has both children. *
-************************************************************************/
-static void unlink_secondary_collision_tree_node_with_both_children(
-                                        bidirectional_hash_map_2_t* map,
-                                        secondary_collision_tree_node_t* node)
-{
-    secondary_collision_tree_node_t* successor =
-    get_minimum_tree_node_of_secondary(node->right);
-    
-    secondary_collision_tree_node_t* child_of_successor;
-    secondary_collision_tree_node_t* parent_of_successor;
-    
-    node->key_pair = successor->key_pair;
-    
-    child_of_successor  = successor->right;
-    parent_of_successor = successor->parent;
-    
-    /* CHECK ME! */
-    if (parent_of_successor->left == successor)
-    {
-        parent_of_successor->left = child_of_successor;
-    }
-    else
-    {
-        parent_of_successor->right = child_of_successor;
-    }
-    
-    if (child_of_successor)
-    {
-        child_of_successor->parent = parent_of_successor;
-    }
-    
-    fix_secondary_collision_tree_after_deletion(map, successor);
-}
-
 /*************************************************************************
-* Unlinks 'node' from its collision tree when 'node' has only one child. *
+* Inserts 'node' as a leaf into the primary collision tree at 'root' and *
+* rebalances the tree.                                                   *
 *************************************************************************/
-static void unlink_secondary_collision_tree_node_with_one_child(
-                                        bidirectional_hash_map_2_t* map,
-                                        secondary_collision_tree_node_t* node)
+static void link_primary_collision_tree_node(
+                                    bidirectional_hash_map_2_t* map,
+                                    primary_collision_tree_node_t** root,
+                                    primary_collision_tree_node_t* node)
 {
-    secondary_collision_tree_node_t* child;
-    secondary_collision_tree_node_t* parent;
+    primary_collision_tree_node_t* parent = NULL;
+    primary_collision_tree_node_t* current = *root;
+    int cmp = 0;
     
-    size_t node_bucket_index = node->key_pair->primary_key_hash
-    & map->modulo_mask;
-    
-    if (node->left)
-    {
-        child = node->left;
-    }
-    else
+    while (current)
     {
-        child = node->right;
+        parent = current;
+        cmp = compare_primary_key(map,
+                                  node->key_pair->primary_key,
+                                  node->key_pair->primary_key_hash,
+                                  current);
+        
+        current = cmp < 0 ? current->left : current->right;
     }
     
-    parent = node->parent;
-    child->parent = parent;
+    node->parent = parent;
+    node->left   = NULL;
+    node->right  = NULL;
+    node->height = 0;
     
     if (!parent)
     {
-        map->secondary_key_table[node_bucket_index] = child;
+        *root = node;
         return;
     }
     
-    if (node == parent->left)
+    if (cmp < 0)
     {
-        parent->left = child;
+        parent->left = node;
     }
     else
     {
-        parent->right = child;
+        parent->right = node;
     }
     
-    fix_secondary_collision_tree_after_deletion(map, node);
+    fix_primary_collision_tree(root, parent);
 }
 
-/**********************************************************************
-* Unlinks 'node' from its collision tree when 'node' has no children. *
-**********************************************************************/
-static void unlink_secondary_collision_tree_node_with_no_children(
-                                        bidirectional_hash_map_2_t* map,
-                                        secondary_collision_tree_node_t* node)
+/***************************************************************************
+* Inserts 'node' as a leaf into the secondary collision tree at 'root' and *
+* rebalances the tree. Equal secondary keys, which 'put_by_primary' may    *
+* introduce just as in 'bidirectional_hash_map_t', go to the right.        *
+***************************************************************************/
+static void link_secondary_collision_tree_node(
+                                    bidirectional_hash_map_2_t* map,
+                                    secondary_collision_tree_node_t** root,
+                                    secondary_collision_tree_node_t* node)
 {
-    secondary_collision_tree_node_t* parent = node->parent;
+    secondary_collision_tree_node_t* parent = NULL;
+    secondary_collision_tree_node_t* current = *root;
+    int cmp = 0;
+    
+    while (current)
+    {
+        parent = current;
+        cmp = compare_secondary_key(map,
+                                    node->key_pair->secondary_key,
+                                    node->key_pair->secondary_key_hash,
+                                    current);
+        
+        current = cmp < 0 ? current->left : current->right;
+    }
     
-    size_t node_bucket_index = node->key_pair->primary_key_hash
-    & map->modulo_mask;
+    node->parent = parent;
+    node->left   = NULL;
+    node->right  = NULL;
+    node->height = 0;
     
     if (!parent)
     {
-        map->primary_key_table[node_bucket_index] = NULL;
+        *root = node;
         return;
     }
     
-    if (node == parent->left)
+    if (cmp < 0)
     {
-        parent->left = NULL;
+        parent->left = node;
     }
     else
     {
-        parent->right = NULL;
+        parent->right = node;
     }
     
-    fix_secondary_collision_tree_after_deletion(map, node->parent);
-}
-
-/***************************************************************************
-* This function unlinks 'secondary_collision_tree_node' from its collision *
-* tree.                                                                    *
-***************************************************************************/
-static void unlink_secondary_collision_tree_node(
-                bidirectional_hash_map_2_t* map,
-                secondary_collision_tree_node_t* secondary_collision_tree_node)
-{
-    if (secondary_collision_tree_node->left &&
-        secondary_collision_tree_node->right)
-    {
-        /*****************************************************
-        * 'secondary_collision_tree_node' has both children. *
-        *****************************************************/
-        unlink_secondary_collision_tree_node_with_both_children(
-                                                map,
-                                                secondary_collision_tree_node);
-    }
-    else if (secondary_collision_tree_node->left || secondary_collision_tree_node->right)
-    {
-        /******************************************************
-        * 'secondary_collision_tree_node' has only one child. *
-        ******************************************************/
-        unlink_secondary_collision_tree_node_with_one_child(
-                                                map,
-                                                secondary_collision_tree_node);
-    }
-    else
-    {
-        /***************************************************
-        * 'secondary_collision_tree_node' has no children. *
-        ***************************************************/
-        unlink_secondary_collision_tree_node_with_no_children(
-                                                map,
-                                                secondary_collision_tree_node);
-    }
+    fix_secondary_collision_tree(root, parent);
 }
 
-/************************************************************
-* Finds a secondary collision tree node that corresponds to *
-* 'primary_collision_tree_node'.                            *
-************************************************************/
-static secondary_collision_tree_node_t*
-find_secondary_collision_tree_node_via_primary_collision_tree_node(
-                    bidirectional_hash_map_2_t* map,
-                    primary_collision_tree_node_t* primary_collision_tree_node)
+/****************************************************************************
+* Unlinks 'node' from the primary collision tree at 'root'. A node with two *
+* children is replaced by its in-order successor; the nodes themselves are  *
+* moved rather than their key pairs, since the twins and the iteration list *
+* refer to them.                                                            *
+****************************************************************************/
+static void unlink_primary_collision_tree_node(
+                                    primary_collision_tree_node_t** root,
+                                    primary_collision_tree_node_t* node)
 {
-    size_t secondary_collision_tree_bucket_index =
-    primary_collision_tree_node->key_pair->secondary_key_hash
-    & map->modulo_mask;
-    
-    secondary_collision_tree_node_t* secondary_collision_tree_node =
-    map->secondary_key_table[secondary_collision_tree_bucket_index];
-    
-    int cmp;
+    primary_collision_tree_node_t* successor;
+    primary_collision_tree_node_t* child;
+    primary_collision_tree_node_t* fix_start;
     
-    while (secondary_collision_tree_node)
+    if (node->left && node->right)
     {
-        if (secondary_collision_tree_node->key_pair ==
-            primary_collision_tree_node->key_pair)
-        {
-            return secondary_collision_tree_node;
-        }
-        
-        cmp = map->primary_key_compare(
-                        primary_collision_tree_node->key_pair->primary_key,
-                        secondary_collision_tree_node->key_pair->primary_key);
+        successor = get_minimum_tree_node_of_primary(node->right);
         
-        if (cmp < 0)
+        if (successor->parent == node)
         {
-            secondary_collision_tree_node = secondary_collision_tree_node->left;
+            fix_start = successor;
         }
-        else if (cmp > 0)
+        else
         {
-            secondary_collision_tree_node =
-            secondary_collision_tree_node->right;
+            fix_start = successor->parent;
+            fix_start->left = successor->right;
+            
+            if (successor->right)
+            {
+                successor->right->parent = fix_start;
+            }
+            
+            successor->right = node->right;
+            successor->right->parent = successor;
         }
-        else
+        
+        successor->left = node->left;
+        successor->left->parent = successor;
+        successor->parent = node->parent;
+        
+        replace_primary_collision_tree_child(root,
+                                             node->parent,
+                                             node,
+                                             successor);
+    }
+    else
+    {
+        child = node->left ? node->left : node->right;
+        
+        if (child)
         {
-            fputs("This abort should never happend!", stderr);
+            child->parent = node->parent;
         }
+        
+        replace_primary_collision_tree_child(root, node->parent, node, child);
+        fix_start = node->parent;
     }
-            
-    return NULL;
+    
+    fix_primary_collision_tree(root, fix_start);
 }
 
-/**********************************************************
-* Finds a primary collision tree node that corresponds to *
-* 'secondary_collision_chain_node'.                       *
-**********************************************************/
-static primary_collision_tree_node_t*
-find_primary_collision_tree_node_via_secondary_collision_tree_node(
-                bidirectional_hash_map_2_t* map,
-                secondary_collision_tree_node_t* secondary_collision_tree_node)
+/*****************************************************************************
+* Unlinks 'node' from the secondary collision tree at 'root' the same way as *
+* 'unlink_primary_collision_tree_node' does.                                 *
+*****************************************************************************/
+static void unlink_secondary_collision_tree_node(
+                                    secondary_collision_tree_node_t** root,
+                                    secondary_collision_tree_node_t* node)
 {
-    size_t primary_collision_tree_bucket_index =
-    secondary_collision_tree_node->key_pair->primary_key_hash
-    & map->modulo_mask;
-    
-    primary_collision_tree_node_t* primary_collision_tree_node =
-    map->primary_key_table[primary_collision_tree_bucket_index];
-    
-    int cmp;
+    secondary_collision_tree_node_t* successor;
+    secondary_collision_tree_node_t* child;
+    secondary_collision_tree_node_t* fix_start;
     
-    while (primary_collision_tree_node)
+    if (node->left && node->right)
     {
-        if (primary_collision_tree_node->key_pair ==
-            secondary_collision_tree_node->key_pair)
-        {
-            return primary_collision_tree_node;
-        }
-        
-        cmp = map->secondary_key_compare(
-                        secondary_collision_tree_node->key_pair->secondary_key,
-                        primary_collision_tree_node->key_pair->secondary_key);
+        successor = get_minimum_tree_node_of_secondary(node->right);
         
-        if (cmp < 0)
+        if (successor->parent == node)
         {
-            primary_collision_tree_node = primary_collision_tree_node->left;
+            fix_start = successor;
         }
-        else if (cmp > 0)
+        else
         {
-            primary_collision_tree_node = primary_collision_tree_node->right;
+            fix_start = successor->parent;
+            fix_start->left = successor->right;
+            
+            if (successor->right)
+            {
+                successor->right->parent = fix_start;
+            }
+            
+            successor->right = node->right;
+            successor->right->parent = successor;
         }
-        else
+        
+        successor->left = node->left;
+        successor->left->parent = successor;
+        successor->parent = node->parent;
+        
+        replace_secondary_collision_tree_child(root,
+                                               node->parent,
+                                               node,
+                                               successor);
+    }
+    else
+    {
+        child = node->left ? node->left : node->right;
+        
+        if (child)
         {
-            fputs("This abort should never happen!", stderr);
+            child->parent = node->parent;
         }
+        
+        replace_secondary_collision_tree_child(root,
+                                               node->parent,
+                                               node,
+                                               child);
+        fix_start = node->parent;
     }
     
-    return NULL;
+    fix_secondary_collision_tree(root, fix_start);
 }
 
-/**************************************************************************
- * This function removes 'primary_collision_chain_node' from the iteration *
- * list.                                                                   *
- **************************************************************************/
+/**************************************************************
+* Returns the bucket of the primary key table holding 'node'. *
+**************************************************************/
+static primary_collision_tree_node_t** get_primary_collision_tree_root(
+                                        bidirectional_hash_map_2_t* map,
+                                        primary_collision_tree_node_t* node)
+{
+    return &map->primary_key_table[node->key_pair->primary_key_hash &
+                                   map->modulo_mask];
+}
+
+/****************************************************************
+* Returns the bucket of the secondary key table holding 'node'. *
+****************************************************************/
+static secondary_collision_tree_node_t** get_secondary_collision_tree_root(
+                                        bidirectional_hash_map_2_t* map,
+                                        secondary_collision_tree_node_t* node)
+{
+    return &map->secondary_key_table[node->key_pair->secondary_key_hash &
+                                     map->modulo_mask];
+}
+
+/*************************************************************************
+* This function removes 'primary_collision_tree_node' from the iteration *
+* list.                                                                  *
+*************************************************************************/
 static void unlink_primary_collision_tree_node_from_iteraton_list(
                     bidirectional_hash_map_2_t* map,
                     primary_collision_tree_node_t* primary_collision_tree_node)
@@ -1098,26 +722,30 @@ static void remove_mapping(
                     primary_collision_tree_node_t* primary_collision_tree_node)
 {
     secondary_collision_tree_node_t* secondary_collision_tree_node =
-    find_secondary_collision_tree_node_via_primary_collision_tree_node(
-                                                map,
-                                                primary_collision_tree_node);
+        primary_collision_tree_node->twin;
     
-    free(primary_collision_tree_node->key_pair);
     unlink_primary_collision_tree_node_from_iteraton_list(
                                                 map,
                                                 primary_collision_tree_node);
     
-    /*****************************************************
-    * Unlink and purge the primary collision chain node: *
-    *****************************************************/
-    unlink_primary_collision_tree_node(map, primary_collision_tree_node);
-    free(primary_collision_tree_node);
-    
-    /*******************************************************
-    * Unlink and purge the secondary collision chain node: *
-    *******************************************************/
-    unlink_secondary_collision_tree_node(map, secondary_collision_tree_node);
-    free(secondary_collision_tree_node);
+    /****************************************************
+    * Unlink and purge the primary collision tree node: *
+    ****************************************************/
+    unlink_primary_collision_tree_node(
+        get_primary_collision_tree_root(map, primary_collision_tree_node),
+        primary_collision_tree_node);
+    
+    /******************************************************
+    * Unlink and purge the secondary collision tree node: *
+    ******************************************************/
+    unlink_secondary_collision_tree_node(
+        get_secondary_collision_tree_root(map, secondary_collision_tree_node),
+        secondary_collision_tree_node);
+    
+    deallocate(map, primary_collision_tree_node->key_pair);
+    deallocate(map, primary_collision_tree_node);
+    deallocate(map, secondary_collision_tree_node);
+    map->size--;
 }
 
 /************************************************************************
@@ -1130,19 +758,17 @@ static primary_collision_tree_node_t* find_primary_collision_tree_node(
 {
     size_t primary_key_hash = map->primary_key_hasher(primary_key);
     
-    size_t primary_key_collision_tree_bucket_index =
-    primary_key_hash & map->modulo_mask;
-    
     primary_collision_tree_node_t* primary_collision_tree_node =
-    map->primary_key_table[primary_key_collision_tree_bucket_index];
+    map->primary_key_table[primary_key_hash & map->modulo_mask];
     
     int cmp;
     
     while (primary_collision_tree_node)
     {
-        cmp = map->primary_key_compare(
-                            primary_collision_tree_node->key_pair->primary_key,
-                            primary_key);
+        cmp = compare_primary_key(map,
+                                  primary_key,
+                                  primary_key_hash,
+                                  primary_collision_tree_node);
         
         if (cmp < 0)
         {
@@ -1171,19 +797,17 @@ static secondary_collision_tree_node_t* find_secondary_collision_tree_node(
 {
     size_t secondary_key_hash = map->secondary_key_hasher(secondary_key);
     
-    size_t secondary_key_collision_tree_bucket_index =
-    secondary_key_hash & map->modulo_mask;
-    
     secondary_collision_tree_node_t* secondary_collision_tree_node =
-    map->secondary_key_table[secondary_key_collision_tree_bucket_index];
+    map->secondary_key_table[secondary_key_hash & map->modulo_mask];
     
     int cmp;
     
     while (secondary_collision_tree_node)
     {
-        cmp = map->secondary_key_compare(
-                        secondary_collision_tree_node->key_pair->secondary_key,
-                        secondary_key);
+        cmp = compare_secondary_key(map,
+                                    secondary_key,
+                                    secondary_key_hash,
+                                    secondary_collision_tree_node);
         
         if (cmp < 0)
         {
@@ -1212,6 +836,28 @@ int bidirectional_hash_map_2_t_init(
                                   int (*primary_key_compare)    (void*, void*),
                                   int (*secondary_key_compare)  (void*, void*),
                                   void* error_sentinel)
+{
+    return bidirectional_hash_map_2_t_init_with_allocator(map,
+                                                          initial_capacity,
+                                                          load_factor,
+                                                          primary_key_hasher,
+                                                          secondary_key_hasher,
+                                                          primary_key_compare,
+                                                          secondary_key_compare,
+                                                          error_sentinel,
+                                                          NULL);
+}
+
+int bidirectional_hash_map_2_t_init_with_allocator(
+                        bidirectional_hash_map_2_t* map,
+                        size_t initial_capacity,
+                        float load_factor,
+                        size_t (*primary_key_hasher)  (void*),
+                        size_t (*secondary_key_hasher)(void*),
+                        int (*primary_key_compare)    (void*, void*),
+                        int (*secondary_key_compare)  (void*, void*),
+                        void* error_sentinel,
+                        const bidirectional_hash_map_allocator_t* allocator)
 {
     if (!map)
     {
@@ -1226,6 +872,18 @@ int bidirectional_hash_map_2_t_init(
         return 0;
     }
     
+    if (!allocator)
+    {
+        allocator = &bidirectional_hash_map_default_allocator;
+    }
+    
+    if (!bidirectional_hash_map_allocator_t_is_valid(allocator))
+    {
+        return 0;
+    }
+    
+    map->allocator = *allocator;
+    
     load_factor      = max_float(load_factor, MINIMUM_LOAD_FACTOR);
     initial_capacity = max_size_t(initial_capacity, MINIMUM_INITIAL_CAPACITY);
     initial_capacity = to_power_of_two(initial_capacity);
@@ -1236,38 +894,38 @@ int bidirectional_hash_map_2_t_init(
     map->load_factor         = load_factor;
     map->size                = 0;
     
-    map->primary_key_table = calloc(initial_capacity,
-                                    sizeof(primary_collision_tree_node_t*));
+    map->primary_key_table = allocate_table(map, initial_capacity);
     
     if (!map->primary_key_table)
     {
         return 0;
     }
     
-    map->secondary_key_table =
-    calloc(initial_capacity, sizeof(secondary_collision_tree_node_t*));
+    map->secondary_key_table = allocate_table(map, initial_capacity);
     
     if (!map->secondary_key_table)
     {
-        free(map->primary_key_table);
+        deallocate(map, map->primary_key_table);
         map->primary_key_table = NULL;
         return 0;
     }
     
-    map->modulo_mask            = map->capacity - 1;
-    map->primary_key_hasher     = primary_key_hasher;
-    map->secondary_key_hasher   = secondary_key_hasher;
-    map->primary_key_compare    = primary_key_compare;
-    map->secondary_key_compare  = secondary_key_compare;
-    map->error_sentinel         = error_sentinel;
+    map->modulo_mask                = map->capacity - 1;
+    map->primary_key_hasher         = primary_key_hasher;
+    map->secondary_key_hasher       = secondary_key_hasher;
+    map->primary_key_compare        = primary_key_compare;
+    map->secondary_key_compare      = secondary_key_compare;
+    map->error_sentinel             = error_sentinel;
+    map->first_collision_chain_node = NULL;
+    map->last_collision_chain_node  = NULL;
     
     return 1;
 }
 
 void bidirectional_hash_map_2_t_destroy(bidirectional_hash_map_2_t* map)
 {
-    primary_collision_tree_node_t* primary_collision_chain_node;
-    primary_collision_tree_node_t* primary_collision_chain_node_next;
+    primary_collision_tree_node_t* primary_collision_tree_node;
+    primary_collision_tree_node_t* primary_collision_tree_node_next;
     
     if (!map)
     {
@@ -1283,23 +941,26 @@ void bidirectional_hash_map_2_t_destroy(bidirectional_hash_map_2_t* map)
         return;
     }
     
-    primary_collision_chain_node = map->first_collision_chain_node;
+    primary_collision_tree_node = map->first_collision_chain_node;
     
-    /*************************
-    * Free the mapping data. *
-    *************************/
-    while (primary_collision_chain_node)
+    /********************************************************************
+    * Free the mapping data. The tables go away as a whole, so there is *
+    * no need to unlink the nodes from the trees.                       *
+    ********************************************************************/
+    while (primary_collision_tree_node)
     {
-        primary_collision_chain_node_next = primary_collision_chain_node->down;
-        remove_mapping(map, primary_collision_chain_node);
-        primary_collision_chain_node = primary_collision_chain_node_next;
+        primary_collision_tree_node_next = primary_collision_tree_node->down;
+        deallocate(map, primary_collision_tree_node->key_pair);
+        deallocate(map, primary_collision_tree_node->twin);
+        deallocate(map, primary_collision_tree_node);
+        primary_collision_tree_node = primary_collision_tree_node_next;
     }
     
     /*******************************
     * Free the actual hash tables. *
     *******************************/
-    free(map->primary_key_table);
-    free(map->secondary_key_table);
+    deallocate(map, map->primary_key_table);
+    deallocate(map, map->secondary_key_table);
     
     map->primary_key_table   = NULL;
     map->secondary_key_table = NULL;
@@ -1324,153 +985,63 @@ size_t bidirectional_hash_map_2_t_capacity(bidirectional_hash_map_2_t* map)
     return map->capacity;
 }
 
-static primary_collision_tree_node_t* 
-get_primary_collision_tree_node(
-    bidirectional_hash_map_2_t* map,
-    void* datum,
-    primary_collision_tree_node_t* bucket_root)
-{
-    primary_collision_tree_node_t* node = bucket_root;
-
-    while (node) 
-    {
-	int cmp = map->primary_key_compare(
-                       datum, 
-                       node->key_pair->primary_key);
-
-        if (cmp == 0) 
-        {
-            return node;
-        }
-
-        if (cmp < 0) 
-        {
-            node = node->left;
-        }
-        else 
-        {
-            node = node->right;
-        }
-    }
-
-    abort();
-    return NULL; 
-}
-
-static secondary_collision_tree_node_t* 
-find_secondary_collision_tree_node_via_primary_collision_tree_node(
-    bidirectional_hash_map_2_t* map,
-    primary_collision_tree_node_t* primary_collision_tree_node
-)  
-{
-	size_t primary_key_hash =
-            primary_collision_tree_node->key_pair->primary_key_hash;
-
-	size_t primary_key_bucket_index = primary_key_hash & map->capacity;
-
-	key_pair_t* key_pair = get_
-            map->primary_key_table[primary_key_bucket_index];
-
-	size_t secondary_key_bucket_index = key_pair->secondary_key_hash;
-
-
-
-	return NULL;      
-}
-
-/****************************************************************************
- * This function relinks the 'primary_collision_chain_node' node to the new * 
- * primary and secondary hash tables.                                       * 
- ****************************************************************************/
-static void relink_to_new_tables(
-                    bidirectional_hash_map_2_t* map,
-                    primary_collision_tree_node_t* primary_collision_tree_node,
-                    primary_collision_tree_node_t** next_primary_hash_table,
-                    secondary_collision_tree_node_t** next_secondary_hash_table)
-{
-    size_t primary_collision_tree_bucket_index;
-    size_t next_capacity = 2 * map->capacity;
-    size_t next_modulo_mask = next_capacity - 1;
-    
-    secondary_collision_tree_node_t* secondary_collision_tree_node =
-        find_secondary_collision_chain_node_via_primary_collision_tree_node(
-                                                map,
-                                                primary_collision_tree_node);
-    
-    /******************************************************************
-    * Unlink the 'primary_collision_tree_node' from its current tree. *
-    ******************************************************************/
-    unlink_primary_collision_tree_node(map, primary_collision_tree_node);
-    
-    /*********************************************************
-    * Unlink the opposite collision tree node of             *
-    * 'primary_collision_tree_node' from the collision tree. *
-    *********************************************************/
-    unlink_secondary_collision_tree_node(map, secondary_collision_tree_node);
-    
-    /************************************************************
-    * Link 'primary_collision_tree_node' to its new hash table. *
-    ************************************************************/
-    primary_collision_tree_bucket_index =
-    primary_collision_tree_node->key_pair->primary_key_hash & next_modulo_mask;
-    
-    /* TODO! */
-    
-    /**************************************************************
-    * Link 'secondary_collision_tree_node' to its new hash table. *
-    **************************************************************/
-    
-    /* TODO! */
-}
-
 /*******************************************************************************
- * This function is responsible for allocating larger hash tables and relinking *
- * all current collision chain nodes and key pairs to them.                     *
- *******************************************************************************/
+* This function is responsible for allocating larger hash tables and relinking *
+* all current collision tree nodes to them.                                    *
+*******************************************************************************/
 static int expand_hash_map(bidirectional_hash_map_2_t* map)
 {
     size_t next_capacity;
     size_t next_modulo_mask;
     primary_collision_tree_node_t** next_primary_hash_table;
     secondary_collision_tree_node_t** next_secondary_hash_table;
-    primary_collision_tree_node_t* primary_collision_chain_node;
-    primary_collision_tree_node_t* primary_collision_chain_node_next;
+    primary_collision_tree_node_t* primary_collision_tree_node;
+    key_pair_t* key_pair;
     
     next_capacity = map->capacity << 1;
     
-    next_primary_hash_table = calloc(next_capacity,
-                                     sizeof(primary_collision_tree_node_t*));
+    next_primary_hash_table = allocate_table(map, next_capacity);
     
     if (!next_primary_hash_table)
     {
         return 0;
     }
     
-    next_secondary_hash_table =
-    calloc(next_capacity, sizeof(secondary_collision_tree_node_t*));
+    next_secondary_hash_table = allocate_table(map, next_capacity);
     
     if (!next_secondary_hash_table)
     {
-        free(next_primary_hash_table);
+        deallocate(map, next_primary_hash_table);
         return 0;
     }
     
     next_modulo_mask = next_capacity - 1;
-    primary_collision_chain_node = map->first_collision_chain_node;
     
-    while (primary_collision_chain_node)
+    /*******************************************************************
+    * Rebuild the collision trees in the new tables. The old trees are *
+    * dropped along with their tables.                                 *
+    *******************************************************************/
+    for (primary_collision_tree_node = map->first_collision_chain_node;
+         primary_collision_tree_node;
+         primary_collision_tree_node = primary_collision_tree_node->down)
     {
-        primary_collision_chain_node_next = primary_collision_chain_node->down;
-        relink_to_new_tables(map,
-                             primary_collision_chain_node,
-                             next_primary_hash_table,
-                             next_secondary_hash_table);
+        key_pair = primary_collision_tree_node->key_pair;
+        
+        link_primary_collision_tree_node(
+            map,
+            &next_primary_hash_table[key_pair->primary_key_hash &
+                                     next_modulo_mask],
+            primary_collision_tree_node);
         
-        primary_collision_chain_node = primary_collision_chain_node_next;
+        link_secondary_collision_tree_node(
+            map,
+            &next_secondary_hash_table[key_pair->secondary_key_hash &
+                                       next_modulo_mask],
+            primary_collision_tree_node->twin);
     }
     
-    free(map->primary_key_table);
-    free(map->secondary_key_table);
+    deallocate(map, map->primary_key_table);
+    deallocate(map, map->secondary_key_table);
     
     map->primary_key_table = next_primary_hash_table;
     map->secondary_key_table = next_secondary_hash_table;
@@ -1481,76 +1052,81 @@ static int expand_hash_map(bidirectional_hash_map_2_t* map)
 }
 
 /************************************************************************
- * This function is responsible for updating a primary key of a mapping. *
- ************************************************************************/
+* This function is responsible for updating a primary key of a mapping. *
+************************************************************************/
 static void* update_primary_key(
                 bidirectional_hash_map_2_t* map,
-                secondary_collision_tree_node_t* secondary_collision_chain_node,
+                secondary_collision_tree_node_t* secondary_collision_tree_node,
                 void* new_primary_key)
 {
-    void* old_primary_key;
-    size_t new_primary_key_hash;
-    size_t new_primary_key_collision_chain_bucket_index;
-    
-    /*******************************************************
-    * Find the corresponding primary collision chain node: *
-    *******************************************************/
-    primary_collision_tree_node_t* primary_collision_chain_node =
-    find_primary_collision_tree_node_via_secondary_collision_tree_node(
-                                                map,
-                                                secondary_collision_chain_node);
-    
-    old_primary_key = primary_collision_chain_node->key_pair->primary_key;
+    primary_collision_tree_node_t* primary_collision_tree_node =
+        secondary_collision_tree_node->twin;
     
-    /**************************************************************************
-    * Unlink 'primary_collision_chain_node' from its current collision chain: *
-    **************************************************************************/
-    unlink_primary_collision_chain_node(map, primary_collision_chain_node);
+    key_pair_t* key_pair = primary_collision_tree_node->key_pair;
+    void* old_primary_key = key_pair->primary_key;
     
     /************************************************************************
-    * Link the unlinked 'primary_collision_chain_node' to its new collision *
-    * chain. Updates the actual key and its hash as well.                   *
+    * Unlink 'primary_collision_tree_node' from its current collision tree: *
     ************************************************************************/
+    unlink_primary_collision_tree_node(
+        get_primary_collision_tree_root(map, primary_collision_tree_node),
+        primary_collision_tree_node);
+    
+    /***********************************************************************
+    * Link the unlinked 'primary_collision_tree_node' to its new collision *
+    * tree. Updates the actual key and its hash as well.                   *
+    ***********************************************************************/
+    key_pair->primary_key      = new_primary_key;
+    key_pair->primary_key_hash = map->primary_key_hasher(new_primary_key);
+    
+    link_primary_collision_tree_node(
+        map,
+        get_primary_collision_tree_root(map, primary_collision_tree_node),
+        primary_collision_tree_node);
     
     return old_primary_key;
 }
 
+/**************************************************************************
+* This function is responsible for updating a secondary key of a mapping. *
+**************************************************************************/
 static void* update_secondary_key(
                     bidirectional_hash_map_2_t* map,
-                    primary_collision_tree_node_t* primary_collision_chain_node,
+                    primary_collision_tree_node_t* primary_collision_tree_node,
                     void* new_secondary_key)
 {
-    void* old_secondary_key;
-    size_t new_secondary_key_hash;
-    size_t new_secondary_key_collision_chain_bucket_index;
-    
-    /*********************************************************
-    * Find the corresponding secondary collision chain node: *
-    *********************************************************/
     secondary_collision_tree_node_t* secondary_collision_tree_node =
-    find_secondary_collision_tree_node_via_primary_collision_chain_node(
-                                                map,
-                                                primary_collision_chain_node);
-    
-    old_secondary_key = secondary_collision_tree_node->key_pair->secondary_key;
-    
-    /*********************************************************************
-    * Unlink 'secondary_collision_chain_node' from its current collision *
-    * chain:                                                             *
-    *********************************************************************/
-    unlink_secondary_collision_chain_node(map, secondary_collision_tree_node);
-    
-    /***************************************************************************
-    * Links the unlinked 'secondary_collision_chain_node' to its new collision *
-    * chain. Updates the actual key and its has as well.                       *
-    ***************************************************************************/
+        primary_collision_tree_node->twin;
+    
+    key_pair_t* key_pair = primary_collision_tree_node->key_pair;
+    void* old_secondary_key = key_pair->secondary_key;
+    
+    /**********************************************************
+    * Unlink 'secondary_collision_tree_node' from its current *
+    * collision tree:                                         *
+    **********************************************************/
+    unlink_secondary_collision_tree_node(
+        get_secondary_collision_tree_root(map, secondary_collision_tree_node),
+        secondary_collision_tree_node);
+    
+    /*************************************************************************
+    * Link the unlinked 'secondary_collision_tree_node' to its new collision *
+    * tree. Updates the actual key and its hash as well.                     *
+    *************************************************************************/
+    key_pair->secondary_key      = new_secondary_key;
+    key_pair->secondary_key_hash = map->secondary_key_hasher(new_secondary_key);
+    
+    link_secondary_collision_tree_node(
+        map,
+        get_secondary_collision_tree_root(map, secondary_collision_tree_node),
+        secondary_collision_tree_node);
     
     return old_secondary_key;
 }
 
 /*******************************************************************************
 * Adds a new mapping to the map. A mapping (primary_key, secondary_key) is     *
-* "new" if primary_key is not mapped to anything and secondary is not mapped   
+* "new" if primary_key is not mapped to anything and secondary is not mapped   *
 * to anything as well. This function also increments the 'size' of the map.    *
 *******************************************************************************/
 static int add_new_mapping(bidirectional_hash_map_2_t* map,
@@ -1558,10 +1134,8 @@ static int add_new_mapping(bidirectional_hash_map_2_t* map,
                            void* secondary_key)
 {
     key_pair_t* key_pair;
-    primary_collision_tree_node_t* primary_collision_chain_node;
-    secondary_collision_tree_node_t* secondary_collision_chain_node;
-    size_t primary_key_collision_chain_bucket_index;
-    size_t secondary_key_collision_chain_bucket_index;
+    primary_collision_tree_node_t* primary_collision_tree_node;
+    secondary_collision_tree_node_t* secondary_collision_tree_node;
     
     if (map->size > map->capacity * map->load_factor)
     {
@@ -1571,29 +1145,29 @@ static int add_new_mapping(bidirectional_hash_map_2_t* map,
         }
     }
     
-    key_pair = malloc(sizeof(*key_pair));
+    key_pair = allocate(map, sizeof(*key_pair));
     
     if (!key_pair)
     {
         return 0;
     }
     
-    primary_collision_chain_node =
-    malloc(sizeof(*primary_collision_chain_node));
+    primary_collision_tree_node =
+    allocate(map, sizeof(*primary_collision_tree_node));
     
-    if (!primary_collision_chain_node)
+    if (!primary_collision_tree_node)
     {
-        free(key_pair);
+        deallocate(map, key_pair);
         return 0;
     }
     
-    secondary_collision_chain_node =
-    malloc(sizeof(*secondary_collision_chain_node));
+    secondary_collision_tree_node =
+    allocate(map, sizeof(*secondary_collision_tree_node));
     
-    if (!secondary_collision_chain_node)
+    if (!secondary_collision_tree_node)
     {
-        free(key_pair);
-        free(primary_collision_chain_node);
+        deallocate(map, key_pair);
+        deallocate(map, primary_collision_tree_node);
         return 0;
     }
     
@@ -1602,56 +1176,60 @@ static int add_new_mapping(bidirectional_hash_map_2_t* map,
     key_pair->secondary_key = secondary_key;
     key_pair->secondary_key_hash = map->secondary_key_hasher(secondary_key);
     
-    /****************************************************
-    * Link 'primary_collision_chain_node' to its table: *
-    ****************************************************/
+    primary_collision_tree_node->key_pair   = key_pair;
+    primary_collision_tree_node->twin       = secondary_collision_tree_node;
+    secondary_collision_tree_node->key_pair = key_pair;
+    secondary_collision_tree_node->twin     = primary_collision_tree_node;
     
-    /******************************************************
-    * Link 'secondary_collision_chain_node' to its table: *
-    ******************************************************/
+    /***************************************************
+    * Link 'primary_collision_tree_node' to its table: *
+    ***************************************************/
+    link_primary_collision_tree_node(
+        map,
+        get_primary_collision_tree_root(map, primary_collision_tree_node),
+        primary_collision_tree_node);
+    
+    /*****************************************************
+    * Link 'secondary_collision_tree_node' to its table: *
+    *****************************************************/
+    link_secondary_collision_tree_node(
+        map,
+        get_secondary_collision_tree_root(map, secondary_collision_tree_node),
+        secondary_collision_tree_node);
     
     /********************************
     * Deal with the iteration list. *
     ********************************/
     if (map->size == 0)
     {
-        map->first_collision_chain_node = primary_collision_chain_node;
-        map->last_collision_chain_node = primary_collision_chain_node;
-        primary_collision_chain_node->up = NULL;
-        primary_collision_chain_node->down = NULL;
+        map->first_collision_chain_node = primary_collision_tree_node;
+        map->last_collision_chain_node = primary_collision_tree_node;
+        primary_collision_tree_node->up = NULL;
+        primary_collision_tree_node->down = NULL;
     }
     else
     {
-        primary_collision_chain_node->up = map->last_collision_chain_node;
-        primary_collision_chain_node->down = NULL;
-        map->last_collision_chain_node->down = primary_collision_chain_node;
-        map->last_collision_chain_node = primary_collision_chain_node;
+        primary_collision_tree_node->up = map->last_collision_chain_node;
+        primary_collision_tree_node->down = NULL;
+        map->last_collision_chain_node->down = primary_collision_tree_node;
+        map->last_collision_chain_node = primary_collision_tree_node;
     }
     
     map->size++;
     return 1;
 }
 
-void* bidirectional_hash_map_t_put_by_primary(bidirectional_hash_map_2_t* map,
-                                              void* primary_key,
-                                              void* secondary_key)
+void* bidirectional_hash_map_2_t_put_by_primary(bidirectional_hash_map_2_t* map,
+                                                void* primary_key,
+                                                void* secondary_key)
 {
-    size_t primary_key_hash;
-    size_t primary_key_collision_chain_bucket_index;
-    primary_collision_tree_node_t* primary_collision_chain_node;
-    void* return_value;
-    
-    primary_key_hash = map->primary_key_hasher(primary_key);
-    primary_key_collision_chain_bucket_index =
-    primary_key_hash & map->modulo_mask;
-    
-    primary_collision_chain_node =
-    find_primary_collision_chain_node(map, primary_key);
+    primary_collision_tree_node_t* primary_collision_tree_node =
+    find_primary_collision_tree_node(map, primary_key);
     
-    if (primary_collision_chain_node)
+    if (primary_collision_tree_node)
     {
         return update_secondary_key(map,
-                                    primary_collision_chain_node,
+                                    primary_collision_tree_node,
                                     secondary_key);
     }
     else
@@ -1661,26 +1239,18 @@ void* bidirectional_hash_map_t_put_by_primary(bidirectional_hash_map_2_t* map,
     }
 }
 
-void* bidirectional_hash_map_t_put_by_secondary(bidirectional_hash_map_2_t* map,
+void* bidirectional_hash_map_2_t_put_by_secondary(
+                                                bidirectional_hash_map_2_t* map,
                                                 void* primary_key,
                                                 void* secondary_key)
 {
-    size_t secondary_key_hash;
-    size_t secondary_key_collision_chain_bucket_index;
-    secondary_collision_tree_node_t* secondary_collision_chain_node;
-    void* return_value;
-    
-    secondary_key_hash = map->secondary_key_hasher(secondary_key);
-    secondary_key_collision_chain_bucket_index =
-    secondary_key_hash & map->modulo_mask;
-    
-    secondary_collision_chain_node =
-    find_secondary_collision_chain_node(map, secondary_key);
+    secondary_collision_tree_node_t* secondary_collision_tree_node =
+    find_secondary_collision_tree_node(map, secondary_key);
     
-    if (secondary_collision_chain_node)
+    if (secondary_collision_tree_node)
     {
         return update_primary_key(map,
-                                  secondary_collision_chain_node,
+                                  secondary_collision_tree_node,
                                   primary_key);
     }
     else
@@ -1698,30 +1268,13 @@ void* bidirectional_hash_map_2_t_remove_by_primary_key(
     primary_collision_tree_node_t* primary_collision_tree_node =
     find_primary_collision_tree_node(map, primary_key);
     
-    secondary_collision_tree_node_t* secondary_collision_tree_node;
-    
     if (primary_collision_tree_node == NULL)
     {
         return NULL;
     }
     
-    secondary_collision_tree_node =
-    find_secondary_collision_tree_node_via_primary_collision_tree_node(
-                                                map,
-                                                primary_collision_tree_node);
-    
-    unlink_primary_collision_tree_node(map, primary_collision_tree_node);
-    unlink_secondary_collision_tree_node(map, secondary_collision_tree_node);
     secondary_key = primary_collision_tree_node->key_pair->secondary_key;
-    
-    unlink_primary_collision_tree_node_from_iteraton_list(
-                                                map,
-                                                primary_collision_tree_node);
-    
-    free(primary_collision_tree_node->key_pair);
-    free(primary_collision_tree_node);
-    free(secondary_collision_tree_node);
-    
+    remove_mapping(map, primary_collision_tree_node);
     return secondary_key;
 }
 
@@ -1738,24 +1291,8 @@ void* bidirectional_hash_map_2_t_remove_by_secondary_key(
         return NULL;
     }
     
-    primary_collision_tree_node_t* primary_collision_tree_node =
-    find_primary_collision_tree_node_via_secondary_collision_tree_node(
-                                                map,
-                                                secondary_collision_tree_node);
-                      
-    
-    unlink_primary_collision_tree_node(map, primary_collision_tree_node);
-    unlink_secondary_collision_tree_node(map, secondary_collision_tree_node);
-    primary_key = primary_collision_tree_node->key_pair->primary_key;
-    
-    unlink_primary_collision_tree_node_from_iteraton_list(
-                                                map,
-                                                primary_collision_tree_node);
-    
-    free(primary_collision_tree_node->key_pair);
-    free(primary_collision_tree_node);
-    free(secondary_collision_tree_node);
-    
+    primary_key = secondary_collision_tree_node->key_pair->primary_key;
+    remove_mapping(map, secondary_collision_tree_node->twin);
     return primary_key;
 }
 
@@ -1766,19 +1303,12 @@ void* bidirectional_hash_map_2_t_get_by_primary_key(
     primary_collision_tree_node_t* primary_collision_tree_node =
     find_primary_collision_tree_node(map, primary_key);
     
-    secondary_collision_tree_node_t* secondary_collision_tree_node;
-    
     if (primary_collision_tree_node == NULL)
     {
         return NULL;
     }
     
-    secondary_collision_tree_node =
-    find_secondary_collision_tree_node_via_primary_collision_chain_node(
-                                                map,
-                                                primary_collision_tree_node);
-    
-    return secondary_collision_tree_node->key_pair->secondary_key;
+    return primary_collision_tree_node->key_pair->secondary_key;
 }
 
 void* bidirectional_hash_map_2_t_get_by_secondary_key(
@@ -1788,18 +1318,11 @@ void* bidirectional_hash_map_2_t_get_by_secondary_key(
     secondary_collision_tree_node_t* secondary_collision_tree_node =
     find_secondary_collision_tree_node(map, secondary_key);
     
-    primary_collision_tree_node_t* primary_collision_tree_node;
-    
     if (secondary_collision_tree_node == NULL)
     {
         return NULL;
     }
     
-    primary_collision_tree_node =
-    find_primary_collision_tree_node_via_secondary_collision_chain_node(
-                                                map,
-                                                secondary_collision_tree_node);
-    
     return secondary_collision_tree_node->key_pair->primary_key;
 }
 
@@ -1858,5 +1381,6 @@ int bidirectional_hash_map_2_iterator_t_next(
     *primary_key_ptr = iterator->current_node->key_pair->primary_key;
     *secondary_key_ptr = iterator->current_node->key_pair->secondary_key;
     iterator->current_node = iterator->current_node->down;
+    iterator->iterated++;
     return 1;
 }
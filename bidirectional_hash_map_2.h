@@ -1,32 +1,10 @@
 #ifndef BIDIRECTIONAL_HASH_MAP_2_H
 #define BIDIRECTIONAL_HASH_MAP_2_H
 
+#include "bidirectional_hash_map_allocator.h"
+#include "key_pair.h"
 #include <stdlib.h>
 
-typedef struct key_pair_t {
-    
-    /*******************
-    * The primary key. *
-    *******************/
-    void* primary_key;
-    
-    /*********************
-    * The secondary key. *
-    *********************/
-    void* secondary_key;
-    
-    /*******************************
-    * The hash of the primary key. *
-    *******************************/
-    size_t primary_key_hash;
-    
-    /********************************
-    * The hash of the secondary key *
-    ********************************/
-    size_t secondary_key_hash;
-}
-key_pair_t;
-
 /****************************************************************************
 * The primary collision tree node. This implements essentially an AVL-tree. *
 ****************************************************************************/
@@ -51,7 +29,7 @@ typedef struct primary_collision_tree_node_t {
     * The height of this tree node. The leaves have height of 0 and the height *
     * grows while going upwards in the tree.                                   *
     ***************************************************************************/
-    size_t height;
+    int height;
     
     /**************************************************************************
     * The previously added node. This field is used for faster iteration over *
@@ -65,6 +43,11 @@ typedef struct primary_collision_tree_node_t {
     ***************************************************************************/
     struct primary_collision_tree_node_t* down;
     
+    /**************************************************************
+    * Points to the secondary collision tree node of the mapping. *
+    **************************************************************/
+    struct secondary_collision_tree_node_t* twin;
+    
     /*******************************************
     * Points to the actual key pair structure. *
     *******************************************/
@@ -72,9 +55,9 @@ typedef struct primary_collision_tree_node_t {
 }
 primary_collision_tree_node_t;
 
-/**********************************************************
-* The collision chain node type for secondary key chains. *
-**********************************************************/
+/******************************************************************************
+* The secondary collision tree node. This implements essentially an AVL-tree. *
+******************************************************************************/
 typedef struct secondary_collision_tree_node_t {
     
     /***************************************************************************
@@ -96,7 +79,12 @@ typedef struct secondary_collision_tree_node_t {
     * The height of this tree node. The leaves have height of 0 and the height *
     * grows while going upwards in the tree.                                   *
     ***************************************************************************/
-    size_t height;
+    int height;
+    
+    /************************************************************
+    * Points to the primary collision tree node of the mapping. *
+    ************************************************************/
+    struct primary_collision_tree_node_t* twin;
     
     /*******************************************
     * Points to the actual key pair structure. *
@@ -177,6 +165,11 @@ typedef struct bidirectional_hash_map_2_t {
     * A value that is returned upon failure. *
     *****************************************/
     void* error_sentinel;
+    
+    /****************************************************
+    * The allocator serving all the memory of this map. *
+    ****************************************************/
+    bidirectional_hash_map_allocator_t allocator;
 }
 bidirectional_hash_map_2_t;
 
@@ -199,30 +192,62 @@ typedef struct bidirectional_hash_map_2_iterator_t {
 }
 bidirectional_hash_map_2_iterator_t;
 
-/****************************************************************************
-* Builds a new, empty bidirectional hash map.|                              *
-*--------------------------------------------+                              *
-* map -------------------- the map to initialize.                           *
-* initial_capacity ------- the initial capacity of both the hash tables.    *
-* load_factor ------------ the load factor.                                 *
-* primary_key_hasher ----- the function for producing primary key hashes.   *
-* secondary_key_hasher --- the function for producing secondary key hashes. *
-* primary_key_equality --- the function for querying primary key equality.  *
-* secondary_key_equality - the function for querying secondary key equality.*
-* error_sentinel --------- the sentinel return on failed addition.          *
-*-----------------------------------------------------------+               *
-* RETURNS: 1 if initialization was successfull, 0 otherwise.|               *
-****************************************************************************/
+/*****************************************************************************
+* Builds a new, empty bidirectional hash map. Each bucket is an AVL tree   | *
+* ordered by the key hash and then by the comparator, so a bucket of n     | *
+* colliding keys costs O(log n) comparisons.                               | *
+*--------------------------------------------------------------------------+ *
+* map ------------------- the map to initialize.                             *
+* initial_capacity ------ the initial capacity of both the hash tables.      *
+* load_factor ----------- the load factor.                                   *
+* primary_key_hasher ---- the function for producing primary key hashes.     *
+* secondary_key_hasher -- the function for producing secondary key hashes.   *
+* primary_key_compare --- the function returning a negative value, zero or a *
+*                         positive value when the first primary key is less  *
+*                         than, equal to or greater than the second one.     *
+* secondary_key_compare - the same for the secondary keys.                   *
+* error_sentinel -------- the sentinel return on failed addition.            *
+*-----------------------------------------------------------+                *
+* RETURNS: 1 if initialization was successfull, 0 otherwise.|                *
+*****************************************************************************/
 int bidirectional_hash_map_2_t_init(
                                   bidirectional_hash_map_2_t* map,
                                   size_t initial_capacity,
                                   float load_factor,
                                   size_t (*primary_key_hasher)  (void*),
                                   size_t (*secondary_key_hasher)(void*),
-                                  int (*primary_key_equality)   (void*, void*),
-                                  int (*secondary_key_equality) (void*, void*),
+                                  int (*primary_key_compare)    (void*, void*),
+                                  int (*secondary_key_compare)  (void*, void*),
                                   void* error_sentinel);
 
+/*****************************************************************************
+* Builds a new, empty bidirectional hash map taking all its memory from the| *
+* given allocator.                                                         | *
+*--------------------------------------------------------------------------+ *
+* map ------------------- the map to initialize.                             *
+* initial_capacity ------ the initial capacity of both the hash tables.      *
+* load_factor ----------- the load factor.                                   *
+* primary_key_hasher ---- the function for producing primary key hashes.     *
+* secondary_key_hasher -- the function for producing secondary key hashes.   *
+* primary_key_compare --- the three-way comparator of the primary keys.      *
+* secondary_key_compare - the three-way comparator of the secondary keys.    *
+* error_sentinel -------- the sentinel return on failed addition.            *
+* allocator ------------- the allocator to copy into the map, or NULL for    *
+*                         the default 'malloc' based one.                    *
+*-----------------------------------------------------------+                *
+* RETURNS: 1 if initialization was successfull, 0 otherwise.|                *
+*****************************************************************************/
+int bidirectional_hash_map_2_t_init_with_allocator(
+        bidirectional_hash_map_2_t* map,
+        size_t initial_capacity,
+        float load_factor,
+        size_t (*primary_key_hasher)  (void*),
+        size_t (*secondary_key_hasher)(void*),
+        int (*primary_key_compare)    (void*, void*),
+        int (*secondary_key_compare)  (void*, void*),
+        void* error_sentinel,
+        const bidirectional_hash_map_allocator_t* allocator);
+
 /************************************************
 * Releases all the resources of the input map.| *
 *---------------------------------------------+ *
@@ -0,0 +1,37 @@
+#include "bidirectional_hash_map_allocator.h"
+#include <stdlib.h>
+
+static void* default_allocate(void* context, size_t size)
+{
+    (void) context;
+    return malloc(size);
+}
+
+static void* default_allocate_zeroed(void* context, size_t count, size_t size)
+{
+    (void) context;
+    return calloc(count, size);
+}
+
+static void default_deallocate(void* context, void* memory)
+{
+    (void) context;
+    free(memory);
+}
+
+const bidirectional_hash_map_allocator_t
+bidirectional_hash_map_default_allocator = {
+    default_allocate,
+    default_allocate_zeroed,
+    default_deallocate,
+    NULL
+};
+
+int bidirectional_hash_map_allocator_t_is_valid(
+                            const bidirectional_hash_map_allocator_t* allocator)
+{
+    return allocator &&
+           allocator->allocate &&
+           allocator->allocate_zeroed &&
+           allocator->deallocate;
+}
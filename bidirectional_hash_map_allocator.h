@@ -0,0 +1,56 @@
+#ifndef BIDIRECTIONAL_HASH_MAP_ALLOCATOR_H
+#define BIDIRECTIONAL_HASH_MAP_ALLOCATOR_H
+
+#include <stdlib.h>
+
+/*****************************************************************************
+* The memory allocator a map obtains its hash tables and mapping storage     *
+* from. Every function receives 'context' as its first argument, so that the *
+* allocator may be, say, an arena or a NUMA node local heap. The memory need *
+* not be aligned beyond what 'malloc' guarantees.                            *
+*****************************************************************************/
+typedef struct bidirectional_hash_map_allocator_t {
+    
+    /*********************************************************
+    * Allocates 'size' bytes, or returns NULL if there is no *
+    * memory. Plays the role of 'malloc'.                    *
+    *********************************************************/
+    void* (*allocate)(void* context, size_t size);
+    
+    /******************************************************************
+    * Allocates 'count' zeroed elements of 'size' bytes each, or      *
+    * returns NULL if there is no memory. Plays the role of 'calloc'. *
+    ******************************************************************/
+    void* (*allocate_zeroed)(void* context, size_t count, size_t size);
+    
+    /*****************************************************************
+    * Releases the memory returned by the two functions above. Plays *
+    * the role of 'free', including accepting NULL.                  *
+    *****************************************************************/
+    void  (*deallocate)(void* context, void* memory);
+    
+    /****************************************************
+    * The opaque state passed to each of the functions. *
+    ****************************************************/
+    void* context;
+}
+bidirectional_hash_map_allocator_t;
+
+/******************************************************************************
+* The allocator built on 'malloc', 'calloc' and 'free', used by the maps that *
+* are not given an allocator of their own.                                    *
+******************************************************************************/
+extern const bidirectional_hash_map_allocator_t
+bidirectional_hash_map_default_allocator;
+
+/*****************************************************************************
+* Checks that all the functions of the input allocator are set.|             *
+*--------------------------------------------------------------+             *
+* allocator - the allocator to check.                                        *
+*-----------------------------------------------------------+                *
+* RETURNS: 1 if the allocator is usable, 0 otherwise.       |                *
+*****************************************************************************/
+int bidirectional_hash_map_allocator_t_is_valid(
+                            const bidirectional_hash_map_allocator_t* allocator);
+
+#endif /* BIDIRECTIONAL_HASH_MAP_ALLOCATOR_H */
@@ -0,0 +1,237 @@
+#include "bidirectional_hash_map_hashing.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*******************************************************************
+* The initial SipHash state, "somepseudorandomlygeneratedbytes" in *
+* ASCII. The key is XORed into it.                                 *
+*******************************************************************/
+static const uint64_t SIPHASH_V0 = ((uint64_t) 0x736F6D65UL << 32) |
+                                   (uint64_t) 0x70736575UL;
+static const uint64_t SIPHASH_V1 = ((uint64_t) 0x646F7261UL << 32) |
+                                   (uint64_t) 0x6E646F6DUL;
+static const uint64_t SIPHASH_V2 = ((uint64_t) 0x6C796765UL << 32) |
+                                   (uint64_t) 0x6E657261UL;
+static const uint64_t SIPHASH_V3 = ((uint64_t) 0x74656462UL << 32) |
+                                   (uint64_t) 0x79746573UL;
+
+/****************************************************************
+* The fixed keys compressing the entropy gathered by the key    *
+* randomization into the two halves of a key. They need not be  *
+* secret, since the entropy itself is what the adversary lacks. *
+****************************************************************/
+static const bidirectional_hash_map_hash_key_t ENTROPY_KEY_0 = {
+    ((uint64_t) 0x243F6A88UL << 32) | (uint64_t) 0x85A308D3UL,
+    ((uint64_t) 0x13198A2EUL << 32) | (uint64_t) 0x03707344UL
+};
+
+static const bidirectional_hash_map_hash_key_t ENTROPY_KEY_1 = {
+    ((uint64_t) 0xA4093822UL << 32) | (uint64_t) 0x299F31D0UL,
+    ((uint64_t) 0x082EFA98UL << 32) | (uint64_t) 0xEC4E6C89UL
+};
+
+/**************************************************************
+* The number of bytes of '/dev/urandom' a key is seeded with. *
+**************************************************************/
+#define RANDOM_BYTE_COUNT 16
+
+static uint64_t rotate_left(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+/************************
+* The state of SipHash. *
+************************/
+typedef struct siphash_state_t {
+    uint64_t v0;
+    uint64_t v1;
+    uint64_t v2;
+    uint64_t v3;
+}
+siphash_state_t;
+
+static void siphash_round(siphash_state_t* state)
+{
+    state->v0 += state->v1;
+    state->v1  = rotate_left(state->v1, 13);
+    state->v1 ^= state->v0;
+    state->v0  = rotate_left(state->v0, 32);
+    state->v2 += state->v3;
+    state->v3  = rotate_left(state->v3, 16);
+    state->v3 ^= state->v2;
+    state->v0 += state->v3;
+    state->v3  = rotate_left(state->v3, 21);
+    state->v3 ^= state->v0;
+    state->v2 += state->v1;
+    state->v1  = rotate_left(state->v1, 17);
+    state->v1 ^= state->v2;
+    state->v2  = rotate_left(state->v2, 32);
+}
+
+static void siphash_start(siphash_state_t* state,
+                          const bidirectional_hash_map_hash_key_t* key)
+{
+    state->v0 = SIPHASH_V0 ^ key->k0;
+    state->v1 = SIPHASH_V1 ^ key->k1;
+    state->v2 = SIPHASH_V2 ^ key->k0;
+    state->v3 = SIPHASH_V3 ^ key->k1;
+}
+
+/*****************************************************
+* Absorbs one message word with a single compression *
+* round, the "1" of SipHash-1-3.                     *
+*****************************************************/
+static void siphash_absorb(siphash_state_t* state, uint64_t message)
+{
+    state->v3 ^= message;
+    siphash_round(state);
+    state->v0 ^= message;
+}
+
+/******************************************************************
+* Runs the three finalization rounds, the "3" of SipHash-1-3, and *
+* returns the hash.                                               *
+******************************************************************/
+static uint64_t siphash_finish(siphash_state_t* state)
+{
+    state->v2 ^= 0xFF;
+    siphash_round(state);
+    siphash_round(state);
+    siphash_round(state);
+    return state->v0 ^ state->v1 ^ state->v2 ^ state->v3;
+}
+
+/**************************************************************
+* Reads up to eight bytes as a little-endian word, as SipHash *
+* does regardless of the byte order of the machine.           *
+**************************************************************/
+static uint64_t load_little_endian(const unsigned char* bytes, size_t count)
+{
+    uint64_t word = 0;
+    
+    while (count > 0)
+    {
+        count--;
+        word = (word << 8) | bytes[count];
+    }
+    
+    return word;
+}
+
+static uint64_t siphash13(const bidirectional_hash_map_hash_key_t* key,
+                          const void* data,
+                          size_t length)
+{
+    const unsigned char* bytes = (const unsigned char*) data;
+    siphash_state_t state;
+    size_t remaining = length;
+    
+    siphash_start(&state, key);
+    
+    while (remaining >= 8)
+    {
+        siphash_absorb(&state, load_little_endian(bytes, 8));
+        bytes     += 8;
+        remaining -= 8;
+    }
+    
+    /*****************************************************************
+    * The last word carries the leftover bytes and, in its top byte, *
+    * the length of the input modulo 256.                            *
+    *****************************************************************/
+    siphash_absorb(&state,
+                   load_little_endian(bytes, remaining) |
+                   ((uint64_t) (length & 0xFF) << 56));
+    
+    return siphash_finish(&state);
+}
+
+size_t bidirectional_hash_map_siphash13(
+                                const bidirectional_hash_map_hash_key_t* key,
+                                const void* data,
+                                size_t length)
+{
+    return (size_t) siphash13(key, data, length);
+}
+
+size_t bidirectional_hash_map_siphash13_word(
+                                const bidirectional_hash_map_hash_key_t* key,
+                                size_t word)
+{
+    siphash_state_t state;
+    
+    siphash_start(&state, key);
+    
+    if (sizeof(size_t) >= 8)
+    {
+        siphash_absorb(&state, (uint64_t) word);
+        siphash_absorb(&state, (uint64_t) 8 << 56);
+    }
+    else
+    {
+        siphash_absorb(&state,
+                       (uint64_t) word | ((uint64_t) sizeof(size_t) << 56));
+    }
+    
+    return (size_t) siphash_finish(&state);
+}
+
+void bidirectional_hash_map_hash_key_t_randomize(
+                                        bidirectional_hash_map_hash_key_t* key)
+{
+    static unsigned long call_count = 0;
+    
+    /**************************************************************
+    * Whatever differs between two calls, processes and machines. *
+    **************************************************************/
+    struct {
+        unsigned char random_bytes[RANDOM_BYTE_COUNT];
+        time_t        time;
+        clock_t       clock;
+        const void*   key_address;
+        const void*   stack_address;
+        const void*   static_address;
+        unsigned long call_count;
+    }
+    entropy;
+    
+    FILE* random_source;
+    
+    memset(&entropy, 0, sizeof(entropy));
+    
+    random_source = fopen("/dev/urandom", "rb");
+    
+    if (random_source)
+    {
+        if (fread(entropy.random_bytes,
+                  1,
+                  RANDOM_BYTE_COUNT,
+                  random_source) != RANDOM_BYTE_COUNT)
+        {
+            memset(entropy.random_bytes, 0, RANDOM_BYTE_COUNT);
+        }
+        
+        fclose(random_source);
+    }
+    
+    entropy.time           = time(NULL);
+    entropy.clock          = clock();
+    entropy.key_address    = key;
+    entropy.stack_address  = &entropy;
+    entropy.static_address = (const void*) &call_count;
+    
+    /****************************************************************
+    * Maps may be seeded from several threads at once, so the count *
+    * is only kept where it can be bumped atomically.               *
+    ****************************************************************/
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+    entropy.call_count = __atomic_add_fetch(&call_count, 1, __ATOMIC_RELAXED);
+#endif
+    
+    key->k0 = siphash13(&ENTROPY_KEY_0, &entropy, sizeof(entropy));
+    key->k1 = siphash13(&ENTROPY_KEY_1, &entropy, sizeof(entropy));
+}
@@ -0,0 +1,66 @@
+#ifndef BIDIRECTIONAL_HASH_MAP_HASHING_H
+#define BIDIRECTIONAL_HASH_MAP_HASHING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**************************************************************************
+* The secret 128-bit key of the keyed hash functions below. Whoever knows *
+* the key can build colliding inputs, so it must not leave the process.   *
+**************************************************************************/
+typedef struct bidirectional_hash_map_hash_key_t {
+    
+    /******************************
+    * The low 64 bits of the key. *
+    ******************************/
+    uint64_t k0;
+    
+    /*******************************
+    * The high 64 bits of the key. *
+    *******************************/
+    uint64_t k1;
+}
+bidirectional_hash_map_hash_key_t;
+
+/*****************************************************************************
+* Fills the input key with fresh random bits. They are read from           | *
+* '/dev/urandom' where it exists, and are folded together with the clock,  | *
+* the address space layout and a call counter, so that two keys differ     | *
+* even where it does not.                                                  | *
+*--------------------------------------------------------------------------+ *
+* key - the key to randomize.                                                *
+*****************************************************************************/
+void bidirectional_hash_map_hash_key_t_randomize(
+                                        bidirectional_hash_map_hash_key_t* key);
+
+/*****************************************************************************
+* Hashes a byte string with SipHash-1-3 under the input key. Without the   | *
+* key, the output can not be predicted, so an adversary controlling the    | *
+* strings can not make them collide on purpose. Suits the hashers of maps  | *
+* whose keys are byte strings coming from untrusted sources.               | *
+*--------------------------------------------------------------------------+ *
+* key ---- the secret key.                                                   *
+* data --- the bytes to hash.                                                *
+* length - the number of bytes to hash.                                      *
+*-----------------------------------------------------------------------+    *
+* RETURNS: the hash, truncated to the width of 'size_t' if it is narrow.|    *
+*****************************************************************************/
+size_t bidirectional_hash_map_siphash13(
+                                const bidirectional_hash_map_hash_key_t* key,
+                                const void* data,
+                                size_t length);
+
+/*****************************************************************************
+* Hashes a single word with SipHash-1-3 under the input key, skipping the  | *
+* byte loop of 'bidirectional_hash_map_siphash13'.                         | *
+*--------------------------------------------------------------------------+ *
+* key -- the secret key.                                                     *
+* word - the word to hash.                                                   *
+*-----------------------------------------------------------------------+    *
+* RETURNS: the hash, truncated to the width of 'size_t' if it is narrow.|    *
+*****************************************************************************/
+size_t bidirectional_hash_map_siphash13_word(
+                                const bidirectional_hash_map_hash_key_t* key,
+                                size_t word);
+
+#endif /* BIDIRECTIONAL_HASH_MAP_HASHING_H */
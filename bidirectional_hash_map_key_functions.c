@@ -0,0 +1,233 @@
+#include "bidirectional_hash_map_key_functions.h"
+#include "bidirectional_hash_map.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BIDIRECTIONAL_HASH_MAP_X86_64
+#include <immintrin.h>
+#endif
+
+/********************************************************************
+* The 64-bit golden ratio, an odd multiplier with well spread bits. *
+********************************************************************/
+static const uint64_t HASH_MULTIPLIER = ((uint64_t) 0x9E3779B9UL << 32) |
+                                        (uint64_t) 0x7F4A7C15UL;
+
+/*********************************
+* The number of bytes in a UUID. *
+*********************************/
+#define UUID_SIZE 16
+
+static uint64_t rotate_left(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+/***************************************************************
+* Reads eight bytes at any alignment in the native byte order. *
+***************************************************************/
+static uint64_t load_word(const unsigned char* bytes)
+{
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+/**************************************************************
+* Reads four bytes at any alignment in the native byte order. *
+**************************************************************/
+static uint64_t load_half_word(const unsigned char* bytes)
+{
+    uint32_t half_word;
+    memcpy(&half_word, bytes, sizeof(half_word));
+    return half_word;
+}
+
+/*******************************************************************
+* Packs the last 'count' bytes of a string, fewer than eight, into *
+* a word. The loads have fixed sizes and may overlap, so that no   *
+* byte loop nor 'memcpy' call of variable size is needed; the word *
+* depends on the bytes and 'count' only.                           *
+*******************************************************************/
+static uint64_t load_tail(const unsigned char* bytes, size_t count)
+{
+    if (count >= 4)
+    {
+        return load_half_word(bytes) |
+               (load_half_word(bytes + count - 4) << 32);
+    }
+    
+    if (count > 0)
+    {
+        return (uint64_t) bytes[0] |
+               ((uint64_t) bytes[count >> 1] << 8) |
+               ((uint64_t) bytes[count - 1] << 16);
+    }
+    
+    return 0;
+}
+
+/********************************************************************
+* Scrambles a 64-bit intermediate hash into a 'size_t', folding the *
+* high half into the low one first where 'size_t' is narrower.      *
+********************************************************************/
+static size_t finish_hash(uint64_t hash)
+{
+#if SIZE_MAX > 0xFFFFFFFFUL
+    return bidirectional_hash_map_mix_hash((size_t) hash);
+#else
+    return bidirectional_hash_map_mix_hash((size_t)(hash ^ (hash >> 32)));
+#endif
+}
+
+/**************************************************************
+* Hashes eight bytes per step with a rotate, an XOR and a     *
+* multiplication. Used when the CRC32 instruction is missing. *
+**************************************************************/
+static size_t hash_bytes_portable(const unsigned char* bytes, size_t length)
+{
+    uint64_t hash = (uint64_t) length * HASH_MULTIPLIER;
+    size_t remaining = length;
+    
+    while (remaining >= 8)
+    {
+        hash = (rotate_left(hash, 5) ^ load_word(bytes)) * HASH_MULTIPLIER;
+        bytes     += 8;
+        remaining -= 8;
+    }
+    
+    hash = (rotate_left(hash, 5) ^ load_tail(bytes, remaining)) *
+           HASH_MULTIPLIER;
+    
+    return finish_hash(hash);
+}
+
+#ifdef BIDIRECTIONAL_HASH_MAP_X86_64
+
+/******************************************************************
+* Hashes sixteen bytes per step with two CRC32-C lanes. The lanes *
+* do not depend on each other, so the processor overlaps them.    *
+******************************************************************/
+__attribute__((target("sse4.2")))
+static size_t hash_bytes_crc32(const unsigned char* bytes, size_t length)
+{
+    uint64_t lane1 = 0;
+    uint64_t lane2 = (uint64_t) length;
+    size_t remaining = length;
+    
+    while (remaining >= 16)
+    {
+        lane1 = _mm_crc32_u64(lane1, load_word(bytes));
+        lane2 = _mm_crc32_u64(lane2, load_word(bytes + 8));
+        bytes     += 16;
+        remaining -= 16;
+    }
+    
+    if (remaining >= 8)
+    {
+        lane1 = _mm_crc32_u64(lane1, load_word(bytes));
+        bytes     += 8;
+        remaining -= 8;
+    }
+    
+    lane2 = _mm_crc32_u64(lane2, load_tail(bytes, remaining));
+    return finish_hash((lane1 << 32) | lane2);
+}
+
+#endif /* BIDIRECTIONAL_HASH_MAP_X86_64 */
+
+size_t bidirectional_hash_map_hash_bytes(const void* data, size_t length)
+{
+#ifdef BIDIRECTIONAL_HASH_MAP_X86_64
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return hash_bytes_crc32((const unsigned char*) data, length);
+    }
+#endif
+    
+    return hash_bytes_portable((const unsigned char*) data, length);
+}
+
+size_t bidirectional_hash_map_integer_hasher(void* key)
+{
+    return bidirectional_hash_map_mix_hash((size_t)(uintptr_t) key);
+}
+
+int bidirectional_hash_map_integer_equality(void* key1, void* key2)
+{
+    return key1 == key2;
+}
+
+size_t bidirectional_hash_map_string_hasher(void* key)
+{
+    return bidirectional_hash_map_hash_bytes(key, strlen((const char*) key));
+}
+
+int bidirectional_hash_map_string_equality(void* key1, void* key2)
+{
+    const char* string1 = (const char*) key1;
+    const char* string2 = (const char*) key2;
+    
+    if (string1 == string2)
+    {
+        return 1;
+    }
+    
+    if (*string1 != *string2)
+    {
+        return 0;
+    }
+    
+    return strcmp(string1, string2) == 0;
+}
+
+size_t bidirectional_hash_map_string_size(void* key)
+{
+    return strlen((const char*) key) + 1;
+}
+
+size_t bidirectional_hash_map_buffer_hasher(void* key)
+{
+    return bidirectional_hash_map_hash_bytes((const size_t*) key + 1,
+                                             *(const size_t*) key);
+}
+
+int bidirectional_hash_map_buffer_equality(void* key1, void* key2)
+{
+    size_t length = *(const size_t*) key1;
+    
+    if (length != *(const size_t*) key2)
+    {
+        return 0;
+    }
+    
+    return memcmp((const size_t*) key1 + 1,
+                  (const size_t*) key2 + 1,
+                  length) == 0;
+}
+
+size_t bidirectional_hash_map_buffer_size(void* key)
+{
+    return sizeof(size_t) + *(const size_t*) key;
+}
+
+size_t bidirectional_hash_map_uuid_hasher(void* key)
+{
+    const unsigned char* bytes = (const unsigned char*) key;
+    
+    return finish_hash(load_word(bytes) * HASH_MULTIPLIER ^
+                       rotate_left(load_word(bytes + 8), 32));
+}
+
+int bidirectional_hash_map_uuid_equality(void* key1, void* key2)
+{
+    return memcmp(key1, key2, UUID_SIZE) == 0;
+}
+
+size_t bidirectional_hash_map_uuid_size(void* key)
+{
+    (void) key;
+    return UUID_SIZE;
+}
@@ -0,0 +1,136 @@
+#ifndef BIDIRECTIONAL_HASH_MAP_KEY_FUNCTIONS_H
+#define BIDIRECTIONAL_HASH_MAP_KEY_FUNCTIONS_H
+
+#include <stdlib.h>
+
+/***************************************************************************
+* Ready-made hashers and equality functions for common key types, to pass  *
+* to the init functions of the maps. The hashers scramble their output, so *
+* the maps need not mix it again. The hashes depend on the processor and   *
+* must not be stored outside the process.                                  *
+***************************************************************************/
+
+/****************************************************************************
+* Hashes a byte string. Where the processor has the SSE4.2 CRC32          | *
+* instruction, two interleaved CRC32-C lanes consume eight bytes each per | *
+* step; elsewhere, a portable multiply-and-rotate loop does. Either way,  | *
+* the result is scrambled with 'bidirectional_hash_map_mix_hash'.         | *
+*-------------------------------------------------------------------------+ *
+* data --- the bytes to hash.                                               *
+* length - the number of bytes to hash.                                     *
+*-------------------+                                                       *
+* RETURNS: the hash.|                                                       *
+****************************************************************************/
+size_t bidirectional_hash_map_hash_bytes(const void* data, size_t length);
+
+/******************************************************
+* Hashes a key that is an integer cast to a pointer.| *
+*---------------------------------------------------+ *
+* key - the integer key.                              *
+*-------------------+                                 *
+* RETURNS: the hash.|                                 *
+******************************************************/
+size_t bidirectional_hash_map_integer_hasher(void* key);
+
+/*************************************************************
+* Compares two keys that are integers cast to pointers.|     *
+*------------------------------------------------------+     *
+* key1 - the first integer key.                              *
+* key2 - the second integer key.                             *
+*----------------------------------------------------------+ *
+* RETURNS: 1 if the keys are the same integer, 0 otherwise.| *
+*************************************************************/
+int bidirectional_hash_map_integer_equality(void* key1, void* key2);
+
+/*****************************************************
+* Hashes a key pointing to a NUL-terminated string.| *
+*--------------------------------------------------+ *
+* key - the string key.                              *
+*-------------------+                                *
+* RETURNS: the hash.|                                *
+*****************************************************/
+size_t bidirectional_hash_map_string_hasher(void* key);
+
+/**************************************************************************
+* Compares two keys pointing to NUL-terminated strings. The strings are | *
+* compared only if they are at different addresses and start with the   | *
+* same byte; the C library compares them with vector instructions.      | *
+*-----------------------------------------------------------------------+ *
+* key1 - the first string key.                                            *
+* key2 - the second string key.                                           *
+*---------------------------------------------------------------+         *
+* RETURNS: 1 if the strings have the same contents, 0 otherwise.|         *
+**************************************************************************/
+int bidirectional_hash_map_string_equality(void* key1, void* key2);
+
+/****************************************************************
+* Measures a key pointing to a NUL-terminated string, for |     *
+* 'bidirectional_hash_map_t_set_inline_keys'.             |     *
+*---------------------------------------------------------+     *
+* key - the string key.                                         *
+*-------------------------------------------------------------+ *
+* RETURNS: the length of the string plus one for its NUL byte.| *
+****************************************************************/
+size_t bidirectional_hash_map_string_size(void* key);
+
+/**************************************************************************
+* Hashes a key pointing to a length-prefixed buffer: a 'size_t' holding | *
+* the number of bytes, immediately followed by the bytes.               | *
+*-----------------------------------------------------------------------+ *
+* key - the buffer key.                                                   *
+*-------------------+                                                     *
+* RETURNS: the hash.|                                                     *
+**************************************************************************/
+size_t bidirectional_hash_map_buffer_hasher(void* key);
+
+/***************************************************************************
+* Compares two keys pointing to length-prefixed buffers. The lengths are | *
+* compared first.                                                        | *
+*------------------------------------------------------------------------+ *
+* key1 - the first buffer key.                                             *
+* key2 - the second buffer key.                                            *
+*---------------------------------------------------------------+          *
+* RETURNS: 1 if the buffers have the same contents, 0 otherwise.|          *
+***************************************************************************/
+int bidirectional_hash_map_buffer_equality(void* key1, void* key2);
+
+/***************************************************************
+* Measures a key pointing to a length-prefixed buffer, for |   *
+* 'bidirectional_hash_map_t_set_inline_keys'.              |   *
+*----------------------------------------------------------+   *
+* key - the buffer key.                                        *
+*------------------------------------------------------------+ *
+* RETURNS: the number of bytes in the buffer plus its prefix.| *
+***************************************************************/
+size_t bidirectional_hash_map_buffer_size(void* key);
+
+/********************************************
+* Hashes a key pointing to a 16-byte UUID.| *
+*-----------------------------------------+ *
+* key - the UUID key.                       *
+*-------------------+                       *
+* RETURNS: the hash.|                       *
+********************************************/
+size_t bidirectional_hash_map_uuid_hasher(void* key);
+
+/***************************************************
+* Compares two keys pointing to 16-byte UUIDs.|    *
+*---------------------------------------------+    *
+* key1 - the first UUID key.                       *
+* key2 - the second UUID key.                      *
+*------------------------------------------------+ *
+* RETURNS: 1 if the UUIDs are equal, 0 otherwise.| *
+***************************************************/
+int bidirectional_hash_map_uuid_equality(void* key1, void* key2);
+
+/***************************************************
+* Measures a key pointing to a 16-byte UUID, for | *
+* 'bidirectional_hash_map_t_set_inline_keys'.    | *
+*------------------------------------------------+ *
+* key - the UUID key.                              *
+*-------------+                                    *
+* RETURNS: 16.|                                    *
+***************************************************/
+size_t bidirectional_hash_map_uuid_size(void* key);
+
+#endif /* BIDIRECTIONAL_HASH_MAP_KEY_FUNCTIONS_H */
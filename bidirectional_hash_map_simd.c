@@ -0,0 +1,115 @@
+#include "bidirectional_hash_map_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BIDIRECTIONAL_HASH_MAP_X86
+#include <immintrin.h>
+#endif
+
+/**********************************************************************
+* Matches 16 control bytes one at a time. Used when no vector unit is *
+* available.                                                          *
+**********************************************************************/
+static void match_group_scalar(const unsigned char* group,
+                               unsigned char tag,
+                               uint32_t* tag_mask,
+                               uint32_t* empty_mask)
+{
+    unsigned i;
+    
+    *tag_mask = 0;
+    *empty_mask = 0;
+    
+    for (i = 0; i < 16; ++i)
+    {
+        if (group[i] == tag)
+        {
+            *tag_mask |= (uint32_t) 1 << i;
+        }
+        else if (group[i] == BIDIRECTIONAL_HASH_MAP_EMPTY_CONTROL_BYTE)
+        {
+            *empty_mask |= (uint32_t) 1 << i;
+        }
+    }
+}
+
+#ifdef BIDIRECTIONAL_HASH_MAP_X86
+
+/***************************************************
+* Matches 16 control bytes with two SSE2 compares. *
+***************************************************/
+__attribute__((target("sse2")))
+static void match_group_sse2(const unsigned char* group,
+                             unsigned char tag,
+                             uint32_t* tag_mask,
+                             uint32_t* empty_mask)
+{
+    __m128i control_bytes = _mm_loadu_si128((const __m128i*) group);
+    
+    *tag_mask = (uint32_t) _mm_movemask_epi8(
+                    _mm_cmpeq_epi8(control_bytes, _mm_set1_epi8((char) tag)));
+    
+    *empty_mask = (uint32_t) _mm_movemask_epi8(
+                    _mm_cmpeq_epi8(control_bytes, _mm_setzero_si128()));
+}
+
+/***************************************************
+* Matches 32 control bytes with two AVX2 compares. *
+***************************************************/
+__attribute__((target("avx2")))
+static void match_group_avx2(const unsigned char* group,
+                             unsigned char tag,
+                             uint32_t* tag_mask,
+                             uint32_t* empty_mask)
+{
+    __m256i control_bytes = _mm256_loadu_si256((const __m256i*) group);
+    
+    *tag_mask = (uint32_t) _mm256_movemask_epi8(
+                    _mm256_cmpeq_epi8(control_bytes,
+                                      _mm256_set1_epi8((char) tag)));
+    
+    *empty_mask = (uint32_t) _mm256_movemask_epi8(
+                    _mm256_cmpeq_epi8(control_bytes,
+                                      _mm256_setzero_si256()));
+}
+
+#endif /* BIDIRECTIONAL_HASH_MAP_X86 */
+
+control_byte_group_matcher_t bidirectional_hash_map_simd_select_matcher(
+                                                        size_t* group_width)
+{
+#ifdef BIDIRECTIONAL_HASH_MAP_X86
+    __builtin_cpu_init();
+    
+    if (__builtin_cpu_supports("avx2"))
+    {
+        *group_width = 32;
+        return match_group_avx2;
+    }
+    
+    if (__builtin_cpu_supports("sse2"))
+    {
+        *group_width = 16;
+        return match_group_sse2;
+    }
+#endif
+    
+    *group_width = 16;
+    return match_group_scalar;
+}
+
+unsigned bidirectional_hash_map_simd_lowest_bit(uint32_t mask)
+{
+#ifdef __GNUC__
+    return (unsigned) __builtin_ctz(mask);
+#else
+    unsigned index = 0;
+    
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        index++;
+    }
+    
+    return index;
+#endif
+}
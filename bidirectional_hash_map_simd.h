@@ -0,0 +1,51 @@
+#ifndef BIDIRECTIONAL_HASH_MAP_SIMD_H
+#define BIDIRECTIONAL_HASH_MAP_SIMD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**************************************************************************
+* The largest number of control bytes a group matcher inspects at a time. *
+* Control byte arrays must have this many readable bytes past their end.  *
+**************************************************************************/
+#define BIDIRECTIONAL_HASH_MAP_MAXIMUM_GROUP_WIDTH 32
+
+/************************************************************************
+* The control byte denoting an empty slot. Occupied slots have the high *
+* bit of their control byte set.                                        *
+************************************************************************/
+#define BIDIRECTIONAL_HASH_MAP_EMPTY_CONTROL_BYTE 0x00
+
+/**************************************************************************
+* A function comparing a group of control bytes against a tag. Bit 'i' of *
+* '*tag_mask' is set if 'group[i]' equals 'tag', and bit 'i' of           *
+* '*empty_mask' is set if 'group[i]' denotes an empty slot.               *
+**************************************************************************/
+typedef void (*control_byte_group_matcher_t)(const unsigned char* group,
+                                             unsigned char tag,
+                                             uint32_t* tag_mask,
+                                             uint32_t* empty_mask);
+
+/****************************************************************************
+* Selects the fastest group matcher the processor supports. The choice is | *
+* made once; AVX2 is preferred over SSE2, and a portable scalar matcher   | *
+* is used if neither is available.                                        | *
+*-------------------------------------------------------------------------+ *
+* group_width - the location where to store the number of control bytes     *
+*               the matcher inspects at a time.                             *
+*-------------------------------------+                                     *
+* RETURNS: the selected group matcher.|                                     *
+****************************************************************************/
+control_byte_group_matcher_t bidirectional_hash_map_simd_select_matcher(
+                                                        size_t* group_width);
+
+/**************************************************************
+* Returns the index of the lowest set bit of a nonzero mask.| *
+*-----------------------------------------------------------+ *
+* mask - the mask to inspect.                                 *
+*--------------------------------------------+                *
+* RETURNS: the index of the lowest set bit.|                  *
+**************************************************************/
+unsigned bidirectional_hash_map_simd_lowest_bit(uint32_t mask);
+
+#endif /* BIDIRECTIONAL_HASH_MAP_SIMD_H */
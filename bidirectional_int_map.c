@@ -0,0 +1,13 @@
+#include "bidirectional_int_map.h"
+#include "bidirectional_typed_hash_map.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+BIDIRECTIONAL_TYPED_HASH_MAP_IMPL(bidirectional_int_map,
+                                  extern,
+                                  uint64_t,
+                                  uint64_t,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_EQUALITY,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_EQUALITY)
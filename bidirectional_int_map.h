@@ -0,0 +1,165 @@
+#ifndef BIDIRECTIONAL_INT_MAP_H
+#define BIDIRECTIONAL_INT_MAP_H
+
+#include "bidirectional_typed_hash_map.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/*****************************************************************************
+* A bidirectional map of 64-bit integer keys to 64-bit integer keys, such as *
+* the internal IDs of a service to its external ones. It is the typed map of *
+* 'bidirectional_typed_hash_map.h' compiled once for 'uint64_t' keys: the    *
+* keys are stored by value in the mapping array, they are hashed by          *
+* 'BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH', and no function pointer is    *
+* called and no key pair is allocated on any operation. Every key value,     *
+* zero included, is a valid key.                                             *
+*****************************************************************************/
+BIDIRECTIONAL_TYPED_HASH_MAP_TYPE(bidirectional_int_map, uint64_t, uint64_t)
+
+/********************************************************************
+* Builds a new, empty bidirectional integer map.|                   *
+*-----------------------------------------------+                   *
+* map -------------- the map to initialize.                         *
+* initial_capacity - the initial capacity of both the probe arrays. *
+* load_factor ------ the load factor. Clamped to [0.2, 0.9].        *
+*-----------------------------------------------------------+       *
+* RETURNS: 1 if initialization was successfull, 0 otherwise.|       *
+********************************************************************/
+int bidirectional_int_map_t_init(bidirectional_int_map_t* map,
+                                 size_t initial_capacity,
+                                 float load_factor);
+
+/************************************************
+* Releases all the resources of the input map.| *
+*---------------------------------------------+ *
+* map - the map to destroy.                     *
+************************************************/
+void bidirectional_int_map_t_destroy(bidirectional_int_map_t* map);
+
+/****************************************************
+* Returns the number of mappings in the input map.| *
+*-------------------------------------------------+ *
+* map - the map to query.                           *
+*---------------------------------------------+     *
+* RETURNS: the number of mappings in this map.|     *
+****************************************************/
+size_t bidirectional_int_map_t_size(bidirectional_int_map_t* map);
+
+/******************************************************************************
+* Associates the primary key to the secondary key in the input map.|          *
+*------------------------------------------------------------------+          *
+* map ------------------- the map into which to store the pair.               *
+* primary_key ----------- the primary key.                                    *
+* secondary_key --------- the secondary key.                                  *
+* old_secondary_key_ptr - receives the old secondary key of a mapped          *
+*                         primary key unless it is NULL.                      *
+*---------------------------------------------------------------------------+ *
+* RETURNS: BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED if the primary key was     | *
+* mapped, BIDIRECTIONAL_TYPED_HASH_MAP_ADDED if it was not, and             | *
+* BIDIRECTIONAL_TYPED_HASH_MAP_FAILED if there is no memory for the new     | *
+* mapping.                                                                  | *
+******************************************************************************/
+int bidirectional_int_map_t_put_by_primary(bidirectional_int_map_t* map,
+                                           uint64_t primary_key,
+                                           uint64_t secondary_key,
+                                           uint64_t* old_secondary_key_ptr);
+
+/******************************************************************************
+* Associates the secondary key to the primary key in the input map.|          *
+*------------------------------------------------------------------+          *
+* map ----------------- the map into which to store the pair.                 *
+* primary_key --------- the primary key.                                      *
+* secondary_key ------- the secondary key.                                    *
+* old_primary_key_ptr - receives the old primary key of a mapped secondary    *
+*                       key unless it is NULL.                                *
+*---------------------------------------------------------------------------+ *
+* RETURNS: BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED if the secondary key was   | *
+* mapped, BIDIRECTIONAL_TYPED_HASH_MAP_ADDED if it was not, and             | *
+* BIDIRECTIONAL_TYPED_HASH_MAP_FAILED if there is no memory for the new     | *
+* mapping.                                                                  | *
+******************************************************************************/
+int bidirectional_int_map_t_put_by_secondary(bidirectional_int_map_t* map,
+                                             uint64_t primary_key,
+                                             uint64_t secondary_key,
+                                             uint64_t* old_primary_key_ptr);
+
+/********************************************************************
+* Queries the secondary key via its primary key.|                   *
+*-----------------------------------------------+                   *
+* map --------------- the map to query.                             *
+* primary_key ------- the primary key to use.                       *
+* secondary_key_ptr - receives the secondary key unless it is NULL. *
+*----------------------------------------------------------+        *
+* RETURNS: 1 if the primary key is in the map, 0 otherwise.|        *
+********************************************************************/
+int bidirectional_int_map_t_get_by_primary_key(bidirectional_int_map_t* map,
+                                               uint64_t primary_key,
+                                               uint64_t* secondary_key_ptr);
+
+/****************************************************************
+* Queries the primary key via its secondary key.|               *
+*-----------------------------------------------+               *
+* map ------------- the map to query.                           *
+* secondary_key --- the secondary key to use.                   *
+* primary_key_ptr - receives the primary key unless it is NULL. *
+*------------------------------------------------------------+  *
+* RETURNS: 1 if the secondary key is in the map, 0 otherwise.|  *
+****************************************************************/
+int bidirectional_int_map_t_get_by_secondary_key(bidirectional_int_map_t* map,
+                                                 uint64_t secondary_key,
+                                                 uint64_t* primary_key_ptr);
+
+/********************************************************************
+* Queries whether the map contains 'primary_key' as a primary key.| *
+*-----------------------------------------------------------------+ *
+* map --------- the map to query.                                   *
+* primary_key - the primary key to query.                           *
+*----------------------------------------------------------+        *
+* RETURNS: 1 if the primary key is in the map, 0 otherwise.|        *
+********************************************************************/
+int bidirectional_int_map_t_contains_primary_key(bidirectional_int_map_t* map,
+                                                 uint64_t primary_key);
+
+/************************************************************************
+* Queries whether the map contains 'secondary_key' as a secondary key.| *
+*---------------------------------------------------------------------+ *
+* map ----------- the map to query.                                     *
+* secondary_key - the secondary key to query.                           *
+*------------------------------------------------------------+          *
+* RETURNS: 1 if the secondary key is in the map, 0 otherwise.|          *
+************************************************************************/
+int bidirectional_int_map_t_contains_secondary_key(
+                                                bidirectional_int_map_t* map,
+                                                uint64_t secondary_key);
+
+/************************************************************************
+* Removes a mapping by its primary key.|                                *
+*--------------------------------------+                                *
+* map --------------- the map.                                          *
+* primary_key ------- the primary key.                                  *
+* secondary_key_ptr - receives the secondary key of the removed mapping *
+*                     unless it is NULL.                                *
+*-----------------------------------------------------------+           *
+* RETURNS: 1 if the primary key was in the map, 0 otherwise.|           *
+************************************************************************/
+int bidirectional_int_map_t_remove_by_primary_key(
+                                                bidirectional_int_map_t* map,
+                                                uint64_t primary_key,
+                                                uint64_t* secondary_key_ptr);
+
+/***************************************************************************
+* Removes a mapping by its secondary key.|                                 *
+*----------------------------------------+                                 *
+* map ------------- the map.                                               *
+* secondary_key --- the secondary key.                                     *
+* primary_key_ptr - receives the primary key of the removed mapping unless *
+*                   it is NULL.                                            *
+*-------------------------------------------------------------+            *
+* RETURNS: 1 if the secondary key was in the map, 0 otherwise.|            *
+***************************************************************************/
+int bidirectional_int_map_t_remove_by_secondary_key(
+                                                bidirectional_int_map_t* map,
+                                                uint64_t secondary_key,
+                                                uint64_t* primary_key_ptr);
+
+#endif /* BIDIRECTIONAL_INT_MAP_H */
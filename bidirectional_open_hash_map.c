@@ -0,0 +1,876 @@
+#include "bidirectional_open_hash_map.h"
+#include "bidirectional_hash_map.h"
+#include "bidirectional_hash_map_simd.h"
+#include <stdlib.h>
+#include <string.h>
+
+static float max_float(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+static float min_float(float a, float b)
+{
+    return a < b ? a : b;
+}
+
+static size_t max_size_t(size_t a, size_t b)
+{
+    return a > b ? a : b;
+}
+
+/****************************************************************
+* Returns an integer that is a power of two no less than 'num'. *
+****************************************************************/
+static size_t to_power_of_two(size_t num)
+{
+    size_t ret = 1;
+    
+    while (ret < num)
+    {
+        ret <<= 1;
+    }
+    
+    return  ret;
+}
+
+static const float  MINIMUM_LOAD_FACTOR      = 0.2;
+static const float  MAXIMUM_LOAD_FACTOR      = 0.9;
+static const size_t MINIMUM_INITIAL_CAPACITY =
+    BIDIRECTIONAL_HASH_MAP_MAXIMUM_GROUP_WIDTH;
+
+/****************************************************************************
+* The largest capacity of a probe array. Fingerprints are 32 bits wide, the *
+* lowest 7 of them go to the control byte, and the remaining 25 must        *
+* determine the home slot of a key.                                         *
+****************************************************************************/
+static const size_t MAXIMUM_CAPACITY = ((size_t) 1) << 25;
+
+/************************************************************************
+* Returns the hash of 'key' the map works with. The output of 'hasher'  *
+* is mixed so that the home slot and the tag, taken from disjoint bits, *
+* both depend on the whole key; identity-hashed integers would give all *
+* the keys the same tag otherwise.                                      *
+************************************************************************/
+static size_t hash_key(size_t (*hasher)(void*), void* key)
+{
+    return bidirectional_hash_map_mix_hash(hasher(key));
+}
+
+/*********************************************************
+* Returns the fingerprint of a key with the hash 'hash'. *
+*********************************************************/
+static uint32_t fingerprint_of(size_t hash)
+{
+    return (uint32_t) hash;
+}
+
+/************************************************************************
+* Returns the control byte of a key with the fingerprint 'fingerprint': *
+* the high bit marks the slot occupied and the remaining 7 bits are the *
+* lowest bits of the fingerprint.                                       *
+************************************************************************/
+static unsigned char control_byte_of(uint32_t fingerprint)
+{
+    return (unsigned char)(0x80 | (fingerprint & 0x7F));
+}
+
+/*********************************************************************
+* Returns the home slot of a key with the fingerprint 'fingerprint'. *
+* It is taken from the bits above the tag, so the tag does not       *
+* repeat what the home slot already says about the key.              *
+*********************************************************************/
+static size_t home_slot_of(bidirectional_open_hash_map_t* map,
+                           uint32_t fingerprint)
+{
+    return (fingerprint >> 7) & map->modulo_mask;
+}
+
+/***************************************************************************
+* Returns the control bytes of the probe array 'table'. They are stored    *
+* right after the slots, followed by a copy of the first                   *
+* BIDIRECTIONAL_HASH_MAP_MAXIMUM_GROUP_WIDTH control bytes so that a group *
+* starting at any slot can be loaded without wrapping around.              *
+***************************************************************************/
+static unsigned char* control_bytes_of(bidirectional_open_hash_map_t* map,
+                                       open_hash_map_slot_t* table)
+{
+    return (unsigned char*)(table + map->capacity);
+}
+
+/*******************************************************************
+* Stores 'slot' at 'slot_index' of 'table' and updates its control *
+* byte along with the mirrored copy of the control byte.           *
+*******************************************************************/
+static void set_slot(bidirectional_open_hash_map_t* map,
+                     open_hash_map_slot_t* table,
+                     size_t slot_index,
+                     open_hash_map_slot_t slot)
+{
+    unsigned char* control_bytes = control_bytes_of(map, table);
+    unsigned char control_byte =
+    slot.mapping_index == OPEN_HASH_MAP_EMPTY_SLOT ?
+    BIDIRECTIONAL_HASH_MAP_EMPTY_CONTROL_BYTE :
+    control_byte_of(slot.fingerprint);
+    
+    table[slot_index] = slot;
+    control_bytes[slot_index] = control_byte;
+    
+    if (slot_index < BIDIRECTIONAL_HASH_MAP_MAXIMUM_GROUP_WIDTH)
+    {
+        control_bytes[map->capacity + slot_index] = control_byte;
+    }
+}
+
+/**************************************************************************
+* Returns the distance between the slot 'slot_index' and the home slot of *
+* the key whose fingerprint is 'fingerprint'.                             *
+**************************************************************************/
+static size_t probe_distance(bidirectional_open_hash_map_t* map,
+                             uint32_t fingerprint,
+                             size_t slot_index)
+{
+    return (slot_index - home_slot_of(map, fingerprint)) & map->modulo_mask;
+}
+
+/**************************************************************************
+* Inserts the slot 'slot' into the probe array 'table' using Robin Hood   *
+* hashing: an incoming slot takes the place of any resident slot that is  *
+* closer to its home slot, and the displaced slot continues probing.      *
+**************************************************************************/
+static void insert_slot(bidirectional_open_hash_map_t* map,
+                        open_hash_map_slot_t* table,
+                        open_hash_map_slot_t slot)
+{
+    open_hash_map_slot_t displaced_slot;
+    size_t slot_index = home_slot_of(map, slot.fingerprint);
+    size_t distance = 0;
+    size_t resident_distance;
+    
+    for (;;)
+    {
+        if (table[slot_index].mapping_index == OPEN_HASH_MAP_EMPTY_SLOT)
+        {
+            set_slot(map, table, slot_index, slot);
+            return;
+        }
+        
+        resident_distance = probe_distance(map,
+                                           table[slot_index].fingerprint,
+                                           slot_index);
+        
+        if (resident_distance < distance)
+        {
+            displaced_slot    = table[slot_index];
+            set_slot(map, table, slot_index, slot);
+            slot              = displaced_slot;
+            distance          = resident_distance;
+        }
+        
+        slot_index = (slot_index + 1) & map->modulo_mask;
+        distance++;
+    }
+}
+
+/***************************************************************************
+* Removes the slot at 'slot_index' from the probe array 'table'. The slots *
+* following it are shifted one position backwards until an empty slot or   *
+* a slot residing in its home slot is met, so no tombstones are needed.    *
+***************************************************************************/
+static void delete_slot(bidirectional_open_hash_map_t* map,
+                        open_hash_map_slot_t* table,
+                        size_t slot_index)
+{
+    size_t next_slot_index = (slot_index + 1) & map->modulo_mask;
+    open_hash_map_slot_t empty_slot;
+    
+    while (table[next_slot_index].mapping_index != OPEN_HASH_MAP_EMPTY_SLOT &&
+           probe_distance(map,
+                          table[next_slot_index].fingerprint,
+                          next_slot_index) > 0)
+    {
+        set_slot(map, table, slot_index, table[next_slot_index]);
+        slot_index = next_slot_index;
+        next_slot_index = (next_slot_index + 1) & map->modulo_mask;
+    }
+    
+    empty_slot.fingerprint = 0;
+    empty_slot.mapping_index = OPEN_HASH_MAP_EMPTY_SLOT;
+    set_slot(map, table, slot_index, empty_slot);
+}
+
+/*****************************************************************************
+* Returns the index of the slot in 'table' referring to the mapping with the *
+* index 'mapping_index' and the key hash 'hash'. The mapping must be in the  *
+* table. Since slots are matched by mapping index, no key comparisons are    *
+* done.                                                                      *
+*****************************************************************************/
+static size_t find_slot_of_mapping(bidirectional_open_hash_map_t* map,
+                                   open_hash_map_slot_t* table,
+                                   size_t hash,
+                                   size_t mapping_index)
+{
+    size_t slot_index = home_slot_of(map, fingerprint_of(hash));
+    
+    while (table[slot_index].mapping_index != mapping_index)
+    {
+        slot_index = (slot_index + 1) & map->modulo_mask;
+    }
+    
+    return slot_index;
+}
+
+/*******************************************************************************
+* Returns the index of the slot in the primary probe array holding             *
+* 'primary_key', or the capacity of the map if there is no such slot. The      *
+* control bytes are scanned a group at a time, and only the slots whose tag    *
+* matches and that precede the first empty slot are compared with the key.     *
+*******************************************************************************/
+static size_t find_primary_slot(bidirectional_open_hash_map_t* map,
+                                void* primary_key)
+{
+    size_t primary_key_hash = hash_key(map->primary_key_hasher, primary_key);
+    uint32_t fingerprint = fingerprint_of(primary_key_hash);
+    unsigned char tag = control_byte_of(fingerprint);
+    unsigned char* control_bytes =
+    control_bytes_of(map, map->primary_key_table);
+    size_t group_index = home_slot_of(map, fingerprint);
+    size_t slot_index;
+    uint32_t tag_mask;
+    uint32_t empty_mask;
+    open_hash_map_slot_t* slot;
+    
+#ifdef __GNUC__
+    /***************************************************************
+    * Fetch the first slot while the control bytes are matched, so *
+    * that a hit does not wait for two cache misses in a row.      *
+    ***************************************************************/
+    __builtin_prefetch(&map->primary_key_table[group_index]);
+#endif
+    
+    for (;;)
+    {
+        map->match_group(&control_bytes[group_index],
+                         tag,
+                         &tag_mask,
+                         &empty_mask);
+        
+        if (empty_mask)
+        {
+            /***************************************************
+            * Only the slots before the first empty one belong *
+            * to the probe sequence of the key.                *
+            ***************************************************/
+            tag_mask &= (empty_mask & (~empty_mask + 1)) - 1;
+        }
+        
+        while (tag_mask)
+        {
+            slot_index = (group_index +
+                          bidirectional_hash_map_simd_lowest_bit(tag_mask))
+                       & map->modulo_mask;
+            
+            slot = &map->primary_key_table[slot_index];
+            
+            if (slot->fingerprint == fingerprint &&
+                map->primary_key_equality(
+                            primary_key,
+                            map->mappings[slot->mapping_index].primary_key))
+            {
+                return slot_index;
+            }
+            
+            tag_mask &= tag_mask - 1;
+        }
+        
+        if (empty_mask)
+        {
+            return map->capacity;
+        }
+        
+        group_index = (group_index + map->group_width) & map->modulo_mask;
+    }
+}
+
+/*******************************************************************************
+* Returns the index of the slot in the secondary probe array holding           *
+* 'secondary_key', or the capacity of the map if there is no such slot. Works  *
+* like find_primary_slot().                                                    *
+*******************************************************************************/
+static size_t find_secondary_slot(bidirectional_open_hash_map_t* map,
+                                  void* secondary_key)
+{
+    size_t secondary_key_hash = hash_key(map->secondary_key_hasher,
+                                         secondary_key);
+    uint32_t fingerprint = fingerprint_of(secondary_key_hash);
+    unsigned char tag = control_byte_of(fingerprint);
+    unsigned char* control_bytes =
+    control_bytes_of(map, map->secondary_key_table);
+    size_t group_index = home_slot_of(map, fingerprint);
+    size_t slot_index;
+    uint32_t tag_mask;
+    uint32_t empty_mask;
+    open_hash_map_slot_t* slot;
+    
+#ifdef __GNUC__
+    /***************************************************************
+    * Fetch the first slot while the control bytes are matched, so *
+    * that a hit does not wait for two cache misses in a row.      *
+    ***************************************************************/
+    __builtin_prefetch(&map->secondary_key_table[group_index]);
+#endif
+    
+    for (;;)
+    {
+        map->match_group(&control_bytes[group_index],
+                         tag,
+                         &tag_mask,
+                         &empty_mask);
+        
+        if (empty_mask)
+        {
+            tag_mask &= (empty_mask & (~empty_mask + 1)) - 1;
+        }
+        
+        while (tag_mask)
+        {
+            slot_index = (group_index +
+                          bidirectional_hash_map_simd_lowest_bit(tag_mask))
+                       & map->modulo_mask;
+            
+            slot = &map->secondary_key_table[slot_index];
+            
+            if (slot->fingerprint == fingerprint &&
+                map->secondary_key_equality(
+                            secondary_key,
+                            map->mappings[slot->mapping_index].secondary_key))
+            {
+                return slot_index;
+            }
+            
+            tag_mask &= tag_mask - 1;
+        }
+        
+        if (empty_mask)
+        {
+            return map->capacity;
+        }
+        
+        group_index = (group_index + map->group_width) & map->modulo_mask;
+    }
+}
+
+/***************************************************************************
+* Allocates a probe array of 'capacity' empty slots along with its control *
+* bytes. Returns NULL if there is no memory.                               *
+***************************************************************************/
+static open_hash_map_slot_t* allocate_table(size_t capacity)
+{
+    size_t i;
+    open_hash_map_slot_t* table =
+    malloc(capacity * sizeof(*table) +
+           capacity +
+           BIDIRECTIONAL_HASH_MAP_MAXIMUM_GROUP_WIDTH);
+    
+    if (!table)
+    {
+        return NULL;
+    }
+    
+    for (i = 0; i < capacity; ++i)
+    {
+        table[i].mapping_index = OPEN_HASH_MAP_EMPTY_SLOT;
+    }
+    
+    memset(table + capacity,
+           BIDIRECTIONAL_HASH_MAP_EMPTY_CONTROL_BYTE,
+           capacity + BIDIRECTIONAL_HASH_MAP_MAXIMUM_GROUP_WIDTH);
+    
+    return table;
+}
+
+int bidirectional_open_hash_map_t_init(
+                                bidirectional_open_hash_map_t* map,
+                                size_t initial_capacity,
+                                float load_factor,
+                                size_t (*primary_key_hasher)  (void*),
+                                size_t (*secondary_key_hasher)(void*),
+                                int (*primary_key_equality)   (void*, void*),
+                                int (*secondary_key_equality) (void*, void*),
+                                void* error_sentinel)
+{
+    if (!map)
+    {
+        return 0;
+    }
+    
+    if (!primary_key_hasher ||
+        !secondary_key_hasher ||
+        !primary_key_equality ||
+        !secondary_key_equality)
+    {
+        return 0;
+    }
+    
+    load_factor      = max_float(load_factor, MINIMUM_LOAD_FACTOR);
+    load_factor      = min_float(load_factor, MAXIMUM_LOAD_FACTOR);
+    initial_capacity = max_size_t(initial_capacity, MINIMUM_INITIAL_CAPACITY);
+    initial_capacity = to_power_of_two(initial_capacity);
+    
+    map->primary_key_table   = NULL;
+    map->secondary_key_table = NULL;
+    map->mappings            = NULL;
+    map->mappings_capacity   = 0;
+    map->capacity            = initial_capacity;
+    map->load_factor         = load_factor;
+    map->size                = 0;
+    
+    if (initial_capacity > MAXIMUM_CAPACITY)
+    {
+        return 0;
+    }
+    
+    map->primary_key_table = allocate_table(initial_capacity);
+    
+    if (!map->primary_key_table)
+    {
+        return 0;
+    }
+    
+    map->secondary_key_table = allocate_table(initial_capacity);
+    
+    if (!map->secondary_key_table)
+    {
+        free(map->primary_key_table);
+        map->primary_key_table = NULL;
+        return 0;
+    }
+    
+    map->modulo_mask            = map->capacity - 1;
+    map->primary_key_hasher     = primary_key_hasher;
+    map->secondary_key_hasher   = secondary_key_hasher;
+    map->primary_key_equality   = primary_key_equality;
+    map->secondary_key_equality = secondary_key_equality;
+    map->error_sentinel         = error_sentinel;
+    map->match_group            =
+    bidirectional_hash_map_simd_select_matcher(&map->group_width);
+    
+    return 1;
+}
+
+void bidirectional_open_hash_map_t_destroy(bidirectional_open_hash_map_t* map)
+{
+    if (!map || !map->primary_key_table)
+    {
+        return;
+    }
+    
+    free(map->primary_key_table);
+    free(map->secondary_key_table);
+    free(map->mappings);
+    
+    map->primary_key_table   = NULL;
+    map->secondary_key_table = NULL;
+    map->mappings            = NULL;
+    map->mappings_capacity   = 0;
+    map->capacity            = 0;
+    map->size                = 0;
+}
+
+int bidirectional_open_hash_map_t_is_working(bidirectional_open_hash_map_t* map)
+{
+    return map->primary_key_table ? 1 : 0;
+}
+
+size_t bidirectional_open_hash_map_t_size(bidirectional_open_hash_map_t* map)
+{
+    return map->size;
+}
+
+size_t bidirectional_open_hash_map_t_capacity(bidirectional_open_hash_map_t* map)
+{
+    return map->capacity;
+}
+
+/****************************************************************************
+* This function is responsible for allocating larger probe arrays and       *
+* reinserting all the mappings into them. Since the key hashes are cached   *
+* in the key pairs, no hashing or key comparison takes place.               *
+****************************************************************************/
+static int expand_hash_map(bidirectional_open_hash_map_t* map)
+{
+    size_t i;
+    size_t next_capacity = map->capacity << 1;
+    open_hash_map_slot_t slot;
+    open_hash_map_slot_t* next_primary_key_table;
+    open_hash_map_slot_t* next_secondary_key_table;
+    
+    if (next_capacity > MAXIMUM_CAPACITY)
+    {
+        return 0;
+    }
+    
+    next_primary_key_table = allocate_table(next_capacity);
+    
+    if (!next_primary_key_table)
+    {
+        return 0;
+    }
+    
+    next_secondary_key_table = allocate_table(next_capacity);
+    
+    if (!next_secondary_key_table)
+    {
+        free(next_primary_key_table);
+        return 0;
+    }
+    
+    free(map->primary_key_table);
+    free(map->secondary_key_table);
+    
+    map->primary_key_table   = next_primary_key_table;
+    map->secondary_key_table = next_secondary_key_table;
+    map->capacity            = next_capacity;
+    map->modulo_mask         = next_capacity - 1;
+    
+    for (i = 0; i < map->size; ++i)
+    {
+        slot.mapping_index = (uint32_t) i;
+        
+        slot.fingerprint = fingerprint_of(map->mappings[i].primary_key_hash);
+        insert_slot(map, map->primary_key_table, slot);
+        
+        slot.fingerprint = fingerprint_of(map->mappings[i].secondary_key_hash);
+        insert_slot(map, map->secondary_key_table, slot);
+    }
+    
+    return 1;
+}
+
+/*******************************************************************************
+* Adds a new mapping to the map. A mapping (primary_key, secondary_key) is     *
+* "new" if primary_key is not mapped to anything and secondary is not mapped   *
+* to anything as well. This function also increments the 'size' of the map.    *
+*******************************************************************************/
+static int add_new_mapping(bidirectional_open_hash_map_t* map,
+                           void* primary_key,
+                           void* secondary_key)
+{
+    key_pair_t* key_pair;
+    key_pair_t* next_mappings;
+    size_t next_mappings_capacity;
+    open_hash_map_slot_t slot;
+    
+    if (map->size + 1 > map->capacity * map->load_factor)
+    {
+        if (!expand_hash_map(map))
+        {
+            return 0;
+        }
+    }
+    
+    if (map->size == map->mappings_capacity)
+    {
+        next_mappings_capacity = max_size_t(map->mappings_capacity << 1,
+                                            MINIMUM_INITIAL_CAPACITY);
+        
+        next_mappings = realloc(map->mappings,
+                                next_mappings_capacity * sizeof(key_pair_t));
+        
+        if (!next_mappings)
+        {
+            return 0;
+        }
+        
+        map->mappings          = next_mappings;
+        map->mappings_capacity = next_mappings_capacity;
+    }
+    
+    key_pair = &map->mappings[map->size];
+    key_pair->primary_key = primary_key;
+    key_pair->primary_key_hash = hash_key(map->primary_key_hasher, primary_key);
+    key_pair->secondary_key = secondary_key;
+    key_pair->secondary_key_hash = hash_key(map->secondary_key_hasher,
+                                            secondary_key);
+    
+    slot.mapping_index = (uint32_t) map->size;
+    
+    slot.fingerprint = fingerprint_of(key_pair->primary_key_hash);
+    insert_slot(map, map->primary_key_table, slot);
+    
+    slot.fingerprint = fingerprint_of(key_pair->secondary_key_hash);
+    insert_slot(map, map->secondary_key_table, slot);
+    
+    map->size++;
+    return 1;
+}
+
+/******************************************************************************
+* Removes the mapping with the index 'mapping_index' whose primary slot is at *
+* 'primary_slot_index' and whose secondary slot is at 'secondary_slot_index'. *
+* The last mapping of the dense mapping array is moved to the vacated index,  *
+* and its two slots are redirected. This function also decrements the 'size'  *
+* of the map.                                                                 *
+******************************************************************************/
+static void remove_mapping(bidirectional_open_hash_map_t* map,
+                           size_t mapping_index,
+                           size_t primary_slot_index,
+                           size_t secondary_slot_index)
+{
+    size_t last_mapping_index = map->size - 1;
+    key_pair_t* last_key_pair;
+    
+    delete_slot(map, map->primary_key_table, primary_slot_index);
+    delete_slot(map, map->secondary_key_table, secondary_slot_index);
+    
+    if (mapping_index != last_mapping_index)
+    {
+        last_key_pair = &map->mappings[last_mapping_index];
+        
+        map->primary_key_table[
+            find_slot_of_mapping(map,
+                                 map->primary_key_table,
+                                 last_key_pair->primary_key_hash,
+                                 last_mapping_index)].mapping_index =
+        (uint32_t) mapping_index;
+        
+        map->secondary_key_table[
+            find_slot_of_mapping(map,
+                                 map->secondary_key_table,
+                                 last_key_pair->secondary_key_hash,
+                                 last_mapping_index)].mapping_index =
+        (uint32_t) mapping_index;
+        
+        map->mappings[mapping_index] = *last_key_pair;
+    }
+    
+    map->size--;
+}
+
+void* bidirectional_open_hash_map_t_put_by_primary(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* primary_key,
+                                        void* secondary_key)
+{
+    size_t primary_slot_index = find_primary_slot(map, primary_key);
+    size_t secondary_slot_index;
+    key_pair_t* key_pair;
+    void* old_secondary_key;
+    open_hash_map_slot_t slot;
+    
+    if (primary_slot_index == map->capacity)
+    {
+        return add_new_mapping(map, primary_key, secondary_key) ?
+               NULL :
+               map->error_sentinel;
+    }
+    
+    /********************************************************************
+    * Move the secondary slot of the mapping to its new position in the *
+    * secondary probe array:                                            *
+    ********************************************************************/
+    slot.mapping_index = map->primary_key_table[primary_slot_index]
+                            .mapping_index;
+    key_pair = &map->mappings[slot.mapping_index];
+    old_secondary_key = key_pair->secondary_key;
+    
+    secondary_slot_index = find_slot_of_mapping(map,
+                                                map->secondary_key_table,
+                                                key_pair->secondary_key_hash,
+                                                slot.mapping_index);
+    
+    delete_slot(map, map->secondary_key_table, secondary_slot_index);
+    
+    key_pair->secondary_key = secondary_key;
+    key_pair->secondary_key_hash = hash_key(map->secondary_key_hasher,
+                                            secondary_key);
+    
+    slot.fingerprint = fingerprint_of(key_pair->secondary_key_hash);
+    insert_slot(map, map->secondary_key_table, slot);
+    
+    return old_secondary_key;
+}
+
+void* bidirectional_open_hash_map_t_put_by_secondary(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* primary_key,
+                                        void* secondary_key)
+{
+    size_t secondary_slot_index = find_secondary_slot(map, secondary_key);
+    size_t primary_slot_index;
+    key_pair_t* key_pair;
+    void* old_primary_key;
+    open_hash_map_slot_t slot;
+    
+    if (secondary_slot_index == map->capacity)
+    {
+        return add_new_mapping(map, primary_key, secondary_key) ?
+               NULL :
+               map->error_sentinel;
+    }
+    
+    /******************************************************************
+    * Move the primary slot of the mapping to its new position in the *
+    * primary probe array:                                            *
+    ******************************************************************/
+    slot.mapping_index = map->secondary_key_table[secondary_slot_index]
+                            .mapping_index;
+    key_pair = &map->mappings[slot.mapping_index];
+    old_primary_key = key_pair->primary_key;
+    
+    primary_slot_index = find_slot_of_mapping(map,
+                                              map->primary_key_table,
+                                              key_pair->primary_key_hash,
+                                              slot.mapping_index);
+    
+    delete_slot(map, map->primary_key_table, primary_slot_index);
+    
+    key_pair->primary_key = primary_key;
+    key_pair->primary_key_hash = hash_key(map->primary_key_hasher, primary_key);
+    
+    slot.fingerprint = fingerprint_of(key_pair->primary_key_hash);
+    insert_slot(map, map->primary_key_table, slot);
+    
+    return old_primary_key;
+}
+
+void* bidirectional_open_hash_map_t_remove_by_primary_key(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* primary_key)
+{
+    size_t primary_slot_index = find_primary_slot(map, primary_key);
+    size_t mapping_index;
+    void* secondary_key;
+    
+    if (primary_slot_index == map->capacity)
+    {
+        return NULL;
+    }
+    
+    mapping_index = map->primary_key_table[primary_slot_index].mapping_index;
+    secondary_key = map->mappings[mapping_index].secondary_key;
+    
+    remove_mapping(map,
+                   mapping_index,
+                   primary_slot_index,
+                   find_slot_of_mapping(
+                            map,
+                            map->secondary_key_table,
+                            map->mappings[mapping_index].secondary_key_hash,
+                            mapping_index));
+    
+    return secondary_key;
+}
+
+void* bidirectional_open_hash_map_t_remove_by_secondary_key(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* secondary_key)
+{
+    size_t secondary_slot_index = find_secondary_slot(map, secondary_key);
+    size_t mapping_index;
+    void* primary_key;
+    
+    if (secondary_slot_index == map->capacity)
+    {
+        return NULL;
+    }
+    
+    mapping_index =
+    map->secondary_key_table[secondary_slot_index].mapping_index;
+    primary_key = map->mappings[mapping_index].primary_key;
+    
+    remove_mapping(map,
+                   mapping_index,
+                   find_slot_of_mapping(
+                            map,
+                            map->primary_key_table,
+                            map->mappings[mapping_index].primary_key_hash,
+                            mapping_index),
+                   secondary_slot_index);
+    
+    return primary_key;
+}
+
+void* bidirectional_open_hash_map_t_get_by_primary_key(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* primary_key)
+{
+    size_t primary_slot_index = find_primary_slot(map, primary_key);
+    
+    if (primary_slot_index == map->capacity)
+    {
+        return NULL;
+    }
+    
+    return map->mappings[map->primary_key_table[primary_slot_index]
+                            .mapping_index].secondary_key;
+}
+
+void* bidirectional_open_hash_map_t_get_by_secondary_key(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* secondary_key)
+{
+    size_t secondary_slot_index = find_secondary_slot(map, secondary_key);
+    
+    if (secondary_slot_index == map->capacity)
+    {
+        return NULL;
+    }
+    
+    return map->mappings[map->secondary_key_table[secondary_slot_index]
+                            .mapping_index].primary_key;
+}
+
+int bidirectional_open_hash_map_t_contains_primary_key(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* primary_key)
+{
+    return find_primary_slot(map, primary_key) != map->capacity ? 1 : 0;
+}
+
+int bidirectional_open_hash_map_t_contains_secondary_key(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* secondary_key)
+{
+    return find_secondary_slot(map, secondary_key) != map->capacity ? 1 : 0;
+}
+
+int bidirectional_open_hash_map_iterator_t_init(
+                            bidirectional_open_hash_map_t* map,
+                            bidirectional_open_hash_map_iterator_t* iterator)
+{
+    if (!map)
+    {
+        return 0;
+    }
+    
+    iterator->map = map;
+    iterator->iterated = 0;
+    iterator->map_size = map->size;
+    
+    return 1;
+}
+
+int bidirectional_open_hash_map_iterator_t_has_next(
+                            bidirectional_open_hash_map_iterator_t* iterator)
+{
+    return iterator->iterated < iterator->map_size;
+}
+
+int bidirectional_open_hash_map_iterator_t_next(
+                            bidirectional_open_hash_map_iterator_t* iterator,
+                            void** primary_key_ptr,
+                            void** secondary_key_ptr)
+{
+    key_pair_t* key_pair;
+    
+    if (iterator->iterated >= iterator->map_size)
+    {
+        return 0;
+    }
+    
+    key_pair = &iterator->map->mappings[iterator->iterated++];
+    *primary_key_ptr = key_pair->primary_key;
+    *secondary_key_ptr = key_pair->secondary_key;
+    return 1;
+}
@@ -0,0 +1,351 @@
+#ifndef BIDIRECTIONAL_OPEN_HASH_MAP_H
+#define BIDIRECTIONAL_OPEN_HASH_MAP_H
+
+#include "bidirectional_hash_map_simd.h"
+#include "key_pair.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/*****************************************************************************
+* A slot of a probe array. Both the probe arrays store the fingerprint and   *
+* the mapping index inline so that most of the non-matching slots are        *
+* rejected without touching the key pairs.                                   *
+*****************************************************************************/
+typedef struct open_hash_map_slot_t {
+    
+    /***********************************************************************
+    * The lowest 32 bits of the mixed hash of the key stored in this slot. *
+    * The lowest 7 of them make up the tag in the control byte. Since the  *
+    * capacity never exceeds 2^25, the bits above the tag also determine   *
+    * the home slot of the key.                                            *
+    ***********************************************************************/
+    uint32_t fingerprint;
+    
+    /*********************************************************
+    * The index of the key pair in the mapping array, or     *
+    * OPEN_HASH_MAP_EMPTY_SLOT if this slot is not occupied. *
+    *********************************************************/
+    uint32_t mapping_index;
+}
+open_hash_map_slot_t;
+
+/********************************************************
+* The mapping index denoting a slot that is not in use. *
+********************************************************/
+#define OPEN_HASH_MAP_EMPTY_SLOT ((uint32_t) 0xFFFFFFFFUL)
+
+typedef struct bidirectional_open_hash_map_t {
+    
+    /**********************************
+    * Caches the number of key pairs. *
+    **********************************/
+    size_t size;
+    
+    /**********************************************
+    * Holds the capacity of the two probe arrays. *
+    **********************************************/
+    size_t capacity;
+    
+    /*************************
+    * Stores the load factor *
+    *************************/
+    float  load_factor;
+    
+    /***************************************
+    * The mask used for simulating modulo. *
+    ***************************************/
+    size_t modulo_mask;
+    
+    /**********************************************************************
+    * The dense array of all key pairs. The probe arrays refer to the key *
+    * pairs by their index into this array.                               *
+    **********************************************************************/
+    key_pair_t* mappings;
+    
+    /********************************************
+    * The number of key pairs 'mappings' holds. *
+    ********************************************/
+    size_t mappings_capacity;
+    
+    /*************************************************************
+    * The primary probe array. Its control bytes follow the last *
+    * slot in the same memory block.                             *
+    *************************************************************/
+    open_hash_map_slot_t* primary_key_table;
+    
+    /***************************************************************
+    * The secondary probe array. Its control bytes follow the last *
+    * slot in the same memory block.                               *
+    ***************************************************************/
+    open_hash_map_slot_t* secondary_key_table;
+    
+    /********************************************************************
+    * The function scanning a group of control bytes for matching tags. *
+    ********************************************************************/
+    control_byte_group_matcher_t match_group;
+    
+    /***************************************************
+    * The number of control bytes 'match_group' scans. *
+    ***************************************************/
+    size_t group_width;
+    
+    /***************************************************************************
+    * The function producing the bucket index in the primary key table given a *
+    * primary key.                                                             *
+    ***************************************************************************/
+    size_t (*primary_key_hasher)(void* primary_key);
+    
+    /***************************************************************************
+    * The function producing the bucket index in the secondary key table given *
+    * a secondary key.                                                         *
+    ***************************************************************************/
+    size_t (*secondary_key_hasher)(void* secondary_key);
+    
+    /*****************************************************
+    * The function for comparing two given primary keys. *
+    *****************************************************/
+    int    (*primary_key_equality)(void* primary_key_1, void* primary_key_2);
+    
+    /*******************************************************
+    * The function for comparing two given secondary keys. *
+    *******************************************************/
+    int    (*secondary_key_equality)(void* secondary_key_1,
+                                     void* secondary_key_2);
+    
+    /*****************************************
+    * A value that is returned upon failure. *
+    *****************************************/
+    void* error_sentinel;
+}
+bidirectional_open_hash_map_t;
+
+typedef struct bidirectional_open_hash_map_iterator_t {
+    
+    /**************************
+    * The map being iterated. *
+    **************************/
+    bidirectional_open_hash_map_t* map;
+    
+    /**************************************
+    * Number of mappings iterated so far. *
+    **************************************/
+    size_t iterated;
+    
+    /**************************************
+    * The size of the map being iterated. *
+    **************************************/
+    size_t map_size;
+}
+bidirectional_open_hash_map_iterator_t;
+
+/****************************************************************************
+* Builds a new, empty bidirectional open addressing hash map.|              *
+*------------------------------------------------------------+              *
+* map -------------------- the map to initialize.                           *
+* initial_capacity ------- the initial capacity of both the probe arrays.   *
+* load_factor ------------ the load factor. Clamped to at most 0.9.         *
+* primary_key_hasher ----- the function for producing primary key hashes.   *
+* secondary_key_hasher --- the function for producing secondary key hashes. *
+* primary_key_equality --- the function for comparing primary keys.         *
+* secondary_key_equality - the function for comparing secondary keys.       *
+* error_sentinel --------- the value returned on failed addition.           *
+*-----------------------------------------------------------+               *
+* RETURNS: 1 if initialization was successfull, 0 otherwise.|               *
+****************************************************************************/
+int bidirectional_open_hash_map_t_init(
+        bidirectional_open_hash_map_t* map,
+        size_t initial_capacity,
+        float load_factor,
+        size_t (*primary_key_hasher)  (void*),
+        size_t (*secondary_key_hasher)(void*),
+        int (*primary_key_equality)   (void*, void*),
+        int (*secondary_key_equality)  (void*, void*),
+        void* error_sentinel);
+
+/************************************************
+* Releases all the resources of the input map.| *
+*---------------------------------------------+ *
+* map - the map to destroy.                     *
+************************************************/
+void bidirectional_open_hash_map_t_destroy(bidirectional_open_hash_map_t* map);
+
+/********************************************************************
+* Checks that the map is well formed and is ready to receive data.| *
+*-----------------------------------------------------------------+ *
+* map - the map to check.                                           *
+*------------------------------------------------+                  *
+* RETURNS: 1 if the map is in order, 0 otherwise.|                  *
+********************************************************************/
+int bidirectional_open_hash_map_t_is_working(
+                                        bidirectional_open_hash_map_t* map);
+
+/*****************************************************
+* Returns the number of key pairs in the input map.| *
+*--------------------------------------------------+ *
+* map - the map to query.                            *
+*----------------------------------------------+     *
+* RETURNS: the number of key pairs in this map.|     *
+*****************************************************/
+size_t bidirectional_open_hash_map_t_size(bidirectional_open_hash_map_t* map);
+
+/*****************************************************************************
+* Returns the capacity of one of the probe arrays (another one has the     | *
+* same capacity).                                                          | *
+*--------------------------------------------------------------------------+ *
+* map - the map to query.                                                    *
+*-------------------------------------------+                                *
+* RETURNS: the capacity of each probe array.|                                *
+*****************************************************************************/
+size_t bidirectional_open_hash_map_t_capacity(
+                                        bidirectional_open_hash_map_t* map);
+
+/******************************************************************************
+* Associates the primary key to the secondary key in the input map.|          *
+*------------------------------------------------------------------+          *
+* map ----------- the map into which to store the pair.                       *
+* primary_key --- the primary key.                                            *
+* secondary_key - the secondary key.                                          *
+*---------------------------------------------------------------------------+ *
+* RETURNS: old secondary key in case the primary key is in the map, NULL if | *
+* the primary key has no mappings yet, and the error sentinel if there is   | *
+* no memory for the new mapping.                                            | *
+******************************************************************************/
+void* bidirectional_open_hash_map_t_put_by_primary(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* primary_key,
+                                        void* secondary_key);
+
+/******************************************************************************
+* Associates the secondary key to the primary key in the input map.|          *
+*------------------------------------------------------------------+          *
+* map ----------- the map into which to store the pair.                       *
+* primary_key --- the primary key.                                            *
+* secondary_key - the secondary key.                                          *
+*---------------------------------------------------------------------------+ *
+* RETURNS: old primary key in case the secondary key is in the map, NULL if | *
+* the secondary key has no mappings yet, and the error sentinel if there is | *
+* no memory for the new mapping.                                            | *
+******************************************************************************/
+void* bidirectional_open_hash_map_t_put_by_secondary(
+                                        bidirectional_open_hash_map_t* map,
+                                        void* primary_key,
+                                        void* secondary_key);
+
+/******************************************************************************
+* Removes a key pair by its primary key.|                                     *
+*---------------------------------------+                                     *
+* map --------- the map.                                                      *
+* primary_key - the primary key.                                              *
+*---------------------------------------------------------------------------+ *
+* RETURNS: NULL if the primary key is not mapped. The current associated    | *
+* secondary key otherwise.                                                  | *
+******************************************************************************/
+void* bidirectional_open_hash_map_t_remove_by_primary_key(
+        bidirectional_open_hash_map_t* map,
+        void* primary_key);
+
+/****************************************************************************
+* Removes a key pair by its secondary key.|                                 *
+*-----------------------------------------+                                 *
+* map ----------- the map.                                                  *
+* secondary_key - the secondary key.                                        *
+*-------------------------------------------------------------------------+ *
+* RETURNS: NULL if the seconary key is not mapped. The current associated | *
+* primary key otherwise.                                                  | *
+****************************************************************************/
+void* bidirectional_open_hash_map_t_remove_by_secondary_key(
+        bidirectional_open_hash_map_t* map,
+        void* secondary_key);
+
+/******************************************************************************
+* Queries the secondary key via its primary key.|                             *
+*-----------------------------------------------+                             *
+* map --------- the map to query.                                             *
+* primary_key - the primary key to use.                                       *
+*---------------------------------------------------------------------------+ *
+* RETURNS: If the primary key is associated with a secondary key, that very | *
+* secondary key is returned. Otherwise, NULL is returned.                   | *
+******************************************************************************/
+void* bidirectional_open_hash_map_t_get_by_primary_key(
+        bidirectional_open_hash_map_t* map,
+        void* primary_key);
+
+/******************************************************************************
+* Queries the primary key via its secondary key.|                             *
+*-----------------------------------------------+                             *
+* map ----------- the map to query.                                           *
+* secondary_key - the secondary key to use.                                   *
+*---------------------------------------------------------------------------+ *
+* RETURNS: If the secondary key is associated with a primary key, that very | *
+* primary key is returned. Otherwise, NULL is returned.                     | *
+******************************************************************************/
+void* bidirectional_open_hash_map_t_get_by_secondary_key(
+        bidirectional_open_hash_map_t* map,
+        void* secondary_key);
+
+/**************************************************************************
+* Queries whether the map contains 'primary_key' as a primary key.|       *
+*-----------------------------------------------------------------+       *
+* map --------- the map to query.                                         *
+* primary_key - the primary key to query.                                 *
+*-----------------------------------------------------------------------+ *
+* RETURNS: If the primary key is in the map, returns 1. Otherwise, 0 is | *
+* returned.                                                             | *
+**************************************************************************/
+int bidirectional_open_hash_map_t_contains_primary_key(
+        bidirectional_open_hash_map_t* map,
+        void* primary_key);
+
+/****************************************************************************
+* Queries whether the map contains 'secondary_key' as a secondary key.|     *
+*---------------------------------------------------------------------+     *
+* map ----------- the map to query.                                         *
+* secondary_key - the secondary key to query.                               *
+*-------------------------------------------------------------------------+ *
+* RETURNS: If the secondary key is in the map, returns 1. Otherwise, 0 is | *
+* returned.                                                               | *
+****************************************************************************/
+int bidirectional_open_hash_map_t_contains_secondary_key(
+        bidirectional_open_hash_map_t* map,
+        void* secondary_key);
+
+/****************************************************************
+* Initializes an iterator. Removing mappings during iteration | *
+* invalidates the iterator.                                   | *
+*-------------------------------------------------------------+ *
+* map ------ the map to iterate.                                *
+* iterator - the iterator being initialized.                    *
+*-----------------------------------------------------------+   *
+* RETURNS: 1 if initialization is successfull. 0 otherwise. |   *
+****************************************************************/
+int bidirectional_open_hash_map_iterator_t_init(
+                            bidirectional_open_hash_map_t* map,
+                            bidirectional_open_hash_map_iterator_t* iterator);
+
+/********************************************************
+* Queries whether there is more mappings to iterate.|   *
+*---------------------------------------------------+   *
+* iterator - the iterator to query.                     *
+*-----------------------------------------------------+ *
+* RETURNS: 1 if there is more to iterate. 0 otherwise | *
+********************************************************/
+int bidirectional_open_hash_map_iterator_t_has_next(
+                            bidirectional_open_hash_map_iterator_t* iterator);
+
+/*******************************************************************************
+* Iterates over a mapping in the map.|                                         *
+*------------------------------------+                                         *
+* iterator ---------- the iterator.                                            *
+* primary_key_ptr --- the pointer to the location where to store the primary   *
+*                     key.                                                     *
+* secondary_key_ptr - the pointer to the location where to store the secondary *
+*                     key.                                                     *
+*-----------------------------------------------------+                        *
+* RETURNS: 1 if iteration was successful, 0 otherwise.|                        *
+*******************************************************************************/
+int bidirectional_open_hash_map_iterator_t_next(
+                            bidirectional_open_hash_map_iterator_t* iterator,
+                            void** primary_key_ptr,
+                            void** secondary_key_ptr);
+
+#endif /* BIDIRECTIONAL_OPEN_HASH_MAP_H */
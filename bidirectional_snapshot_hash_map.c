@@ -0,0 +1,465 @@
+#include "bidirectional_snapshot_hash_map.h"
+#include "bidirectional_frozen_hash_map.h"
+#include "bidirectional_hash_map.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/****************************************************************
+* With the atomic builtins, readers fetch versions and announce *
+* quiescent states with plain atomic loads and stores. Without  *
+* them, 'reader_lock' orders those accesses instead.            *
+****************************************************************/
+#if defined(__GNUC__) && defined(__ATOMIC_ACQUIRE)
+#define SNAPSHOT_HASH_MAP_ATOMICS
+#endif
+
+static const size_t FIRST_PERIOD = 1;
+
+static snapshot_hash_map_version_t* load_current_version(
+                                    bidirectional_snapshot_hash_map_t* map)
+{
+    snapshot_hash_map_version_t* version;
+
+#ifdef SNAPSHOT_HASH_MAP_ATOMICS
+    version = __atomic_load_n(&map->current_version, __ATOMIC_ACQUIRE);
+#else
+    pthread_mutex_lock(&map->reader_lock);
+    version = map->current_version;
+    pthread_mutex_unlock(&map->reader_lock);
+#endif
+
+    return version;
+}
+
+static void store_current_version(bidirectional_snapshot_hash_map_t* map,
+                                  snapshot_hash_map_version_t* version)
+{
+#ifdef SNAPSHOT_HASH_MAP_ATOMICS
+    __atomic_store_n(&map->current_version, version, __ATOMIC_SEQ_CST);
+#else
+    pthread_mutex_lock(&map->reader_lock);
+    map->current_version = version;
+    pthread_mutex_unlock(&map->reader_lock);
+#endif
+}
+
+static size_t load_period(bidirectional_snapshot_hash_map_t* map,
+                          size_t* period_ptr)
+{
+    size_t period;
+
+#ifdef SNAPSHOT_HASH_MAP_ATOMICS
+    (void) map;
+    period = __atomic_load_n(period_ptr, __ATOMIC_SEQ_CST);
+#else
+    pthread_mutex_lock(&map->reader_lock);
+    period = *period_ptr;
+    pthread_mutex_unlock(&map->reader_lock);
+#endif
+
+    return period;
+}
+
+static void store_period(bidirectional_snapshot_hash_map_t* map,
+                         size_t* period_ptr,
+                         size_t period)
+{
+#ifdef SNAPSHOT_HASH_MAP_ATOMICS
+    (void) map;
+    __atomic_store_n(period_ptr, period, __ATOMIC_SEQ_CST);
+#else
+    pthread_mutex_lock(&map->reader_lock);
+    *period_ptr = period;
+    pthread_mutex_unlock(&map->reader_lock);
+#endif
+}
+
+/********************************************************************
+* Freezes the working map into a new version. Returns NULL if there *
+* is no memory for it. The caller holds 'writer_lock'.              *
+********************************************************************/
+static snapshot_hash_map_version_t* create_version(
+                                    bidirectional_snapshot_hash_map_t* map)
+{
+    snapshot_hash_map_version_t* version =
+        malloc(sizeof(snapshot_hash_map_version_t));
+    
+    if (!version)
+    {
+        return NULL;
+    }
+    
+    if (!bidirectional_hash_map_t_freeze(&map->working_map,
+                                         &version->frozen_map))
+    {
+        free(version);
+        return NULL;
+    }
+    
+    version->period = 0;
+    version->next   = NULL;
+    return version;
+}
+
+static void free_version(snapshot_hash_map_version_t* version)
+{
+    bidirectional_frozen_hash_map_t_destroy(&version->frozen_map);
+    free(version);
+}
+
+/*******************************************************************
+* Returns the oldest grace period a registered reader may still be *
+* in. Versions replaced at that period or earlier are held by no   *
+* reader.                                                          *
+*******************************************************************/
+static size_t get_oldest_reader_period(bidirectional_snapshot_hash_map_t* map)
+{
+    size_t oldest_period = load_period(map, &map->period);
+    size_t reader_period;
+    snapshot_hash_map_reader_t* reader;
+    
+    pthread_mutex_lock(&map->reader_lock);
+    
+    for (reader = map->readers; reader; reader = reader->next)
+    {
+#ifdef SNAPSHOT_HASH_MAP_ATOMICS
+        reader_period = __atomic_load_n(&reader->period, __ATOMIC_SEQ_CST);
+#else
+        reader_period = reader->period;
+#endif
+
+        if (reader_period < oldest_period)
+        {
+            oldest_period = reader_period;
+        }
+    }
+    
+    pthread_mutex_unlock(&map->reader_lock);
+    return oldest_period;
+}
+
+/**************************************************************
+* Frees the replaced versions whose grace periods have ended. *
+* The caller holds 'writer_lock'.                             *
+**************************************************************/
+static void free_expired_versions(bidirectional_snapshot_hash_map_t* map)
+{
+    size_t oldest_period = get_oldest_reader_period(map);
+    snapshot_hash_map_version_t** link = &map->retired_versions;
+    snapshot_hash_map_version_t* version;
+    
+    while (*link)
+    {
+        version = *link;
+        
+        if (version->period > oldest_period)
+        {
+            link = &version->next;
+            continue;
+        }
+        
+        *link = version->next;
+        free_version(version);
+    }
+}
+
+/*********************************************************************
+* Completes a put into the working map, which found 'key_mapped' and *
+* 'size' mappings before the put, and returned 'old_key'. A put that *
+* had to add a mapping but left the size as is ran out of memory:    *
+* the working map reports that in no other way. Returns the error    *
+* sentinel then, and 'old_key' otherwise, in which case the map has  *
+* changed. The caller holds 'writer_lock'.                           *
+*********************************************************************/
+static void* finish_put(bidirectional_snapshot_hash_map_t* map,
+                        int key_mapped,
+                        size_t size,
+                        void* old_key)
+{
+    if (!key_mapped && bidirectional_hash_map_t_size(&map->working_map) == size)
+    {
+        return map->working_map.error_sentinel;
+    }
+    
+    map->changed = 1;
+    return old_key;
+}
+
+int bidirectional_snapshot_hash_map_t_init(
+        bidirectional_snapshot_hash_map_t* map,
+        size_t initial_capacity,
+        float load_factor,
+        size_t (*primary_key_hasher)  (void*),
+        size_t (*secondary_key_hasher)(void*),
+        int (*primary_key_equality)   (void*, void*),
+        int (*secondary_key_equality) (void*, void*),
+        void* error_sentinel)
+{
+    if (!map)
+    {
+        return 0;
+    }
+    
+    if (!bidirectional_hash_map_t_init(&map->working_map,
+                                       initial_capacity,
+                                       load_factor,
+                                       primary_key_hasher,
+                                       secondary_key_hasher,
+                                       primary_key_equality,
+                                       secondary_key_equality,
+                                       error_sentinel))
+    {
+        return 0;
+    }
+    
+    map->period           = FIRST_PERIOD;
+    map->changed          = 0;
+    map->retired_versions = NULL;
+    map->readers          = NULL;
+    map->current_version  = create_version(map);
+    
+    if (!map->current_version)
+    {
+        bidirectional_hash_map_t_destroy(&map->working_map);
+        return 0;
+    }
+    
+    if (pthread_mutex_init(&map->writer_lock, NULL) != 0)
+    {
+        free_version(map->current_version);
+        bidirectional_hash_map_t_destroy(&map->working_map);
+        return 0;
+    }
+    
+    if (pthread_mutex_init(&map->reader_lock, NULL) != 0)
+    {
+        pthread_mutex_destroy(&map->writer_lock);
+        free_version(map->current_version);
+        bidirectional_hash_map_t_destroy(&map->working_map);
+        return 0;
+    }
+    
+    return 1;
+}
+
+void bidirectional_snapshot_hash_map_t_destroy(
+                                    bidirectional_snapshot_hash_map_t* map)
+{
+    snapshot_hash_map_version_t* version;
+    snapshot_hash_map_version_t* next_version;
+    
+    if (!map || !map->current_version)
+    {
+        return;
+    }
+    
+    for (version = map->retired_versions; version; version = next_version)
+    {
+        next_version = version->next;
+        free_version(version);
+    }
+    
+    free_version(map->current_version);
+    bidirectional_hash_map_t_destroy(&map->working_map);
+    pthread_mutex_destroy(&map->reader_lock);
+    pthread_mutex_destroy(&map->writer_lock);
+    
+    map->current_version  = NULL;
+    map->retired_versions = NULL;
+}
+
+void* bidirectional_snapshot_hash_map_t_put_by_primary(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    void* primary_key,
+                                    void* secondary_key)
+{
+    void* old_secondary_key;
+    size_t size;
+    int key_mapped;
+    
+    pthread_mutex_lock(&map->writer_lock);
+    size = bidirectional_hash_map_t_size(&map->working_map);
+    key_mapped = bidirectional_hash_map_t_contains_primary_key(
+                                                        &map->working_map,
+                                                        primary_key);
+    old_secondary_key = bidirectional_hash_map_t_put_by_primary(
+                                                        &map->working_map,
+                                                        primary_key,
+                                                        secondary_key);
+    old_secondary_key = finish_put(map, key_mapped, size, old_secondary_key);
+    pthread_mutex_unlock(&map->writer_lock);
+    return old_secondary_key;
+}
+
+void* bidirectional_snapshot_hash_map_t_put_by_secondary(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    void* primary_key,
+                                    void* secondary_key)
+{
+    void* old_primary_key;
+    size_t size;
+    int key_mapped;
+    
+    pthread_mutex_lock(&map->writer_lock);
+    size = bidirectional_hash_map_t_size(&map->working_map);
+    key_mapped = bidirectional_hash_map_t_contains_secondary_key(
+                                                        &map->working_map,
+                                                        secondary_key);
+    old_primary_key = bidirectional_hash_map_t_put_by_secondary(
+                                                        &map->working_map,
+                                                        primary_key,
+                                                        secondary_key);
+    old_primary_key = finish_put(map, key_mapped, size, old_primary_key);
+    pthread_mutex_unlock(&map->writer_lock);
+    return old_primary_key;
+}
+
+void* bidirectional_snapshot_hash_map_t_remove_by_primary_key(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    void* primary_key)
+{
+    void* secondary_key;
+    
+    pthread_mutex_lock(&map->writer_lock);
+    
+    if (bidirectional_hash_map_t_contains_primary_key(&map->working_map,
+                                                      primary_key))
+    {
+        map->changed = 1;
+    }
+    
+    secondary_key = bidirectional_hash_map_t_remove_by_primary_key(
+                                                        &map->working_map,
+                                                        primary_key);
+    pthread_mutex_unlock(&map->writer_lock);
+    return secondary_key;
+}
+
+void* bidirectional_snapshot_hash_map_t_remove_by_secondary_key(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    void* secondary_key)
+{
+    void* primary_key;
+    
+    pthread_mutex_lock(&map->writer_lock);
+    
+    if (bidirectional_hash_map_t_contains_secondary_key(&map->working_map,
+                                                        secondary_key))
+    {
+        map->changed = 1;
+    }
+    
+    primary_key = bidirectional_hash_map_t_remove_by_secondary_key(
+                                                        &map->working_map,
+                                                        secondary_key);
+    pthread_mutex_unlock(&map->writer_lock);
+    return primary_key;
+}
+
+int bidirectional_snapshot_hash_map_t_publish(
+                                    bidirectional_snapshot_hash_map_t* map)
+{
+    snapshot_hash_map_version_t* version;
+    snapshot_hash_map_version_t* replaced_version;
+    
+    pthread_mutex_lock(&map->writer_lock);
+    
+    if (!map->changed)
+    {
+        free_expired_versions(map);
+        pthread_mutex_unlock(&map->writer_lock);
+        return 1;
+    }
+    
+    version = create_version(map);
+    
+    if (!version)
+    {
+        pthread_mutex_unlock(&map->writer_lock);
+        return 0;
+    }
+    
+    /**************************************************************
+    * Swap the version in before starting the new grace period: a *
+    * reader that sees the new period at its quiescent state is   *
+    * then sure to fetch the new version afterwards.              *
+    **************************************************************/
+    replaced_version = map->current_version;
+    store_current_version(map, version);
+    store_period(map, &map->period, map->period + 1);
+    
+    replaced_version->period = map->period;
+    replaced_version->next   = map->retired_versions;
+    map->retired_versions    = replaced_version;
+    map->changed             = 0;
+    
+    free_expired_versions(map);
+    pthread_mutex_unlock(&map->writer_lock);
+    return 1;
+}
+
+snapshot_hash_map_reader_t* bidirectional_snapshot_hash_map_t_register_reader(
+                                    bidirectional_snapshot_hash_map_t* map)
+{
+    snapshot_hash_map_padded_reader_t* padded_reader =
+        malloc(sizeof(snapshot_hash_map_padded_reader_t));
+    snapshot_hash_map_reader_t* reader;
+    
+    if (!padded_reader)
+    {
+        return NULL;
+    }
+    
+    reader = &padded_reader->reader;
+    reader->period = load_period(map, &map->period);
+    
+    pthread_mutex_lock(&map->reader_lock);
+    reader->previous = NULL;
+    reader->next     = map->readers;
+    
+    if (map->readers)
+    {
+        map->readers->previous = reader;
+    }
+    
+    map->readers = reader;
+    pthread_mutex_unlock(&map->reader_lock);
+    return reader;
+}
+
+void bidirectional_snapshot_hash_map_t_unregister_reader(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    snapshot_hash_map_reader_t* reader)
+{
+    pthread_mutex_lock(&map->reader_lock);
+    
+    if (reader->previous)
+    {
+        reader->previous->next = reader->next;
+    }
+    else
+    {
+        map->readers = reader->next;
+    }
+    
+    if (reader->next)
+    {
+        reader->next->previous = reader->previous;
+    }
+    
+    pthread_mutex_unlock(&map->reader_lock);
+    free(reader);
+}
+
+bidirectional_frozen_hash_map_t* bidirectional_snapshot_hash_map_t_get_version(
+                                    bidirectional_snapshot_hash_map_t* map)
+{
+    return &load_current_version(map)->frozen_map;
+}
+
+void bidirectional_snapshot_hash_map_t_quiescent_state(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    snapshot_hash_map_reader_t* reader)
+{
+    store_period(map, &reader->period, load_period(map, &map->period));
+}
@@ -0,0 +1,303 @@
+#ifndef BIDIRECTIONAL_SNAPSHOT_HASH_MAP_H
+#define BIDIRECTIONAL_SNAPSHOT_HASH_MAP_H
+
+#include "bidirectional_frozen_hash_map.h"
+#include "bidirectional_hash_map.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+/******************************************************************************
+* A bidirectional map for data that changes rarely and is read all the time,  *
+* such as configuration. Writers stage their changes in a private working map *
+* and publish them in one go as a new version: a frozen copy of the working   *
+* map. Readers fetch the current version with a single atomic load and query  *
+* it through the frozen map API, with no lock taken and no shared memory      *
+* written.                                                                    *
+*                                                                             *
+* A version that is no longer current is freed after a grace period: once     *
+* every registered reader has announced a quiescent state, a moment at which  *
+* it holds no version, since the version was replaced. A reader may keep      *
+* using the versions it fetched until its next quiescent state, so a thread   *
+* serving requests typically announces one between two requests.              *
+******************************************************************************/
+
+/***********************************************************************
+* A published version of the map, and the link to the next one waiting *
+* for the end of its grace period once it has been replaced.           *
+***********************************************************************/
+typedef struct snapshot_hash_map_version_t {
+    
+    /****************************************************************
+    * The frozen mappings. The first member, so that a pointer to a *
+    * version is one to its frozen map.                             *
+    ****************************************************************/
+    bidirectional_frozen_hash_map_t frozen_map;
+    
+    /*****************************************************
+    * The grace period that started when the version was *
+    * replaced.                                          *
+    *****************************************************/
+    size_t period;
+    
+    /**************************************
+    * The next replaced version, or NULL. *
+    **************************************/
+    struct snapshot_hash_map_version_t* next;
+}
+snapshot_hash_map_version_t;
+
+/****************************************************************
+* The number of bytes each reader is padded to, so that readers *
+* announcing their quiescent states share no cache line.        *
+****************************************************************/
+#define SNAPSHOT_HASH_MAP_READER_SIZE 128
+
+/************************************************************
+* A registered reader. Only its own thread writes 'period'. *
+************************************************************/
+typedef struct snapshot_hash_map_reader_t {
+    
+    /************************************************************
+    * The grace period the reader saw at its latest quiescent   *
+    * state. Versions replaced at this period or earlier are no *
+    * longer held by the reader.                                *
+    ************************************************************/
+    size_t period;
+    
+    /***************************************
+    * The next reader of the map, or NULL. *
+    ***************************************/
+    struct snapshot_hash_map_reader_t* next;
+    
+    /********************************
+    * The previous reader, or NULL. *
+    ********************************/
+    struct snapshot_hash_map_reader_t* previous;
+}
+snapshot_hash_map_reader_t;
+
+/**********************************************************
+* A reader padded to SNAPSHOT_HASH_MAP_READER_SIZE bytes. *
+**********************************************************/
+typedef union snapshot_hash_map_padded_reader_t {
+    
+    /**************
+    * The reader. *
+    **************/
+    snapshot_hash_map_reader_t reader;
+    
+    /***********************************
+    * The padding up to the full size. *
+    ***********************************/
+    char padding[SNAPSHOT_HASH_MAP_READER_SIZE];
+}
+snapshot_hash_map_padded_reader_t;
+
+typedef struct bidirectional_snapshot_hash_map_t {
+    
+    /**************************************************************
+    * The version the readers fetch. Replaced only by publishing. *
+    **************************************************************/
+    snapshot_hash_map_version_t* current_version;
+    
+    /***********************************************************
+    * The current grace period. Every publication starts a new *
+    * one.                                                     *
+    ***********************************************************/
+    size_t period;
+    
+    /************************************************************
+    * The map the writers stage their changes in. Readers never *
+    * see it.                                                   *
+    ************************************************************/
+    bidirectional_hash_map_t working_map;
+    
+    /********************************************************
+    * Nonzero if the working map has changed since the last *
+    * publication.                                          *
+    ********************************************************/
+    int changed;
+    
+    /****************************************************************
+    * The replaced versions waiting for their grace periods to end, *
+    * the latest one first.                                         *
+    ****************************************************************/
+    snapshot_hash_map_version_t* retired_versions;
+    
+    /****************************************************
+    * Serializes the writers, and guards 'working_map', *
+    * 'changed' and 'retired_versions'.                 *
+    ****************************************************/
+    pthread_mutex_t writer_lock;
+    
+    /**********************************************************
+    * Guards the list of readers. Without atomic builtins, it *
+    * also guards 'current_version', 'period' and the periods *
+    * of the readers.                                         *
+    **********************************************************/
+    pthread_mutex_t reader_lock;
+    
+    /***********************************
+    * The registered readers, or NULL. *
+    ***********************************/
+    snapshot_hash_map_reader_t* readers;
+}
+bidirectional_snapshot_hash_map_t;
+
+/****************************************************************************
+* Builds a new snapshot map whose current version is empty.|                *
+*----------------------------------------------------------+                *
+* map -------------------- the map to initialize.                           *
+* initial_capacity ------- the initial capacity of the working map.         *
+* load_factor ------------ the load factor of the working map.              *
+* primary_key_hasher ----- the function for producing primary key hashes.   *
+* secondary_key_hasher --- the function for producing secondary key hashes. *
+* primary_key_equality --- the function for comparing primary keys.         *
+* secondary_key_equality - the function for comparing secondary keys.       *
+* error_sentinel --------- the value returned on failed addition.           *
+*-----------------------------------------------------------+               *
+* RETURNS: 1 if initialization was successfull, 0 otherwise.|               *
+****************************************************************************/
+int bidirectional_snapshot_hash_map_t_init(
+        bidirectional_snapshot_hash_map_t* map,
+        size_t initial_capacity,
+        float load_factor,
+        size_t (*primary_key_hasher)  (void*),
+        size_t (*secondary_key_hasher)(void*),
+        int (*primary_key_equality)   (void*, void*),
+        int (*secondary_key_equality) (void*, void*),
+        void* error_sentinel);
+
+/*****************************************************************************
+* Releases all the resources of the input map, every version included. No  | *
+* reader may be registered any more.                                       | *
+*--------------------------------------------------------------------------+ *
+* map - the map to destroy.                                                  *
+*****************************************************************************/
+void bidirectional_snapshot_hash_map_t_destroy(
+                                    bidirectional_snapshot_hash_map_t* map);
+
+/******************************************************************************
+* Stages the association of the primary key to the secondary key. Readers   | *
+* see it once the map is published.                                         | *
+*---------------------------------------------------------------------------+ *
+* map ----------- the map into which to store the pair.                       *
+* primary_key --- the primary key.                                            *
+* secondary_key - the secondary key.                                          *
+*---------------------------------------------------------------------------+ *
+* RETURNS: old secondary key in case the primary key is in the working map, | *
+* NULL if the primary key has no mappings yet, and the error sentinel if    | *
+* there is no memory for the new mapping.                                   | *
+******************************************************************************/
+void* bidirectional_snapshot_hash_map_t_put_by_primary(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    void* primary_key,
+                                    void* secondary_key);
+
+/******************************************************************************
+* Stages the association of the secondary key to the primary key. Readers   | *
+* see it once the map is published.                                         | *
+*---------------------------------------------------------------------------+ *
+* map ----------- the map into which to store the pair.                       *
+* primary_key --- the primary key.                                            *
+* secondary_key - the secondary key.                                          *
+*---------------------------------------------------------------------------+ *
+* RETURNS: old primary key in case the secondary key is in the working map, | *
+* NULL if the secondary key has no mappings yet, and the error sentinel if  | *
+* there is no memory for the new mapping.                                   | *
+******************************************************************************/
+void* bidirectional_snapshot_hash_map_t_put_by_secondary(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    void* primary_key,
+                                    void* secondary_key);
+
+/******************************************************************************
+* Stages the removal of a key pair by its primary key. Readers see it once  | *
+* the map is published.                                                     | *
+*---------------------------------------------------------------------------+ *
+* map --------- the map.                                                      *
+* primary_key - the primary key.                                              *
+*---------------------------------------------------------------------------+ *
+* RETURNS: NULL if the primary key is not in the working map. The current   | *
+* associated secondary key otherwise.                                       | *
+******************************************************************************/
+void* bidirectional_snapshot_hash_map_t_remove_by_primary_key(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    void* primary_key);
+
+/******************************************************************************
+* Stages the removal of a key pair by its secondary key. Readers see it     | *
+* once the map is published.                                                | *
+*---------------------------------------------------------------------------+ *
+* map ----------- the map.                                                    *
+* secondary_key - the secondary key.                                          *
+*---------------------------------------------------------------------------+ *
+* RETURNS: NULL if the secondary key is not in the working map. The current | *
+* associated primary key otherwise.                                         | *
+******************************************************************************/
+void* bidirectional_snapshot_hash_map_t_remove_by_secondary_key(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    void* secondary_key);
+
+/******************************************************************************
+* Makes the staged changes visible by replacing the current version with a  | *
+* frozen copy of the working map, and frees the replaced versions whose     | *
+* grace periods have ended. If nothing has been staged since the last       | *
+* publication, the current version stays and only the freeing is done.      | *
+* Takes time linear in the size of the map.                                 | *
+*---------------------------------------------------------------------------+ *
+* map - the map to publish.                                                   *
+*---------------------------------------------------------------------------+ *
+* RETURNS: 1 if the changes are published, 0 if there is no memory for the  | *
+* new version, in which case the current version stays.                     | *
+******************************************************************************/
+int bidirectional_snapshot_hash_map_t_publish(
+                                    bidirectional_snapshot_hash_map_t* map);
+
+/******************************************************************************
+* Registers the calling thread as a reader of the map. Only registered      | *
+* threads may fetch versions.                                               | *
+*---------------------------------------------------------------------------+ *
+* map - the map to read.                                                      *
+*---------------------------------------------------------------------------+ *
+* RETURNS: the reader to announce the quiescent states through, or NULL if  | *
+* there is no memory for it.                                                | *
+******************************************************************************/
+snapshot_hash_map_reader_t* bidirectional_snapshot_hash_map_t_register_reader(
+                                    bidirectional_snapshot_hash_map_t* map);
+
+/****************************************************************************
+* Unregisters a reader. Its thread may no longer use the versions it has  | *
+* fetched.                                                                | *
+*-------------------------------------------------------------------------+ *
+* map ---- the map.                                                         *
+* reader - the reader to unregister.                                        *
+****************************************************************************/
+void bidirectional_snapshot_hash_map_t_unregister_reader(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    snapshot_hash_map_reader_t* reader);
+
+/******************************************************************************
+* Returns the current version of the map, to be queried through the frozen  | *
+* map API and neither modified nor destroyed. It stays valid until the      | *
+* calling reader announces its next quiescent state.                        | *
+*---------------------------------------------------------------------------+ *
+* map - the map to read.                                                      *
+*-----------------------------------------+                                   *
+* RETURNS: the current version of the map.|                                   *
+******************************************************************************/
+bidirectional_frozen_hash_map_t* bidirectional_snapshot_hash_map_t_get_version(
+                                    bidirectional_snapshot_hash_map_t* map);
+
+/******************************************************************************
+* Announces that the reader holds no version of the map any more, so that   | *
+* the versions replaced before may be freed. Writes only the reader itself. | *
+*---------------------------------------------------------------------------+ *
+* map ---- the map.                                                           *
+* reader - the reader of the calling thread.                                  *
+******************************************************************************/
+void bidirectional_snapshot_hash_map_t_quiescent_state(
+                                    bidirectional_snapshot_hash_map_t* map,
+                                    snapshot_hash_map_reader_t* reader);
+
+#endif /* BIDIRECTIONAL_SNAPSHOT_HASH_MAP_H */
@@ -0,0 +1,510 @@
+#include "bidirectional_static_hash_map.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*********************************************************
+* The average number of keys per bucket of the CHD hash. *
+*********************************************************/
+static const size_t KEYS_PER_BUCKET = 4;
+
+/***************************************************************************
+* The constants of the SplitMix64 output function. Where 'size_t' has only *
+* 32 bits, the upper halves vanish and the mixing is merely weaker.        *
+***************************************************************************/
+static const size_t GOLDEN_GAMMA     = ((size_t) 0x9E3779B9UL << 16 << 16) |
+                                       (size_t) 0x7F4A7C15UL;
+static const size_t MIX_MULTIPLIER_1 = ((size_t) 0xBF58476DUL << 16 << 16) |
+                                       (size_t) 0x1CE4E5B9UL;
+static const size_t MIX_MULTIPLIER_2 = ((size_t) 0x94D049BBUL << 16 << 16) |
+                                       (size_t) 0x133111EBUL;
+
+/****************************************************************************
+* Holds the scratch arrays used while building the perfect hash function of *
+* one direction.                                                            *
+****************************************************************************/
+typedef struct perfect_hash_workspace_t {
+    
+    /********************************************
+    * The hash of each key, in the input order. *
+    ********************************************/
+    size_t* key_hashes;
+    
+    /*************************************************
+    * Receives the slot of each key, in input order. *
+    *************************************************/
+    uint32_t* key_slots;
+    
+    /****************************************************
+    * 'bucket_count + 1' offsets into 'bucket_members'. *
+    ****************************************************/
+    uint32_t* bucket_offsets;
+    
+    /****************************************************
+    * The indices of the keys grouped by their buckets. *
+    ****************************************************/
+    uint32_t* bucket_members;
+    
+    /**************************************************************
+    * The slots tried for the members of the bucket being placed. *
+    **************************************************************/
+    uint32_t* candidate_slots;
+    
+    /**********************************************
+    * Tells for each slot whether a key holds it. *
+    **********************************************/
+    unsigned char* taken_slots;
+}
+perfect_hash_workspace_t;
+
+/*******************************************************************
+* Scrambles 'hash' with the SplitMix64 output function, offset by  *
+* 'seed'. For a fixed seed this is a bijection, so distinct hashes *
+* stay distinct.                                                   *
+*******************************************************************/
+static size_t mix_hash(size_t hash, size_t seed)
+{
+    hash += seed;
+    hash = (hash ^ (hash >> 30)) * MIX_MULTIPLIER_1;
+    hash = (hash ^ (hash >> 27)) * MIX_MULTIPLIER_2;
+    return hash ^ (hash >> 31);
+}
+
+/******************************************************************************
+* Maps a mixed hash to the range 0, 1, ..., 'range' - 1. With 64-bit 'size_t' *
+* this multiplies by the upper half of the hash instead of dividing; 'range'  *
+* never exceeds 2^32.                                                         *
+******************************************************************************/
+static size_t reduce_hash(size_t hash, size_t range)
+{
+#if SIZE_MAX > 0xFFFFFFFFUL
+    return ((hash >> 32) * range) >> 32;
+#else
+    return hash % range;
+#endif
+}
+
+static size_t get_bucket_index(size_t hash, size_t bucket_count)
+{
+    return reduce_hash(mix_hash(hash, GOLDEN_GAMMA), bucket_count);
+}
+
+/****************************************************************
+* Returns the slot of a key with hash 'hash' in a bucket having *
+* the displacement 'displacement'.                              *
+****************************************************************/
+static size_t get_slot_index(size_t hash, size_t displacement, size_t size)
+{
+    return reduce_hash(mix_hash(hash, GOLDEN_GAMMA * (displacement + 2)), size);
+}
+
+/********************************************************************
+* Tries to send all the members of 'bucket' to free slots using     *
+* 'displacement'. On success, the slots are marked as taken and the *
+* function returns 1.                                               *
+********************************************************************/
+static int try_displacement(perfect_hash_workspace_t* workspace,
+                            size_t count,
+                            size_t bucket,
+                            size_t displacement)
+{
+    size_t begin = workspace->bucket_offsets[bucket];
+    size_t end   = workspace->bucket_offsets[bucket + 1];
+    size_t slot;
+    size_t i;
+    size_t j;
+    
+    for (i = begin; i < end; ++i)
+    {
+        slot = get_slot_index(
+                    workspace->key_hashes[workspace->bucket_members[i]],
+                    displacement,
+                    count);
+        
+        if (workspace->taken_slots[slot])
+        {
+            break;
+        }
+        
+        /****************************************************************
+        * Mark the slot right away so that two members of the bucket do *
+        * not take the same slot.                                       *
+        ****************************************************************/
+        workspace->taken_slots[slot] = 1;
+        workspace->candidate_slots[i - begin] = (uint32_t) slot;
+    }
+    
+    if (i == end)
+    {
+        for (i = begin; i < end; ++i)
+        {
+            workspace->key_slots[workspace->bucket_members[i]] =
+                workspace->candidate_slots[i - begin];
+        }
+        
+        return 1;
+    }
+    
+    for (j = begin; j < i; ++j)
+    {
+        workspace->taken_slots[workspace->candidate_slots[j - begin]] = 0;
+    }
+    
+    return 0;
+}
+
+/*****************************************************************************
+* Builds the perfect hash function of the keys whose hashes are in           *
+* 'workspace->key_hashes': stores the displacement of each bucket and the    *
+* slot of each key. The buckets are placed from the largest to the smallest, *
+* since the large ones are the hardest to fit. Returns 0 if two keys share a *
+* hash, as no displacement can separate them.                                *
+*****************************************************************************/
+static int build_perfect_hash(perfect_hash_workspace_t* workspace,
+                              size_t count,
+                              size_t bucket_count,
+                              uint32_t* displacements)
+{
+    size_t maximum_bucket_size = 0;
+    size_t bucket_size;
+    size_t displacement;
+    size_t bucket;
+    size_t i;
+    size_t j;
+    
+    memset(workspace->bucket_offsets,
+           0,
+           (bucket_count + 1) * sizeof(uint32_t));
+    
+    memset(workspace->taken_slots, 0, count);
+    
+    for (i = 0; i < count; ++i)
+    {
+        workspace->bucket_offsets[
+            get_bucket_index(workspace->key_hashes[i], bucket_count)]++;
+    }
+    
+    for (bucket = 0; bucket < bucket_count; ++bucket)
+    {
+        if (maximum_bucket_size < workspace->bucket_offsets[bucket])
+        {
+            maximum_bucket_size = workspace->bucket_offsets[bucket];
+        }
+        
+        if (bucket > 0)
+        {
+            workspace->bucket_offsets[bucket] +=
+                workspace->bucket_offsets[bucket - 1];
+        }
+    }
+    
+    /******************************************************************
+    * The offsets now point past the end of each bucket. Filling each *
+    * bucket backwards leaves them at the beginnings.                 *
+    ******************************************************************/
+    for (i = 0; i < count; ++i)
+    {
+        bucket = get_bucket_index(workspace->key_hashes[i], bucket_count);
+        workspace->bucket_members[--workspace->bucket_offsets[bucket]] =
+            (uint32_t) i;
+    }
+    
+    workspace->bucket_offsets[bucket_count] = (uint32_t) count;
+    
+    for (bucket = 0; bucket < bucket_count; ++bucket)
+    {
+        for (i = workspace->bucket_offsets[bucket];
+             i < workspace->bucket_offsets[bucket + 1];
+             ++i)
+        {
+            for (j = i + 1; j < workspace->bucket_offsets[bucket + 1]; ++j)
+            {
+                if (workspace->key_hashes[workspace->bucket_members[i]] ==
+                    workspace->key_hashes[workspace->bucket_members[j]])
+                {
+                    return 0;
+                }
+            }
+        }
+    }
+    
+    for (bucket_size = maximum_bucket_size; bucket_size > 0; --bucket_size)
+    {
+        for (bucket = 0; bucket < bucket_count; ++bucket)
+        {
+            if (workspace->bucket_offsets[bucket + 1] -
+                workspace->bucket_offsets[bucket] != bucket_size)
+            {
+                continue;
+            }
+            
+            for (displacement = 0;
+                 !try_displacement(workspace, count, bucket, displacement);
+                 ++displacement)
+            {
+                if (displacement == (size_t) 0xFFFFFFFFUL)
+                {
+                    return 0;
+                }
+            }
+            
+            displacements[bucket] = (uint32_t) displacement;
+        }
+    }
+    
+    return 1;
+}
+
+int bidirectional_static_hash_map_t_build(
+                        bidirectional_static_hash_map_t* map,
+                        key_pair_t* key_pairs,
+                        size_t count,
+                        size_t (*primary_key_hasher)  (void*),
+                        size_t (*secondary_key_hasher)(void*),
+                        int (*primary_key_equality)   (void*, void*),
+                        int (*secondary_key_equality) (void*, void*),
+                        const bidirectional_hash_map_allocator_t* allocator)
+{
+    perfect_hash_workspace_t workspace;
+    size_t bucket_count;
+    size_t i;
+    unsigned char* block;
+    unsigned char* workspace_block;
+    
+    if (!map || (!key_pairs && count > 0))
+    {
+        return 0;
+    }
+    
+    if (!primary_key_hasher ||
+        !secondary_key_hasher ||
+        !primary_key_equality ||
+        !secondary_key_equality)
+    {
+        return 0;
+    }
+    
+    if (!allocator)
+    {
+        allocator = &bidirectional_hash_map_default_allocator;
+    }
+    
+    if (!bidirectional_hash_map_allocator_t_is_valid(allocator))
+    {
+        return 0;
+    }
+    
+    if (count >= (size_t) 0xFFFFFFFFUL)
+    {
+        return 0;
+    }
+    
+    bucket_count = (count + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+    
+    if (bucket_count == 0)
+    {
+        bucket_count = 1;
+    }
+    
+    map->size                   = count;
+    map->bucket_count           = bucket_count;
+    map->primary_key_hasher     = primary_key_hasher;
+    map->secondary_key_hasher   = secondary_key_hasher;
+    map->primary_key_equality   = primary_key_equality;
+    map->secondary_key_equality = secondary_key_equality;
+    map->allocator              = *allocator;
+    
+    /******************************************************************
+    * The key pairs come first so that the block alignment serves the *
+    * pointers; the 32-bit arrays follow them.                        *
+    ******************************************************************/
+    block = allocator->allocate(allocator->context,
+                                count * sizeof(key_pair_t) +
+                                (2 * bucket_count + count) * sizeof(uint32_t));
+    
+    if (!block)
+    {
+        map->key_pairs = NULL;
+        return 0;
+    }
+    
+    map->key_pairs               = (key_pair_t*) block;
+    map->primary_displacements   =
+        (uint32_t*)(block + count * sizeof(key_pair_t));
+    map->secondary_displacements = map->primary_displacements + bucket_count;
+    map->secondary_index         = map->secondary_displacements + bucket_count;
+    
+    workspace_block = allocator->allocate(allocator->context,
+                                          count * sizeof(size_t) +
+                                          (4 * count + bucket_count + 1) *
+                                          sizeof(uint32_t) +
+                                          count);
+    
+    if (!workspace_block)
+    {
+        bidirectional_static_hash_map_t_destroy(map);
+        return 0;
+    }
+    
+    workspace.key_hashes      = (size_t*) workspace_block;
+    workspace.key_slots       = (uint32_t*)(workspace.key_hashes + count);
+    workspace.bucket_offsets  = workspace.key_slots + count;
+    workspace.bucket_members  = workspace.bucket_offsets + bucket_count + 1;
+    workspace.candidate_slots = workspace.bucket_members + count;
+    workspace.taken_slots     =
+        (unsigned char*)(workspace.candidate_slots + count);
+    
+    /****************************************************************
+    * Place the key pairs by their primary keys, then index them by *
+    * their secondary keys.                                         *
+    ****************************************************************/
+    for (i = 0; i < count; ++i)
+    {
+        workspace.key_hashes[i] = primary_key_hasher(key_pairs[i].primary_key);
+    }
+    
+    if (!build_perfect_hash(&workspace,
+                            count,
+                            bucket_count,
+                            map->primary_displacements))
+    {
+        allocator->deallocate(allocator->context, workspace_block);
+        bidirectional_static_hash_map_t_destroy(map);
+        return 0;
+    }
+    
+    for (i = 0; i < count; ++i)
+    {
+        map->key_pairs[workspace.key_slots[i]] = key_pairs[i];
+    }
+    
+    for (i = 0; i < count; ++i)
+    {
+        workspace.key_hashes[i] =
+            secondary_key_hasher(map->key_pairs[i].secondary_key);
+    }
+    
+    if (!build_perfect_hash(&workspace,
+                            count,
+                            bucket_count,
+                            map->secondary_displacements))
+    {
+        allocator->deallocate(allocator->context, workspace_block);
+        bidirectional_static_hash_map_t_destroy(map);
+        return 0;
+    }
+    
+    for (i = 0; i < count; ++i)
+    {
+        map->secondary_index[workspace.key_slots[i]] = (uint32_t) i;
+    }
+    
+    allocator->deallocate(allocator->context, workspace_block);
+    return 1;
+}
+
+void bidirectional_static_hash_map_t_destroy(
+                                        bidirectional_static_hash_map_t* map)
+{
+    if (!map || !map->key_pairs)
+    {
+        return;
+    }
+    
+    map->allocator.deallocate(map->allocator.context, map->key_pairs);
+    
+    map->key_pairs               = NULL;
+    map->primary_displacements   = NULL;
+    map->secondary_displacements = NULL;
+    map->secondary_index         = NULL;
+    map->size                    = 0;
+}
+
+size_t bidirectional_static_hash_map_t_size(
+                                        bidirectional_static_hash_map_t* map)
+{
+    return map->size;
+}
+
+/*******************************************************************
+* Returns the key pair whose primary key is 'primary_key', or NULL *
+* if there is no such key pair.                                    *
+*******************************************************************/
+static key_pair_t* find_key_pair_by_primary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* primary_key)
+{
+    size_t hash;
+    key_pair_t* key_pair;
+    
+    if (map->size == 0)
+    {
+        return NULL;
+    }
+    
+    hash = map->primary_key_hasher(primary_key);
+    key_pair = &map->key_pairs[
+        get_slot_index(hash,
+                       map->primary_displacements[
+                            get_bucket_index(hash, map->bucket_count)],
+                       map->size)];
+    
+    return map->primary_key_equality(key_pair->primary_key, primary_key) ?
+           key_pair : NULL;
+}
+
+/***************************************************************
+* Returns the key pair whose secondary key is 'secondary_key', *
+* or NULL if there is no such key pair.                        *
+***************************************************************/
+static key_pair_t* find_key_pair_by_secondary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* secondary_key)
+{
+    size_t hash;
+    key_pair_t* key_pair;
+    
+    if (map->size == 0)
+    {
+        return NULL;
+    }
+    
+    hash = map->secondary_key_hasher(secondary_key);
+    key_pair = &map->key_pairs[map->secondary_index[
+        get_slot_index(hash,
+                       map->secondary_displacements[
+                            get_bucket_index(hash, map->bucket_count)],
+                       map->size)]];
+    
+    return map->secondary_key_equality(key_pair->secondary_key,
+                                       secondary_key) ? key_pair : NULL;
+}
+
+void* bidirectional_static_hash_map_t_get_by_primary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* primary_key)
+{
+    key_pair_t* key_pair = find_key_pair_by_primary_key(map, primary_key);
+    return key_pair ? key_pair->secondary_key : NULL;
+}
+
+void* bidirectional_static_hash_map_t_get_by_secondary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* secondary_key)
+{
+    key_pair_t* key_pair = find_key_pair_by_secondary_key(map, secondary_key);
+    return key_pair ? key_pair->primary_key : NULL;
+}
+
+int bidirectional_static_hash_map_t_contains_primary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* primary_key)
+{
+    return find_key_pair_by_primary_key(map, primary_key) != NULL ? 1 : 0;
+}
+
+int bidirectional_static_hash_map_t_contains_secondary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* secondary_key)
+{
+    return find_key_pair_by_secondary_key(map, secondary_key) != NULL ? 1 : 0;
+}
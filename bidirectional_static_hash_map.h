@@ -0,0 +1,177 @@
+#ifndef BIDIRECTIONAL_STATIC_HASH_MAP_H
+#define BIDIRECTIONAL_STATIC_HASH_MAP_H
+
+#include "bidirectional_hash_map_allocator.h"
+#include "key_pair.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/*****************************************************************************
+* An immutable bidirectional map over a key set known in advance. Each       *
+* direction has a minimal perfect hash function built with the CHD ("hash,   *
+* displace and compress") scheme: the keys are split into small buckets, and *
+* each bucket stores the displacement that sends its keys to free slots. A   *
+* lookup computes its one and only candidate slot from the key hash and the  *
+* displacement of its bucket, and compares a single key.                     *
+*****************************************************************************/
+typedef struct bidirectional_static_hash_map_t {
+    
+    /**********************************
+    * Caches the number of key pairs. *
+    **********************************/
+    size_t size;
+    
+    /****************************************************
+    * The number of buckets of both the hash functions. *
+    ****************************************************/
+    size_t bucket_count;
+    
+    /*****************************************************************
+    * The key pairs placed at the slots the primary keys hash to. It *
+    * also points to the start of the memory block of this map.      *
+    *****************************************************************/
+    key_pair_t* key_pairs;
+    
+    /***********************************************
+    * The displacement of each primary key bucket. *
+    ***********************************************/
+    uint32_t* primary_displacements;
+    
+    /*************************************************
+    * The displacement of each secondary key bucket. *
+    *************************************************/
+    uint32_t* secondary_displacements;
+    
+    /***************************************************************
+    * Maps each secondary key slot to the index of its key pair in *
+    * 'key_pairs'.                                                 *
+    ***************************************************************/
+    uint32_t* secondary_index;
+    
+    /**************************************************************
+    * The function producing the hash of a primary key. Its       *
+    * output seeds the perfect hash function of the primary keys. *
+    **************************************************************/
+    size_t (*primary_key_hasher)(void* primary_key);
+    
+    /****************************************************************
+    * The function producing the hash of a secondary key. Its       *
+    * output seeds the perfect hash function of the secondary keys. *
+    ****************************************************************/
+    size_t (*secondary_key_hasher)(void* secondary_key);
+    
+    /***********************************************
+    * The function for comparing the primary keys. *
+    ***********************************************/
+    int (*primary_key_equality)(void* key1, void* key2);
+    
+    /*************************************************
+    * The function for comparing the secondary keys. *
+    *************************************************/
+    int (*secondary_key_equality)(void* key1, void* key2);
+    
+    /****************************************************
+    * The allocator the memory block was obtained from. *
+    ****************************************************/
+    bidirectional_hash_map_allocator_t allocator;
+}
+bidirectional_static_hash_map_t;
+
+/******************************************************************************
+* Builds a static map holding exactly the input key pairs.|                   *
+*---------------------------------------------------------+                   *
+* map -------------------- the map to initialize.                             *
+* key_pairs -------------- the key pairs to store; copied into the map.       *
+* count ------------------ the number of key pairs.                           *
+* primary_key_hasher ----- the function for producing primary key hashes.     *
+* secondary_key_hasher --- the function for producing secondary key hashes.   *
+* primary_key_equality --- the function for comparing primary keys.           *
+* secondary_key_equality - the function for comparing secondary keys.         *
+* allocator -------------- the allocator to copy into the map, or NULL for    *
+*                          the default 'malloc' based one.                    *
+*---------------------------------------------------------------------------+ *
+* RETURNS: 1 if the map was built, 0 if there is no memory, or if two       | *
+* primary keys or two secondary keys have the same hash. The latter covers  | *
+* duplicate keys.                                                           | *
+******************************************************************************/
+int bidirectional_static_hash_map_t_build(
+                        bidirectional_static_hash_map_t* map,
+                        key_pair_t* key_pairs,
+                        size_t count,
+                        size_t (*primary_key_hasher)  (void*),
+                        size_t (*secondary_key_hasher)(void*),
+                        int (*primary_key_equality)   (void*, void*),
+                        int (*secondary_key_equality) (void*, void*),
+                        const bidirectional_hash_map_allocator_t* allocator);
+
+/************************************************
+* Releases all the resources of the input map.| *
+*---------------------------------------------+ *
+* map - the map to destroy.                     *
+************************************************/
+void bidirectional_static_hash_map_t_destroy(
+                                        bidirectional_static_hash_map_t* map);
+
+/*****************************************************
+* Returns the number of key pairs in the input map.| *
+*--------------------------------------------------+ *
+* map - the map to query.                            *
+*----------------------------------------------+     *
+* RETURNS: the number of key pairs in this map.|     *
+*****************************************************/
+size_t bidirectional_static_hash_map_t_size(
+                                        bidirectional_static_hash_map_t* map);
+
+/******************************************************************************
+* Queries the secondary key via its primary key.|                             *
+*-----------------------------------------------+                             *
+* map --------- the map to query.                                             *
+* primary_key - the primary key to use.                                       *
+*---------------------------------------------------------------------------+ *
+* RETURNS: If the primary key is associated with a secondary key, that very | *
+* secondary key is returned. Otherwise, NULL is returned.                   | *
+******************************************************************************/
+void* bidirectional_static_hash_map_t_get_by_primary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* primary_key);
+
+/******************************************************************************
+* Queries the primary key via its secondary key.|                             *
+*-----------------------------------------------+                             *
+* map ----------- the map to query.                                           *
+* secondary_key - the secondary key to use.                                   *
+*---------------------------------------------------------------------------+ *
+* RETURNS: If the secondary key is associated with a primary key, that very | *
+* primary key is returned. Otherwise, NULL is returned.                     | *
+******************************************************************************/
+void* bidirectional_static_hash_map_t_get_by_secondary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* secondary_key);
+
+/**************************************************************************
+* Queries whether the map contains 'primary_key' as a primary key.|       *
+*-----------------------------------------------------------------+       *
+* map --------- the map to query.                                         *
+* primary_key - the primary key to query.                                 *
+*-----------------------------------------------------------------------+ *
+* RETURNS: If the primary key is in the map, returns 1. Otherwise, 0 is | *
+* returned.                                                             | *
+**************************************************************************/
+int bidirectional_static_hash_map_t_contains_primary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* primary_key);
+
+/**************************************************************************
+* Queries whether the map contains 'secondary_key' as a secondary key.|   *
+*---------------------------------------------------------------------+   *
+* map ----------- the map to query.                                       *
+* secondary_key - the secondary key to query.                             *
+*-----------------------------------------------------------------------+ *
+* RETURNS: If the secondary key is in the map, returns 1. Otherwise, 0  | *
+* is returned.                                                          | *
+**************************************************************************/
+int bidirectional_static_hash_map_t_contains_secondary_key(
+                                        bidirectional_static_hash_map_t* map,
+                                        void* secondary_key);
+
+#endif /* BIDIRECTIONAL_STATIC_HASH_MAP_H */
@@ -0,0 +1,808 @@
+#ifndef BIDIRECTIONAL_TYPED_HASH_MAP_H
+#define BIDIRECTIONAL_TYPED_HASH_MAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*****************************************************************************
+* A header-only bidirectional map specialised at compile time for concrete   *
+* key types. 'BIDIRECTIONAL_TYPED_HASH_MAP_INIT' generates a map type and    *
+* its functions for two key types and their hashers and equality functions,  *
+* much like the instantiation macros of klib's khash. The keys are stored by *
+* value, and the hashers and equality functions are called directly, so      *
+* that the compiler inlines them: the map of integer keys probes with a      *
+* couple of multiplications, loads and comparisons and no indirect calls.    *
+*                                                                            *
+* The layout is the one of the open addressing engine: a dense array of the  *
+* mappings and two linear probing arrays of slots, each holding the 32-bit   *
+* fingerprint of a key and the index of its mapping.                         *
+*****************************************************************************/
+
+/*****************************************************************
+* A slot of a probe array. The fingerprint lets most of the non- *
+* matching slots be rejected without touching the mappings.      *
+*****************************************************************/
+typedef struct typed_hash_map_slot_t {
+    
+    /***********************************************************************
+    * The lowest 32 bits of the hash of the key stored in this slot. Since *
+    * the capacity never exceeds 2^31, the fingerprint also determines the *
+    * home slot of the key.                                                *
+    ***********************************************************************/
+    uint32_t fingerprint;
+    
+    /**********************************************************
+    * The index of the mapping in the mapping array, or       *
+    * TYPED_HASH_MAP_EMPTY_SLOT if this slot is not occupied. *
+    **********************************************************/
+    uint32_t mapping_index;
+}
+typed_hash_map_slot_t;
+
+/********************************************************
+* The mapping index denoting a slot that is not in use. *
+********************************************************/
+#define TYPED_HASH_MAP_EMPTY_SLOT ((uint32_t) 0xFFFFFFFFUL)
+
+/**************************************************************
+* The outcomes of the put functions of the generated maps: no *
+* memory for a new mapping, a new mapping, or a mapping whose *
+* other key was replaced.                                     *
+**************************************************************/
+#define BIDIRECTIONAL_TYPED_HASH_MAP_FAILED   0
+#define BIDIRECTIONAL_TYPED_HASH_MAP_ADDED    1
+#define BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED 2
+
+#define TYPED_HASH_MAP_MINIMUM_CAPACITY    8
+#define TYPED_HASH_MAP_MINIMUM_LOAD_FACTOR 0.2f
+#define TYPED_HASH_MAP_MAXIMUM_LOAD_FACTOR 0.9f
+
+/******************************************************************
+* The largest capacity of a probe array. Fingerprints are 32 bits *
+* wide, and they must determine the home slot of a key.           *
+******************************************************************/
+#define TYPED_HASH_MAP_MAXIMUM_CAPACITY (((size_t) 1) << 31)
+
+/********************************************************************
+* The 64-bit golden ratio, an odd multiplier with well spread bits. *
+********************************************************************/
+#define TYPED_HASH_MAP_MULTIPLIER (((uint64_t) 0x9E3779B9UL << 32) | \
+                                   (uint64_t) 0x7F4A7C15UL)
+
+/***************************************************************************
+* Hashes an integer key of at most 64 bits with a single multiplication. | *
+* The high half of the key is folded into the low one first: the home    | *
+* slot comes from the low bits of the fingerprint, which only the low    | *
+* bits of the multiplied value reach, so keys differing only in their    | *
+* high bits, such as IDs carrying a shard number at the top, would all   | *
+* share one home slot otherwise. The upper half of the product becomes   | *
+* the fingerprint. Can be passed to 'BIDIRECTIONAL_TYPED_HASH_MAP_INIT'  | *
+* as a hasher, and evaluates 'key' once.                                 | *
+*------------------------------------------------------------------------+ *
+* key - the integer key.                                                   *
+*-------------------+                                                      *
+* RETURNS: the hash.|                                                      *
+***************************************************************************/
+#define BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH(key) \
+    typed_hash_map_hash_integer((uint64_t)(key))
+
+/****************************************************************
+* Compares two keys with '=='. Suits integer and pointer keys.| *
+*-------------------------------------------------------------+ *
+* key1 - the first key.                                         *
+* key2 - the second key.                                        *
+*-----------------------------------------------+               *
+* RETURNS: 1 if the keys are equal, 0 otherwise.|               *
+****************************************************************/
+#define BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_EQUALITY(key1, key2) \
+    ((key1) == (key2))
+
+/******************************************************************
+* Every function of this header is static, so that each program   *
+* file gets its own copy the compiler may inline; the ones a file *
+* does not call must not be reported as unused.                   *
+******************************************************************/
+#ifdef __GNUC__
+#define TYPED_HASH_MAP_FUNCTION static __inline__ __attribute__((unused))
+#else
+#define TYPED_HASH_MAP_FUNCTION static
+#endif
+
+/**********************************************************
+* Implements 'BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH'. *
+**********************************************************/
+TYPED_HASH_MAP_FUNCTION
+size_t typed_hash_map_hash_integer(uint64_t key)
+{
+    return (size_t)(((key ^ (key >> 32)) * TYPED_HASH_MAP_MULTIPLIER) >> 32);
+}
+
+/*****************************************************************
+* Allocates a probe array of 'capacity' slots, all of them free. *
+*****************************************************************/
+TYPED_HASH_MAP_FUNCTION
+typed_hash_map_slot_t* typed_hash_map_allocate_slots(size_t capacity)
+{
+    typed_hash_map_slot_t* slots =
+        malloc(capacity * sizeof(typed_hash_map_slot_t));
+    
+    if (slots)
+    {
+        memset(slots, 0xFF, capacity * sizeof(typed_hash_map_slot_t));
+    }
+    
+    return slots;
+}
+
+/*****************************************************************
+* Stores a slot into the first free slot of 'slots' on the probe *
+* sequence of 'fingerprint'.                                     *
+*****************************************************************/
+TYPED_HASH_MAP_FUNCTION
+void typed_hash_map_insert_slot(typed_hash_map_slot_t* slots,
+                                size_t modulo_mask,
+                                uint32_t fingerprint,
+                                uint32_t mapping_index)
+{
+    size_t index = fingerprint & modulo_mask;
+    
+    while (slots[index].mapping_index != TYPED_HASH_MAP_EMPTY_SLOT)
+    {
+        index = (index + 1) & modulo_mask;
+    }
+    
+    slots[index].fingerprint   = fingerprint;
+    slots[index].mapping_index = mapping_index;
+}
+
+/************************************************************************
+* Frees the slot at 'index'. The slots following it in the same run are *
+* shifted back into the hole unless their home slot lies past the hole, *
+* so that no tombstones are needed and every run stays contiguous.      *
+************************************************************************/
+TYPED_HASH_MAP_FUNCTION
+void typed_hash_map_delete_slot(typed_hash_map_slot_t* slots,
+                                size_t modulo_mask,
+                                size_t index)
+{
+    size_t hole = index;
+    size_t next = (index + 1) & modulo_mask;
+    
+    while (slots[next].mapping_index != TYPED_HASH_MAP_EMPTY_SLOT)
+    {
+        if (((next - (slots[next].fingerprint & modulo_mask)) & modulo_mask) >=
+            ((next - hole) & modulo_mask))
+        {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+        
+        next = (next + 1) & modulo_mask;
+    }
+    
+    slots[hole].mapping_index = TYPED_HASH_MAP_EMPTY_SLOT;
+}
+
+/****************************************************************
+* Returns the index of the slot referring to 'mapping_index' on *
+* the probe sequence of 'fingerprint'. The slot must exist.     *
+****************************************************************/
+TYPED_HASH_MAP_FUNCTION
+size_t typed_hash_map_find_slot_of_mapping(typed_hash_map_slot_t* slots,
+                                           size_t modulo_mask,
+                                           uint32_t fingerprint,
+                                           uint32_t mapping_index)
+{
+    size_t index = fingerprint & modulo_mask;
+    
+    while (slots[index].mapping_index != mapping_index)
+    {
+        index = (index + 1) & modulo_mask;
+    }
+    
+    return index;
+}
+
+/*******************************************************************************
+* Generates a bidirectional map of the key types 'K1' and 'K2'.|               *
+*--------------------------------------------------------------+               *
+* name -- the prefix of the generated types and functions.                     *
+* K1 ---- the type of the primary keys.                                        *
+* K2 ---- the type of the secondary keys.                                      *
+* hash1 - the function or macro hashing a 'K1' into a 'size_t'.                *
+* eq1 --- the function or macro returning nonzero for two equal 'K1's.         *
+* hash2 - the function or macro hashing a 'K2' into a 'size_t'.                *
+* eq2 --- the function or macro returning nonzero for two equal 'K2's.         *
+*------------------------------------------------------------------------------*
+* The generated types are 'name_t', the map, and 'name_mapping_t', a mapping   *
+* of it. 'map->mappings[0]' through 'map->mappings[map->size - 1]' are all     *
+* the mappings, so iterating is a loop over them. The macro expands to         *
+* definitions only and takes no trailing semicolon. The generated functions    *
+* mirror the API of the open addressing engine:                                *
+*                                                                              *
+* int name_t_init(name_t* map, size_t initial_capacity, float load_factor)     *
+*     builds an empty map, returning 1 on success and 0 on no memory. The      *
+*     load factor is clamped to [0.2, 0.9].                                    *
+* void name_t_destroy(name_t* map)                                             *
+*     releases all the resources of the map.                                   *
+* size_t name_t_size(name_t* map)                                              *
+*     returns the number of mappings.                                          *
+* int name_t_put_by_primary(name_t* map, K1 primary_key, K2 secondary_key,     *
+*                           K2* old_secondary_key_ptr)                         *
+* int name_t_put_by_secondary(name_t* map, K1 primary_key, K2 secondary_key,   *
+*                             K1* old_primary_key_ptr)                         *
+*     associate the keys. Return BIDIRECTIONAL_TYPED_HASH_MAP_ADDED for a new  *
+*     mapping, BIDIRECTIONAL_TYPED_HASH_MAP_FAILED on no memory, and           *
+*     BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED if the given key was mapped, in    *
+*     which case its old opposite key is stored into the pointer unless it is  *
+*     NULL.                                                                    *
+* int name_t_get_by_primary_key(name_t* map, K1 primary_key,                   *
+*                               K2* secondary_key_ptr)                         *
+* int name_t_get_by_secondary_key(name_t* map, K2 secondary_key,               *
+*                                 K1* primary_key_ptr)                         *
+*     return 1 and store the opposite key into the pointer unless it is NULL   *
+*     if the key is mapped, and 0 otherwise.                                   *
+* int name_t_contains_primary_key(name_t* map, K1 primary_key)                 *
+* int name_t_contains_secondary_key(name_t* map, K2 secondary_key)             *
+*     return 1 if the key is mapped, and 0 otherwise.                          *
+* int name_t_remove_by_primary_key(name_t* map, K1 primary_key,                *
+*                                  K2* secondary_key_ptr)                      *
+* int name_t_remove_by_secondary_key(name_t* map, K2 secondary_key,            *
+*                                    K1* primary_key_ptr)                      *
+*     remove the mapping of the key, returning 1 and storing the opposite key  *
+*     into the pointer unless it is NULL if it was mapped, and 0 otherwise.    *
+*******************************************************************************/
+#define BIDIRECTIONAL_TYPED_HASH_MAP_INIT(name, K1, K2,                        \
+                                          hash1, eq1, hash2, eq2)              \
+    BIDIRECTIONAL_TYPED_HASH_MAP_TYPE(name, K1, K2)                            \
+    BIDIRECTIONAL_TYPED_HASH_MAP_IMPL(name,                                    \
+                                      TYPED_HASH_MAP_FUNCTION,                 \
+                                      K1,                                      \
+                                      K2,                                      \
+                                      hash1,                                   \
+                                      eq1,                                     \
+                                      hash2,                                   \
+                                      eq2)
+
+/******************************************************************
+* Generates the map type and the mapping type of the typed map of *
+* the key types 'K1' and 'K2', without any functions.             *
+******************************************************************/
+#define BIDIRECTIONAL_TYPED_HASH_MAP_TYPE(name, K1, K2)                        \
+typedef struct name##_mapping_t {                                              \
+    K1       primary_key;                                                      \
+    K2       secondary_key;                                                    \
+    uint32_t primary_key_fingerprint;                                          \
+    uint32_t secondary_key_fingerprint;                                        \
+}                                                                              \
+name##_mapping_t;                                                              \
+                                                                               \
+typedef struct name##_t {                                                      \
+    size_t                 size;                                               \
+    size_t                 capacity;                                           \
+    size_t                 modulo_mask;                                        \
+    float                  load_factor;                                        \
+    name##_mapping_t*      mappings;                                           \
+    size_t                 mappings_capacity;                                  \
+    typed_hash_map_slot_t* primary_key_table;                                  \
+    typed_hash_map_slot_t* secondary_key_table;                                \
+}                                                                              \
+name##_t;
+
+/**************************************************************************
+* Generates the functions of the typed map 'name_t', whose type must have *
+* been generated already. The public functions are declared with 'scope', *
+* so that a program file may compile them once with 'extern' behind a     *
+* header of its own, while the helpers they call stay static.             *
+**************************************************************************/
+#define BIDIRECTIONAL_TYPED_HASH_MAP_IMPL(name, scope, K1, K2,                 \
+                                          hash1, eq1, hash2, eq2)              \
+scope                                                                          \
+int name##_t_init(name##_t* map, size_t initial_capacity, float load_factor)   \
+{                                                                              \
+    size_t capacity = TYPED_HASH_MAP_MINIMUM_CAPACITY;                         \
+                                                                               \
+    if (!map)                                                                  \
+    {                                                                          \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    while (capacity < initial_capacity &&                                      \
+           capacity < TYPED_HASH_MAP_MAXIMUM_CAPACITY)                         \
+    {                                                                          \
+        capacity <<= 1;                                                        \
+    }                                                                          \
+                                                                               \
+    map->primary_key_table   = typed_hash_map_allocate_slots(capacity);        \
+    map->secondary_key_table = typed_hash_map_allocate_slots(capacity);        \
+                                                                               \
+    if (!map->primary_key_table || !map->secondary_key_table)                  \
+    {                                                                          \
+        free(map->primary_key_table);                                          \
+        free(map->secondary_key_table);                                        \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    if (!(load_factor >= TYPED_HASH_MAP_MINIMUM_LOAD_FACTOR))                  \
+    {                                                                          \
+        load_factor = TYPED_HASH_MAP_MINIMUM_LOAD_FACTOR;                      \
+    }                                                                          \
+    else if (load_factor > TYPED_HASH_MAP_MAXIMUM_LOAD_FACTOR)                 \
+    {                                                                          \
+        load_factor = TYPED_HASH_MAP_MAXIMUM_LOAD_FACTOR;                      \
+    }                                                                          \
+                                                                               \
+    map->size              = 0;                                                \
+    map->capacity          = capacity;                                         \
+    map->modulo_mask       = capacity - 1;                                     \
+    map->load_factor       = load_factor;                                      \
+    map->mappings          = NULL;                                             \
+    map->mappings_capacity = 0;                                                \
+    return 1;                                                                  \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+void name##_t_destroy(name##_t* map)                                           \
+{                                                                              \
+    if (!map)                                                                  \
+    {                                                                          \
+        return;                                                                \
+    }                                                                          \
+                                                                               \
+    free(map->mappings);                                                       \
+    free(map->primary_key_table);                                              \
+    free(map->secondary_key_table);                                            \
+                                                                               \
+    map->mappings            = NULL;                                           \
+    map->primary_key_table   = NULL;                                           \
+    map->secondary_key_table = NULL;                                           \
+    map->size                = 0;                                              \
+    map->mappings_capacity   = 0;                                              \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+size_t name##_t_size(name##_t* map)                                            \
+{                                                                              \
+    return map->size;                                                          \
+}                                                                              \
+                                                                               \
+TYPED_HASH_MAP_FUNCTION                                                        \
+size_t name##_t_find_primary_slot(name##_t* map,                               \
+                                  K1 primary_key,                              \
+                                  uint32_t* fingerprint_ptr)                   \
+{                                                                              \
+    uint32_t fingerprint = (uint32_t) hash1(primary_key);                      \
+    size_t index = fingerprint & map->modulo_mask;                             \
+    typed_hash_map_slot_t* slot;                                               \
+                                                                               \
+    *fingerprint_ptr = fingerprint;                                            \
+                                                                               \
+    while ((slot = &map->primary_key_table[index])->mapping_index              \
+           != TYPED_HASH_MAP_EMPTY_SLOT)                                       \
+    {                                                                          \
+        if (slot->fingerprint == fingerprint &&                                \
+            eq1(map->mappings[slot->mapping_index].primary_key, primary_key))  \
+        {                                                                      \
+            return index;                                                      \
+        }                                                                      \
+                                                                               \
+        index = (index + 1) & map->modulo_mask;                                \
+    }                                                                          \
+                                                                               \
+    return map->capacity;                                                      \
+}                                                                              \
+                                                                               \
+TYPED_HASH_MAP_FUNCTION                                                        \
+size_t name##_t_find_secondary_slot(name##_t* map,                             \
+                                    K2 secondary_key,                          \
+                                    uint32_t* fingerprint_ptr)                 \
+{                                                                              \
+    uint32_t fingerprint = (uint32_t) hash2(secondary_key);                    \
+    size_t index = fingerprint & map->modulo_mask;                             \
+    typed_hash_map_slot_t* slot;                                               \
+                                                                               \
+    *fingerprint_ptr = fingerprint;                                            \
+                                                                               \
+    while ((slot = &map->secondary_key_table[index])->mapping_index            \
+           != TYPED_HASH_MAP_EMPTY_SLOT)                                       \
+    {                                                                          \
+        if (slot->fingerprint == fingerprint &&                                \
+            eq2(map->mappings[slot->mapping_index].secondary_key,              \
+                secondary_key))                                                \
+        {                                                                      \
+            return index;                                                      \
+        }                                                                      \
+                                                                               \
+        index = (index + 1) & map->modulo_mask;                                \
+    }                                                                          \
+                                                                               \
+    return map->capacity;                                                      \
+}                                                                              \
+                                                                               \
+TYPED_HASH_MAP_FUNCTION                                                        \
+int name##_t_expand(name##_t* map)                                             \
+{                                                                              \
+    size_t i;                                                                  \
+    size_t next_capacity = map->capacity << 1;                                 \
+    size_t next_modulo_mask = next_capacity - 1;                               \
+    typed_hash_map_slot_t* next_primary_key_table;                             \
+    typed_hash_map_slot_t* next_secondary_key_table;                           \
+                                                                               \
+    if (next_capacity > TYPED_HASH_MAP_MAXIMUM_CAPACITY)                       \
+    {                                                                          \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    next_primary_key_table   = typed_hash_map_allocate_slots(next_capacity);   \
+    next_secondary_key_table = typed_hash_map_allocate_slots(next_capacity);   \
+                                                                               \
+    if (!next_primary_key_table || !next_secondary_key_table)                  \
+    {                                                                          \
+        free(next_primary_key_table);                                          \
+        free(next_secondary_key_table);                                        \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    free(map->primary_key_table);                                              \
+    free(map->secondary_key_table);                                            \
+                                                                               \
+    map->primary_key_table   = next_primary_key_table;                         \
+    map->secondary_key_table = next_secondary_key_table;                       \
+    map->capacity            = next_capacity;                                  \
+    map->modulo_mask         = next_modulo_mask;                               \
+                                                                               \
+    for (i = 0; i < map->size; ++i)                                            \
+    {                                                                          \
+        typed_hash_map_insert_slot(next_primary_key_table,                     \
+                                   next_modulo_mask,                           \
+                                   map->mappings[i].primary_key_fingerprint,   \
+                                   (uint32_t) i);                              \
+                                                                               \
+        typed_hash_map_insert_slot(next_secondary_key_table,                   \
+                                   next_modulo_mask,                           \
+                                   map->mappings[i].secondary_key_fingerprint, \
+                                   (uint32_t) i);                              \
+    }                                                                          \
+                                                                               \
+    return 1;                                                                  \
+}                                                                              \
+                                                                               \
+TYPED_HASH_MAP_FUNCTION                                                        \
+int name##_t_add_new_mapping(name##_t* map,                                    \
+                             K1 primary_key,                                   \
+                             uint32_t primary_key_fingerprint,                 \
+                             K2 secondary_key,                                 \
+                             uint32_t secondary_key_fingerprint)               \
+{                                                                              \
+    name##_mapping_t* mapping;                                                 \
+    name##_mapping_t* next_mappings;                                           \
+    size_t next_mappings_capacity;                                             \
+                                                                               \
+    if (map->size + 1 > map->capacity * map->load_factor &&                    \
+        !name##_t_expand(map))                                                 \
+    {                                                                          \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    if (map->size == map->mappings_capacity)                                   \
+    {                                                                          \
+        next_mappings_capacity = map->mappings_capacity ?                      \
+                                 map->mappings_capacity << 1 :                 \
+                                 TYPED_HASH_MAP_MINIMUM_CAPACITY;              \
+                                                                               \
+        next_mappings = realloc(map->mappings,                                 \
+                                next_mappings_capacity *                       \
+                                sizeof(name##_mapping_t));                     \
+                                                                               \
+        if (!next_mappings)                                                    \
+        {                                                                      \
+            return 0;                                                          \
+        }                                                                      \
+                                                                               \
+        map->mappings          = next_mappings;                                \
+        map->mappings_capacity = next_mappings_capacity;                       \
+    }                                                                          \
+                                                                               \
+    mapping = &map->mappings[map->size];                                       \
+    mapping->primary_key               = primary_key;                          \
+    mapping->secondary_key             = secondary_key;                        \
+    mapping->primary_key_fingerprint   = primary_key_fingerprint;              \
+    mapping->secondary_key_fingerprint = secondary_key_fingerprint;            \
+                                                                               \
+    typed_hash_map_insert_slot(map->primary_key_table,                         \
+                               map->modulo_mask,                               \
+                               primary_key_fingerprint,                        \
+                               (uint32_t) map->size);                          \
+                                                                               \
+    typed_hash_map_insert_slot(map->secondary_key_table,                       \
+                               map->modulo_mask,                               \
+                               secondary_key_fingerprint,                      \
+                               (uint32_t) map->size);                          \
+                                                                               \
+    map->size++;                                                               \
+    return 1;                                                                  \
+}                                                                              \
+                                                                               \
+TYPED_HASH_MAP_FUNCTION                                                        \
+void name##_t_remove_mapping(name##_t* map,                                    \
+                             uint32_t mapping_index,                           \
+                             size_t primary_slot_index,                        \
+                             size_t secondary_slot_index)                      \
+{                                                                              \
+    uint32_t last_mapping_index = (uint32_t)(map->size - 1);                   \
+    name##_mapping_t* last_mapping;                                            \
+                                                                               \
+    typed_hash_map_delete_slot(map->primary_key_table,                         \
+                               map->modulo_mask,                               \
+                               primary_slot_index);                            \
+                                                                               \
+    typed_hash_map_delete_slot(map->secondary_key_table,                       \
+                               map->modulo_mask,                               \
+                               secondary_slot_index);                          \
+                                                                               \
+    if (mapping_index != last_mapping_index)                                   \
+    {                                                                          \
+        last_mapping = &map->mappings[last_mapping_index];                     \
+                                                                               \
+        map->primary_key_table[typed_hash_map_find_slot_of_mapping(            \
+                                    map->primary_key_table,                    \
+                                    map->modulo_mask,                          \
+                                    last_mapping->primary_key_fingerprint,     \
+                                    last_mapping_index)].mapping_index =       \
+            mapping_index;                                                     \
+                                                                               \
+        map->secondary_key_table[typed_hash_map_find_slot_of_mapping(          \
+                                    map->secondary_key_table,                  \
+                                    map->modulo_mask,                          \
+                                    last_mapping->secondary_key_fingerprint,   \
+                                    last_mapping_index)].mapping_index =       \
+            mapping_index;                                                     \
+                                                                               \
+        map->mappings[mapping_index] = *last_mapping;                          \
+    }                                                                          \
+                                                                               \
+    map->size--;                                                               \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+int name##_t_put_by_primary(name##_t* map,                                     \
+                            K1 primary_key,                                    \
+                            K2 secondary_key,                                  \
+                            K2* old_secondary_key_ptr)                         \
+{                                                                              \
+    uint32_t primary_key_fingerprint;                                          \
+    uint32_t mapping_index;                                                    \
+    size_t primary_slot_index = name##_t_find_primary_slot(                    \
+                                                    map,                       \
+                                                    primary_key,               \
+                                                    &primary_key_fingerprint); \
+    name##_mapping_t* mapping;                                                 \
+                                                                               \
+    if (primary_slot_index == map->capacity)                                   \
+    {                                                                          \
+        return name##_t_add_new_mapping(map,                                   \
+                                        primary_key,                           \
+                                        primary_key_fingerprint,               \
+                                        secondary_key,                         \
+                                        (uint32_t) hash2(secondary_key)) ?     \
+               BIDIRECTIONAL_TYPED_HASH_MAP_ADDED :                            \
+               BIDIRECTIONAL_TYPED_HASH_MAP_FAILED;                            \
+    }                                                                          \
+                                                                               \
+    mapping_index = map->primary_key_table[primary_slot_index].mapping_index;  \
+    mapping = &map->mappings[mapping_index];                                   \
+                                                                               \
+    if (old_secondary_key_ptr)                                                 \
+    {                                                                          \
+        *old_secondary_key_ptr = mapping->secondary_key;                       \
+    }                                                                          \
+                                                                               \
+    typed_hash_map_delete_slot(map->secondary_key_table,                       \
+                               map->modulo_mask,                               \
+                               typed_hash_map_find_slot_of_mapping(            \
+                                    map->secondary_key_table,                  \
+                                    map->modulo_mask,                          \
+                                    mapping->secondary_key_fingerprint,        \
+                                    mapping_index));                           \
+                                                                               \
+    mapping->secondary_key             = secondary_key;                        \
+    mapping->secondary_key_fingerprint = (uint32_t) hash2(secondary_key);      \
+                                                                               \
+    typed_hash_map_insert_slot(map->secondary_key_table,                       \
+                               map->modulo_mask,                               \
+                               mapping->secondary_key_fingerprint,             \
+                               mapping_index);                                 \
+                                                                               \
+    return BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED;                              \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+int name##_t_put_by_secondary(name##_t* map,                                   \
+                              K1 primary_key,                                  \
+                              K2 secondary_key,                                \
+                              K1* old_primary_key_ptr)                         \
+{                                                                              \
+    uint32_t secondary_key_fingerprint;                                        \
+    uint32_t mapping_index;                                                    \
+    size_t secondary_slot_index = name##_t_find_secondary_slot(                \
+                                                map,                           \
+                                                secondary_key,                 \
+                                                &secondary_key_fingerprint);   \
+    name##_mapping_t* mapping;                                                 \
+                                                                               \
+    if (secondary_slot_index == map->capacity)                                 \
+    {                                                                          \
+        return name##_t_add_new_mapping(map,                                   \
+                                        primary_key,                           \
+                                        (uint32_t) hash1(primary_key),         \
+                                        secondary_key,                         \
+                                        secondary_key_fingerprint) ?           \
+               BIDIRECTIONAL_TYPED_HASH_MAP_ADDED :                            \
+               BIDIRECTIONAL_TYPED_HASH_MAP_FAILED;                            \
+    }                                                                          \
+                                                                               \
+    mapping_index =                                                            \
+        map->secondary_key_table[secondary_slot_index].mapping_index;          \
+    mapping = &map->mappings[mapping_index];                                   \
+                                                                               \
+    if (old_primary_key_ptr)                                                   \
+    {                                                                          \
+        *old_primary_key_ptr = mapping->primary_key;                           \
+    }                                                                          \
+                                                                               \
+    typed_hash_map_delete_slot(map->primary_key_table,                         \
+                               map->modulo_mask,                               \
+                               typed_hash_map_find_slot_of_mapping(            \
+                                    map->primary_key_table,                    \
+                                    map->modulo_mask,                          \
+                                    mapping->primary_key_fingerprint,          \
+                                    mapping_index));                           \
+                                                                               \
+    mapping->primary_key             = primary_key;                            \
+    mapping->primary_key_fingerprint = (uint32_t) hash1(primary_key);          \
+                                                                               \
+    typed_hash_map_insert_slot(map->primary_key_table,                         \
+                               map->modulo_mask,                               \
+                               mapping->primary_key_fingerprint,               \
+                               mapping_index);                                 \
+                                                                               \
+    return BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED;                              \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+int name##_t_get_by_primary_key(name##_t* map,                                 \
+                                K1 primary_key,                                \
+                                K2* secondary_key_ptr)                         \
+{                                                                              \
+    uint32_t fingerprint;                                                      \
+    size_t slot_index = name##_t_find_primary_slot(map,                        \
+                                                   primary_key,                \
+                                                   &fingerprint);              \
+                                                                               \
+    if (slot_index == map->capacity)                                           \
+    {                                                                          \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    if (secondary_key_ptr)                                                     \
+    {                                                                          \
+        *secondary_key_ptr =                                                   \
+            map->mappings[map->primary_key_table[slot_index].mapping_index]    \
+                .secondary_key;                                                \
+    }                                                                          \
+                                                                               \
+    return 1;                                                                  \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+int name##_t_get_by_secondary_key(name##_t* map,                               \
+                                  K2 secondary_key,                            \
+                                  K1* primary_key_ptr)                         \
+{                                                                              \
+    uint32_t fingerprint;                                                      \
+    size_t slot_index = name##_t_find_secondary_slot(map,                      \
+                                                     secondary_key,            \
+                                                     &fingerprint);            \
+                                                                               \
+    if (slot_index == map->capacity)                                           \
+    {                                                                          \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    if (primary_key_ptr)                                                       \
+    {                                                                          \
+        *primary_key_ptr =                                                     \
+            map->mappings[map->secondary_key_table[slot_index].mapping_index]  \
+                .primary_key;                                                  \
+    }                                                                          \
+                                                                               \
+    return 1;                                                                  \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+int name##_t_contains_primary_key(name##_t* map, K1 primary_key)               \
+{                                                                              \
+    return name##_t_get_by_primary_key(map, primary_key, NULL);                \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+int name##_t_contains_secondary_key(name##_t* map, K2 secondary_key)           \
+{                                                                              \
+    return name##_t_get_by_secondary_key(map, secondary_key, NULL);            \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+int name##_t_remove_by_primary_key(name##_t* map,                              \
+                                   K1 primary_key,                             \
+                                   K2* secondary_key_ptr)                      \
+{                                                                              \
+    uint32_t fingerprint;                                                      \
+    uint32_t mapping_index;                                                    \
+    size_t primary_slot_index = name##_t_find_primary_slot(map,                \
+                                                           primary_key,        \
+                                                           &fingerprint);      \
+    name##_mapping_t* mapping;                                                 \
+                                                                               \
+    if (primary_slot_index == map->capacity)                                   \
+    {                                                                          \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    mapping_index = map->primary_key_table[primary_slot_index].mapping_index;  \
+    mapping = &map->mappings[mapping_index];                                   \
+                                                                               \
+    if (secondary_key_ptr)                                                     \
+    {                                                                          \
+        *secondary_key_ptr = mapping->secondary_key;                           \
+    }                                                                          \
+                                                                               \
+    name##_t_remove_mapping(map,                                               \
+                            mapping_index,                                     \
+                            primary_slot_index,                                \
+                            typed_hash_map_find_slot_of_mapping(               \
+                                    map->secondary_key_table,                  \
+                                    map->modulo_mask,                          \
+                                    mapping->secondary_key_fingerprint,        \
+                                    mapping_index));                           \
+    return 1;                                                                  \
+}                                                                              \
+                                                                               \
+scope                                                                          \
+int name##_t_remove_by_secondary_key(name##_t* map,                            \
+                                     K2 secondary_key,                         \
+                                     K1* primary_key_ptr)                      \
+{                                                                              \
+    uint32_t fingerprint;                                                      \
+    uint32_t mapping_index;                                                    \
+    size_t secondary_slot_index = name##_t_find_secondary_slot(map,            \
+                                                               secondary_key,  \
+                                                               &fingerprint);  \
+    name##_mapping_t* mapping;                                                 \
+                                                                               \
+    if (secondary_slot_index == map->capacity)                                 \
+    {                                                                          \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    mapping_index =                                                            \
+        map->secondary_key_table[secondary_slot_index].mapping_index;          \
+    mapping = &map->mappings[mapping_index];                                   \
+                                                                               \
+    if (primary_key_ptr)                                                       \
+    {                                                                          \
+        *primary_key_ptr = mapping->primary_key;                               \
+    }                                                                          \
+                                                                               \
+    name##_t_remove_mapping(map,                                               \
+                            mapping_index,                                     \
+                            typed_hash_map_find_slot_of_mapping(               \
+                                    map->primary_key_table,                    \
+                                    map->modulo_mask,                          \
+                                    mapping->primary_key_fingerprint,          \
+                                    mapping_index),                            \
+                            secondary_slot_index);                             \
+    return 1;                                                                  \
+}
+
+#endif /* BIDIRECTIONAL_TYPED_HASH_MAP_H */
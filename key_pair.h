@@ -0,0 +1,30 @@
+#ifndef KEY_PAIR_H
+#define KEY_PAIR_H
+
+#include <stdlib.h>
+
+typedef struct key_pair_t {
+    
+    /*******************
+    * The primary key. *
+    *******************/
+    void* primary_key;
+    
+    /*********************
+    * The secondary key. *
+    *********************/
+    void* secondary_key;
+    
+    /*******************************
+    * The hash of the primary key. *
+    *******************************/
+    size_t primary_key_hash;
+    
+    /********************************
+    * The hash of the secondary key *
+    ********************************/
+    size_t secondary_key_hash;
+}
+key_pair_t;
+
+#endif /* KEY_PAIR_H */
@@ -1,7 +1,19 @@
+#include "bidirectional_concurrent_hash_map.h"
+#include "bidirectional_frozen_hash_map.h"
 #include "bidirectional_hash_map.h"
+#include "bidirectional_hash_map_2.h"
+#include "bidirectional_hash_map_key_functions.h"
+#include "bidirectional_int_map.h"
+#include "bidirectional_open_hash_map.h"
+#include "bidirectional_snapshot_hash_map.h"
+#include "bidirectional_static_hash_map.h"
+#include "bidirectional_typed_hash_map.h"
+#include <pthread.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define ASSERT(CONDITION) assert(CONDITION, #CONDITION, __FILE__, __LINE__);
 
@@ -40,6 +52,2914 @@ int secondary_key_equality(void* a, void* b)
     return primary_key_equality(a, b);
 }
 
+static void test_fused_mappings(void* error_sentinel)
+{
+    size_t i;
+    bidirectional_hash_map_t map;
+    
+    ASSERT(bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        1.0f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        error_sentinel,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS));
+    
+    for (i = 0; i < 100; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 1000));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_size(&map) == 100);
+    
+    for (i = 0; i < 100; i += 2)
+    {
+        ASSERT(bidirectional_hash_map_t_remove_by_primary_key(&map, (void*) i)
+               == (void*)(i + 1000));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_size(&map) == 50);
+    
+    for (i = 0; i < 100; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_contains_primary_key(&map, (void*) i)
+               == (i & 1));
+        ASSERT(bidirectional_hash_map_t_contains_secondary_key(
+                                                &map,
+                                                (void*)(i + 1000)) == (i & 1));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_remove_by_secondary_key(&map,
+                                                            (void*) 1001)
+           == (void*) 1);
+    ASSERT(bidirectional_hash_map_t_size(&map) == 49);
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+static void test_open_hash_map(void* error_sentinel)
+{
+    size_t i;
+    size_t key;
+    size_t next_secondary_key = 100000;
+    size_t random_state = 12345;
+    bidirectional_hash_map_t map;
+    bidirectional_open_hash_map_t open_map;
+    bidirectional_open_hash_map_iterator_t iterator;
+    void* primary_key;
+    void* secondary_key;
+    
+    bidirectional_hash_map_t_init(&map,
+                                  0,
+                                  1.0f,
+                                  primary_key_hasher,
+                                  secondary_key_hasher,
+                                  primary_key_equality,
+                                  secondary_key_equality,
+                                  error_sentinel);
+    
+    ASSERT(bidirectional_open_hash_map_t_init(&open_map,
+                                              0,
+                                              0.75f,
+                                              primary_key_hasher,
+                                              secondary_key_hasher,
+                                              primary_key_equality,
+                                              secondary_key_equality,
+                                              error_sentinel));
+    
+    /**************************************************************
+    * Run the same random operations on both the engines and make *
+    * sure they agree.                                            *
+    **************************************************************/
+    for (i = 0; i < 20000; ++i)
+    {
+        random_state = random_state * 1103515245 + 12345;
+        key = (random_state >> 8) % 1000;
+        
+        switch ((random_state >> 4) % 4)
+        {
+            case 0:
+            case 1:
+                ASSERT(bidirectional_hash_map_t_put_by_primary(
+                                            &map,
+                                            (void*) key,
+                                            (void*) next_secondary_key) ==
+                       bidirectional_open_hash_map_t_put_by_primary(
+                                            &open_map,
+                                            (void*) key,
+                                            (void*) next_secondary_key));
+                next_secondary_key++;
+                break;
+            
+            case 2:
+                ASSERT(bidirectional_hash_map_t_remove_by_primary_key(
+                                                            &map,
+                                                            (void*) key) ==
+                       bidirectional_open_hash_map_t_remove_by_primary_key(
+                                                            &open_map,
+                                                            (void*) key));
+                break;
+            
+            case 3:
+                key = next_secondary_key - 1 - key;
+                ASSERT(bidirectional_hash_map_t_remove_by_secondary_key(
+                                                            &map,
+                                                            (void*) key) ==
+                       bidirectional_open_hash_map_t_remove_by_secondary_key(
+                                                            &open_map,
+                                                            (void*) key));
+                break;
+        }
+        
+        ASSERT(bidirectional_hash_map_t_size(&map) ==
+               bidirectional_open_hash_map_t_size(&open_map));
+    }
+    
+    for (key = 0; key < 1000; ++key)
+    {
+        secondary_key = bidirectional_open_hash_map_t_get_by_primary_key(
+                                                                &open_map,
+                                                                (void*) key);
+        
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, (void*) key)
+               == secondary_key);
+        
+        if (secondary_key)
+        {
+            ASSERT(bidirectional_open_hash_map_t_get_by_secondary_key(
+                                                    &open_map,
+                                                    secondary_key) ==
+                   (void*) key);
+        }
+    }
+    
+    bidirectional_open_hash_map_iterator_t_init(&open_map, &iterator);
+    
+    for (i = 0; i < bidirectional_open_hash_map_t_size(&open_map); ++i)
+    {
+        ASSERT(bidirectional_open_hash_map_iterator_t_next(&iterator,
+                                                           &primary_key,
+                                                           &secondary_key));
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, primary_key)
+               == secondary_key);
+    }
+    
+    ASSERT(!bidirectional_open_hash_map_iterator_t_has_next(&iterator));
+    
+    bidirectional_hash_map_t_destroy(&map);
+    bidirectional_open_hash_map_t_destroy(&open_map);
+}
+
+/*********************************************************************
+* Checks that identity-hashed small integer keys get differing tags: *
+* the group compare would accept every occupied slot otherwise.      *
+*********************************************************************/
+static void test_open_hash_map_tags(void* error_sentinel)
+{
+    size_t i;
+    size_t distinct_tags = 0;
+    int seen[256] = { 0 };
+    unsigned char* control_bytes;
+    bidirectional_open_hash_map_t open_map;
+    
+    ASSERT(bidirectional_open_hash_map_t_init(&open_map,
+                                              0,
+                                              0.75f,
+                                              primary_key_hasher,
+                                              secondary_key_hasher,
+                                              primary_key_equality,
+                                              secondary_key_equality,
+                                              error_sentinel));
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_open_hash_map_t_put_by_primary(
+                                            &open_map,
+                                            (void*) i,
+                                            (void*)(i + 1000)) == NULL);
+    }
+    
+    control_bytes = (unsigned char*)(open_map.primary_key_table +
+                                     open_map.capacity);
+    
+    for (i = 0; i < open_map.capacity; ++i)
+    {
+        if (control_bytes[i] & 0x80 && !seen[control_bytes[i]])
+        {
+            seen[control_bytes[i]] = 1;
+            distinct_tags++;
+        }
+    }
+    
+    ASSERT(distinct_tags > 64);
+    bidirectional_open_hash_map_t_destroy(&open_map);
+}
+
+static size_t colliding_key_hasher(void* key)
+{
+    return (size_t) key & 0x3;
+}
+
+static int key_compare(void* a, void* b)
+{
+    return ((uintptr_t) a > (uintptr_t) b) - ((uintptr_t) a < (uintptr_t) b);
+}
+
+static void test_avl_hash_map(void* error_sentinel,
+                              size_t (*key_hasher)(void*))
+{
+    size_t i;
+    size_t key;
+    size_t next_primary_key = 1000000;
+    size_t next_secondary_key = 100000;
+    size_t random_state = 54321;
+    bidirectional_hash_map_t map;
+    bidirectional_hash_map_2_t avl_map;
+    bidirectional_hash_map_2_iterator_t iterator;
+    void* primary_key;
+    void* secondary_key;
+    
+    bidirectional_hash_map_t_init(&map,
+                                  0,
+                                  1.0f,
+                                  key_hasher,
+                                  key_hasher,
+                                  primary_key_equality,
+                                  secondary_key_equality,
+                                  error_sentinel);
+    
+    ASSERT(bidirectional_hash_map_2_t_init(&avl_map,
+                                           0,
+                                           1.0f,
+                                           key_hasher,
+                                           key_hasher,
+                                           key_compare,
+                                           key_compare,
+                                           error_sentinel));
+    
+    /**************************************************************
+    * Run the same random operations on both the engines and make *
+    * sure they agree.                                            *
+    **************************************************************/
+    for (i = 0; i < 20000; ++i)
+    {
+        random_state = random_state * 1103515245 + 12345;
+        key = (random_state >> 8) % 1000;
+        
+        switch ((random_state >> 4) % 5)
+        {
+            case 0:
+            case 1:
+                ASSERT(bidirectional_hash_map_t_put_by_primary(
+                                            &map,
+                                            (void*) key,
+                                            (void*) next_secondary_key) ==
+                       bidirectional_hash_map_2_t_put_by_primary(
+                                            &avl_map,
+                                            (void*) key,
+                                            (void*) next_secondary_key));
+                next_secondary_key++;
+                break;
+            
+            case 2:
+                key = next_secondary_key - 1 - key;
+                ASSERT(bidirectional_hash_map_t_put_by_secondary(
+                                            &map,
+                                            (void*) next_primary_key,
+                                            (void*) key) ==
+                       bidirectional_hash_map_2_t_put_by_secondary(
+                                            &avl_map,
+                                            (void*) next_primary_key,
+                                            (void*) key));
+                next_primary_key++;
+                break;
+            
+            case 3:
+                ASSERT(bidirectional_hash_map_t_remove_by_primary_key(
+                                                            &map,
+                                                            (void*) key) ==
+                       bidirectional_hash_map_2_t_remove_by_primary_key(
+                                                            &avl_map,
+                                                            (void*) key));
+                break;
+            
+            case 4:
+                key = next_secondary_key - 1 - key;
+                ASSERT(bidirectional_hash_map_t_remove_by_secondary_key(
+                                                            &map,
+                                                            (void*) key) ==
+                       bidirectional_hash_map_2_t_remove_by_secondary_key(
+                                                            &avl_map,
+                                                            (void*) key));
+                break;
+        }
+        
+        ASSERT(bidirectional_hash_map_t_size(&map) ==
+               bidirectional_hash_map_2_t_size(&avl_map));
+    }
+    
+    for (key = 0; key < 1000; ++key)
+    {
+        secondary_key = bidirectional_hash_map_2_t_get_by_primary_key(
+                                                                &avl_map,
+                                                                (void*) key);
+        
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, (void*) key)
+               == secondary_key);
+        
+        ASSERT(bidirectional_hash_map_2_t_contains_primary_key(&avl_map,
+                                                               (void*) key)
+               == (secondary_key != NULL));
+        
+        if (secondary_key)
+        {
+            ASSERT(bidirectional_hash_map_2_t_get_by_secondary_key(
+                                                    &avl_map,
+                                                    secondary_key) ==
+                   (void*) key);
+        }
+    }
+    
+    bidirectional_hash_map_2_iterator_t_init(&avl_map, &iterator);
+    
+    for (i = 0; i < bidirectional_hash_map_2_t_size(&avl_map); ++i)
+    {
+        ASSERT(bidirectional_hash_map_2_iterator_t_next(&iterator,
+                                                        &primary_key,
+                                                        &secondary_key));
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, primary_key)
+               == secondary_key);
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                             secondary_key)
+               == primary_key);
+    }
+    
+    ASSERT(!bidirectional_hash_map_2_iterator_t_has_next(&iterator));
+    
+    bidirectional_hash_map_t_destroy(&map);
+    bidirectional_hash_map_2_t_destroy(&avl_map);
+}
+
+static void test_adaptive_buckets(void* error_sentinel, int flags)
+{
+    size_t i;
+    size_t key;
+    size_t next_secondary_key = 100000;
+    size_t random_state = 24680;
+    bidirectional_hash_map_t map;
+    bidirectional_hash_map_t adaptive_map;
+    
+    bidirectional_hash_map_t_init(&map,
+                                  0,
+                                  1.0f,
+                                  primary_key_hasher,
+                                  secondary_key_hasher,
+                                  primary_key_equality,
+                                  secondary_key_equality,
+                                  error_sentinel);
+    
+    bidirectional_hash_map_t_init_with_flags(&adaptive_map,
+                                             0,
+                                             1.0f,
+                                             colliding_key_hasher,
+                                             colliding_key_hasher,
+                                             primary_key_equality,
+                                             secondary_key_equality,
+                                             error_sentinel,
+                                             flags);
+    
+    bidirectional_hash_map_t_set_key_comparators(&adaptive_map,
+                                                 key_compare,
+                                                 key_compare);
+    
+    /*****************************************************************
+    * The colliding hasher keeps the buckets long, so they turn into *
+    * trees, and the removals make them turn back into chains.       *
+    *****************************************************************/
+    for (i = 0; i < 20000; ++i)
+    {
+        random_state = random_state * 1103515245 + 12345;
+        key = (random_state >> 8) % 1000;
+        
+        if (i == 10000)
+        {
+            bidirectional_hash_map_t_set_key_comparators(&adaptive_map,
+                                                         NULL,
+                                                         key_compare);
+        }
+        else if (i == 15000)
+        {
+            bidirectional_hash_map_t_set_key_comparators(&adaptive_map,
+                                                         key_compare,
+                                                         key_compare);
+        }
+        
+        switch ((random_state >> 4) % 4)
+        {
+            case 0:
+            case 1:
+                ASSERT(bidirectional_hash_map_t_put_by_primary(
+                                            &map,
+                                            (void*) key,
+                                            (void*) next_secondary_key) ==
+                       bidirectional_hash_map_t_put_by_primary(
+                                            &adaptive_map,
+                                            (void*) key,
+                                            (void*) next_secondary_key));
+                next_secondary_key++;
+                break;
+            
+            case 2:
+                ASSERT(bidirectional_hash_map_t_remove_by_primary_key(
+                                                            &map,
+                                                            (void*) key) ==
+                       bidirectional_hash_map_t_remove_by_primary_key(
+                                                            &adaptive_map,
+                                                            (void*) key));
+                break;
+            
+            case 3:
+                key = next_secondary_key - 1 - key;
+                ASSERT(bidirectional_hash_map_t_remove_by_secondary_key(
+                                                            &map,
+                                                            (void*) key) ==
+                       bidirectional_hash_map_t_remove_by_secondary_key(
+                                                            &adaptive_map,
+                                                            (void*) key));
+                break;
+        }
+        
+        ASSERT(bidirectional_hash_map_t_size(&map) ==
+               bidirectional_hash_map_t_size(&adaptive_map));
+    }
+    
+    for (key = 0; key < 1000; ++key)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, (void*) key)
+               == bidirectional_hash_map_t_get_by_primary_key(&adaptive_map,
+                                                              (void*) key));
+    }
+    
+    for (key = 100000; key < next_secondary_key; ++key)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                             (void*) key)
+               == bidirectional_hash_map_t_get_by_secondary_key(
+                                                            &adaptive_map,
+                                                            (void*) key));
+    }
+    
+    /*********************************************
+    * Emptying the map turns all the trees back. *
+    *********************************************/
+    for (key = 0; key < 1000; ++key)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&adaptive_map,
+                                                       (void*) key);
+    }
+    
+    ASSERT(bidirectional_hash_map_t_size(&adaptive_map) == 0);
+    
+    bidirectional_hash_map_t_destroy(&map);
+    bidirectional_hash_map_t_destroy(&adaptive_map);
+}
+
+static void test_incremental_rehash(void* error_sentinel)
+{
+    size_t i;
+    int was_rehashing = 0;
+    bidirectional_hash_map_t map;
+    
+    ASSERT(bidirectional_hash_map_t_init_with_flags(
+                                    &map,
+                                    0,
+                                    1.0f,
+                                    primary_key_hasher,
+                                    secondary_key_hasher,
+                                    primary_key_equality,
+                                    secondary_key_equality,
+                                    error_sentinel,
+                                    BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS |
+                                    BIDIRECTIONAL_HASH_MAP_INCREMENTAL_REHASH));
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 1000));
+        
+        if (bidirectional_hash_map_t_is_rehashing(&map))
+        {
+            was_rehashing = 1;
+            
+            /**********************************************************
+            * The mappings must stay reachable while being migrated.  *
+            **********************************************************/
+            ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map,
+                                                               (void*) 0)
+                   == (void*) 1000);
+            ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                                 (void*) 1000)
+                   == (void*) 0);
+        }
+    }
+    
+    ASSERT(was_rehashing);
+    
+    for (i = 0; i < 1000; i += 2)
+    {
+        ASSERT(bidirectional_hash_map_t_remove_by_secondary_key(
+                                                &map,
+                                                (void*)(i + 1000)) == (void*) i);
+    }
+    
+    bidirectional_hash_map_t_put_by_secondary(&map, (void*) 5000, (void*) 1001);
+    bidirectional_hash_map_t_finish_rehash(&map);
+    
+    ASSERT(!bidirectional_hash_map_t_is_rehashing(&map));
+    ASSERT(bidirectional_hash_map_t_pending_rehash_buckets(&map) == 0);
+    ASSERT(bidirectional_hash_map_t_rehash_step(&map, 10) == 0);
+    ASSERT(bidirectional_hash_map_t_size(&map) == 500);
+    ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, (void*) 5000)
+           == (void*) 1001);
+    
+    for (i = 2; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_contains_primary_key(&map, (void*) i)
+               == (i & 1));
+        ASSERT(bidirectional_hash_map_t_contains_secondary_key(
+                                                &map,
+                                                (void*)(i + 1000)) == (i & 1));
+    }
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+static void test_shrinking(void* error_sentinel)
+{
+    size_t i;
+    size_t capacity;
+    bidirectional_hash_map_t map;
+    
+    ASSERT(bidirectional_hash_map_t_init(&map,
+                                         0,
+                                         1.0f,
+                                         primary_key_hasher,
+                                         secondary_key_hasher,
+                                         primary_key_equality,
+                                         secondary_key_equality,
+                                         error_sentinel));
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 1000));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 1024);
+    
+    for (i = 0; i < 990; ++i)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&map, (void*) i);
+    }
+    
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 32);
+    
+    for (i = 990; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, (void*) i)
+               == (void*)(i + 1000));
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                             (void*)(i + 1000))
+               == (void*) i);
+    }
+    
+    /**********************************************************
+    * Oscillating around a watermark must not resize the map. *
+    **********************************************************/
+    capacity = bidirectional_hash_map_t_capacity(&map);
+    
+    for (i = 0; i < 100; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) 5000,
+                                                (void*) 6000);
+        bidirectional_hash_map_t_remove_by_primary_key(&map, (void*) 5000);
+        ASSERT(bidirectional_hash_map_t_capacity(&map) == capacity);
+    }
+    
+    bidirectional_hash_map_t_destroy(&map);
+    
+    ASSERT(bidirectional_hash_map_t_init(&map,
+                                         0,
+                                         1.0f,
+                                         primary_key_hasher,
+                                         secondary_key_hasher,
+                                         primary_key_equality,
+                                         secondary_key_equality,
+                                         error_sentinel));
+    
+    bidirectional_hash_map_t_set_shrink_load_factor(&map, 0.0f);
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 1000));
+    }
+    
+    for (i = 0; i < 990; ++i)
+    {
+        bidirectional_hash_map_t_remove_by_secondary_key(&map,
+                                                         (void*)(i + 1000));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 1024);
+    ASSERT(bidirectional_hash_map_t_shrink_to_fit(&map));
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 16);
+    ASSERT(bidirectional_hash_map_t_size(&map) == 10);
+    
+    for (i = 990; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, (void*) i)
+               == (void*)(i + 1000));
+    }
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+static void test_reserve(void* error_sentinel)
+{
+    size_t i;
+    bidirectional_hash_map_t map;
+    
+    ASSERT(bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        1.0f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        error_sentinel,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS));
+    
+    ASSERT(bidirectional_hash_map_t_reserve(&map, 1000));
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 1024);
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 1000));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 1024);
+    ASSERT(bidirectional_hash_map_t_size(&map) == 1000);
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_remove_by_primary_key(&map, (void*) i)
+               == (void*)(i + 1000));
+    }
+    
+    /***************************************************
+    * The reserved capacity survives the sparse phase. *
+    ***************************************************/
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 1024);
+    
+    ASSERT(bidirectional_hash_map_t_reserve(&map, 100));
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 1024);
+    ASSERT(bidirectional_hash_map_t_shrink_to_fit(&map));
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 8);
+    
+    /****************************************************
+    * Leave some reserved records unused for 'destroy'. *
+    ****************************************************/
+    ASSERT(bidirectional_hash_map_t_reserve(&map, 100));
+    bidirectional_hash_map_t_put_by_primary(&map, (void*) 1, (void*) 2);
+    ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map, (void*) 2)
+           == (void*) 1);
+    
+    /**********************************************************
+    * Counts no table could hold fail, leaving the map as is. *
+    **********************************************************/
+    ASSERT(!bidirectional_hash_map_t_reserve(&map, SIZE_MAX));
+    ASSERT(!bidirectional_hash_map_t_reserve(&map, SIZE_MAX / 2));
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 128);
+    ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map, (void*) 2)
+           == (void*) 1);
+    
+    bidirectional_hash_map_t_destroy(&map);
+    
+    /************************************************************
+    * With a huge load factor the tables need not grow, so only *
+    * the size of the slab for the missing records stops it.    *
+    ************************************************************/
+    ASSERT(bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        1e30f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        error_sentinel,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS));
+    
+    ASSERT(!bidirectional_hash_map_t_reserve(&map, SIZE_MAX));
+    ASSERT(bidirectional_hash_map_t_put_by_primary(&map,
+                                                   (void*) 1,
+                                                   (void*) 2) == NULL);
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+static void test_put_batch(void* error_sentinel)
+{
+    size_t i;
+    void* primary_keys[100];
+    void* secondary_keys[100];
+    void* results[100];
+    bidirectional_hash_map_t map;
+    bidirectional_hash_map_t expected_map;
+    
+    ASSERT(bidirectional_hash_map_t_init(&map,
+                                         0,
+                                         1.0f,
+                                         primary_key_hasher,
+                                         secondary_key_hasher,
+                                         primary_key_equality,
+                                         secondary_key_equality,
+                                         error_sentinel));
+    
+    ASSERT(bidirectional_hash_map_t_init(&expected_map,
+                                         0,
+                                         1.0f,
+                                         primary_key_hasher,
+                                         secondary_key_hasher,
+                                         primary_key_equality,
+                                         secondary_key_equality,
+                                         error_sentinel));
+    
+    for (i = 0; i < 10; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 500));
+        bidirectional_hash_map_t_put_by_primary(&expected_map,
+                                                (void*) i,
+                                                (void*)(i + 500));
+    }
+    
+    /***************************************************************
+    * Repeat the primary keys so that the batch updates the pairs  *
+    * stored both before the batch and earlier within the batch.   *
+    ***************************************************************/
+    for (i = 0; i < 100; ++i)
+    {
+        primary_keys[i]   = (void*)(i % 40);
+        secondary_keys[i] = (void*)(i + 1000);
+    }
+    
+    ASSERT(bidirectional_hash_map_t_put_batch_by_primary(&map,
+                                                         primary_keys,
+                                                         secondary_keys,
+                                                         100,
+                                                         results));
+    
+    for (i = 0; i < 100; ++i)
+    {
+        ASSERT(results[i] ==
+               bidirectional_hash_map_t_put_by_primary(&expected_map,
+                                                       primary_keys[i],
+                                                       secondary_keys[i]));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_size(&map) == 40);
+    ASSERT(bidirectional_hash_map_t_size(&expected_map) == 40);
+    
+    for (i = 0; i < 40; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, (void*) i) ==
+               bidirectional_hash_map_t_get_by_primary_key(&expected_map,
+                                                           (void*) i));
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(
+                                    &map,
+                                    (void*)(i + (i < 20 ? 1080 : 1040)))
+               == (void*) i);
+    }
+    
+    ASSERT(bidirectional_hash_map_t_put_batch_by_primary(&map,
+                                                         primary_keys,
+                                                         secondary_keys,
+                                                         0,
+                                                         NULL));
+    
+    bidirectional_hash_map_t_destroy(&map);
+    bidirectional_hash_map_t_destroy(&expected_map);
+}
+
+static void test_get_batch(void* error_sentinel)
+{
+    size_t i;
+    void* keys[150];
+    void* results[150];
+    bidirectional_hash_map_t map;
+    
+    ASSERT(bidirectional_hash_map_t_init(&map,
+                                         0,
+                                         1.0f,
+                                         primary_key_hasher,
+                                         secondary_key_hasher,
+                                         primary_key_equality,
+                                         secondary_key_equality,
+                                         error_sentinel));
+    
+    for (i = 0; i < 100; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*)(2 * i),
+                                                (void*)(2 * i + 1001));
+    }
+    
+    for (i = 0; i < 150; ++i)
+    {
+        keys[i] = (void*) i;
+    }
+    
+    ASSERT(bidirectional_hash_map_t_get_batch_by_primary(&map,
+                                                         keys,
+                                                         150,
+                                                         results) == 75);
+    
+    for (i = 0; i < 150; ++i)
+    {
+        ASSERT(results[i] ==
+               bidirectional_hash_map_t_get_by_primary_key(&map, keys[i]));
+    }
+    
+    for (i = 0; i < 150; ++i)
+    {
+        keys[i] = (void*)(i + 1100);
+    }
+    
+    ASSERT(bidirectional_hash_map_t_get_batch_by_secondary(&map,
+                                                           keys,
+                                                           150,
+                                                           results) == 50);
+    
+    for (i = 0; i < 150; ++i)
+    {
+        ASSERT(results[i] ==
+               bidirectional_hash_map_t_get_by_secondary_key(&map, keys[i]));
+    }
+    
+    ASSERT(results[1] == (void*) 100);
+    ASSERT(results[0] == NULL);
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+static void test_remove_batch(void* error_sentinel)
+{
+    size_t i;
+    void* keys[300];
+    void* results[300];
+    bidirectional_hash_map_t map;
+    
+    ASSERT(bidirectional_hash_map_t_init(&map,
+                                         0,
+                                         1.0f,
+                                         primary_key_hasher,
+                                         secondary_key_hasher,
+                                         primary_key_equality,
+                                         secondary_key_equality,
+                                         error_sentinel));
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 1000));
+    }
+    
+    /************************************************************
+    * Every key is listed twice and a third of them are absent. *
+    ************************************************************/
+    for (i = 0; i < 300; ++i)
+    {
+        keys[i] = (void*)(7 * (i % 150));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_remove_batch_by_primary(&map,
+                                                            keys,
+                                                            300,
+                                                            results) == 143);
+    
+    for (i = 0; i < 300; ++i)
+    {
+        ASSERT(results[i] == (i < 150 && 7 * i < 1000 ?
+                              (void*)(7 * i + 1000) :
+                              NULL));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_size(&map) == 857);
+    
+    for (i = 0; i < 300; ++i)
+    {
+        keys[i] = (void*)(i + 1000);
+    }
+    
+    ASSERT(bidirectional_hash_map_t_remove_batch_by_secondary(&map,
+                                                              keys,
+                                                              300,
+                                                              NULL) == 257);
+    ASSERT(bidirectional_hash_map_t_size(&map) == 600);
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_contains_primary_key(&map, (void*) i)
+               == (i >= 300 && i % 7 != 0));
+        ASSERT(bidirectional_hash_map_t_contains_secondary_key(
+                                        &map,
+                                        (void*)(i + 1000)) ==
+               (i >= 300 && i % 7 != 0));
+    }
+    
+    for (i = 0; i < 300; ++i)
+    {
+        keys[i] = (void*)(i + 300);
+    }
+    
+    bidirectional_hash_map_t_remove_batch_by_primary(&map, keys, 300, NULL);
+    bidirectional_hash_map_t_remove_batch_by_primary(&map, keys, 300, NULL);
+    
+    for (i = 0; i < 300; ++i)
+    {
+        keys[i] = (void*)(i + 600);
+    }
+    
+    bidirectional_hash_map_t_remove_batch_by_primary(&map, keys, 300, NULL);
+    
+    for (i = 0; i < 100; ++i)
+    {
+        keys[i] = (void*)(i + 900);
+    }
+    
+    bidirectional_hash_map_t_remove_batch_by_primary(&map, keys, 100, NULL);
+    
+    /*********************************************************
+    * The batch removals shrink the map back to its minimum. *
+    *********************************************************/
+    ASSERT(bidirectional_hash_map_t_size(&map) == 0);
+    ASSERT(bidirectional_hash_map_t_capacity(&map) == 8);
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+static void test_mapping_record_slabs(void* error_sentinel)
+{
+    size_t i;
+    size_t slab_record_count;
+    bidirectional_hash_map_t map;
+    primary_collision_chain_node_t* primary_collision_chain_node;
+    
+    ASSERT(bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        1.0f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        error_sentinel,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS));
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 1000));
+    }
+    
+    slab_record_count = map.slab_record_count;
+    ASSERT(slab_record_count >= 1000);
+    
+    /************************************************************
+    * Every record starts at a cache line boundary of its slab. *
+    ************************************************************/
+    for (primary_collision_chain_node = map.first_collision_chain_node;
+         primary_collision_chain_node;
+         primary_collision_chain_node = primary_collision_chain_node->down)
+    {
+        ASSERT(((size_t) primary_collision_chain_node -
+                offsetof(mapping_record_t, primary_collision_chain_node)) %
+               BIDIRECTIONAL_HASH_MAP_CACHE_LINE_SIZE == 0);
+    }
+    
+    /************************************************************
+    * Churn must reuse the released records instead of growing. *
+    ************************************************************/
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&map, (void*) i);
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*)(i + 5000),
+                                                (void*)(i + 6000));
+    }
+    
+    ASSERT(map.slab_record_count == slab_record_count);
+    ASSERT(bidirectional_hash_map_t_size(&map) == 1000);
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                             (void*)(i + 6000))
+               == (void*)(i + 5000));
+    }
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&map, (void*)(i + 5000));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_shrink_to_fit(&map));
+    ASSERT(map.slab_record_count == 0);
+    
+    /********************************************************
+    * The map stays usable, and 'destroy' releases the live *
+    * mappings along with their slabs.                      *
+    ********************************************************/
+    for (i = 0; i < 100; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 1000));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, (void*) 99)
+           == (void*) 1099);
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/******************************************************************
+* An allocator that counts the blocks it hands out and gets back. *
+******************************************************************/
+typedef struct counting_allocator_state_t {
+    size_t allocations;
+    size_t deallocations;
+}
+counting_allocator_state_t;
+
+static void* counting_allocate(void* context, size_t size)
+{
+    ((counting_allocator_state_t*) context)->allocations++;
+    return malloc(size);
+}
+
+static void* counting_allocate_zeroed(void* context, size_t count, size_t size)
+{
+    ((counting_allocator_state_t*) context)->allocations++;
+    return calloc(count, size);
+}
+
+static void counting_deallocate(void* context, void* memory)
+{
+    if (memory)
+    {
+        ((counting_allocator_state_t*) context)->deallocations++;
+        free(memory);
+    }
+}
+
+static void test_allocator(void* error_sentinel, int flags)
+{
+    size_t i;
+    bidirectional_hash_map_t map;
+    counting_allocator_state_t state;
+    bidirectional_hash_map_allocator_t allocator;
+    
+    state.allocations   = 0;
+    state.deallocations = 0;
+    
+    allocator.allocate        = counting_allocate;
+    allocator.allocate_zeroed = counting_allocate_zeroed;
+    allocator.deallocate      = NULL;
+    allocator.context         = &state;
+    
+    ASSERT(!bidirectional_hash_map_t_init_with_allocator(&map,
+                                                         0,
+                                                         1.0f,
+                                                         primary_key_hasher,
+                                                         secondary_key_hasher,
+                                                         primary_key_equality,
+                                                         secondary_key_equality,
+                                                         error_sentinel,
+                                                         flags,
+                                                         &allocator));
+    
+    allocator.deallocate = counting_deallocate;
+    
+    ASSERT(bidirectional_hash_map_t_init_with_allocator(&map,
+                                                        0,
+                                                        1.0f,
+                                                        primary_key_hasher,
+                                                        secondary_key_hasher,
+                                                        primary_key_equality,
+                                                        secondary_key_equality,
+                                                        error_sentinel,
+                                                        flags,
+                                                        &allocator));
+    ASSERT(state.allocations == 2);
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) i,
+                                                (void*)(i + 1000));
+    }
+    
+    for (i = 0; i < 500; ++i)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&map, (void*) i);
+    }
+    
+    ASSERT(state.allocations > state.deallocations + 2);
+    ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map, (void*) 999)
+           == (void*) 1999);
+    
+    bidirectional_hash_map_t_destroy(&map);
+    ASSERT(state.allocations == state.deallocations);
+}
+
+static void test_frozen_map(void* error_sentinel, int flags)
+{
+    size_t i;
+    bidirectional_hash_map_t map;
+    bidirectional_frozen_hash_map_t frozen_map;
+    counting_allocator_state_t state;
+    bidirectional_hash_map_allocator_t allocator;
+    
+    state.allocations   = 0;
+    state.deallocations = 0;
+    
+    allocator.allocate        = counting_allocate;
+    allocator.allocate_zeroed = counting_allocate_zeroed;
+    allocator.deallocate      = counting_deallocate;
+    allocator.context         = &state;
+    
+    ASSERT(bidirectional_hash_map_t_init_with_allocator(
+                                        &map,
+                                        0,
+                                        1.0f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        error_sentinel,
+                                        flags,
+                                        &allocator));
+    
+    ASSERT(bidirectional_hash_map_t_freeze(&map, &frozen_map));
+    ASSERT(bidirectional_frozen_hash_map_t_size(&frozen_map) == 0);
+    ASSERT(!bidirectional_frozen_hash_map_t_contains_primary_key(&frozen_map,
+                                                                 (void*) 1));
+    bidirectional_frozen_hash_map_t_destroy(&frozen_map);
+    
+    /********************************************************************
+    * Colliding keys: all the primary keys share the low bits, so their *
+    * probe runs in the frozen map overlap.                             *
+    ********************************************************************/
+    for (i = 0; i < 1000; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*)(i << 12),
+                                                (void*)(i + 1000));
+    }
+    
+    for (i = 0; i < 1000; i += 2)
+    {
+        bidirectional_hash_map_t_remove_by_primary_key(&map, (void*)(i << 12));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_freeze(&map, &frozen_map));
+    bidirectional_hash_map_t_destroy(&map);
+    
+    ASSERT(bidirectional_frozen_hash_map_t_size(&frozen_map) == 500);
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        if (i % 2 == 1)
+        {
+            ASSERT(bidirectional_frozen_hash_map_t_get_by_primary_key(
+                                                            &frozen_map,
+                                                            (void*)(i << 12))
+                   == (void*)(i + 1000));
+            
+            ASSERT(bidirectional_frozen_hash_map_t_get_by_secondary_key(
+                                                            &frozen_map,
+                                                            (void*)(i + 1000))
+                   == (void*)(i << 12));
+        }
+        else
+        {
+            ASSERT(!bidirectional_frozen_hash_map_t_contains_primary_key(
+                                                            &frozen_map,
+                                                            (void*)(i << 12)));
+            
+            ASSERT(!bidirectional_frozen_hash_map_t_contains_secondary_key(
+                                                            &frozen_map,
+                                                            (void*)(i + 1000)));
+        }
+    }
+    
+    ASSERT(bidirectional_frozen_hash_map_t_get_by_primary_key(&frozen_map,
+                                                              (void*) 7)
+           == NULL);
+    
+    bidirectional_frozen_hash_map_t_destroy(&frozen_map);
+    ASSERT(state.allocations == state.deallocations);
+}
+
+static void test_hash_mixing(void* error_sentinel)
+{
+    size_t i;
+    size_t bucket;
+    size_t used_buckets = 0;
+    unsigned char bucket_used[1024] = { 0 };
+    bidirectional_hash_map_t map;
+    
+    /************************************************************
+    * Keys sharing a stride of 4096 would all land in bucket 0; *
+    * mixed, they must spread about as well as random ones.     *
+    ************************************************************/
+    for (i = 0; i < 1024; ++i)
+    {
+        bucket = bidirectional_hash_map_mix_hash(i << 12) & 1023;
+        
+        if (!bucket_used[bucket])
+        {
+            bucket_used[bucket] = 1;
+            used_buckets++;
+        }
+    }
+    
+    ASSERT(used_buckets > 600);
+    ASSERT(bidirectional_hash_map_mix_hash(1) !=
+           bidirectional_hash_map_mix_hash(2));
+    
+    ASSERT(bidirectional_hash_map_t_init_with_flags(
+                                    &map,
+                                    0,
+                                    1.0f,
+                                    primary_key_hasher,
+                                    secondary_key_hasher,
+                                    primary_key_equality,
+                                    secondary_key_equality,
+                                    error_sentinel,
+                                    BIDIRECTIONAL_HASH_MAP_MIX_HASHES |
+                                    BIDIRECTIONAL_HASH_MAP_INCREMENTAL_REHASH));
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_put_by_primary(&map,
+                                                       (void*)(i << 12),
+                                                       (void*)(i + 1))
+               == NULL);
+    }
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map,
+                                                           (void*)(i << 12))
+               == (void*)(i + 1));
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                             (void*)(i + 1))
+               == (void*)(i << 12));
+    }
+    
+    for (i = 0; i < 1000; i += 2)
+    {
+        ASSERT(bidirectional_hash_map_t_remove_by_secondary_key(&map,
+                                                                (void*)(i + 1))
+               == (void*)(i << 12));
+    }
+    
+    ASSERT(bidirectional_hash_map_t_size(&map) == 500);
+    ASSERT(!bidirectional_hash_map_t_contains_primary_key(&map, (void*) 0));
+    ASSERT(bidirectional_hash_map_t_contains_primary_key(&map,
+                                                         (void*)(1 << 12)));
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+/****************************************************************
+* Returns the number of nodes in the longest collision chain of *
+* the primary key table of the input map.                       *
+****************************************************************/
+static size_t get_longest_primary_collision_chain(
+                                                bidirectional_hash_map_t* map)
+{
+    size_t i;
+    size_t length;
+    size_t longest_length = 0;
+    primary_collision_chain_node_t* primary_collision_chain_node;
+    
+    for (i = 0; i < map->capacity; ++i)
+    {
+        length = 0;
+        
+        for (primary_collision_chain_node = map->primary_key_table[i];
+             primary_collision_chain_node;
+             primary_collision_chain_node = primary_collision_chain_node->next)
+        {
+            length++;
+        }
+        
+        if (longest_length < length)
+        {
+            longest_length = length;
+        }
+    }
+    
+    return longest_length;
+}
+
+/******************************************************************
+* Fills a map with the key pairs (keys[i], i + 1) and returns the *
+* length of its longest primary key chain.                        *
+******************************************************************/
+static size_t get_longest_chain_under_attack(void* error_sentinel,
+                                             int flags,
+                                             size_t* keys,
+                                             size_t count)
+{
+    size_t i;
+    size_t longest_length;
+    bidirectional_hash_map_t map;
+    
+    ASSERT(bidirectional_hash_map_t_init_with_flags(&map,
+                                                    0,
+                                                    1.0f,
+                                                    primary_key_hasher,
+                                                    secondary_key_hasher,
+                                                    primary_key_equality,
+                                                    secondary_key_equality,
+                                                    error_sentinel,
+                                                    flags));
+    
+    for (i = 0; i < count; ++i)
+    {
+        bidirectional_hash_map_t_put_by_primary(&map,
+                                                (void*) keys[i],
+                                                (void*)(i + 1));
+    }
+    
+    for (i = 0; i < count; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map,
+                                                           (void*) keys[i])
+               == (void*)(i + 1));
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                             (void*)(i + 1))
+               == (void*) keys[i]);
+    }
+    
+    ASSERT(bidirectional_hash_map_t_size(&map) == count);
+    longest_length = get_longest_primary_collision_chain(&map);
+    bidirectional_hash_map_t_destroy(&map);
+    return longest_length;
+}
+
+/****************************************************************
+* Randomizes the hash key 'argument' points to, the way seeding *
+* a map does.                                                   *
+****************************************************************/
+static void* run_hash_key_randomizer(void* argument)
+{
+    bidirectional_hash_map_hash_key_t_randomize(argument);
+    return NULL;
+}
+
+static void test_seeded_hashes(void* error_sentinel)
+{
+    static size_t strided_keys[2000];
+    static size_t mix_colliding_keys[2000];
+    size_t i;
+    size_t j;
+    size_t candidate = 1;
+    bidirectional_hash_map_t map1;
+    bidirectional_hash_map_t map2;
+    bidirectional_hash_map_hash_key_t hash_key = { 0, 0 };
+    bidirectional_hash_map_hash_key_t hash_keys[4];
+    pthread_t threads[4];
+    
+    /******************************************************************
+    * An adversary knowing how buckets are picked crafts keys landing *
+    * in bucket 0 of every table up to 4096 buckets: a stride beats   *
+    * the bare mask, and a search beats the public mixing function.   *
+    ******************************************************************/
+    for (i = 0; i < 2000; ++i)
+    {
+        strided_keys[i] = (i + 1) << 16;
+        
+        while (bidirectional_hash_map_mix_hash(candidate) & 0xFFF)
+        {
+            candidate++;
+        }
+        
+        mix_colliding_keys[i] = candidate++;
+    }
+    
+    ASSERT(get_longest_chain_under_attack(error_sentinel,
+                                          0,
+                                          strided_keys,
+                                          2000) == 2000);
+    ASSERT(get_longest_chain_under_attack(error_sentinel,
+                                          BIDIRECTIONAL_HASH_MAP_MIX_HASHES,
+                                          mix_colliding_keys,
+                                          2000) == 2000);
+    
+    /****************************************************************
+    * With a secret per-map key, both workloads spread like random  *
+    * keys: 2000 keys over 2048 buckets give chains of a few nodes. *
+    ****************************************************************/
+    ASSERT(get_longest_chain_under_attack(error_sentinel,
+                                          BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES,
+                                          strided_keys,
+                                          2000) <= 16);
+    ASSERT(get_longest_chain_under_attack(
+                                error_sentinel,
+                                BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES |
+                                BIDIRECTIONAL_HASH_MAP_MIX_HASHES |
+                                BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS,
+                                mix_colliding_keys,
+                                2000) <= 16);
+    
+    ASSERT(bidirectional_hash_map_t_init_with_flags(
+                                        &map1,
+                                        0,
+                                        1.0f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        error_sentinel,
+                                        BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES));
+    ASSERT(bidirectional_hash_map_t_init_with_flags(
+                                        &map2,
+                                        0,
+                                        1.0f,
+                                        primary_key_hasher,
+                                        secondary_key_hasher,
+                                        primary_key_equality,
+                                        secondary_key_equality,
+                                        error_sentinel,
+                                        BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES));
+    
+    ASSERT(map1.hash_key.k0 != map2.hash_key.k0 ||
+           map1.hash_key.k1 != map2.hash_key.k1);
+    
+    bidirectional_hash_map_t_destroy(&map1);
+    bidirectional_hash_map_t_destroy(&map2);
+    
+    /*************************************************************
+    * Keys randomized from several threads at once still differ. *
+    *************************************************************/
+    for (i = 0; i < 4; ++i)
+    {
+        ASSERT(pthread_create(&threads[i],
+                              NULL,
+                              run_hash_key_randomizer,
+                              &hash_keys[i]) == 0);
+    }
+    
+    for (i = 0; i < 4; ++i)
+    {
+        ASSERT(pthread_join(threads[i], NULL) == 0);
+    }
+    
+    for (i = 0; i < 4; ++i)
+    {
+        for (j = 0; j < i; ++j)
+        {
+            ASSERT(hash_keys[i].k0 != hash_keys[j].k0 ||
+                   hash_keys[i].k1 != hash_keys[j].k1);
+        }
+    }
+    
+    /********************************************************************
+    * SipHash-1-3 under the all-zero key, as used by CPython for bytes. *
+    ********************************************************************/
+    ASSERT(bidirectional_hash_map_siphash13(&hash_key, "hello", 5) ==
+           (size_t)(((uint64_t) 0xE2E77B41UL << 32) | 0xCB4E1F9EUL));
+    ASSERT(bidirectional_hash_map_siphash13_word(&hash_key, 7) !=
+           bidirectional_hash_map_siphash13_word(&hash_key, 8));
+}
+
+static void test_key_functions(void* error_sentinel)
+{
+    static char strings[300][16];
+    static char string_copies[300][16];
+    static unsigned char uuids[300][16];
+    static unsigned char uuid_copies[300][16];
+    static size_t buffers[300][3];
+    static size_t buffer_copies[300][3];
+    unsigned char bytes[48];
+    unsigned char shifted_bytes[64];
+    size_t i;
+    size_t length;
+    size_t offset;
+    bidirectional_hash_map_t map;
+    
+    for (i = 0; i < 300; ++i)
+    {
+        sprintf(strings[i], "key-%d", (int) i);
+        strcpy(string_copies[i], strings[i]);
+        
+        memset(uuids[i], 0, 16);
+        uuids[i][0]  = (unsigned char) i;
+        uuids[i][15] = (unsigned char)(i >> 8);
+        memcpy(uuid_copies[i], uuids[i], 16);
+        
+        buffers[i][0] = i % (2 * sizeof(size_t) + 1);
+        memset(&buffers[i][1], 'x', 2 * sizeof(size_t));
+        memcpy(&buffers[i][1], &i, sizeof(i) < buffers[i][0] ?
+                                   sizeof(i) : buffers[i][0]);
+        memcpy(buffer_copies[i], buffers[i], sizeof(buffers[i]));
+    }
+    
+    /******************************************************************
+    * The hash of a byte string must not depend on its alignment, nor *
+    * on the bytes past its end.                                      *
+    ******************************************************************/
+    for (length = 0; length <= 40; ++length)
+    {
+        for (offset = 1; offset < 8; ++offset)
+        {
+            memset(bytes, 0xAB, sizeof(bytes));
+            memset(shifted_bytes, 0xCD, sizeof(shifted_bytes));
+            
+            for (i = 0; i < length; ++i)
+            {
+                bytes[i] = (unsigned char)(i * 7 + 1);
+                shifted_bytes[offset + i] = bytes[i];
+            }
+            
+            ASSERT(bidirectional_hash_map_hash_bytes(bytes, length) ==
+                   bidirectional_hash_map_hash_bytes(shifted_bytes + offset,
+                                                     length));
+        }
+    }
+    
+    ASSERT(bidirectional_hash_map_hash_bytes("a", 1) !=
+           bidirectional_hash_map_hash_bytes("a\0", 2));
+    ASSERT(bidirectional_hash_map_string_equality("", ""));
+    ASSERT(bidirectional_hash_map_string_equality(strings[5],
+                                                  string_copies[5]));
+    ASSERT(!bidirectional_hash_map_string_equality(strings[5], strings[6]));
+    ASSERT(!bidirectional_hash_map_string_equality("key", "key-1"));
+    ASSERT(!bidirectional_hash_map_buffer_equality(buffers[16], buffers[33]));
+    ASSERT(bidirectional_hash_map_integer_hasher((void*) 1) !=
+           bidirectional_hash_map_integer_hasher((void*) 2));
+    
+    ASSERT(bidirectional_hash_map_t_init(&map,
+                                         0,
+                                         1.0f,
+                                         bidirectional_hash_map_string_hasher,
+                                         bidirectional_hash_map_uuid_hasher,
+                                         bidirectional_hash_map_string_equality,
+                                         bidirectional_hash_map_uuid_equality,
+                                         error_sentinel));
+    
+    for (i = 0; i < 300; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_put_by_primary(&map,
+                                                       strings[i],
+                                                       uuids[i]) == NULL);
+    }
+    
+    for (i = 0; i < 300; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map,
+                                                           string_copies[i])
+               == uuids[i]);
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                             uuid_copies[i])
+               == strings[i]);
+    }
+    
+    bidirectional_hash_map_t_destroy(&map);
+    
+    ASSERT(bidirectional_hash_map_t_init(
+                                    &map,
+                                    0,
+                                    1.0f,
+                                    bidirectional_hash_map_integer_hasher,
+                                    bidirectional_hash_map_buffer_hasher,
+                                    bidirectional_hash_map_integer_equality,
+                                    bidirectional_hash_map_buffer_equality,
+                                    error_sentinel));
+    
+    /*****************************************************************
+    * The buffers of equal length differ in their first byte, except *
+    * the empty ones, which all map to the last of them.             *
+    *****************************************************************/
+    for (i = 0; i < 300; ++i)
+    {
+        bidirectional_hash_map_t_put_by_secondary(&map,
+                                                  (void*)(i + 1),
+                                                  buffers[i]);
+    }
+    
+    for (i = 0; i < 300; ++i)
+    {
+        if (buffers[i][0] == 0)
+        {
+            continue;
+        }
+        
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(&map,
+                                                             buffer_copies[i])
+               == (void*)(i + 1));
+    }
+    
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+static size_t string_equality_calls = 0;
+
+static int counting_string_equality(void* a, void* b)
+{
+    string_equality_calls++;
+    return bidirectional_hash_map_string_equality(a, b);
+}
+
+static void test_inline_keys(void* error_sentinel)
+{
+    static char strings[400][40];
+    static char string_copies[400][40];
+    static char renamed_strings[400][40];
+    size_t i;
+    bidirectional_hash_map_t map;
+    
+    /****************************************************************
+    * Every fourth string is too long to fit the 16 inline bytes.   *
+    ****************************************************************/
+    for (i = 0; i < 400; ++i)
+    {
+        sprintf(strings[i],
+                i % 4 == 0 ? "a-rather-long-string-%d" : "s%d",
+                (int) i);
+        strcpy(string_copies[i], strings[i]);
+        sprintf(renamed_strings[i],
+                i % 4 == 0 ? "a-rather-long-new-name-%d" : "r%d",
+                (int) i);
+    }
+    
+    ASSERT(bidirectional_hash_map_t_init(&map,
+                                         0,
+                                         1.0f,
+                                         bidirectional_hash_map_string_hasher,
+                                         bidirectional_hash_map_string_hasher,
+                                         counting_string_equality,
+                                         counting_string_equality,
+                                         error_sentinel));
+    
+    ASSERT(!bidirectional_hash_map_t_set_inline_keys(
+                                        &map,
+                                        bidirectional_hash_map_string_size,
+                                        bidirectional_hash_map_string_size,
+                                        16));
+    
+    bidirectional_hash_map_t_destroy(&map);
+    
+    ASSERT(bidirectional_hash_map_t_init_with_flags(
+                                        &map,
+                                        0,
+                                        1.0f,
+                                        bidirectional_hash_map_string_hasher,
+                                        bidirectional_hash_map_string_hasher,
+                                        counting_string_equality,
+                                        counting_string_equality,
+                                        error_sentinel,
+                                        BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS));
+    
+    ASSERT(!bidirectional_hash_map_t_set_inline_keys(
+                                        &map,
+                                        bidirectional_hash_map_string_size,
+                                        bidirectional_hash_map_string_size,
+                                        255));
+    ASSERT(bidirectional_hash_map_t_set_inline_keys(
+                                        &map,
+                                        bidirectional_hash_map_string_size,
+                                        bidirectional_hash_map_string_size,
+                                        16));
+    
+    /*****************************************************************
+    * The primary key i maps to the secondary key 399 - i, so a pair *
+    * may mix a short and a long key.                                *
+    *****************************************************************/
+    for (i = 0; i < 400; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_put_by_primary(&map,
+                                                       strings[i],
+                                                       strings[399 - i])
+               == NULL);
+    }
+    
+    ASSERT(!bidirectional_hash_map_t_set_inline_keys(
+                                        &map,
+                                        bidirectional_hash_map_string_size,
+                                        NULL,
+                                        16));
+    
+    string_equality_calls = 0;
+    
+    for (i = 0; i < 400; ++i)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map,
+                                                           string_copies[i])
+               == strings[399 - i]);
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(
+                                                    &map,
+                                                    string_copies[399 - i])
+               == strings[i]);
+    }
+    
+    ASSERT(!bidirectional_hash_map_t_contains_primary_key(&map, "s401"));
+    ASSERT(!bidirectional_hash_map_t_contains_primary_key(
+                                                    &map,
+                                                    "a-rather-long-string-1"));
+    
+    /***************************************************************
+    * Only the long keys, 100 in each direction, call the equality *
+    * function.                                                    *
+    ***************************************************************/
+    ASSERT(string_equality_calls == 200);
+    
+    /******************************************************************
+    * Re-keying and reusing the records of removed mappings must keep *
+    * the inline copies up to date.                                   *
+    ******************************************************************/
+    for (i = 0; i < 400; i += 2)
+    {
+        ASSERT(bidirectional_hash_map_t_remove_by_primary_key(&map,
+                                                              string_copies[i])
+               == strings[399 - i]);
+    }
+    
+    for (i = 0; i < 400; i += 2)
+    {
+        ASSERT(bidirectional_hash_map_t_put_by_primary(&map,
+                                                       strings[i],
+                                                       strings[399 - i])
+               == NULL);
+        ASSERT(bidirectional_hash_map_t_put_by_secondary(&map,
+                                                         renamed_strings[i],
+                                                         strings[399 - i])
+               == strings[i]);
+    }
+    
+    for (i = 0; i < 400; i += 2)
+    {
+        ASSERT(!bidirectional_hash_map_t_contains_primary_key(
+                                                        &map,
+                                                        string_copies[i]));
+        ASSERT(bidirectional_hash_map_t_get_by_secondary_key(
+                                                    &map,
+                                                    string_copies[399 - i])
+               == renamed_strings[i]);
+        
+        strcpy(string_copies[i], renamed_strings[i]);
+        
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map,
+                                                           string_copies[i])
+               == strings[399 - i]);
+    }
+    
+    ASSERT(bidirectional_hash_map_t_size(&map) == 400);
+    bidirectional_hash_map_t_destroy(&map);
+}
+
+static size_t truncating_key_hasher(void* key)
+{
+    return (size_t) key & 0xFF;
+}
+
+static void test_static_map(void)
+{
+    size_t i;
+    key_pair_t key_pairs[1000];
+    bidirectional_static_hash_map_t map;
+    counting_allocator_state_t state;
+    bidirectional_hash_map_allocator_t allocator;
+    
+    state.allocations   = 0;
+    state.deallocations = 0;
+    
+    allocator.allocate        = counting_allocate;
+    allocator.allocate_zeroed = counting_allocate_zeroed;
+    allocator.deallocate      = counting_deallocate;
+    allocator.context         = &state;
+    
+    ASSERT(bidirectional_static_hash_map_t_build(&map,
+                                                 NULL,
+                                                 0,
+                                                 primary_key_hasher,
+                                                 secondary_key_hasher,
+                                                 primary_key_equality,
+                                                 secondary_key_equality,
+                                                 &allocator));
+    ASSERT(bidirectional_static_hash_map_t_size(&map) == 0);
+    ASSERT(!bidirectional_static_hash_map_t_contains_primary_key(&map,
+                                                                 (void*) 1));
+    bidirectional_static_hash_map_t_destroy(&map);
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        key_pairs[i].primary_key   = (void*)(i * 3 + 1);
+        key_pairs[i].secondary_key = (void*)(i << 12);
+    }
+    
+    ASSERT(bidirectional_static_hash_map_t_build(&map,
+                                                 key_pairs,
+                                                 1000,
+                                                 primary_key_hasher,
+                                                 secondary_key_hasher,
+                                                 primary_key_equality,
+                                                 secondary_key_equality,
+                                                 &allocator));
+    ASSERT(bidirectional_static_hash_map_t_size(&map) == 1000);
+    
+    for (i = 0; i < 1000; ++i)
+    {
+        ASSERT(bidirectional_static_hash_map_t_get_by_primary_key(
+                                                        &map,
+                                                        (void*)(i * 3 + 1))
+               == (void*)(i << 12));
+        
+        ASSERT(bidirectional_static_hash_map_t_get_by_secondary_key(
+                                                        &map,
+                                                        (void*)(i << 12))
+               == (void*)(i * 3 + 1));
+        
+        ASSERT(!bidirectional_static_hash_map_t_contains_primary_key(
+                                                        &map,
+                                                        (void*)(i * 3 + 2)));
+        
+        ASSERT(!bidirectional_static_hash_map_t_contains_secondary_key(
+                                                        &map,
+                                                        (void*)(i + 1)));
+    }
+    
+    bidirectional_static_hash_map_t_destroy(&map);
+    
+    /********************************************************************
+    * Keys sharing a hash cannot be told apart by a perfect hash, and a *
+    * duplicate key is just a special case of that.                     *
+    ********************************************************************/
+    ASSERT(!bidirectional_static_hash_map_t_build(&map,
+                                                  key_pairs,
+                                                  1000,
+                                                  truncating_key_hasher,
+                                                  secondary_key_hasher,
+                                                  primary_key_equality,
+                                                  secondary_key_equality,
+                                                  &allocator));
+    
+    key_pairs[999].secondary_key = key_pairs[0].secondary_key;
+    
+    ASSERT(!bidirectional_static_hash_map_t_build(&map,
+                                                  key_pairs,
+                                                  1000,
+                                                  primary_key_hasher,
+                                                  secondary_key_hasher,
+                                                  primary_key_equality,
+                                                  secondary_key_equality,
+                                                  &allocator));
+    
+    ASSERT(state.allocations == state.deallocations);
+}
+
+static size_t typed_string_hasher(const char* key)
+{
+    return bidirectional_hash_map_hash_bytes(key, strlen(key));
+}
+
+static int typed_string_equality(const char* key1, const char* key2)
+{
+    return strcmp(key1, key2) == 0;
+}
+
+BIDIRECTIONAL_TYPED_HASH_MAP_INIT(typed_integer_map,
+                                  size_t,
+                                  size_t,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_EQUALITY,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_EQUALITY)
+
+BIDIRECTIONAL_TYPED_HASH_MAP_INIT(typed_string_map,
+                                  const char*,
+                                  int,
+                                  typed_string_hasher,
+                                  typed_string_equality,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH,
+                                  BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_EQUALITY)
+
+static void test_typed_map(void* error_sentinel)
+{
+    static char strings[300][16];
+    static char string_copies[300][16];
+    size_t i;
+    size_t key;
+    size_t other_key;
+    size_t next_secondary_key = 100000;
+    size_t random_state = 54321;
+    void* secondary_key;
+    const char* string = NULL;
+    int value = 0;
+    typed_integer_map_t typed_map;
+    typed_string_map_t string_map = { 0 };
+    bidirectional_open_hash_map_t open_map;
+    
+    ASSERT(typed_integer_map_t_init(&typed_map, 0, 0.75f));
+    ASSERT(bidirectional_open_hash_map_t_init(&open_map,
+                                              0,
+                                              0.75f,
+                                              primary_key_hasher,
+                                              secondary_key_hasher,
+                                              primary_key_equality,
+                                              secondary_key_equality,
+                                              error_sentinel));
+    
+    /****************************************************************
+    * Run the same random operations on the typed map and the open  *
+    * addressing engine, and make sure they agree. The keys are     *
+    * nonzero, since the engine reports missing keys with NULL.     *
+    ****************************************************************/
+    for (i = 0; i < 20000; ++i)
+    {
+        random_state = random_state * 1103515245 + 12345;
+        key = (random_state >> 8) % 1000 + 1;
+        other_key = 0;
+        
+        switch ((random_state >> 4) % 4)
+        {
+            case 0:
+            case 1:
+                ASSERT(typed_integer_map_t_put_by_primary(
+                                            &typed_map,
+                                            key,
+                                            next_secondary_key,
+                                            &other_key) ==
+                       (bidirectional_open_hash_map_t_contains_primary_key(
+                                            &open_map,
+                                            (void*) key) ?
+                        BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED :
+                        BIDIRECTIONAL_TYPED_HASH_MAP_ADDED));
+                ASSERT(bidirectional_open_hash_map_t_put_by_primary(
+                                            &open_map,
+                                            (void*) key,
+                                            (void*) next_secondary_key) ==
+                       (void*) other_key);
+                next_secondary_key++;
+                break;
+            
+            case 2:
+                typed_integer_map_t_remove_by_primary_key(&typed_map,
+                                                          key,
+                                                          &other_key);
+                ASSERT(bidirectional_open_hash_map_t_remove_by_primary_key(
+                                                            &open_map,
+                                                            (void*) key) ==
+                       (void*) other_key);
+                break;
+            
+            case 3:
+                key = next_secondary_key - key;
+                typed_integer_map_t_remove_by_secondary_key(&typed_map,
+                                                            key,
+                                                            &other_key);
+                ASSERT(bidirectional_open_hash_map_t_remove_by_secondary_key(
+                                                            &open_map,
+                                                            (void*) key) ==
+                       (void*) other_key);
+                break;
+        }
+        
+        ASSERT(typed_integer_map_t_size(&typed_map) ==
+               bidirectional_open_hash_map_t_size(&open_map));
+    }
+    
+    for (key = 1; key <= 1000; ++key)
+    {
+        secondary_key = bidirectional_open_hash_map_t_get_by_primary_key(
+                                                                &open_map,
+                                                                (void*) key);
+        
+        ASSERT(typed_integer_map_t_contains_primary_key(&typed_map, key) ==
+               (secondary_key != NULL));
+        
+        if (secondary_key)
+        {
+            ASSERT(typed_integer_map_t_get_by_primary_key(&typed_map,
+                                                          key,
+                                                          &other_key));
+            ASSERT(other_key == (size_t) secondary_key);
+            ASSERT(typed_integer_map_t_get_by_secondary_key(&typed_map,
+                                                            other_key,
+                                                            &other_key));
+            ASSERT(other_key == key);
+        }
+    }
+    
+    for (i = 0; i < typed_integer_map_t_size(&typed_map); ++i)
+    {
+        ASSERT(bidirectional_open_hash_map_t_get_by_primary_key(
+                            &open_map,
+                            (void*) typed_map.mappings[i].primary_key) ==
+               (void*) typed_map.mappings[i].secondary_key);
+    }
+    
+    typed_integer_map_t_destroy(&typed_map);
+    bidirectional_open_hash_map_t_destroy(&open_map);
+    
+    /*****************************************************************
+    * Keys stored by value are compared by contents, so the copies   *
+    * of the strings find the mappings of the originals.             *
+    *****************************************************************/
+    ASSERT(typed_string_map_t_init(&string_map, 100, 0.5f));
+    
+    for (i = 0; i < 300; ++i)
+    {
+        sprintf(strings[i], "key-%d", (int) i);
+        strcpy(string_copies[i], strings[i]);
+        
+        ASSERT(typed_string_map_t_put_by_primary(&string_map,
+                                                 strings[i],
+                                                 (int) i,
+                                                 NULL) ==
+               BIDIRECTIONAL_TYPED_HASH_MAP_ADDED);
+    }
+    
+    for (i = 0; i < 300; ++i)
+    {
+        ASSERT(typed_string_map_t_get_by_primary_key(&string_map,
+                                                     string_copies[i],
+                                                     &value));
+        ASSERT(value == (int) i);
+        ASSERT(typed_string_map_t_get_by_secondary_key(&string_map,
+                                                       (int) i,
+                                                       &string));
+        ASSERT(string == strings[i]);
+    }
+    
+    ASSERT(typed_string_map_t_put_by_secondary(&string_map,
+                                               "renamed",
+                                               7,
+                                               &string) ==
+           BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED);
+    ASSERT(string == strings[7]);
+    ASSERT(!typed_string_map_t_contains_primary_key(&string_map,
+                                                    string_copies[7]));
+    ASSERT(typed_string_map_t_remove_by_primary_key(&string_map,
+                                                    "renamed",
+                                                    &value));
+    ASSERT(value == 7);
+    ASSERT(!typed_string_map_t_contains_secondary_key(&string_map, 7));
+    ASSERT(typed_string_map_t_size(&string_map) == 299);
+    
+    typed_string_map_t_destroy(&string_map);
+}
+
+/*****************************************************************
+* Checks that keys differing only in their high bits spread over *
+* the home slots of the integer hash.                            *
+*****************************************************************/
+#define HIGH_BIT_KEY_SHIFT (sizeof(size_t) * 8 - 16)
+
+static void test_typed_map_high_bit_keys(void)
+{
+    size_t i;
+    size_t key;
+    unsigned char home_slot_taken[1024];
+    typed_integer_map_t typed_map;
+    
+    memset(home_slot_taken, 0, sizeof(home_slot_taken));
+    
+    for (i = 0; i < 1024; ++i)
+    {
+        home_slot_taken[BIDIRECTIONAL_TYPED_HASH_MAP_INTEGER_HASH(
+                                            (uint64_t) i << 48) & 1023] = 1;
+    }
+    
+    for (i = 0, key = 0; i < 1024; ++i)
+    {
+        key += home_slot_taken[i];
+    }
+    
+    ASSERT(key >= 512);
+    
+    ASSERT(typed_integer_map_t_init(&typed_map, 0, 0.75f));
+    
+    for (i = 1; i <= 50000; ++i)
+    {
+        ASSERT(typed_integer_map_t_put_by_primary(&typed_map,
+                                                  i << HIGH_BIT_KEY_SHIFT,
+                                                  i,
+                                                  NULL) ==
+               BIDIRECTIONAL_TYPED_HASH_MAP_ADDED);
+    }
+    
+    for (i = 1; i <= 50000; ++i)
+    {
+        ASSERT(typed_integer_map_t_get_by_secondary_key(&typed_map,
+                                                        i,
+                                                        &key));
+        ASSERT(key == i << HIGH_BIT_KEY_SHIFT);
+    }
+    
+    typed_integer_map_t_destroy(&typed_map);
+}
+
+/***********************************************************
+* Returns the length of the longest run of occupied slots. *
+***********************************************************/
+static size_t get_longest_probe_run(typed_hash_map_slot_t* slots,
+                                    size_t capacity)
+{
+    size_t i;
+    size_t run = 0;
+    size_t longest_run = 0;
+    
+    for (i = 0; i < capacity; ++i)
+    {
+        run = slots[i].mapping_index == TYPED_HASH_MAP_EMPTY_SLOT ? 0 : run + 1;
+        longest_run = run > longest_run ? run : longest_run;
+    }
+    
+    return longest_run;
+}
+
+static void test_int_map(void)
+{
+    uint64_t i;
+    uint64_t key;
+    bidirectional_int_map_t map;
+    
+    ASSERT(bidirectional_int_map_t_init(&map, 0, 0.75f));
+    
+    /*****************************************************************
+    * Keys differing only in their high bits must spread as well as  *
+    * the sequential ones. Zero and all ones are ordinary keys.      *
+    *****************************************************************/
+    for (i = 0; i < 4096; ++i)
+    {
+        ASSERT(bidirectional_int_map_t_put_by_primary(&map,
+                                                      i << 40,
+                                                      ~i,
+                                                      NULL) ==
+               BIDIRECTIONAL_TYPED_HASH_MAP_ADDED);
+    }
+    
+    ASSERT(bidirectional_int_map_t_size(&map) == 4096);
+    ASSERT(get_longest_probe_run(map.primary_key_table, map.capacity) < 64);
+    ASSERT(get_longest_probe_run(map.secondary_key_table, map.capacity) < 64);
+    
+    for (i = 0; i < 4096; ++i)
+    {
+        ASSERT(bidirectional_int_map_t_get_by_primary_key(&map, i << 40, &key));
+        ASSERT(key == ~i);
+        ASSERT(bidirectional_int_map_t_get_by_secondary_key(&map, ~i, &key));
+        ASSERT(key == i << 40);
+        ASSERT(!bidirectional_int_map_t_contains_primary_key(&map, i + 1));
+    }
+    
+    ASSERT(bidirectional_int_map_t_put_by_primary(&map, 0, 7, &key) ==
+           BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED);
+    ASSERT(key == ~(uint64_t) 0);
+    ASSERT(!bidirectional_int_map_t_contains_secondary_key(&map,
+                                                           ~(uint64_t) 0));
+    ASSERT(bidirectional_int_map_t_put_by_secondary(&map, 1, 7, &key) ==
+           BIDIRECTIONAL_TYPED_HASH_MAP_REPLACED);
+    ASSERT(key == 0);
+    ASSERT(bidirectional_int_map_t_get_by_secondary_key(&map, 7, &key));
+    ASSERT(key == 1);
+    
+    for (i = 1; i < 4095; i += 2)
+    {
+        ASSERT(bidirectional_int_map_t_remove_by_primary_key(&map,
+                                                             i << 40,
+                                                             &key));
+        ASSERT(key == ~i);
+        ASSERT(bidirectional_int_map_t_remove_by_secondary_key(&map,
+                                                               ~(i + 1),
+                                                               &key));
+        ASSERT(key == (i + 1) << 40);
+    }
+    
+    ASSERT(!bidirectional_int_map_t_remove_by_primary_key(&map, 1 << 20, NULL));
+    ASSERT(bidirectional_int_map_t_size(&map) == 2);
+    ASSERT(bidirectional_int_map_t_remove_by_primary_key(&map, 1, &key));
+    ASSERT(key == 7);
+    ASSERT(bidirectional_int_map_t_size(&map) == 1);
+    
+    bidirectional_int_map_t_destroy(&map);
+}
+
+static void test_concurrent_map_against_chained_map(void* error_sentinel)
+{
+    size_t i;
+    size_t key;
+    size_t next_key = 100000;
+    size_t random_state = 54321;
+    void* removed_key;
+    bidirectional_hash_map_t map;
+    bidirectional_concurrent_hash_map_t concurrent_map;
+    
+    bidirectional_hash_map_t_init(&map,
+                                  0,
+                                  1.0f,
+                                  primary_key_hasher,
+                                  secondary_key_hasher,
+                                  primary_key_equality,
+                                  secondary_key_equality,
+                                  error_sentinel);
+    
+    ASSERT(bidirectional_concurrent_hash_map_t_init(&concurrent_map,
+                                                    4,
+                                                    1.0f,
+                                                    primary_key_hasher,
+                                                    secondary_key_hasher,
+                                                    primary_key_equality,
+                                                    secondary_key_equality,
+                                                    error_sentinel));
+    
+    /***************************************************************
+    * Re-keying moves the mappings between the stripes, so the     *
+    * paths taking the locks of three stripes get exercised too.   *
+    ***************************************************************/
+    for (i = 0; i < 20000; ++i)
+    {
+        random_state = random_state * 1103515245 + 12345;
+        key = (random_state >> 8) % 1000;
+        
+        switch ((random_state >> 4) % 5)
+        {
+            case 0:
+            case 1:
+                ASSERT(bidirectional_hash_map_t_put_by_primary(
+                                            &map,
+                                            (void*) key,
+                                            (void*) next_key) ==
+                       bidirectional_concurrent_hash_map_t_put_by_primary(
+                                            &concurrent_map,
+                                            (void*) key,
+                                            (void*) next_key));
+                next_key++;
+                break;
+            
+            case 2:
+                key = next_key - 1 - key;
+                ASSERT(bidirectional_hash_map_t_put_by_secondary(
+                                            &map,
+                                            (void*) next_key,
+                                            (void*) key) ==
+                       bidirectional_concurrent_hash_map_t_put_by_secondary(
+                                            &concurrent_map,
+                                            (void*) next_key,
+                                            (void*) key));
+                next_key++;
+                break;
+            
+            case 3:
+                removed_key =
+                    bidirectional_concurrent_hash_map_t_remove_by_primary_key(
+                                                            &concurrent_map,
+                                                            (void*) key);
+                ASSERT(bidirectional_hash_map_t_remove_by_primary_key(
+                                                            &map,
+                                                            (void*) key) ==
+                       removed_key);
+                break;
+            
+            case 4:
+                key = next_key - 1 - key;
+                removed_key =
+                    bidirectional_concurrent_hash_map_t_remove_by_secondary_key(
+                                                            &concurrent_map,
+                                                            (void*) key);
+                ASSERT(bidirectional_hash_map_t_remove_by_secondary_key(
+                                                            &map,
+                                                            (void*) key) ==
+                       removed_key);
+                break;
+        }
+        
+        ASSERT(bidirectional_hash_map_t_size(&map) ==
+               bidirectional_concurrent_hash_map_t_size(&concurrent_map));
+    }
+    
+    for (key = 0; key < next_key; ++key)
+    {
+        ASSERT(bidirectional_hash_map_t_get_by_primary_key(&map,
+                                                           (void*) key) ==
+               bidirectional_concurrent_hash_map_t_get_by_primary_key(
+                                                           &concurrent_map,
+                                                           (void*) key));
+        ASSERT(bidirectional_hash_map_t_contains_secondary_key(&map,
+                                                               (void*) key) ==
+               bidirectional_concurrent_hash_map_t_contains_secondary_key(
+                                                           &concurrent_map,
+                                                           (void*) key));
+    }
+    
+    bidirectional_hash_map_t_destroy(&map);
+    bidirectional_concurrent_hash_map_t_destroy(&concurrent_map);
+}
+
+/*****************************************************************
+* The work of one thread of the concurrent map test. Each thread *
+* owns its keys, but all of them share the few stripes.          *
+*****************************************************************/
+typedef struct concurrent_map_worker_t {
+    bidirectional_concurrent_hash_map_t* map;
+    size_t first_key;
+    size_t key_count;
+}
+concurrent_map_worker_t;
+
+#define CONCURRENT_TEST_KEY_SPACE ((size_t) 1 << 24)
+
+static void* run_concurrent_map_worker(void* argument)
+{
+    concurrent_map_worker_t* worker = argument;
+    bidirectional_concurrent_hash_map_t* map = worker->map;
+    size_t i;
+    size_t primary_key;
+    size_t secondary_key;
+    void* removed_key;
+    
+    for (i = 0; i < worker->key_count; ++i)
+    {
+        primary_key = worker->first_key + i;
+        secondary_key = primary_key + CONCURRENT_TEST_KEY_SPACE;
+        ASSERT(bidirectional_concurrent_hash_map_t_put_by_primary(
+                                                    map,
+                                                    (void*) primary_key,
+                                                    (void*) secondary_key)
+               == NULL);
+    }
+    
+    for (i = 0; i < worker->key_count; ++i)
+    {
+        primary_key = worker->first_key + i;
+        secondary_key = primary_key + 2 * CONCURRENT_TEST_KEY_SPACE;
+        ASSERT(bidirectional_concurrent_hash_map_t_put_by_primary(
+                                                    map,
+                                                    (void*) primary_key,
+                                                    (void*) secondary_key)
+               == (void*)(primary_key + CONCURRENT_TEST_KEY_SPACE));
+        ASSERT(bidirectional_concurrent_hash_map_t_get_by_secondary_key(
+                                                    map,
+                                                    (void*) secondary_key)
+               == (void*) primary_key);
+    }
+    
+    for (i = 0; i < worker->key_count; ++i)
+    {
+        primary_key = worker->first_key + i;
+        secondary_key = primary_key + 2 * CONCURRENT_TEST_KEY_SPACE;
+        
+        switch (i % 4)
+        {
+            case 0:
+                ASSERT(bidirectional_concurrent_hash_map_t_put_by_secondary(
+                                map,
+                                (void*)(primary_key +
+                                        3 * CONCURRENT_TEST_KEY_SPACE),
+                                (void*) secondary_key) == (void*) primary_key);
+                break;
+            
+            case 1:
+                removed_key =
+                    bidirectional_concurrent_hash_map_t_remove_by_primary_key(
+                                                        map,
+                                                        (void*) primary_key);
+                ASSERT(removed_key == (void*) secondary_key);
+                break;
+            
+            case 2:
+                removed_key =
+                    bidirectional_concurrent_hash_map_t_remove_by_secondary_key(
+                                                        map,
+                                                        (void*) secondary_key);
+                ASSERT(removed_key == (void*) primary_key);
+                break;
+        }
+    }
+    
+    return NULL;
+}
+
+static void test_concurrent_map(void* error_sentinel)
+{
+    size_t i;
+    size_t primary_key;
+    size_t secondary_key;
+    bidirectional_concurrent_hash_map_t map;
+    concurrent_map_worker_t workers[8];
+    pthread_t threads[8];
+    
+    test_concurrent_map_against_chained_map(error_sentinel);
+    
+    ASSERT(bidirectional_concurrent_hash_map_t_init(&map,
+                                                    4,
+                                                    0.75f,
+                                                    primary_key_hasher,
+                                                    secondary_key_hasher,
+                                                    primary_key_equality,
+                                                    secondary_key_equality,
+                                                    error_sentinel));
+    
+    for (i = 0; i < 8; ++i)
+    {
+        workers[i].map       = &map;
+        workers[i].first_key = 1 + i * 2000;
+        workers[i].key_count = 2000;
+        ASSERT(pthread_create(&threads[i],
+                              NULL,
+                              run_concurrent_map_worker,
+                              &workers[i]) == 0);
+    }
+    
+    for (i = 0; i < 8; ++i)
+    {
+        ASSERT(pthread_join(threads[i], NULL) == 0);
+    }
+    
+    ASSERT(bidirectional_concurrent_hash_map_t_size(&map) == 8 * 1000);
+    
+    for (i = 0; i < 8 * 2000; ++i)
+    {
+        primary_key = 1 + i;
+        secondary_key = primary_key + 2 * CONCURRENT_TEST_KEY_SPACE;
+        
+        switch (i % 4)
+        {
+            case 0:
+                ASSERT(bidirectional_concurrent_hash_map_t_get_by_secondary_key(
+                                &map,
+                                (void*) secondary_key) ==
+                       (void*)(primary_key + 3 * CONCURRENT_TEST_KEY_SPACE));
+                ASSERT(bidirectional_concurrent_hash_map_t_get_by_primary_key(
+                                &map,
+                                (void*) primary_key) == NULL);
+                break;
+            
+            case 1:
+            case 2:
+                ASSERT(bidirectional_concurrent_hash_map_t_get_by_secondary_key(
+                                &map,
+                                (void*) secondary_key) == NULL);
+                break;
+            
+            case 3:
+                ASSERT(bidirectional_concurrent_hash_map_t_get_by_primary_key(
+                                &map,
+                                (void*) primary_key) == (void*) secondary_key);
+                break;
+        }
+    }
+    
+    bidirectional_concurrent_hash_map_t_destroy(&map);
+}
+
+static void* run_concurrent_map_writer(void* argument)
+{
+    concurrent_map_worker_t* worker = argument;
+    size_t round;
+    size_t key;
+    
+    for (round = 0; round < 10; ++round)
+    {
+        for (key = worker->first_key;
+             key < worker->first_key + worker->key_count;
+             ++key)
+        {
+            ASSERT(bidirectional_concurrent_hash_map_t_put_by_primary(
+                                worker->map,
+                                (void*) key,
+                                (void*)(key + 2 * CONCURRENT_TEST_KEY_SPACE))
+                   == NULL);
+        }
+        
+        for (key = worker->first_key;
+             key < worker->first_key + worker->key_count;
+             ++key)
+        {
+            ASSERT(bidirectional_concurrent_hash_map_t_put_by_primary(
+                                worker->map,
+                                (void*) key,
+                                (void*)(key + 3 * CONCURRENT_TEST_KEY_SPACE))
+                   == (void*)(key + 2 * CONCURRENT_TEST_KEY_SPACE));
+        }
+        
+        for (key = worker->first_key;
+             key < worker->first_key + worker->key_count;
+             ++key)
+        {
+            ASSERT(bidirectional_concurrent_hash_map_t_remove_by_secondary_key(
+                                worker->map,
+                                (void*)(key + 3 * CONCURRENT_TEST_KEY_SPACE))
+                   == (void*) key);
+        }
+    }
+    
+    return NULL;
+}
+
+/****************************************************************
+* Looks up the stable keys, which must always be found, and the *
+* keys the writers keep re-keying and removing, which must map  *
+* to one of their secondary keys or to nothing.                 *
+****************************************************************/
+static void* run_concurrent_map_reader(void* argument)
+{
+    concurrent_map_worker_t* worker = argument;
+    size_t i;
+    size_t key;
+    void* secondary_key;
+    
+    for (i = 0; i < 40000; ++i)
+    {
+        key = 1 + i % worker->key_count;
+        ASSERT(bidirectional_concurrent_hash_map_t_get_by_primary_key(
+                                    worker->map,
+                                    (void*) key) ==
+               (void*)(key + CONCURRENT_TEST_KEY_SPACE));
+        ASSERT(bidirectional_concurrent_hash_map_t_get_by_secondary_key(
+                                    worker->map,
+                                    (void*)(key + CONCURRENT_TEST_KEY_SPACE))
+               == (void*) key);
+        
+        key = worker->first_key + i % worker->key_count;
+        secondary_key = bidirectional_concurrent_hash_map_t_get_by_primary_key(
+                                    worker->map,
+                                    (void*) key);
+        ASSERT(secondary_key == NULL ||
+               secondary_key == (void*)(key + 2 * CONCURRENT_TEST_KEY_SPACE) ||
+               secondary_key == (void*)(key + 3 * CONCURRENT_TEST_KEY_SPACE));
+    }
+    
+    return NULL;
+}
+
+static void test_concurrent_lookups(void* error_sentinel)
+{
+    size_t i;
+    size_t key;
+    bidirectional_concurrent_hash_map_t map;
+    concurrent_map_worker_t workers[6];
+    pthread_t threads[6];
+    
+    ASSERT(bidirectional_concurrent_hash_map_t_init(&map,
+                                                    4,
+                                                    0.75f,
+                                                    primary_key_hasher,
+                                                    secondary_key_hasher,
+                                                    primary_key_equality,
+                                                    secondary_key_equality,
+                                                    error_sentinel));
+    
+    for (key = 1; key <= 2000; ++key)
+    {
+        bidirectional_concurrent_hash_map_t_put_by_primary(
+                                    &map,
+                                    (void*) key,
+                                    (void*)(key + CONCURRENT_TEST_KEY_SPACE));
+    }
+    
+    /**************************************************************
+    * Two writers churn 1000 keys each while four readers look up *
+    * the stable keys and the keys of both the writers.           *
+    **************************************************************/
+    for (i = 0; i < 6; ++i)
+    {
+        workers[i].map       = &map;
+        workers[i].first_key = i < 2 ? 100000 + i * 1000 : 100000;
+        workers[i].key_count = i < 2 ? 1000 : 2000;
+        ASSERT(pthread_create(&threads[i],
+                              NULL,
+                              i < 2 ? run_concurrent_map_writer :
+                                      run_concurrent_map_reader,
+                              &workers[i]) == 0);
+    }
+    
+    for (i = 0; i < 6; ++i)
+    {
+        ASSERT(pthread_join(threads[i], NULL) == 0);
+    }
+    
+    ASSERT(bidirectional_concurrent_hash_map_t_size(&map) == 2000);
+    
+    /*************************************************************
+    * With no lookup under way, the removed mappings and the old *
+    * tables get freed as fast as they are retired.              *
+    *************************************************************/
+    for (key = 100000; key < 102000; ++key)
+    {
+        bidirectional_concurrent_hash_map_t_put_by_primary(&map,
+                                                           (void*) key,
+                                                           (void*) key);
+        bidirectional_concurrent_hash_map_t_remove_by_primary_key(&map,
+                                                                  (void*) key);
+    }
+    
+    ASSERT(map.retired_count <= 64);
+    
+    /**************************************************************
+    * Pretend the reader of this thread is stuck inside a lookup: *
+    * nothing retired from then on may be freed until it leaves.  *
+    **************************************************************/
+    ASSERT(bidirectional_concurrent_hash_map_t_contains_primary_key(&map,
+                                                                    (void*) 1));
+    
+    if (map.readers)
+    {
+        map.readers->epoch = map.epoch;
+        
+        for (key = 100000; key < 102000; ++key)
+        {
+            bidirectional_concurrent_hash_map_t_put_by_primary(&map,
+                                                               (void*) key,
+                                                               (void*) key);
+            bidirectional_concurrent_hash_map_t_remove_by_primary_key(
+                                                               &map,
+                                                               (void*) key);
+        }
+        
+        ASSERT(map.retired_count >= 2000);
+        map.readers->epoch = 0;
+        
+        for (key = 100000; key < 100100; ++key)
+        {
+            bidirectional_concurrent_hash_map_t_put_by_primary(&map,
+                                                               (void*) key,
+                                                               (void*) key);
+            bidirectional_concurrent_hash_map_t_remove_by_primary_key(
+                                                               &map,
+                                                               (void*) key);
+        }
+        
+        ASSERT(map.retired_count <= 64);
+    }
+    
+    bidirectional_concurrent_hash_map_t_destroy(&map);
+}
+
+#define SNAPSHOT_TEST_KEYS        100
+#define SNAPSHOT_TEST_GENERATIONS 50
+
+/********************************************************************
+* Checks that all the keys of one version belong to one generation, *
+* never to two publications at once, until the last one shows up.   *
+********************************************************************/
+static void* run_snapshot_map_reader(void* argument)
+{
+    bidirectional_snapshot_hash_map_t* map = argument;
+    bidirectional_frozen_hash_map_t* version;
+    snapshot_hash_map_reader_t* reader =
+        bidirectional_snapshot_hash_map_t_register_reader(map);
+    size_t generation = 0;
+    size_t secondary_key;
+    size_t key;
+    
+    ASSERT(reader != NULL);
+    
+    while (generation != SNAPSHOT_TEST_GENERATIONS)
+    {
+        version = bidirectional_snapshot_hash_map_t_get_version(map);
+        ASSERT(bidirectional_frozen_hash_map_t_size(version) ==
+               SNAPSHOT_TEST_KEYS);
+        
+        secondary_key =
+            (size_t) bidirectional_frozen_hash_map_t_get_by_primary_key(
+                                                                version,
+                                                                (void*) 1);
+        ASSERT(secondary_key / 1000 >= generation);
+        generation = secondary_key / 1000;
+        
+        for (key = 1; key <= SNAPSHOT_TEST_KEYS; ++key)
+        {
+            secondary_key = key + generation * 1000;
+            ASSERT(bidirectional_frozen_hash_map_t_get_by_primary_key(
+                                                version,
+                                                (void*) key) ==
+                   (void*) secondary_key);
+            ASSERT(bidirectional_frozen_hash_map_t_get_by_secondary_key(
+                                                version,
+                                                (void*) secondary_key) ==
+                   (void*) key);
+        }
+        
+        bidirectional_snapshot_hash_map_t_quiescent_state(map, reader);
+    }
+    
+    bidirectional_snapshot_hash_map_t_unregister_reader(map, reader);
+    return NULL;
+}
+
+/**************************************
+* An allocator that is out of memory. *
+**************************************/
+static void* failing_allocate(void* context, size_t size)
+{
+    (void) context;
+    (void) size;
+    return NULL;
+}
+
+static void* failing_allocate_zeroed(void* context, size_t count, size_t size)
+{
+    (void) context;
+    (void) count;
+    (void) size;
+    return NULL;
+}
+
+static size_t count_retired_versions(bidirectional_snapshot_hash_map_t* map)
+{
+    size_t count = 0;
+    snapshot_hash_map_version_t* version;
+    
+    for (version = map->retired_versions; version; version = version->next)
+    {
+        ++count;
+    }
+    
+    return count;
+}
+
+static void test_snapshot_map(void* error_sentinel)
+{
+    size_t i;
+    size_t key;
+    size_t generation;
+    bidirectional_snapshot_hash_map_t map;
+    bidirectional_frozen_hash_map_t* first_version;
+    bidirectional_frozen_hash_map_t* version;
+    snapshot_hash_map_reader_t* reader;
+    bidirectional_hash_map_allocator_t allocator;
+    pthread_t threads[4];
+    
+    ASSERT(bidirectional_snapshot_hash_map_t_init(&map,
+                                                  0,
+                                                  0.75f,
+                                                  primary_key_hasher,
+                                                  secondary_key_hasher,
+                                                  primary_key_equality,
+                                                  secondary_key_equality,
+                                                  error_sentinel));
+    
+    reader = bidirectional_snapshot_hash_map_t_register_reader(&map);
+    ASSERT(reader != NULL);
+    
+    /****************************************************************
+    * The staged mappings stay invisible until they are published,  *
+    * and publishing with nothing staged keeps the current version. *
+    ****************************************************************/
+    first_version = bidirectional_snapshot_hash_map_t_get_version(&map);
+    ASSERT(bidirectional_frozen_hash_map_t_size(first_version) == 0);
+    ASSERT(bidirectional_snapshot_hash_map_t_publish(&map));
+    ASSERT(bidirectional_snapshot_hash_map_t_get_version(&map) ==
+           first_version);
+    
+    for (key = 1; key <= SNAPSHOT_TEST_KEYS; ++key)
+    {
+        ASSERT(bidirectional_snapshot_hash_map_t_put_by_primary(
+                                                &map,
+                                                (void*) key,
+                                                (void*) key) == NULL);
+    }
+    
+    ASSERT(bidirectional_snapshot_hash_map_t_get_version(&map) ==
+           first_version);
+    ASSERT(bidirectional_snapshot_hash_map_t_publish(&map));
+    
+    version = bidirectional_snapshot_hash_map_t_get_version(&map);
+    ASSERT(bidirectional_frozen_hash_map_t_size(version) == SNAPSHOT_TEST_KEYS);
+    ASSERT(bidirectional_frozen_hash_map_t_get_by_secondary_key(version,
+                                                                (void*) 7)
+           == (void*) 7);
+    
+    ASSERT(bidirectional_snapshot_hash_map_t_remove_by_primary_key(
+                                                &map,
+                                                (void*) 7) == (void*) 7);
+    ASSERT(bidirectional_snapshot_hash_map_t_remove_by_secondary_key(
+                                                &map,
+                                                (void*) 7) == NULL);
+    ASSERT(bidirectional_snapshot_hash_map_t_publish(&map));
+    
+    /*************************************************************
+    * The reader has announced no quiescent state yet, so it may *
+    * still hold either version replaced so far.                 *
+    *************************************************************/
+    ASSERT(count_retired_versions(&map) == 2);
+    ASSERT(bidirectional_frozen_hash_map_t_size(first_version) == 0);
+    ASSERT(bidirectional_frozen_hash_map_t_contains_primary_key(version,
+                                                                (void*) 7));
+    
+    version = bidirectional_snapshot_hash_map_t_get_version(&map);
+    ASSERT(!bidirectional_frozen_hash_map_t_contains_primary_key(version,
+                                                                 (void*) 7));
+    
+    bidirectional_snapshot_hash_map_t_quiescent_state(&map, reader);
+    ASSERT(bidirectional_snapshot_hash_map_t_publish(&map));
+    ASSERT(count_retired_versions(&map) == 0);
+    
+    ASSERT(bidirectional_snapshot_hash_map_t_put_by_secondary(
+                                                &map,
+                                                (void*) 7,
+                                                (void*) 7) == NULL);
+    ASSERT(bidirectional_snapshot_hash_map_t_publish(&map));
+    ASSERT(count_retired_versions(&map) == 1);
+    
+    bidirectional_snapshot_hash_map_t_unregister_reader(&map, reader);
+    ASSERT(bidirectional_snapshot_hash_map_t_publish(&map));
+    ASSERT(count_retired_versions(&map) == 0);
+    
+    /************************************************************
+    * A put the working map has no memory for returns the error *
+    * sentinel and leaves nothing to publish.                   *
+    ************************************************************/
+    version   = bidirectional_snapshot_hash_map_t_get_version(&map);
+    allocator = map.working_map.allocator;
+    map.working_map.allocator.allocate        = failing_allocate;
+    map.working_map.allocator.allocate_zeroed = failing_allocate_zeroed;
+    
+    ASSERT(bidirectional_snapshot_hash_map_t_put_by_primary(
+                                                &map,
+                                                (void*) 500,
+                                                (void*) 500) == error_sentinel);
+    ASSERT(bidirectional_snapshot_hash_map_t_put_by_secondary(
+                                                &map,
+                                                (void*) 500,
+                                                (void*) 500) == error_sentinel);
+    
+    map.working_map.allocator = allocator;
+    ASSERT(bidirectional_snapshot_hash_map_t_publish(&map));
+    ASSERT(bidirectional_snapshot_hash_map_t_get_version(&map) == version);
+    
+    /***************************************************************
+    * Four readers check every version they fetch while the writer *
+    * re-keys all the keys and publishes a generation at a time.   *
+    ***************************************************************/
+    for (i = 0; i < 4; ++i)
+    {
+        ASSERT(pthread_create(&threads[i],
+                              NULL,
+                              run_snapshot_map_reader,
+                              &map) == 0);
+    }
+    
+    for (generation = 1;
+         generation <= SNAPSHOT_TEST_GENERATIONS;
+         ++generation)
+    {
+        for (key = 1; key <= SNAPSHOT_TEST_KEYS; ++key)
+        {
+            ASSERT(bidirectional_snapshot_hash_map_t_put_by_primary(
+                                            &map,
+                                            (void*) key,
+                                            (void*)(key + generation * 1000))
+                   == (void*)(key + (generation - 1) * 1000));
+        }
+        
+        ASSERT(bidirectional_snapshot_hash_map_t_publish(&map));
+    }
+    
+    for (i = 0; i < 4; ++i)
+    {
+        ASSERT(pthread_join(threads[i], NULL) == 0);
+    }
+    
+    ASSERT(bidirectional_snapshot_hash_map_t_publish(&map));
+    ASSERT(count_retired_versions(&map) == 0);
+    
+    bidirectional_snapshot_hash_map_t_destroy(&map);
+}
+
 int main()
 {
     int i ;
@@ -128,6 +3048,45 @@ int main()
     
     ASSERT(bidirectional_hash_map_iterator_t_has_next(&iterator));
     
+    bidirectional_hash_map_t_destroy(&map);
+    
+    test_fused_mappings(error_sentinel);
+    test_open_hash_map(error_sentinel);
+    test_open_hash_map_tags(error_sentinel);
+    test_avl_hash_map(error_sentinel, primary_key_hasher);
+    test_avl_hash_map(error_sentinel, colliding_key_hasher);
+    test_adaptive_buckets(error_sentinel, 0);
+    test_adaptive_buckets(error_sentinel,
+                          BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS |
+                          BIDIRECTIONAL_HASH_MAP_INCREMENTAL_REHASH);
+    test_incremental_rehash(error_sentinel);
+    test_shrinking(error_sentinel);
+    test_reserve(error_sentinel);
+    test_put_batch(error_sentinel);
+    test_get_batch(error_sentinel);
+    test_remove_batch(error_sentinel);
+    test_mapping_record_slabs(error_sentinel);
+    test_allocator(error_sentinel, 0);
+    test_allocator(error_sentinel, BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    test_frozen_map(error_sentinel, BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS);
+    test_frozen_map(error_sentinel,
+                    BIDIRECTIONAL_HASH_MAP_FUSED_MAPPINGS |
+                    BIDIRECTIONAL_HASH_MAP_MIX_HASHES);
+    test_frozen_map(error_sentinel,
+                    BIDIRECTIONAL_HASH_MAP_SEEDED_HASHES);
+    test_hash_mixing(error_sentinel);
+    test_seeded_hashes(error_sentinel);
+    test_key_functions(error_sentinel);
+    test_inline_keys(error_sentinel);
+    test_static_map();
+    test_typed_map(error_sentinel);
+    test_typed_map_high_bit_keys();
+    test_int_map();
+    test_concurrent_map(error_sentinel);
+    test_concurrent_lookups(error_sentinel);
+    test_snapshot_map(error_sentinel);
+    
+    free(error_sentinel);
     puts("Tests done.");
     return 0;
 }